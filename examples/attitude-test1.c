@@ -0,0 +1,67 @@
+#pragma config(Sensor, S1,     DIMU,           sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * attitude.h fuses gyro and accelerometer data into pitch, roll and yaw.  This program
+ * demonstrates how to use it with a Dexter Industries IMU.
+ *
+ * Define LOG_SAMPLES to write the samples to the debug stream, the lines can be
+ * copied into a file and replayed with host/benchmarks/attitude-replay.c.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+#include "dexterind-imu.h"
+#include "attitude.h"
+
+//#define LOG_SAMPLES
+
+tDIMU dimu;
+tATT att;
+tATTSample sample;
+
+task main(){
+
+  displayCenteredTextLine(0, "Attitude");
+  displayCenteredTextLine(2, "Test 1");
+  displayCenteredTextLine(4, "Connect DIMU");
+  displayCenteredTextLine(5, "to S1, keep it");
+  displayCenteredTextLine(6, "still and level");
+  sleep(2000);
+  eraseDisplay();
+
+  initSensor(&dimu, DIMU);
+  if (!DIMUconfigIMU(&dimu, DIMU_ACC_RANGE_2G, DIMU_GYRO_RANGE_250))
+    playSound(soundException);
+
+  // The Mahony filter copes better with large tilt angles
+  ATTinit(&att, ATT_FILTER_MAHONY);
+
+  while (true)
+  {
+    if (ATTreadDIMU(&dimu, &sample))
+    {
+      ATTupdate(&att, &sample);
+#ifdef LOG_SAMPLES
+      ATTwriteLog(&sample);
+#endif
+    }
+
+    displayTextLine(1, "Pitch: %4.1f", att.pitch);
+    displayTextLine(2, "Roll:  %4.1f", att.roll);
+    displayTextLine(3, "Yaw:   %4.1f", att.yaw);
+    displayTextLine(5, "Bias X: %4.2f", att.bias[0]);
+    displayTextLine(6, "Bias Y: %4.2f", att.bias[1]);
+    displayTextLine(7, "Bias Z: %4.2f", att.bias[2]);
+    sleep(10);
+  }
+}
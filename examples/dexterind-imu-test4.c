@@ -0,0 +1,69 @@
+#pragma config(Sensor, S1,     DIMU,           sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * dexterind-imu.h provides an API for the Dexter Industries IMU Sensor.  This program
+ * demonstrates how to use the gyro's FIFO to integrate the heading from every sample.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to Dexter Industries for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+#include "dexterind-imu.h"
+
+tDIMUGyroBlock block;
+
+task main(){
+  float heading = 0;
+  long samples = 0;
+  short overruns = 0;
+
+  displayCenteredTextLine(0, "Dexter Ind.");
+  displayCenteredBigTextLine(1, "IMU");
+  displayCenteredTextLine(3, "Test 4");
+  displayCenteredTextLine(5, "Connect sensor");
+  displayCenteredTextLine(6, "to S1");
+  sleep(2000);
+  eraseDisplay();
+
+  // Fire up the gyro and initialize it. Only needs to be done once.
+  if(!DIMUconfigGyro(DIMU, DIMU_GYRO_RANGE_250, true))
+    playSound(soundException);
+
+  // From now on the gyro keeps its samples until we fetch them
+  if(!DIMUstartGyroFIFO(DIMU))
+    playSound(soundException);
+
+  while (true) {
+    // The FIFO holds 320ms worth of samples, but draining it takes
+    // almost as long as filling it, so don't wait too long
+    sleep(20);
+
+    if (!DIMUreadGyroFIFO(DIMU, block))
+      continue;
+
+    // Each sample covers one sample period
+    for (short i = 0; i < block.count; i++)
+      heading += inertialToFloat(block.z[i]) * DIMU_GYRO_SAMPLE_TIME / 1000.0;
+
+    samples += block.count;
+    if (block.overrun)
+      overruns++;
+
+    displayTextLine(1, "Heading: %3.1f", heading);
+    displayTextLine(3, "Block:   %d", block.count);
+    displayTextLine(4, "Samples: %d", samples);
+    displayTextLine(5, "Overrun: %d", overruns);
+  }
+}
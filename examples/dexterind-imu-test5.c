@@ -0,0 +1,74 @@
+#pragma config(Sensor, S1,     DIMU1,          sensorI2CCustom)
+#pragma config(Sensor, S2,     DIMU2,          sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * dexterind-imu.h provides an API for the Dexter Industries IMU Sensor.  This program
+ * demonstrates how to use the struct based API to read two IMUs from two tasks.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to Dexter Industries for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+#include "dexterind-imu.h"
+
+// Each IMU has its own buffers, divisors and offsets
+tDIMU dimu1;
+tDIMU dimu2;
+
+task readSecond()
+{
+  while (true)
+  {
+    if (readSensor(&dimu2))
+    {
+      displayTextLine(5, "2: %4.1f %4.1f", inertialToFloat(dimu2.axesGyro[2]), inertialToFloat(dimu2.axesAccel10Bit[2]));
+    }
+    sleep(20);
+  }
+}
+
+task main(){
+
+  displayCenteredTextLine(0, "Dexter Ind.");
+  displayCenteredBigTextLine(1, "IMU");
+  displayCenteredTextLine(3, "Test 5");
+  displayCenteredTextLine(5, "Connect sensors");
+  displayCenteredTextLine(6, "to S1 and S2");
+  sleep(2000);
+  eraseDisplay();
+
+  initSensor(&dimu1, DIMU1);
+  initSensor(&dimu2, DIMU2);
+
+  // Configure and calibrate both, keep them still while this is done
+  if (!DIMUconfigIMU(&dimu1, DIMU_ACC_RANGE_2G, DIMU_GYRO_RANGE_250))
+    playSound(soundException);
+  if (!DIMUconfigIMU(&dimu2, DIMU_ACC_RANGE_2G, DIMU_GYRO_RANGE_500))
+    playSound(soundException);
+
+  displayTextLine(0, "   gyro Z  acc Z");
+
+  startTask(readSecond);
+
+  while (true)
+  {
+    // Gyro and accelerometer, one transaction each
+    if (readSensor(&dimu1))
+    {
+      displayTextLine(3, "1: %4.1f %4.1f", inertialToFloat(dimu1.axesGyro[2]), inertialToFloat(dimu1.axesAccel10Bit[2]));
+    }
+    sleep(20);
+  }
+}
@@ -0,0 +1,71 @@
+#pragma config(Sensor, S1,     HTSMUX,              sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * hitechnic-accelerometer.h provides an API for the HiTechnic Acceleration Sensor.  This program
+ * demonstrates how to use that API with the SMUX poller task, which reads the sensor in
+ * the background so readSensor() doesn't have to wait for the bus.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to HiTechnic for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+// The poller task is opt-in
+#define __HTSMUX_POLLER__ 1
+
+#include "hitechnic-accelerometer.h"
+
+task main () {
+  tHTSMUXSnapshot snapshot;
+
+  displayCenteredTextLine(0, "HiTechnic");
+  displayCenteredBigTextLine(1, "Accel");
+  displayCenteredTextLine(3, "SMUX Poller");
+  displayCenteredTextLine(5, "Connect SMUX to");
+  displayCenteredTextLine(6, "S1 and sensor to");
+  displayCenteredTextLine(7, "SMUX Port 1");
+  sleep(2000);
+
+  // Create struct to hold sensor data
+  tHTAC accelerometer;
+
+  // Initialise and configure struct and port, this has to be done
+  // before the poller is started, it only reads configured channels.
+  initSensor(&accelerometer, msensor_S1_1);
+
+  // Start reading the SMUX in the background
+  HTSMUXstartPoller(HTSMUX);
+
+  while (true) {
+    eraseDisplay();
+
+    // This is now a copy of the poller's latest snapshot
+    if (!readSensor(&accelerometer)) {
+      displayTextLine(4, "ERROR!!");
+      sleep(2000);
+      stopAllTasks();
+    }
+
+    displayTextLine(0,"HTAC Poller");
+    displayTextLine(2, "   X    Y    Z");
+    displayTextLine(3, "%4d %4d %4d", accelerometer.x, accelerometer.y, accelerometer.z);
+
+    // How fresh is the data?
+    if (HTSMUXreadSnapshot(HTSMUX, snapshot)) {
+      displayTextLine(5, "Sweep: %d", snapshot.sequence);
+      displayTextLine(6, "Age:   %d ms", nPgmTime - snapshot.timestamp);
+    }
+    sleep(100);
+  }
+}
@@ -56,7 +56,7 @@ task main () {
       // Start the calibration and display the offset
       sensorCalibrate(&gyroSensor);
 
-      displayTextLine(2, "Offset: %f", gyroSensor.offset);
+      displayTextLine(2, "Offset: %f", inertialToFloat(gyroSensor.offset));
       playSound(soundBlip);
       while(bSoundActive) sleep(1);
       time1[T1] = 0;
@@ -71,11 +71,11 @@ task main () {
       readSensor(&gyroSensor);
 
       // Read the current calibration offset and display it
-      displayTextLine(2, "Offset: %4f", gyroSensor.offset);
+      displayTextLine(2, "Offset: %4f", inertialToFloat(gyroSensor.offset));
 
       displayClearTextLine(4);
       // Read the current rotational speed and display it
-      displayTextLine(4, "Gyro:   %4f", gyroSensor.rotation);
+      displayTextLine(4, "Gyro:   %4f", inertialToFloat(gyroSensor.rotation));
       displayTextLine(6, "Press enter");
       displayTextLine(7, "to recalibrate");
       sleep(100);
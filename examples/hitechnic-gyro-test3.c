@@ -0,0 +1,69 @@
+/**
+ * hitechnic-gyro.h provides an API for the HiTechnic Gyroscopic Sensor.  This program
+ * demonstrates how to keep a heading with the background integrator.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ * - 0.2: The offset is estimated by the integrator instead of calibrated up front
+ *
+ * Credits:
+ * - Big thanks to HiTechnic for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.2
+ */
+
+// The integrator task and the offset estimation are opt-in
+#define __HTGYRO_INTEGRATOR__ 1
+#define __HTGYRO_AUTOCAL__ 1
+
+#include "hitechnic-gyro.h"
+
+task main () {
+  displayTextLine(0, "HT Gyro");
+  displayTextLine(1, "Test 3");
+  displayTextLine(6, "Press enter");
+  displayTextLine(7, "to reset heading");
+
+  sleep(2000);
+  eraseDisplay();
+
+  // Create struct to hold sensor data
+  tHTGYRO gyroSensor;
+
+  // Holds a copy of the integrator's heading, rate and sample timing
+  tHTGYROIntegral integral;
+
+  // Initialise and configure struct and port, start from the default offset
+  initSensor(&gyroSensor, S1);
+  gyroSensor.offset = HTGYRO_DEFAULT_OFFSET;
+
+  // From here on the gyro is sampled every HTGYRO_INT_PERIOD ms,
+  // no matter how long this loop takes.  The offset is worked out
+  // whenever the sensor is kept still, there's no need to calibrate first.
+  HTGYROstartIntegrator(&gyroSensor, HTGYRO_INT_DEADBAND, true);
+
+  while(true) {
+    if (getXbuttonValue(xButtonEnter)) {
+      HTGYROresetIntegrator(&gyroSensor);
+      while(getXbuttonValue(xButtonEnter)) sleep(1);
+    }
+
+    if (HTGYROreadIntegral(&gyroSensor, integral)) {
+      displayTextLine(0, "Dropped: %ld", integral.dropped);
+      displayTextLine(1, "Head: %6.1f", integral.heading);
+      displayTextLine(2, "Rate: %6.1f", inertialToFloat(integral.rate));
+      displayTextLine(3, "Offset: %6.1f", inertialToFloat(integral.offset));
+      displayTextLine(4, "Samples: %ld", integral.samples);
+      displayTextLine(5, "Period: %d-%d", integral.periodMin, integral.periodMax);
+      displayTextLine(6, "Mean:   %4.2f", integral.periodMean);
+      displayTextLine(7, "Jitter: %4.2f", integral.periodJitter);
+    }
+    sleep(100);
+  }
+}
@@ -0,0 +1,52 @@
+#pragma config(Sensor, S1,     HTSMUX,              sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * hitechnic-sensormux.h provides an API for the HiTechnic Sensor MUX.  This program
+ * scans the SMUX for attached sensors and shows what it found.  The second time it
+ * is run, the saved scan results are reused and the scan is a lot quicker.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+#include "hitechnic-sensormux.h"
+
+task main () {
+  string sensorName;
+
+  displayCenteredTextLine(0, "HiTechnic");
+  displayCenteredBigTextLine(1, "SMUX");
+  displayCenteredTextLine(3, "Scan Test");
+  displayCenteredTextLine(5, "Connect SMUX to");
+  displayCenteredTextLine(6, "S1, press enter");
+  displayCenteredTextLine(7, "to force a scan");
+  sleep(2000);
+
+  eraseDisplay();
+
+  // Scan the SMUX, or reuse the results from the last time
+  if (!HTSMUXscanPorts(HTSMUX, getXbuttonValue(xButtonEnter))) {
+    displayTextLine(4, "ERROR!!");
+    sleep(2000);
+    stopAllTasks();
+  }
+
+  for (short i = 0; i < 4; i++) {
+    HTSMUXsensorTypeToString(HTSMUXreadSensorType((tMUXSensor)(msensor_S1_1 + i)), sensorName);
+    displayTextLine(i, "%d: %s", i + 1, sensorName);
+  }
+
+  displayTextLine(5, "%s", HTSMUXdata[HTSMUX].scanReused ? "Saved results" : "Full scan");
+  displayTextLine(6, "Took %d ms", HTSMUXdata[HTSMUX].scanTime);
+
+  while (true) sleep(100);
+}
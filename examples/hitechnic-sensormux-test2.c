@@ -0,0 +1,70 @@
+#pragma config(Sensor, S1,     HTSMUX1,             sensorI2CCustom)
+#pragma config(Sensor, S2,     HTSMUX2,             sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * hitechnic-sensormux.h provides an API for the HiTechnic Sensor MUX.  This program
+ * reads the analogue channels of two SMUXes, each from its own task.  Every task
+ * has its own tHTSMUX struct, so neither has to wait for the other.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+#include "hitechnic-sensormux.h"
+
+tHTSMUXAnalogue values1;
+tHTSMUXAnalogue values2;
+
+task readMUX2 () {
+  tHTSMUX smux2;
+
+  initSensor(&smux2, HTSMUX2);
+  HTSMUXscanPorts(&smux2);
+
+  while (true) {
+    HTSMUXreadAllAnalogue(&smux2, values2);
+    sleep(20);
+  }
+}
+
+task main () {
+  tHTSMUX smux1;
+
+  displayCenteredTextLine(0, "HiTechnic");
+  displayCenteredBigTextLine(1, "SMUX");
+  displayCenteredTextLine(3, "Two SMUX Test");
+  displayCenteredTextLine(5, "Connect SMUXes");
+  displayCenteredTextLine(6, "to S1 and S2");
+  sleep(2000);
+
+  eraseDisplay();
+
+  // Find out which channels have analogue sensors
+  initSensor(&smux1, HTSMUX1);
+  HTSMUXscanPorts(&smux1);
+  startTask(readMUX2);
+
+  while (true) {
+    if (!HTSMUXreadAllAnalogue(&smux1, values1)) {
+      displayTextLine(4, "ERROR!!");
+      sleep(2000);
+      stopAllTasks();
+    }
+
+    displayTextLine(0, "S1 %4d %4d", values1[0], values1[1]);
+    displayTextLine(1, "   %4d %4d", values1[2], values1[3]);
+    displayTextLine(3, "S2 %4d %4d", values2[0], values2[1]);
+    displayTextLine(4, "   %4d %4d", values2[2], values2[3]);
+    displayTextLine(6, "skipped %d", smux1.commandsSkipped);
+    sleep(20);
+  }
+}
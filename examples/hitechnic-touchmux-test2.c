@@ -0,0 +1,61 @@
+#pragma config(Sensor, S1,     HTTMUX,              sensorAnalogInactive)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * hitechnic-touchmux.h provides an API for the HiTechnic Touch Sensor MUX.  This program
+ * demonstrates how to use the sampler and its event queue, so no presses are missed
+ * while the program is busy.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to HiTechnic for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+// The sampler task is opt-in
+#define __HTTMUX_SAMPLER__ 1
+
+#include "hitechnic-touchmux.h"
+
+task main () {
+  tHTTMUX touchMUX;
+  tHTTMUXEvent event;
+  short presses[4] = {0, 0, 0, 0};
+
+  displayCenteredTextLine(0, "HiTechnic");
+  displayCenteredBigTextLine(1, "TMUX");
+  displayCenteredTextLine(3, "Test 2");
+  displayCenteredTextLine(5, "This is for the");
+  displayCenteredTextLine(6, "Touch MUX");
+  sleep(2000);
+  eraseDisplay();
+
+  initSensor(&touchMUX, HTTMUX);
+
+  // Sample the switches in the background
+  HTTMUXstartSampler(&touchMUX);
+
+  while (true) {
+    // Count every press, even the ones that were over before we got here
+    while (HTTMUXreadEvent(&touchMUX, event)) {
+      if (event.pressed)
+        presses[event.touch - 1]++;
+    }
+
+    for (short i = 0; i < 4; i++)
+      displayTextLine(i + 1, "Touch %d: %d", i + 1, presses[i]);
+    displayTextLine(6, "Lost: %d", HTTMUXsamplers[HTTMUX].lost);
+
+    // Pretend to be busy
+    sleep(500);
+  }
+}
@@ -0,0 +1,50 @@
+#pragma config(Sensor, S1,     HTSMUX,              sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * lego-touch.h provides an API for the Lego Touch Sensor.  This program
+ * demonstrates how to read the touch sensors on all four SMUX channels
+ * at once.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+#include "hitechnic-sensormux.h"
+#include "lego-touch.h"
+
+task main() {
+  ubyte states;
+
+  displayCenteredTextLine(0, "Lego");
+  displayCenteredBigTextLine(1, "TOUCH");
+  displayCenteredTextLine(3, "SMUX Test");
+  displayCenteredTextLine(5, "Connect SMUX to");
+  displayCenteredTextLine(6, "S1 and sensors to");
+  displayCenteredTextLine(7, "SMUX Port 1 - 4");
+  sleep(2000);
+
+  eraseDisplay();
+
+  while (true) {
+    // Read all four channels with a single I2C transaction.
+    // Bit 0 is channel 1, bit 1 is channel 2, etc.
+    states = TSreadAllStates(HTSMUX);
+
+    for (short i = 0; i < 4; i++) {
+      if (states & (1 << i))
+        displayTextLine(i + 2, "Port %d: ACTIVE", i + 1);
+      else
+        displayTextLine(i + 2, "Port %d: INACTIVE", i + 1);
+    }
+    sleep(50);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma config(Sensor, S1,     EV3SMUX,        sensorEV3_GenericI2C)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+#include "mindsensors-ev3smux.h"
+
+/**
+ * mindsensors-ev3smux.h provides an API for the Mindsensors EV3 Sensor MUX.  This
+ * program sets up all three channels in one go and reads them with MSEV3readAll().
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ */
+
+// All three channels of the SMUX
+tMSEV3SMUX smux;
+
+task main()
+{
+  long start;
+
+  displayCenteredTextLine(0, "Mindsensors");
+  displayCenteredBigTextLine(1, "EV3 SMUX");
+  displayCenteredTextLine(3, "Test 2");
+  sleep(2000);
+  eraseDisplay();
+
+  // Use noSensor for a channel with nothing attached
+  if (!initSensor(&smux, EV3SMUX, touchStateBump, sonarCM, colorReflectedLight))
+    writeDebugStreamLine("initSensor() failed!");
+
+  while (true)
+  {
+    start = nPgmTime;
+    if (!MSEV3readAll(&smux))
+      writeDebugStreamLine("MSEV3readAll() failed!");
+
+    displayTextLine(0, "Touch: %s, Bumps: %d", smux.chan[0].touch ? "yes" : "no ", smux.chan[0].bumpCount);
+    displayTextLine(2, "Distance: %d", smux.chan[1].distance);
+    displayTextLine(4, "Light: %d", smux.chan[2].light);
+    displayTextLine(6, "Read took %d ms", nPgmTime - start);
+    sleep(100);
+  }
+}
@@ -0,0 +1,62 @@
+#pragma config(Sensor, S1,     MSRXMUX,             sensorI2CCustom9V)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * mindsensors-rcxsensorsmux.h provides an API for the Mindsensors RCX Sensor MUX Sensor.  This program
+ * demonstrates how to use the scan scheduler, which switches between the channels in the background.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+// The scan scheduler task is opt-in
+#define __MSRXMUX_SCHEDULER__ 1
+
+#include "mindsensors-rcxsensorsmux.h"
+
+task main () {
+  short value;
+  long timestamp;
+
+  displayCenteredTextLine(0, "Mindsensors");
+  displayCenteredBigTextLine(1, "RXMUX");
+  displayCenteredTextLine(3, "Test 2");
+
+  sleep(2000);
+  eraseDisplay();
+
+  // Set up channels 1 and 2 on the RCX sensor MUX for light sensors in percentage mode
+  MSRXMUXsetupChan(MSRXMUX, 1, sensorReflection, modePercentage, 5);
+  MSRXMUXsetupChan(MSRXMUX, 2, sensorReflection, modePercentage, 5);
+
+  // Set up channel 4 on the RCX sensor MUX to a touch sensor in raw mode
+  MSRXMUXsetupChan(MSRXMUX, 4, sensorTouch, modeRaw, 5);
+
+  // The scheduler cycles through these channels in the background
+  MSRXMUXsubscribe(MSRXMUX, 1);
+  MSRXMUXsubscribe(MSRXMUX, 2);
+  MSRXMUXsubscribe(MSRXMUX, 4);
+
+  while(true) {
+    // Reading the latest values doesn't wait for the MUX
+    for (short chan = 1; chan <= 4; chan++) {
+      if (MSRXMUXreadCached(MSRXMUX, chan, value, timestamp))
+        displayTextLine(chan - 1, "%d: %4d (%4d ms)", chan, value, nPgmTime - timestamp);
+      else
+        displayTextLine(chan - 1, "%d: ----", chan);
+    }
+    displayTextLine(5, "Cycle: %d ms", MSRXMUXcycleTime[MSRXMUX]);
+    sleep(50);
+  }
+}
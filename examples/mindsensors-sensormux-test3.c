@@ -0,0 +1,64 @@
+#pragma config(Sensor, S1,     MSSMUX,         sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * mindsensors-sensormux.h provides an API for the Mindsensors SensorMUX Sensor.
+ * This program demonstrates how to use the scan scheduler, which switches between
+ * the channels in the background.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * Credits:
+ * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
+ *
+ * License: You may use this code as you wish, provided you give credit where it's due.
+ *
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ * Xander Soldaat (xander_at_botbench.com)
+ * 17 October 2026
+ * version 0.1
+ */
+
+// The scan scheduler task is opt-in
+#define __MSSMUX_SCHEDULER__ 1
+
+#include "mindsensors-sensormux.h"
+
+task main()
+{
+  short value;
+  long timestamp;
+
+  displayCenteredTextLine(0, "Mindsensors");
+  displayCenteredBigTextLine(1, "SnsrMUX");
+  displayCenteredTextLine(3, "Test 3");
+  displayCenteredTextLine(5, "Connect LEGO");
+  displayCenteredTextLine(6, "Light Sensors");
+  displayCenteredTextLine(7, "to ports 1-4");
+
+  sleep(2000);
+  eraseDisplay();
+
+  // Set up all four channels and let the scheduler cycle through them
+  for (short channel = 1; channel <= 4; channel++)
+  {
+    MSSMUXsetupChan(MSSMUX, channel, sensorLightActive, modePercentage, 0);
+    MSSMUXsubscribe(MSSMUX, channel);
+  }
+
+  while(true)
+  {
+    // Reading the latest values doesn't wait for the SMUX
+    for (short channel = 1; channel <= 4; channel++)
+    {
+      if (MSSMUXreadCached(MSSMUX, channel, value, timestamp))
+        displayTextLine(channel - 1, "%d: %3d (%4d ms)", channel, value, nPgmTime - timestamp);
+      else
+        displayTextLine(channel - 1, "%d: ---", channel);
+    }
+    displayTextLine(5, "Cycle: %d ms", MSSMUXcycleTime[MSSMUX]);
+    sleep(50);
+  }
+}
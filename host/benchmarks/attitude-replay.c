@@ -0,0 +1,173 @@
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * attitude-replay.c
+ * Runs the attitude.h filters over a log of samples on the host and reports how
+ * well and how fast they did.
+ *
+ * Without a log a 60 second run is made up: the sensor tilts and turns, the gyro has
+ * a bias and noise and the accelerometer sees some bumps.  The errors are measured
+ * against the made up attitude.  With a log, the lines written by ATTwriteLog() are
+ * replayed and the final attitude and bias estimates are shown.
+ *
+ * Build and run it with:
+ * \code
+ * scripts/host-build.sh host/benchmarks/attitude-replay.c attitude-replay && ./attitude-replay
+ * ATT_LOG=robot.log ./attitude-replay
+ * \endcode
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#include <chrono>
+#include <vector>
+#include "attitude.h"
+
+#define SIM_TIME      60000   // ms
+#define SIM_PERIOD    10      // ms between samples
+
+std::vector<tATTSample> samples;
+std::vector<float> truthRoll, truthPitch, truthYaw;
+
+const float simBias[3] = {0.5, -0.3, 0.8};
+
+/*
+ * Gaussian noise, Box-Muller on a fixed seed so runs can be compared
+ */
+float noise(float sigma)
+{
+  float u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  float u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sigma * sqrt(-2.0 * log(u1)) * cos(2 * PI * u2);
+}
+
+/*
+ * Make up a run.  The Euler angles are smooth functions of time, the body rates
+ * and the direction of gravity follow from them.
+ */
+void simulate()
+{
+  srand(1);
+  for (long t = 0; t <= SIM_TIME; t += SIM_PERIOD)
+  {
+    float s = t / 1000.0;
+    float roll = 30 * sin(0.5 * s);
+    float pitch = 20 * sin(0.3 * s + 1);
+    float yaw = 45 * s;
+    float droll = 30 * 0.5 * cos(0.5 * s);
+    float dpitch = 20 * 0.3 * cos(0.3 * s + 1);
+    float dyaw = 45;
+    float sr = sinDegrees(roll), cr = cosDegrees(roll);
+    float sp = sinDegrees(pitch), cp = cosDegrees(pitch);
+    tATTSample sample;
+
+    sample.timestamp = t;
+    sample.gyro[0] = droll - (dyaw * sp) + simBias[0] + noise(0.3);
+    sample.gyro[1] = (dpitch * cr) + (dyaw * cp * sr) + simBias[1] + noise(0.3);
+    sample.gyro[2] = -(dpitch * sr) + (dyaw * cp * cr) + simBias[2] + noise(0.3);
+    sample.accel[0] = -sp + noise(0.02);
+    sample.accel[1] = sr * cp + noise(0.02);
+    sample.accel[2] = cr * cp + noise(0.02);
+    sample.hasAccel = true;
+
+    // A bump every 5 seconds
+    if ((t % 5000) < 200)
+      sample.accel[0] += 0.4;
+
+    samples.push_back(sample);
+    truthRoll.push_back(roll);
+    truthPitch.push_back(pitch);
+    truthYaw.push_back(yaw);
+  }
+}
+
+/*
+ * Load the lines written by ATTwriteLog(), anything else is skipped
+ */
+bool load(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  char line[256];
+
+  if (f == NULL)
+    return false;
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    tATTSample sample;
+    long t;
+    int n = sscanf(line, "%ld,%f,%f,%f,%f,%f,%f", &t, &sample.gyro[0], &sample.gyro[1], &sample.gyro[2],
+                   &sample.accel[0], &sample.accel[1], &sample.accel[2]);
+    if (n != 4 && n != 7)
+      continue;
+    sample.timestamp = t;
+    sample.hasAccel = (n == 7);
+    samples.push_back(sample);
+  }
+  fclose(f);
+  return true;
+}
+
+void run(const char *name, ubyte filter)
+{
+  tATT att;
+  float errRoll = 0, errPitch = 0, errYaw = 0;
+  long compared = 0;
+
+  ATTinit(&att, filter);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    ATTupdate(&att, &samples[i]);
+
+    // Skip the first second, the filters need to settle
+    if (!truthRoll.empty() && samples[i].timestamp >= 1000)
+    {
+      errRoll += pow(_ATTwrap(att.roll - truthRoll[i]), 2);
+      errPitch += pow(att.pitch - truthPitch[i], 2);
+      errYaw += pow(att.yaw - truthYaw[i], 2);
+      compared++;
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%-14s %8ld %10.1f", name, att.updates, (float)elapsed / samples.size());
+  if (compared > 0)
+    printf(" %8.2f %8.2f %8.2f", sqrt(errRoll / compared), sqrt(errPitch / compared), sqrt(errYaw / compared));
+  else
+    printf(" %8.2f %8.2f %8.2f", att.roll, att.pitch, att.yaw);
+  printf("   %6.2f %6.2f %6.2f  rejected %ld gaps %ld\n", att.bias[0], att.bias[1], att.bias[2], att.accelRejected, att.gaps);
+}
+
+task main()
+{
+  const char *path = getenv("ATT_LOG");
+
+  if (path != NULL)
+  {
+    if (!load(path))
+    {
+      printf("Can't read %s\n", path);
+      return;
+    }
+    printf("%s: %d samples\n", path, (int)samples.size());
+    printf("%-14s %8s %10s %8s %8s %8s   %20s\n", "filter", "updates", "ns/update", "roll", "pitch", "yaw", "bias x, y, z (dps)");
+  }
+  else
+  {
+    simulate();
+    printf("Simulated %d samples, gyro bias %.2f %.2f %.2f dps\n", (int)samples.size(), simBias[0], simBias[1], simBias[2]);
+    printf("%-14s %8s %10s %8s %8s %8s   %20s\n", "filter", "updates", "ns/update", "rms roll", "pitch", "yaw", "bias x, y, z (dps)");
+  }
+
+  run("complementary", ATT_FILTER_COMPLEMENTARY);
+  run("mahony", ATT_FILTER_MAHONY);
+}
@@ -0,0 +1,199 @@
+#pragma config(Sensor, S1,     DGPS,                sensorI2CCustom)
+#pragma config(Sensor, S2,     HTAC,                sensorI2CCustom)
+#pragma config(Sensor, S3,     DIMU,                sensorI2CCustom)
+#pragma config(Sensor, S4,     HTSMUX,              sensorI2CCustom)
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * driver-latency.c
+ * Measures the cost of a single read call for a number of drivers on the host-side
+ * emulation: the number of I2C transactions and bytes, and the virtual time.
+ *
+ * Build and run it with:
+ * \code
+ * scripts/host-build.sh host/benchmarks/driver-latency.c driver-latency && ./driver-latency
+ * \endcode
+ *
+ * The sensor type check in startI2C() costs no virtual time, so it is timed on its own
+ * in host CPU time at the end.  A whole emulated transaction takes close to a ms of host
+ * CPU and varies by 20% between runs, which hides a difference of a few ns.  Building
+ * with -D__COMMON_H_SENSOR_CHECK__=0 leaves the check, and this part, out.  The NXT
+ * runs the check as interpreted byte code, so the host only shows how the cached check
+ * compares to the full one, not what either costs on a brick.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ * - 0.2: Added the host CPU time of the sensor type check in startI2C()
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.2
+ */
+
+#include <chrono>
+
+// The SMUX poller is opt-in and needs the bus ownership in common.h
+#define __HTSMUX_POLLER__ 1
+#define __COMMON_H_I2C_ARBITRATION__ 1
+
+#include "dexterind-gps.h"
+#include "hitechnic-accelerometer.h"
+#include "dexterind-imu.h"
+#include "hitechnic-sensormux.h"
+#include "lego-touch.h"
+#include "hitechnic-gyro.h"
+#include "mindsensors-ev3smux.h"
+
+// The SMUX channels used
+const tMUXSensor LEGOTOUCH = msensor_S4_1;
+const tMUXSensor LEGOLIGHT = msensor_S4_2;
+const tMUXSensor HTACMUX = msensor_S4_3;
+
+#define BENCH_CALLS 100
+#define CHECK_CALLS 1000000   // sensor type checks per measurement, timed in host CPU time
+
+robotc::RegMapDevice gpsModel;
+robotc::RegMapDevice htacModel;
+robotc::RegMapDevice dimuAccelModel;
+robotc::RegMapDevice dimuGyroModel;
+robotc::RegMapDevice smuxModel;
+robotc::RegMapDevice ev3smuxModel[3];
+
+void hostSetup()
+{
+  gpsModel.setBE16(DGPS_CMD_LAT, 0x02FA);
+  robotc::attachI2C(DGPS, DGPS_I2C_ADDR, &gpsModel);
+
+  htacModel.regs[0x42] = 0x10;
+  robotc::attachI2C(HTAC, HTAC_I2C_ADDR, &htacModel);
+
+  // The L3G4200D only auto-increments when bit 7 of the register address is set
+  dimuGyroModel.autoIncFlag = 0x80;
+  dimuAccelModel.setLE16(DIMU_ACC_X_AXIS, 64);
+  robotc::attachI2C(DIMU, DIMU_ACC_I2C_ADDR, &dimuAccelModel);
+  robotc::attachI2C(DIMU, DIMU_GYRO_I2C_ADDR, &dimuGyroModel);
+
+  smuxModel.setBE16(HTSMUX_ANALOG, 0x0102);
+  smuxModel.regs[HTSMUX_I2C_BUF + (2 * HTSMUX_BF_ENTRY_SIZE)] = 0x10;
+
+  // Commands change the status register, a scan finds analogue sensors on
+  // channels 1 and 2 and an accelerometer on channel 3
+  smuxModel.onWrite = [](robotc::RegMapDevice &dev, ubyte reg, ubyte value) {
+    if (reg != HTSMUX_COMMAND)
+      return;
+    dev.regs[HTSMUX_STATUS] = (value == HTSMUX_CMD_RUN) ? HTSMUX_STAT_NORMAL : HTSMUX_STAT_HALT;
+    if (value != HTSMUX_CMD_AUTODETECT)
+      return;
+    ubyte detected[4][5] = {{HTSMUX_CHAN_NONE, HTSMUXAnalogue, 0, 0, 0},
+                            {HTSMUX_CHAN_NONE, HTSMUXAnalogue, 0, 0, 0},
+                            {HTSMUX_CHAN_I2C, HTSMUXAccel, 6, 0x02, 0x42},
+                            {HTSMUX_CHAN_NONE, HTSMUXSensorNone, 0, 0, 0}};
+    memcpy(&dev.regs[HTSMUX_CH_OFFSET], detected, sizeof(detected));
+  };
+  robotc::attachI2C(HTSMUX, HTSMUX_I2C_ADDR, &smuxModel);
+
+  // The EV3 SMUX shares S1 with the GPS, each channel has its own address
+  ev3smuxModel[1].setLE16(MSEV3_DATA_REG, 42);
+  robotc::attachI2C(DGPS, MSEV3_I2C_ADDR_CHAN1, &ev3smuxModel[0]);
+  robotc::attachI2C(DGPS, MSEV3_I2C_ADDR_CHAN2, &ev3smuxModel[1]);
+  robotc::attachI2C(DGPS, MSEV3_I2C_ADDR_CHAN3, &ev3smuxModel[2]);
+}
+
+/*
+ * Print one line of results, the bus counters are the emulation's own
+ */
+void report(const char *name, tSensors link, long long start)
+{
+  robotc::BusStats &s = robotc::ports[link].stats;
+  printf("%-28s %8.2f %8.2f %8.2f %10.3f\n", name,
+         (float)s.transactions / BENCH_CALLS,
+         (float)s.bytesSent / BENCH_CALLS,
+         (float)s.bytesReceived / BENCH_CALLS,
+         (robotc::now - start) / 1000.0 / BENCH_CALLS);
+}
+
+#define BENCH(NAME, LINK, CALL) \
+  { \
+    robotc::resetBusStats(); \
+    long long start = robotc::now; \
+    for (short i = 0; i < BENCH_CALLS; i++) { CALL; } \
+    report(NAME, LINK, start); \
+  }
+
+#define BENCH_CPU(NAME, CALLS, CALL) \
+  { \
+    auto start = std::chrono::steady_clock::now(); \
+    for (long i = 0; i < CALLS; i++) { CALL; } \
+    long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(); \
+    printf("%-28s %10.2f ns\n", NAME, (float)elapsed / CALLS); \
+  }
+
+task main()
+{
+  tHTAC htac;
+  tHTAC htacMux;
+  tHTSMUXSnapshot snapshot;
+  tHTGYRORotations rotations;
+  tMSEV3 ev3chan[3];
+  tMSEV3SMUX ev3smux;
+  float x, y, z;
+
+  initSensor(&htac, HTAC);
+  DIMUconfigAccel(DIMU, DIMU_ACC_RANGE_2G);
+  DIMUconfigGyro(DIMU, DIMU_GYRO_RANGE_250);
+
+  printf("%-28s %8s %8s %8s %10s\n", "call", "xfers", "out", "in", "ms");
+
+  BENCH("DGPSreadLatitude", DGPS, DGPSreadLatitude(DGPS));
+  BENCH("readSensor(tHTACPtr)", HTAC, readSensor(&htac));
+  BENCH("DIMUreadAccelAxes8Bit", DIMU, DIMUreadAccelAxes8Bit(DIMU, x, y, z));
+  BENCH("DIMUreadAccelAxes10Bit", DIMU, DIMUreadAccelAxes10Bit(DIMU, x, y, z));
+  BENCH("DIMUreadGyroAxes", DIMU, DIMUreadGyroAxes(DIMU, x, y, z));
+
+  initSensor(&ev3chan[0], msensor_S1_1, touchStateBump);
+  initSensor(&ev3chan[1], msensor_S1_2, sonarCM);
+  initSensor(&ev3chan[2], msensor_S1_3, colorReflectedLight);
+  initSensor(&ev3smux, DGPS, touchStateBump, sonarCM, colorReflectedLight);
+  BENCH("readSensor(tMSEV3Ptr) x3", DGPS, for (short c = 0; c < 3; c++) readSensor(&ev3chan[c]));
+  BENCH("MSEV3readAll", DGPS, MSEV3readAll(&ev3smux));
+  BENCH("TSreadState(tMUXSensor)", HTSMUX, TSreadState(LEGOTOUCH));
+  BENCH("HTSMUXsetAnalogueActive", HTSMUX, HTSMUXsetAnalogueActive(LEGOLIGHT));
+  BENCH("HTGYROreadRot(tMUXSensor) x4", HTSMUX, for (short c = 0; c < 4; c++) HTGYROreadRot((tMUXSensor)(msensor_S4_1 + c)));
+  BENCH("HTGYROreadAllRot", HTSMUX, HTGYROreadAllRot(HTSMUX, rotations));
+
+  // Channel 3 is an accelerometer from here on, channels 1, 2 and 4 stay analogue
+  initSensor(&htacMux, HTACMUX);
+  BENCH("readSensor(tHTACPtr) SMUX", HTSMUX, readSensor(&htacMux));
+
+  // Reads are served from the poller's snapshot, the loops don't yield so
+  // the poller doesn't run while they are measured
+  HTSMUXstartPoller(HTSMUX);
+  sleep(100);
+  BENCH("readSensor(tHTACPtr) poller", HTSMUX, readSensor(&htacMux));
+  BENCH("TSreadState() poller", HTSMUX, TSreadState(LEGOTOUCH));
+  HTSMUXreadSnapshot(HTSMUX, snapshot);
+  printf("HTSMUX poller sweep: %d transactions, accel x %d\n", snapshot.transactions, htacMux.x);
+  HTSMUXstopPoller(HTSMUX);
+
+  // Scan the SMUX without saved results, then again as if the program was restarted
+  TFileIOResult nIoResult;
+  Delete(HTSMUXDAT, nIoResult);
+  HTSMUXscanRecordsLoaded = false;
+  HTSMUXscanPorts(HTSMUX);
+  printf("HTSMUXscanPorts: full scan %ld ms", HTSMUXdata[HTSMUX].scanTime);
+  HTSMUXscanRecordsLoaded = false;
+  HTSMUXscanPorts(HTSMUX);
+  printf(", with saved results %ld ms (%s)\n", HTSMUXdata[HTSMUX].scanTime, HTSMUXdata[HTSMUX].scanReused ? "reused" : "scanned");
+  Delete(HTSMUXDAT, nIoResult);
+
+#if (__COMMON_H_SENSOR_CHECK__ == 1)
+  // The check on its own: the full switch every time, as before the type was cached,
+  // against the compare startI2C() does now
+  volatile short port = HTAC;
+  BENCH_CPU("full check per xfer", CHECK_CALLS, _I2CcheckSensorType((tSensors)port));
+  BENCH_CPU("cached check per xfer", CHECK_CALLS,
+    if (SensorType[port] != I2CPortCheckedType[port]) _I2CcheckSensorType((tSensors)port));
+#endif // __COMMON_H_SENSOR_CHECK__
+}
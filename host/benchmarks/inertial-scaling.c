@@ -0,0 +1,126 @@
+//*!!Code automatically generated by 'ROBOTC' configuration wizard               !!*//
+
+/**
+ * inertial-scaling.c
+ * Measures how long the inertial drivers take to turn raw register values into
+ * degrees per second and G, without any I2C in the way.  The same made up
+ * register dumps are scaled with the float and the Q16.16 versions of the drivers,
+ * see math-fixed.h.  Build it once for each and compare the ns/sample columns.
+ *
+ * The host has an FPU, on the NXT every float operation is a library call, so the
+ * difference there is bigger than the one measured here.  The checksums show the
+ * two builds agree.
+ *
+ * Build and run it with:
+ * \code
+ * scripts/host-build.sh host/benchmarks/inertial-scaling.c inertial-float && ./inertial-float
+ * scripts/host-build.sh host/benchmarks/inertial-scaling.c inertial-fixed -D__INERTIAL_FIXED__=1 && ./inertial-fixed
+ * \endcode
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#include <chrono>
+#include "dexterind-imu.h"
+#include "hitechnic-gyro.h"
+
+#define BENCH_SAMPLES   4096    // register dumps per pass
+#define BENCH_PASSES    200
+
+ubyte gyroRegs[BENCH_SAMPLES][6];
+ubyte accelRegs[BENCH_SAMPLES][6];
+short htgyroRaw[BENCH_SAMPLES];
+tInertial results[BENCH_SAMPLES];
+float floatResults[BENCH_SAMPLES];
+
+/*
+ * Fill the register dumps, fixed seed so runs can be compared
+ */
+void makeSamples()
+{
+  srand(1);
+  for (long i = 0; i < BENCH_SAMPLES; i++)
+  {
+    for (short j = 0; j < 6; j++)
+    {
+      gyroRegs[i][j] = rand() & 0xFF;
+      accelRegs[i][j] = (j & 1) ? (rand() & 0x03) : (rand() & 0xFF);
+    }
+    htgyroRaw[i] = 400 + (rand() % 440);
+  }
+}
+
+/*
+ * Print one line of results, the checksum is the mean of the last pass's
+ * results and is worked out after the clock has stopped
+ */
+void report(const char *name, long long elapsed, bool floats)
+{
+  float checksum = 0;
+  for (long i = 0; i < BENCH_SAMPLES; i++)
+    checksum += floats ? floatResults[i] : inertialToFloat(results[i]);
+  printf("%-26s %10.2f %14.4f\n", name, (float)elapsed / ((long long)BENCH_SAMPLES * BENCH_PASSES), checksum / BENCH_SAMPLES);
+}
+
+#define BENCH(NAME, FLOATS, BODY) \
+  { \
+    auto start = std::chrono::steady_clock::now(); \
+    for (short pass = 0; pass < BENCH_PASSES; pass++) \
+      for (long i = 0; i < BENCH_SAMPLES; i++) { BODY; } \
+    long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(); \
+    report(NAME, elapsed, FLOATS); \
+  }
+
+task main()
+{
+  tInertial gyroDivisor = _DIMUgyroDivisor(DIMU_GYRO_RANGE_500);
+  tInertial gyroOffset = inertialFromFloat(1.25);
+  tInertial accelScale = _DIMUaccelScale(DIMU_ACC_RANGE_2G);
+  tInertial htgyroOffset = HTGYRO_DEFAULT_OFFSET;
+  tInertial sum;
+  float x, y, z;
+
+  makeSamples();
+
+  printf("tInertial is %s\n", (__INERTIAL_FIXED__ == 1) ? "Q16.16 fixed point" : "float");
+  printf("%-26s %10s %14s\n", "path", "ns/sample", "checksum");
+
+  // Scaling only, the values stay a tInertial as in the struct API
+  BENCH("DIMU gyro, 3 axes", false, {
+    sum = _DIMUgyroValue(gyroRegs[i][0], gyroRegs[i][1], gyroDivisor, gyroOffset);
+    sum += _DIMUgyroValue(gyroRegs[i][2], gyroRegs[i][3], gyroDivisor, gyroOffset);
+    sum += _DIMUgyroValue(gyroRegs[i][4], gyroRegs[i][5], gyroDivisor, gyroOffset);
+    results[i] = sum;
+  });
+  BENCH("DIMU accel 10 bit, 3 axes", false, {
+    sum = _DIMUaccel10Bit(accelRegs[i][0], accelRegs[i][1]) * DIMU_ACC_10BIT_SCALE;
+    sum += _DIMUaccel10Bit(accelRegs[i][2], accelRegs[i][3]) * DIMU_ACC_10BIT_SCALE;
+    sum += _DIMUaccel10Bit(accelRegs[i][4], accelRegs[i][5]) * DIMU_ACC_10BIT_SCALE;
+    results[i] = sum;
+  });
+  BENCH("DIMU accel 8 bit, 3 axes", false, {
+    sum = (char)accelRegs[i][0] * accelScale;
+    sum += (char)accelRegs[i][2] * accelScale;
+    sum += (char)accelRegs[i][4] * accelScale;
+    results[i] = sum;
+  });
+  BENCH("HTGYRO rotation", false, {
+    sum = inertialFromInt(htgyroRaw[i]) - htgyroOffset;
+    results[i] = sum;
+  });
+
+  // Every axis turned into a float, as the float API does
+  BENCH("DIMU gyro, float API", true, {
+    x = inertialToFloat(_DIMUgyroValue(gyroRegs[i][0], gyroRegs[i][1], gyroDivisor, gyroOffset));
+    y = inertialToFloat(_DIMUgyroValue(gyroRegs[i][2], gyroRegs[i][3], gyroDivisor, gyroOffset));
+    z = inertialToFloat(_DIMUgyroValue(gyroRegs[i][4], gyroRegs[i][5], gyroDivisor, gyroOffset));
+    floatResults[i] = x + y + z;
+  });
+}
@@ -0,0 +1 @@
+// Host-side stand-in for the ROBOTC firmwareVersion.h, the version is set in robotc.h
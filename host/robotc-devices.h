@@ -0,0 +1,276 @@
+/** \file robotc-devices.h
+ * \brief Virtual I2C bus and device models for the host-side ROBOTC emulation
+ *
+ * Each sensor port has a virtual I2C bus with a simple timing model: a transaction
+ * costs a fixed setup overhead plus a per-byte time for every byte sent and received.
+ * Ports configured as one of the sensorI2CCustomFast types use the fast byte time.
+ * The defaults approximate the NXT firmware's software I2C master.
+ *
+ * Devices are attached to a port at an 8 bit I2C address.  RegMapDevice covers most
+ * sensors: a 256 byte register map with an auto-incrementing register pointer, an
+ * optional update hook that is called before every read, and a script of timed
+ * register writes that can be loaded from a text file:
+ * \code
+ * # time(ms) register value
+ * 0    0x42 0x10
+ * 500  0x42 0x20
+ * \endcode
+ *
+ * Analogue sensors are modelled with a function of virtual time, see
+ * robotc::attachAnalog().
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#ifndef __ROBOTC_HOST_DEVICES_H__
+#define __ROBOTC_HOST_DEVICES_H__
+
+namespace robotc {
+
+/*!< Bus timing for a single port, in microseconds */
+struct BusTiming {
+  long long overhead;       /*!< Fixed cost per transaction */
+  long long byteTime;       /*!< Cost per byte on a standard speed port */
+  long long fastByteTime;   /*!< Cost per byte on a sensorI2CCustomFast port */
+};
+
+/*!< Per-port bus counters, used to measure drivers deterministically */
+struct BusStats {
+  long transactions;
+  long bytesSent;
+  long bytesReceived;
+  long errors;
+  long collisions;
+  long long busyTime;
+};
+
+/*!< Base class for I2C devices */
+struct I2CDevice {
+  virtual ~I2CDevice() {}
+  /*!< Called with the bytes following the address byte */
+  virtual void write(const ubyte *data, short len) = 0;
+  /*!< Called to fill in the reply */
+  virtual void read(ubyte *buf, short len) = 0;
+};
+
+/*!< Generic register map device */
+struct RegMapDevice : I2CDevice {
+  ubyte regs[256];
+  ubyte ptr;
+  ubyte autoIncFlag;       /*!< If non-zero, the pointer only increments when this bit is set in the register address */
+  bool autoInc;
+  std::function<void(RegMapDevice &)> onUpdate;                 /*!< Called before every read */
+  std::function<void(RegMapDevice &, ubyte, ubyte)> onWrite;    /*!< Called for every register written */
+
+  struct Event { long long time; ubyte reg; ubyte value; };
+  std::vector<Event> script;
+  size_t scriptPos;
+
+  RegMapDevice() : ptr(0), autoIncFlag(0), autoInc(true), scriptPos(0) { memset(regs, 0, sizeof(regs)); }
+
+  /*!< Read a register, override for FIFOs and other registers with side effects */
+  virtual ubyte readReg(ubyte reg) { return regs[reg]; }
+
+  void runScript() {
+    while (scriptPos < script.size() && script[scriptPos].time <= now) {
+      regs[script[scriptPos].reg] = script[scriptPos].value;
+      scriptPos++;
+    }
+  }
+
+  void write(const ubyte *data, short len) {
+    if (len < 1)
+      return;
+    ptr = data[0];
+    autoInc = true;
+    if (autoIncFlag != 0) {
+      autoInc = (ptr & autoIncFlag) != 0;
+      ptr &= ~autoIncFlag;
+    }
+    for (short i = 1; i < len; i++) {
+      regs[ptr] = data[i];
+      if (onWrite)
+        onWrite(*this, ptr, data[i]);
+      if (autoInc)
+        ptr++;
+    }
+  }
+
+  void read(ubyte *buf, short len) {
+    runScript();
+    if (onUpdate)
+      onUpdate(*this);
+    for (short i = 0; i < len; i++) {
+      buf[i] = readReg(ptr);
+      if (autoInc)
+        ptr++;
+    }
+  }
+
+  /*!< Set a 16 bit little endian register pair */
+  void setLE16(ubyte reg, short value) {
+    regs[reg] = value & 0xFF;
+    regs[(ubyte)(reg + 1)] = (value >> 8) & 0xFF;
+  }
+
+  /*!< Set a 16 bit big endian register pair */
+  void setBE16(ubyte reg, short value) {
+    regs[reg] = (value >> 8) & 0xFF;
+    regs[(ubyte)(reg + 1)] = value & 0xFF;
+  }
+
+  /*!< Load timed register writes from a file, lines are "time(ms) register value" */
+  bool loadScript(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+      return false;
+    char line[128];
+    while (fgets(line, sizeof(line), f) != NULL) {
+      if (line[0] == '#')
+        continue;
+      long t; unsigned int r, v;
+      if (sscanf(line, "%ld %i %i", &t, &r, &v) == 3) {
+        Event e = {(long long)t * 1000, (ubyte)r, (ubyte)v};
+        script.push_back(e);
+      }
+    }
+    fclose(f);
+    return true;
+  }
+};
+
+struct Port {
+  struct Attached { ubyte address; I2CDevice *dev; };
+  std::vector<Attached> devices;
+  std::function<short(long long)> analog;
+  BusTiming timing;
+  BusStats stats;
+  long long pendingUntil;
+  TI2CStatus status;
+  ubyte reply[32];
+  short replyLen;
+  short failNext;          /*!< Number of upcoming requests to fail with a bus error */
+};
+
+extern Port ports[4];
+
+inline bool isFastPort(tSensors port) {
+  switch (SensorType[port]) {
+    case sensorI2CCustomFast:
+    case sensorI2CCustomFast9V:
+    case sensorI2CCustomFastSkipStates:
+    case sensorI2CCustomFastSkipStates9V:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*!< Attach an I2C device to a port at an 8 bit address */
+inline void attachI2C(tSensors port, ubyte address, I2CDevice *dev) {
+  Port::Attached a = {address, dev};
+  ports[port].devices.push_back(a);
+}
+
+/*!< Attach an analogue device to a port, the function returns the raw 10 bit value */
+inline void attachAnalog(tSensors port, std::function<short(long long)> fn) {
+  ports[port].analog = fn;
+}
+
+/*!< Make the next count requests on a port fail with a bus error */
+inline void injectBusErrors(tSensors port, short count) {
+  ports[port].failNext = count;
+}
+
+inline void resetBusStats() {
+  for (int i = 0; i < 4; i++)
+    memset(&ports[i].stats, 0, sizeof(BusStats));
+}
+
+inline void printBusStats() {
+  for (int i = 0; i < 4; i++) {
+    BusStats &s = ports[i].stats;
+    if (s.transactions == 0)
+      continue;
+    printf("S%d: %ld transactions, %ld bytes out, %ld bytes in, %ld errors, %ld collisions, busy %.3f ms\n",
+           i + 1, s.transactions, s.bytesSent, s.bytesReceived, s.errors, s.collisions, s.busyTime / 1000.0);
+  }
+}
+
+inline TI2CStatus busStatus(tSensors port) {
+  Port &p = ports[port];
+  if (now < p.pendingUntil)
+    return STAT_COMM_PENDING;
+  return p.status;
+}
+
+inline void busSend(tSensors port, const ubyte *msg, short replyLen) {
+  Port &p = ports[port];
+  short len = msg[0];
+  ubyte address = msg[1];
+
+  // A new message while the previous one is still in flight garbles both
+  if (now < p.pendingUntil) {
+    p.stats.collisions++;
+    p.stats.errors++;
+    p.status = ERR_COMM_BUS_ERR;
+    return;
+  }
+
+  long long byteTime = isFastPort(port) ? p.timing.fastByteTime : p.timing.byteTime;
+  long long duration = p.timing.overhead + (len + replyLen) * byteTime;
+
+  p.stats.transactions++;
+  p.stats.bytesSent += len;
+  p.stats.busyTime += duration;
+  p.pendingUntil = now + duration;
+  p.replyLen = replyLen;
+  memset(p.reply, 0, sizeof(p.reply));
+
+  // Address-only packets, like the ones clearI2CError() sends, don't use up injected errors
+  if (p.failNext > 0 && len > 1) {
+    p.failNext--;
+    p.stats.errors++;
+    p.status = ERR_COMM_BUS_ERR;
+    return;
+  }
+
+  I2CDevice *dev = NULL;
+  for (size_t i = 0; i < p.devices.size(); i++)
+    if (p.devices[i].address == address)
+      dev = p.devices[i].dev;
+
+  // Nobody home, the address is not acknowledged
+  if (dev == NULL) {
+    p.stats.errors++;
+    p.status = ERR_COMM_BUS_ERR;
+    return;
+  }
+
+  dev->write(&msg[2], len - 1);
+  if (replyLen > 0) {
+    dev->read(p.reply, replyLen);
+    p.stats.bytesReceived += replyLen;
+  }
+  p.status = NO_ERR;
+}
+
+inline void busRead(tSensors port, ubyte *buf, short len) {
+  memcpy(buf, ports[port].reply, len);
+}
+
+inline short analogValue(tSensors port) {
+  if (!ports[port].analog)
+    return 1023;
+  return ports[port].analog(now);
+}
+
+} // namespace robotc
+
+#endif // __ROBOTC_HOST_DEVICES_H__
@@ -0,0 +1,347 @@
+/** \file robotc-runtime.h
+ * \brief Virtual clock, cooperative task scheduler and intrinsics for the host-side
+ * ROBOTC emulation
+ *
+ * Every ROBOTC task runs on its own ucontext stack.  The scheduler always resumes
+ * the task with the earliest wake-up time and advances the virtual clock to it.
+ * Tasks that never sleep are preempted when they touch an intrinsic after using up
+ * their time slice, unless they hold the CPU with hogCPU().
+ *
+ * A program may define hostSetup() to attach device models before task main starts.
+ * scripts/host-build.sh generates robotcPragmaConfig() from the program's
+ * "#pragma config" lines, it sets up the sensor types the same way ROBOTC does.
+ * The run ends when task main returns, stopAllTasks() is called or the virtual time
+ * limit (ROBOTC_HOST_TIME_LIMIT in ms, default 60000) is reached.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#ifndef __ROBOTC_HOST_RUNTIME_H__
+#define __ROBOTC_HOST_RUNTIME_H__
+
+namespace robotc {
+
+long long now = 0;
+Port ports[4];
+
+const long long kTimeSlice = 1000;          /*!< Preemption slice in microseconds */
+const size_t kStackSize = 256 * 1024;
+
+struct Task {
+  robotc_task_t fn;
+  ucontext_t ctx;
+  char *stack;
+  long long wake;
+  TTaskStates state;
+};
+
+std::vector<Task *> tasks;
+Task *current = NULL;
+ucontext_t schedCtx;
+long long sliceStart = 0;
+long long timeLimit = 60000000;
+bool hogging = false;
+bool stopping = false;
+
+bool &debugEnabled() {
+  static bool enabled = true;
+  return enabled;
+}
+
+void trampoline() {
+  current->fn();
+  current->state = taskStateStopped;
+  swapcontext(&current->ctx, &schedCtx);
+}
+
+void yield(long long wakeTime) {
+  if (current == NULL) {
+    // Called outside of a task (from hostSetup), just move the clock
+    if (wakeTime > now)
+      now = wakeTime;
+    return;
+  }
+  current->wake = wakeTime;
+  swapcontext(&current->ctx, &schedCtx);
+}
+
+void charge(long long us) {
+  now += us;
+  if (current != NULL && !hogging && (now - sliceStart) >= kTimeSlice)
+    yield(now);
+}
+
+Task *findTask(robotc_task_t fn) {
+  for (size_t i = 0; i < tasks.size(); i++)
+    if (tasks[i]->fn == fn)
+      return tasks[i];
+  return NULL;
+}
+
+void spawn(robotc_task_t fn) {
+  Task *t = findTask(fn);
+  if (t == NULL) {
+    t = new Task();
+    t->fn = fn;
+    t->stack = new char[kStackSize];
+    tasks.push_back(t);
+  }
+  getcontext(&t->ctx);
+  t->ctx.uc_stack.ss_sp = t->stack;
+  t->ctx.uc_stack.ss_size = kStackSize;
+  t->ctx.uc_link = NULL;
+  makecontext(&t->ctx, trampoline, 0);
+  t->wake = now;
+  t->state = taskStateRunning;
+}
+
+void run(robotc_task_t mainTask) {
+  const char *limit = getenv("ROBOTC_HOST_TIME_LIMIT");
+  if (limit != NULL)
+    timeLimit = atoll(limit) * 1000;
+
+  spawn(mainTask);
+  Task *mainT = tasks[0];
+  size_t last = 0;
+
+  while (!stopping && mainT->state != taskStateStopped) {
+    // Earliest wake-up wins, round robin between equals
+    Task *next = NULL;
+    size_t nextIdx = 0;
+    for (size_t n = 1; n <= tasks.size(); n++) {
+      size_t i = (last + n) % tasks.size();
+      Task *t = tasks[i];
+      if (t->state != taskStateRunning)
+        continue;
+      if (next == NULL || t->wake < next->wake) {
+        next = t;
+        nextIdx = i;
+      }
+    }
+    if (next == NULL)
+      break;
+    if (next->wake > now)
+      now = next->wake;
+    if (now > timeLimit)
+      break;
+    last = nextIdx;
+    current = next;
+    sliceStart = now;
+    swapcontext(&schedCtx, &next->ctx);
+    current = NULL;
+    hogging = false;
+  }
+}
+
+} // namespace robotc
+
+robotc::SensorTypeArray SensorType;
+SensorModeProxy SensorMode;
+robotc::SensorValueArray SensorValue = {false};
+robotc::SensorValueArray SensorRaw = {true};
+robotc::I2CStatusArray nI2CStatus;
+robotc::TimerArray time1 = {{0, 0, 0, 0}, 1};
+robotc::TimerArray time10 = {{0, 0, 0, 0}, 10};
+robotc::TimerArray time100 = {{0, 0, 0, 0}, 100};
+robotc::PgmTime nPgmTime;
+robotc::PgmTime nSysTime;
+bool bSoundActive = false;
+TButtons nNxtButtonPressed = kNoButton;
+short nNxtButtonTask = 0;
+short nNxtExitClicks = 1;
+TNxtRunState nMotorRunState[4];
+long nMotorEncoderTarget[4];
+short nMotorPIDSpeedCtrl[4];
+bool bFloatDuringInactiveMotorPWM = false;
+ubyte DigitalPinDirection[4];
+ubyte DigitalPinValue[4];
+ubyte nI2CBytesReady[4];
+long nMotorEncoder[4];
+short motor[4];
+
+short robotc::SensorValueArray::operator[](int i) const {
+  charge(kIntrinsicCost);
+  short raw = analogValue((tSensors)i);
+  if (this->raw)
+    return raw;
+
+  switch (SensorType.types[i]) {
+    case sensorTouch:
+      return (raw < 512) ? 1 : 0;
+    case sensorLightActive:
+    case sensorLightInactive:
+    case sensorSoundDB:
+    case sensorSoundDBA:
+      return (short)((1023 - raw) * 100 / 1023);
+    default:
+      return raw;
+  }
+}
+
+void sleep(long ms) {
+  robotc::yield(robotc::now + (long long)ms * 1000);
+}
+
+void abortTimeslice() {
+  robotc::yield(robotc::now);
+}
+
+void hogCPU() {
+  robotc::hogging = true;
+}
+
+void releaseCPU() {
+  robotc::hogging = false;
+}
+
+void stopAllTasks() {
+  robotc::stopping = true;
+  robotc::yield(robotc::now);
+  exit(0);
+}
+
+void startTask(robotc_task_t fn, short priority) {
+  robotc::spawn(fn);
+}
+
+void stopTask(robotc_task_t fn) {
+  robotc::Task *t = robotc::findTask(fn);
+  if (t == NULL)
+    return;
+  t->state = taskStateStopped;
+  if (t == robotc::current)
+    robotc::yield(robotc::now);
+}
+
+TTaskStates getTaskState(robotc_task_t fn) {
+  robotc::Task *t = robotc::findTask(fn);
+  return (t == NULL) ? taskStateStopped : t->state;
+}
+
+void sendI2CMsg(tSensors port, ubyte *msg, short replyLen) {
+  robotc::charge(robotc::kIntrinsicCost);
+  robotc::busSend(port, msg, replyLen);
+}
+
+void readI2CReply(tSensors port, ubyte *buf, short len) {
+  robotc::charge(robotc::kIntrinsicCost);
+  robotc::busRead(port, buf, len);
+}
+
+void writeDebugStream(const char *fmt, ...) {
+  if (!robotc::debugEnabled())
+    return;
+  va_list ap;
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+}
+
+void writeDebugStreamLine(const char *fmt, ...) {
+  if (!robotc::debugEnabled())
+    return;
+  va_list ap;
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+  printf("\n");
+}
+
+/*
+ * Flash files are plain files in the current directory
+ */
+static FILE *robotcFiles[16];
+
+static TFileHandle robotcNewHandle(FILE *f) {
+  for (short i = 1; i < 16; i++) {
+    if (robotcFiles[i] == NULL) {
+      robotcFiles[i] = f;
+      return i;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+void OpenWrite(TFileHandle &h, TFileIOResult &res, const char *name, short &size) {
+  FILE *f = fopen(name, "wb");
+  h = (f == NULL) ? 0 : robotcNewHandle(f);
+  res = (h == 0) ? ioRsltNoSpace : ioRsltSuccess;
+}
+
+void OpenRead(TFileHandle &h, TFileIOResult &res, const char *name, short &size) {
+  FILE *f = fopen(name, "rb");
+  h = (f == NULL) ? 0 : robotcNewHandle(f);
+  res = (h == 0) ? ioRsltFileNotFound : ioRsltSuccess;
+  if (h != 0) {
+    fseek(f, 0, SEEK_END);
+    size = (short)ftell(f);
+    fseek(f, 0, SEEK_SET);
+  }
+}
+
+void Close(TFileHandle h, TFileIOResult &res) {
+  if (h > 0 && h < 16 && robotcFiles[h] != NULL) {
+    fclose(robotcFiles[h]);
+    robotcFiles[h] = NULL;
+  }
+  res = ioRsltSuccess;
+}
+
+void Delete(const char *name, TFileIOResult &res) {
+  res = (remove(name) == 0) ? ioRsltSuccess : ioRsltFileNotFound;
+}
+
+static void robotcWrite(TFileHandle h, TFileIOResult &res, const void *p, size_t n) {
+  res = (h > 0 && h < 16 && robotcFiles[h] != NULL && fwrite(p, n, 1, robotcFiles[h]) == 1) ? ioRsltSuccess : ioRsltNoSpace;
+}
+
+static void robotcRead(TFileHandle h, TFileIOResult &res, void *p, size_t n) {
+  res = (h > 0 && h < 16 && robotcFiles[h] != NULL && fread(p, n, 1, robotcFiles[h]) == 1) ? ioRsltSuccess : ioRsltEndOfFile;
+}
+
+void WriteByte(TFileHandle h, TFileIOResult &res, ubyte b) { robotcWrite(h, res, &b, 1); }
+void ReadByte(TFileHandle h, TFileIOResult &res, ubyte &b) { robotcRead(h, res, &b, 1); }
+void WriteShort(TFileHandle h, TFileIOResult &res, short s) { robotcWrite(h, res, &s, 2); }
+void ReadShort(TFileHandle h, TFileIOResult &res, short &s) { robotcRead(h, res, &s, 2); }
+void WriteLong(TFileHandle h, TFileIOResult &res, long l) { int32_t v = (int32_t)l; robotcWrite(h, res, &v, 4); }
+void ReadLong(TFileHandle h, TFileIOResult &res, long &l) { int32_t v = 0; robotcRead(h, res, &v, 4); l = v; }
+void WriteFloat(TFileHandle h, TFileIOResult &res, float f) { robotcWrite(h, res, &f, 4); }
+void ReadFloat(TFileHandle h, TFileIOResult &res, float &f) { robotcRead(h, res, &f, 4); }
+
+/*
+ * Entry point
+ */
+void robotc_main();
+void robotcPragmaConfig() __attribute__((weak));
+void hostSetup() __attribute__((weak));
+void hostReport() __attribute__((weak));
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < 4; i++) {
+    robotc::ports[i].timing.overhead = 1500;
+    robotc::ports[i].timing.byteTime = 1000;
+    robotc::ports[i].timing.fastByteTime = 320;
+    robotc::ports[i].status = NO_ERR;
+  }
+
+  if (robotcPragmaConfig)
+    robotcPragmaConfig();
+
+  if (hostSetup)
+    hostSetup();
+
+  robotc::run(robotc_main);
+
+  if (hostReport)
+    hostReport();
+  return 0;
+}
+
+#endif // __ROBOTC_HOST_RUNTIME_H__
@@ -0,0 +1,365 @@
+/** \file robotc.h
+ * \brief Host-side emulation of the ROBOTC NXT intrinsics
+ *
+ * robotc.h lets the drivers in include/ and the programs in examples/ be compiled
+ * and run on a Linux host with g++.  It provides the ROBOTC types, the sensor and
+ * I2C intrinsics, the debug stream and a cooperative task scheduler, all running
+ * on a virtual clock.  Nothing here talks to real hardware.
+ *
+ * The program is built as C++ with this file force-included:
+ * \code
+ * g++ -std=c++17 -fpermissive -Wno-enum-compare -Wno-narrowing -Wno-endif-labels \
+ *     -x c++ -include robotc.h -Ihost -Iinclude prog.c
+ * \endcode
+ * or simply with scripts/host-build.sh, which also turns the program's
+ * "#pragma config(Sensor, ...)" lines into sensor names and port types.
+ *
+ * Time only moves when a task sleeps, yields, or touches a bus intrinsic, so runs are
+ * fully deterministic: the same program and the same device models always produce
+ * the same transaction counts and the same virtual-time latencies.
+ *
+ * Devices are modelled by robotc-devices.h, see that file for the I2C register map
+ * and analogue device models.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#ifndef __ROBOTC_HOST_H__
+#define __ROBOTC_HOST_H__
+
+#ifndef NXT
+#define NXT
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ucontext.h>
+#include <functional>
+#include <vector>
+#include <string>
+#include <type_traits>
+
+#define kRobotCVersionNumeric 410
+
+/*
+ * Basic types
+ */
+typedef uint8_t  ubyte;
+typedef int8_t   sbyte;
+// A macro rather than a typedef so that "unsigned byte" works as well, char is signed on the hosts we build on
+#define byte char
+typedef uint16_t word;
+
+#ifndef PI
+#define PI 3.14159265358979
+#endif
+
+/*!< ROBOTC strings are fixed 20 byte buffers */
+struct string {
+  char s[20];
+  string() { s[0] = 0; }
+  string(const char *c) { set(c); }
+  void set(const char *c) { strncpy(s, c, sizeof(s) - 1); s[sizeof(s) - 1] = 0; }
+  string &operator=(const char *c) { set(c); return *this; }
+  operator char *() { return s; }
+  operator const char *() const { return s; }
+};
+
+/*
+ * Sensor ports, types and modes
+ */
+typedef enum tSensors {
+  S1 = 0, S2 = 1, S3 = 2, S4 = 3,
+  kNumbOfSensors = 4
+} tSensors;
+
+typedef enum TSensorTypes {
+  sensorNone = 0,
+  sensorTouch,
+  sensorLightActive,
+  sensorLightInactive,
+  sensorSoundDB,
+  sensorSoundDBA,
+  sensorSONAR,
+  sensorRawValue,
+  sensorAnalogActive,
+  sensorAnalogInactive,
+  sensorCustom,
+  sensorCustom9V,
+  sensorI2CCustom,
+  sensorI2CCustom9V,
+  sensorI2CCustomFast,
+  sensorI2CCustomFast9V,
+  sensorI2CCustomFastSkipStates,
+  sensorI2CCustomFastSkipStates9V,
+  sensorColorNxtFULL,
+  sensorColorNxtRED,
+  sensorColorNxtGREEN,
+  sensorColorNxtBLUE,
+  sensorColorNxtNONE,
+  sensorHiTechnicGyro,
+  sensorLightActiveAmbient,
+  sensorLowSpeed,
+  sensorHighSpeed,
+  sensorRotation,
+  sensorReflection = sensorLightInactive
+} TSensorTypes;
+
+typedef enum TSensorModes {
+  modeRaw = 0,
+  modeBoolean,
+  modeEdge,
+  modePulse,
+  modePercentage,
+  modeCelcius,
+  modeFarenheit,
+  modeAngle
+} TSensorModes;
+
+typedef enum tMotor {
+  motorA = 0, motorB = 1, motorC = 2,
+  kNumbOfRealMotors = 3
+} tMotor;
+
+typedef enum TI2CStatus {
+  NO_ERR = 0,
+  STAT_COMM_PENDING = 32,
+  ERR_COMM_CHAN_NOT_READY = -32,
+  ERR_COMM_BUS_ERR = -35
+} TI2CStatus;
+
+/*
+ * Sounds, buttons, tasks
+ */
+typedef enum TSounds {
+  soundBlip = 0, soundBeepBeep, soundDownwardTones, soundUpwardTones,
+  soundLowBuzz, soundFastUpwardTones, soundShortBlip, soundException
+} TSounds;
+
+typedef enum TButtons {
+  kNoButton = -1, kExitButton = 0, kRightButton = 1, kLeftButton = 2, kEnterButton = 3
+} TButtons;
+
+typedef enum TTaskStates {
+  taskStateStopped = 0, taskStateRunning = 1, taskStateWaiting = 2
+} TTaskStates;
+
+typedef enum TMotorRegulation { mtrNoReg = 0, mtrSpeedReg = 1, mtrSyncRegMaster = 2, mtrSyncRegSlave = 3 } TMotorRegulation;
+typedef enum TNxtRunState { runStateIdle = 0, runStateRunning = 0x20, runStateHoldPosition = 0x10 } TNxtRunState;
+
+typedef ubyte TBTAddress[6];
+
+typedef enum TTimers { T1 = 0, T2, T3, T4 } TTimers;
+
+/*
+ * File I/O types
+ */
+typedef short TFileHandle;
+typedef enum TFileIOResult {
+  ioRsltSuccess = 0, ioRsltFileNotFound = 1, ioRsltNoSpace = 2, ioRsltEndOfFile = 3
+} TFileIOResult;
+
+namespace robotc {
+
+/*!< Virtual clock in microseconds */
+extern long long now;
+
+/*!< Cost in microseconds charged to the caller for touching a bus intrinsic */
+const long long kIntrinsicCost = 20;
+
+void yield(long long wakeTime);
+void charge(long long us);
+
+/*
+ * The I2C bus, implemented in robotc-devices.h
+ */
+TI2CStatus busStatus(tSensors port);
+void busSend(tSensors port, const ubyte *msg, short replyLen);
+void busRead(tSensors port, ubyte *buf, short len);
+short analogValue(tSensors port);
+
+struct SensorTypeArray {
+  TSensorTypes types[4];
+  TSensorModes modes[4];
+  TSensorTypes &operator[](int i) { return types[i]; }
+};
+
+struct SensorValueArray {
+  bool raw;
+  short operator[](int i) const;
+};
+
+struct I2CStatusArray {
+  TI2CStatus operator[](int i) const { charge(kIntrinsicCost); return busStatus((tSensors)i); }
+};
+
+struct TimerArray {
+  long long start[4];
+  long divisor;
+  struct Ref {
+    TimerArray *t; int i;
+    operator long() const { return (long)((now - t->start[i]) / (1000 * t->divisor)); }
+    Ref &operator=(long v) { t->start[i] = now - (long long)v * 1000 * t->divisor; return *this; }
+  };
+  Ref operator[](int i) { Ref r = {this, i}; return r; }
+};
+
+struct PgmTime {
+  operator long() const { return (long)(now / 1000); }
+};
+
+bool &debugEnabled();
+
+} // namespace robotc
+
+extern robotc::SensorTypeArray SensorType;
+extern robotc::SensorValueArray SensorValue;
+extern robotc::SensorValueArray SensorRaw;
+extern robotc::I2CStatusArray nI2CStatus;
+extern robotc::TimerArray time1;
+extern robotc::TimerArray time10;
+extern robotc::TimerArray time100;
+extern robotc::PgmTime nPgmTime;
+extern robotc::PgmTime nSysTime;
+extern bool bSoundActive;
+extern TButtons nNxtButtonPressed;
+extern short nNxtButtonTask;
+extern short nNxtExitClicks;
+extern TNxtRunState nMotorRunState[4];
+extern long nMotorEncoderTarget[4];
+extern short nMotorPIDSpeedCtrl[4];
+extern bool bFloatDuringInactiveMotorPWM;
+extern ubyte DigitalPinDirection[4];
+extern ubyte DigitalPinValue[4];
+extern ubyte nI2CBytesReady[4];
+extern long nMotorEncoder[4];
+extern short motor[4];
+
+/*!< SensorMode[] lives next to the types, it's only ever assigned and compared */
+struct SensorModeProxy {
+  TSensorModes &operator[](int i) { return SensorType.modes[i]; }
+};
+extern SensorModeProxy SensorMode;
+
+/*
+ * Intrinsics
+ */
+void sleep(long ms);
+#define wait1Msec(X) sleep(X)
+void abortTimeslice();
+#define EndTimeSlice() abortTimeslice()
+void hogCPU();
+void releaseCPU();
+void stopAllTasks();
+
+typedef void (*robotc_task_t)();
+void startTask(robotc_task_t fn, short priority = 7);
+void stopTask(robotc_task_t fn);
+TTaskStates getTaskState(robotc_task_t fn);
+
+void sendI2CMsg(tSensors port, ubyte *msg, short replyLen);
+void readI2CReply(tSensors port, ubyte *buf, short len);
+
+void writeDebugStream(const char *fmt, ...);
+void writeDebugStreamLine(const char *fmt, ...);
+inline void displayTextLine(int, const char *, ...) {}
+inline void displayCenteredTextLine(int, const char *, ...) {}
+inline void displayCenteredBigTextLine(int, const char *, ...) {}
+inline void displayBigTextLine(int, const char *, ...) {}
+inline void displayClearTextLine(int) {}
+inline void displayString(int, const char *, ...) {}
+inline void displayStringAt(int, int, const char *, ...) {}
+inline void displayRICFile(int, int, const char *) {}
+inline void eraseDisplay() {}
+inline void playSound(TSounds) {}
+inline void playTone(int, int) {}
+inline void playImmediateTone(int, int) {}
+inline void drawLine(int, int, int, int) {}
+inline void drawRect(int, int, int, int) {}
+inline void eraseRect(int, int, int, int) {}
+inline void fillRect(int, int, int, int) {}
+inline void setPixel(int, int) {}
+inline void clearPixel(int, int) {}
+inline void drawCircle(int, int, int) {}
+inline void getBTAddress(TBTAddress &addr) { memset(addr, 0, sizeof(TBTAddress)); }
+
+/*!< ROBOTC passes structs to memcpy() and memset() by reference */
+template <class T>
+inline typename std::enable_if<std::is_class<T>::value, void *>::type memcpy(T &dst, const T &src, size_t n) { return memcpy((void *)&dst, (const void *)&src, n); }
+template <class T>
+inline typename std::enable_if<std::is_class<T>::value, void *>::type memset(T &dst, int c, size_t n) { return memset((void *)&dst, c, n); }
+
+inline short stringFind(const char *haystack, const char *needle) {
+  const char *p = strstr(haystack, needle);
+  return p ? (short)(p - haystack) : -1;
+}
+
+inline void stringFormat(string &s, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(s.s, sizeof(s.s), fmt, ap);
+  va_end(ap);
+}
+
+inline void stringFromChars(string &s, const char *chars) {
+  strncpy(s.s, chars, sizeof(s.s) - 1);
+  s.s[sizeof(s.s) - 1] = 0;
+}
+
+inline void stringDelete(string &s, int pos, int len) {
+  int n = strlen(s.s);
+  if (pos < 0 || pos >= n)
+    return;
+  if (pos + len > n)
+    len = n - pos;
+  memmove(&s.s[pos], &s.s[pos + len], n - pos - len + 1);
+}
+
+/*!< ROBOTC's random(n) returns 0 to n, it overloads the C library's random() */
+inline short random(short range) { return (short)(rand() % (range + 1)); }
+
+inline float cosDegrees(float d) { return cos(d * PI / 180.0); }
+inline float sinDegrees(float d) { return sin(d * PI / 180.0); }
+inline float radiansToDegrees(float r) { return r * 180.0 / PI; }
+inline float degreesToRadians(float d) { return d * PI / 180.0; }
+inline short sgn(float f) { return (f > 0) - (f < 0); }
+
+/*
+ * Flash file I/O, files live in the current directory
+ */
+void OpenWrite(TFileHandle &h, TFileIOResult &res, const char *name, short &size);
+void OpenRead(TFileHandle &h, TFileIOResult &res, const char *name, short &size);
+void Close(TFileHandle h, TFileIOResult &res);
+void Delete(const char *name, TFileIOResult &res);
+void WriteByte(TFileHandle h, TFileIOResult &res, ubyte b);
+void ReadByte(TFileHandle h, TFileIOResult &res, ubyte &b);
+void WriteShort(TFileHandle h, TFileIOResult &res, short s);
+void ReadShort(TFileHandle h, TFileIOResult &res, short &s);
+void WriteLong(TFileHandle h, TFileIOResult &res, long l);
+void ReadLong(TFileHandle h, TFileIOResult &res, long &l);
+void WriteFloat(TFileHandle h, TFileIOResult &res, float f);
+void ReadFloat(TFileHandle h, TFileIOResult &res, float &f);
+
+#include "robotc-devices.h"
+#include "robotc-runtime.h"
+
+/*
+ * ROBOTC keywords
+ */
+#define task void
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+
+// The program's "task main" becomes robotc_main, the host's main() runs it
+#define main robotc_main
+
+#endif // __ROBOTC_HOST_H__
@@ -0,0 +1,509 @@
+/*!@addtogroup other
+ * @{
+ * @defgroup attitude Attitude Estimation Library
+ * Attitude Estimation Library
+ * @{
+ */
+
+#ifndef __ATTITUDE_H__
+#define __ATTITUDE_H__
+/** \file attitude.h
+ * \brief Attitude estimation for ROBOTC.
+ *
+ * attitude.h fuses gyro and accelerometer data into pitch, roll and yaw.
+ * There are two filters to choose from:
+ * - ATT_FILTER_COMPLEMENTARY: a complementary filter on the Euler angles.  The gyro
+ *   rates are integrated and pulled towards the accelerometer's tilt.
+ * - ATT_FILTER_MAHONY: a Mahony style filter on a quaternion, which doesn't suffer
+ *   from the Euler angles' problems at large tilt angles, at about twice the cost.
+ *
+ * Both filters correct with a proportional and an integral gain, the integral
+ * part is the gyro bias estimate.  The accelerometer can only correct pitch and
+ * roll and the bias of the axes it sees tilting, yaw is integrated from the gyro.\n
+ * Each update does a fixed amount of work, there are no loops or iterations.
+ *
+ * Samples are timestamped, the time between two samples is taken from their
+ * timestamps rather than from when ATTupdate() happens to be called.  The
+ * adapters fill in a sample from a driver, they are only available if that
+ * driver was included before this file:
+ * - ATTreadDIMU() and ATTupdateDIMUBlock() for dexterind-imu.h
+ * - ATTreadMSIMU() for mindsensors-imu.h
+ * - ATTreadHTGYRO() for hitechnic-gyro.h, yaw only
+ *
+ * ATTwriteLog() writes a sample to the debug stream, the lines can be replayed
+ * with host/benchmarks/attitude-replay.c.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.1
+ * \example attitude-test1.c
+ */
+
+#pragma systemFile
+
+#ifndef __COMMON_H__
+#include "common.h"
+#endif
+
+#define ATT_FILTER_COMPLEMENTARY  0     /*!< Complementary filter on the Euler angles */
+#define ATT_FILTER_MAHONY         1     /*!< Mahony filter on a quaternion */
+
+#define ATT_DEFAULT_KP            2.0   /*!< Default proportional gain, in 1/s */
+#define ATT_DEFAULT_KI            0.1   /*!< Default integral gain, in 1/s^2 */
+#define ATT_MAX_DT                100   /*!< Longest time between samples in ms that is integrated in full */
+#define ATT_ACCEL_MIN             0.85  /*!< Accelerometer data is only used when the magnitude is above this, in G */
+#define ATT_ACCEL_MAX             1.15  /*!< Accelerometer data is only used when the magnitude is below this, in G */
+
+/*!< A timestamped sample, the axes are those of the sensor */
+typedef struct
+{
+  long timestamp;       /*!< Time at which the sample was taken, in ms */
+  float gyro[3];        /*!< Rotation rates in degrees per second, x, y and z */
+  float accel[3];       /*!< Acceleration in G, x, y and z */
+  bool hasAccel;        /*!< Whether accel[] holds data */
+} tATTSample, *tATTSamplePtr;
+
+/*!< Attitude estimator state */
+typedef struct
+{
+  ubyte filter;         /*!< ATT_FILTER_COMPLEMENTARY or ATT_FILTER_MAHONY */
+  float kp;             /*!< Proportional gain, in 1/s */
+  float ki;             /*!< Integral gain, in 1/s^2 */
+  float pitch;          /*!< Rotation around the Y axis in degrees */
+  float roll;           /*!< Rotation around the X axis in degrees */
+  float yaw;            /*!< Rotation around the Z axis in degrees, not limited to +/-180 */
+  float bias[3];        /*!< Gyro bias estimate in degrees per second, x, y and z */
+  float q[4];           /*!< Quaternion, used by the Mahony filter */
+  long lastTime;        /*!< Timestamp of the last sample */
+  bool initialised;     /*!< The first sample has been seen */
+  long updates;         /*!< Number of samples processed */
+  long accelRejected;   /*!< Number of accelerometer samples that were too far from 1G to use */
+  long gaps;            /*!< Number of times the time between samples was more than ATT_MAX_DT */
+} tATT, *tATTPtr;
+
+// Prototypes
+void ATTinit(tATTPtr att, ubyte filter = ATT_FILTER_COMPLEMENTARY);
+void ATTsetGains(tATTPtr att, float kp, float ki);
+void ATTreset(tATTPtr att);
+bool ATTupdate(tATTPtr att, tATTSamplePtr sample);
+void ATTwriteLog(tATTSamplePtr sample);
+
+/**
+ * Initialise the estimator
+ * @param att pointer to the estimator's data struct
+ * @param filter ATT_FILTER_COMPLEMENTARY (default) or ATT_FILTER_MAHONY
+ */
+void ATTinit(tATTPtr att, ubyte filter)
+{
+  memset(att, 0, sizeof(tATT));
+  att->filter = filter;
+  att->kp = ATT_DEFAULT_KP;
+  att->ki = ATT_DEFAULT_KI;
+  att->q[0] = 1.0;
+}
+
+/**
+ * Set the correction gains.  A higher kp trusts the accelerometer more, a
+ * higher ki tracks the gyro bias faster.
+ * @param att pointer to the estimator's data struct
+ * @param kp proportional gain, in 1/s
+ * @param ki integral gain, in 1/s^2
+ */
+void ATTsetGains(tATTPtr att, float kp, float ki)
+{
+  att->kp = kp;
+  att->ki = ki;
+}
+
+/**
+ * Forget the attitude, the bias estimate is kept.  The next sample with
+ * accelerometer data sets pitch and roll, yaw starts at 0.
+ * @param att pointer to the estimator's data struct
+ */
+void ATTreset(tATTPtr att)
+{
+  att->pitch = 0;
+  att->roll = 0;
+  att->yaw = 0;
+  att->q[0] = 1.0;
+  att->q[1] = 0;
+  att->q[2] = 0;
+  att->q[3] = 0;
+  att->initialised = false;
+}
+
+/**
+ * Wrap an angle to -180 to 180 degrees.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param angle the angle in degrees
+ * @return the wrapped angle
+ */
+float _ATTwrap(float angle)
+{
+  while (angle > 180.0)
+    angle -= 360.0;
+  while (angle < -180.0)
+    angle += 360.0;
+  return angle;
+}
+
+/**
+ * Check whether a sample's accelerometer data can be used for tilt.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param att pointer to the estimator's data struct
+ * @param sample the sample
+ * @return true if the magnitude is close enough to 1G
+ */
+bool _ATTaccelUsable(tATTPtr att, tATTSamplePtr sample)
+{
+  float magSq;
+
+  if (!sample->hasAccel)
+    return false;
+
+  magSq = (sample->accel[0] * sample->accel[0]) + (sample->accel[1] * sample->accel[1]) + (sample->accel[2] * sample->accel[2]);
+  if ((magSq < ATT_ACCEL_MIN * ATT_ACCEL_MIN) || (magSq > ATT_ACCEL_MAX * ATT_ACCEL_MAX))
+  {
+    att->accelRejected++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Set pitch and roll straight from the accelerometer and build the matching
+ * quaternion, yaw is kept.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param att pointer to the estimator's data struct
+ * @param sample the sample
+ */
+void _ATTsetFromAccel(tATTPtr att, tATTSamplePtr sample)
+{
+  float cr, sr, cp, sp, cy, sy;
+
+  att->roll = radiansToDegrees(atan2(sample->accel[1], sample->accel[2]));
+  att->pitch = radiansToDegrees(atan2(-sample->accel[0], sqrt((sample->accel[1] * sample->accel[1]) + (sample->accel[2] * sample->accel[2]))));
+
+  cr = cosDegrees(att->roll / 2);
+  sr = sinDegrees(att->roll / 2);
+  cp = cosDegrees(att->pitch / 2);
+  sp = sinDegrees(att->pitch / 2);
+  cy = cosDegrees(att->yaw / 2);
+  sy = sinDegrees(att->yaw / 2);
+
+  att->q[0] = (cr * cp * cy) + (sr * sp * sy);
+  att->q[1] = (sr * cp * cy) - (cr * sp * sy);
+  att->q[2] = (cr * sp * cy) + (sr * cp * sy);
+  att->q[3] = (cr * cp * sy) - (sr * sp * cy);
+}
+
+/**
+ * Complementary filter step.  The gyro rates are turned into Euler angle
+ * rates and integrated, the difference with the accelerometer's tilt is
+ * fed back through kp and ki.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param att pointer to the estimator's data struct
+ * @param sample the sample
+ * @param dt time since the last sample in seconds
+ * @param useAccel whether the accelerometer data can be used
+ */
+void _ATTcomplementary(tATTPtr att, tATTSamplePtr sample, float dt, bool useAccel)
+{
+  float errRoll, errPitch;
+  float p, q, r;
+  float sr, cr, cp, qr;
+
+  p = sample->gyro[0] - att->bias[0];
+  q = sample->gyro[1] - att->bias[1];
+  r = sample->gyro[2] - att->bias[2];
+
+  sr = sinDegrees(att->roll);
+  cr = cosDegrees(att->roll);
+  cp = max2(cosDegrees(att->pitch), 0.01);   // Yaw and roll are undefined at +/-90 degrees pitch
+  qr = (q * sr) + (r * cr);
+
+  att->roll += (p + (qr * sinDegrees(att->pitch) / cp)) * dt;
+  att->pitch += ((q * cr) - (r * sr)) * dt;
+  att->yaw += (qr / cp) * dt;
+
+  if (useAccel)
+  {
+    errRoll = _ATTwrap(radiansToDegrees(atan2(sample->accel[1], sample->accel[2])) - att->roll);
+    errPitch = radiansToDegrees(atan2(-sample->accel[0], sqrt((sample->accel[1] * sample->accel[1]) + (sample->accel[2] * sample->accel[2])))) - att->pitch;
+
+    att->roll += att->kp * errRoll * dt;
+    att->pitch += att->kp * errPitch * dt;
+    att->bias[0] -= att->ki * errRoll * dt;
+    att->bias[1] -= att->ki * errPitch * dt;
+  }
+
+  att->roll = _ATTwrap(att->roll);
+}
+
+/**
+ * Mahony filter step.  The error between the measured and the estimated
+ * direction of gravity is fed back into the rates through kp and ki before
+ * the quaternion is integrated.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param att pointer to the estimator's data struct
+ * @param sample the sample
+ * @param dt time since the last sample in seconds
+ * @param useAccel whether the accelerometer data can be used
+ */
+void _ATTmahony(tATTPtr att, tATTSamplePtr sample, float dt, bool useAccel)
+{
+  float gx, gy, gz;
+  float ax, ay, az;
+  float vx, vy, vz;
+  float ex, ey, ez;
+  float norm;
+  float q0 = att->q[0];
+  float q1 = att->q[1];
+  float q2 = att->q[2];
+  float q3 = att->q[3];
+
+  gx = degreesToRadians(sample->gyro[0] - att->bias[0]);
+  gy = degreesToRadians(sample->gyro[1] - att->bias[1]);
+  gz = degreesToRadians(sample->gyro[2] - att->bias[2]);
+
+  if (useAccel)
+  {
+    norm = sqrt((sample->accel[0] * sample->accel[0]) + (sample->accel[1] * sample->accel[1]) + (sample->accel[2] * sample->accel[2]));
+    ax = sample->accel[0] / norm;
+    ay = sample->accel[1] / norm;
+    az = sample->accel[2] / norm;
+
+    // Direction of gravity according to the quaternion
+    vx = 2 * ((q1 * q3) - (q0 * q2));
+    vy = 2 * ((q0 * q1) + (q2 * q3));
+    vz = (q0 * q0) - (q1 * q1) - (q2 * q2) + (q3 * q3);
+
+    // The error is the cross product of the measured and estimated directions
+    ex = (ay * vz) - (az * vy);
+    ey = (az * vx) - (ax * vz);
+    ez = (ax * vy) - (ay * vx);
+
+    att->bias[0] -= radiansToDegrees(att->ki * ex * dt);
+    att->bias[1] -= radiansToDegrees(att->ki * ey * dt);
+    att->bias[2] -= radiansToDegrees(att->ki * ez * dt);
+
+    gx += att->kp * ex;
+    gy += att->kp * ey;
+    gz += att->kp * ez;
+  }
+
+  gx *= 0.5 * dt;
+  gy *= 0.5 * dt;
+  gz *= 0.5 * dt;
+  att->q[0] = q0 - (q1 * gx) - (q2 * gy) - (q3 * gz);
+  att->q[1] = q1 + (q0 * gx) + (q2 * gz) - (q3 * gy);
+  att->q[2] = q2 + (q0 * gy) - (q1 * gz) + (q3 * gx);
+  att->q[3] = q3 + (q0 * gz) + (q1 * gy) - (q2 * gx);
+
+  norm = sqrt((att->q[0] * att->q[0]) + (att->q[1] * att->q[1]) + (att->q[2] * att->q[2]) + (att->q[3] * att->q[3]));
+  for (short i = 0; i < 4; i++)
+    att->q[i] /= norm;
+
+  q0 = att->q[0];
+  q1 = att->q[1];
+  q2 = att->q[2];
+  q3 = att->q[3];
+  att->roll = radiansToDegrees(atan2(2 * ((q0 * q1) + (q2 * q3)), 1 - (2 * ((q1 * q1) + (q2 * q2)))));
+  att->pitch = radiansToDegrees(asin(min2(1.0, max2(-1.0, 2 * ((q0 * q2) - (q3 * q1))))));
+
+  // Keep counting yaw past +/-180, like the complementary filter does
+  att->yaw += _ATTwrap(radiansToDegrees(atan2(2 * ((q0 * q3) + (q1 * q2)), 1 - (2 * ((q2 * q2) + (q3 * q3))))) - att->yaw);
+}
+
+/**
+ * Feed a sample to the estimator.  The first sample only sets the starting
+ * point, if it has usable accelerometer data pitch and roll are taken from it.
+ * @param att pointer to the estimator's data struct
+ * @param sample the sample
+ * @return true if the sample was used, false if its timestamp was not after the previous one
+ */
+bool ATTupdate(tATTPtr att, tATTSamplePtr sample)
+{
+  long interval;
+  bool useAccel;
+
+  useAccel = _ATTaccelUsable(att, sample);
+
+  if (!att->initialised)
+  {
+    if (useAccel)
+      _ATTsetFromAccel(att, sample);
+    att->lastTime = sample->timestamp;
+    att->initialised = true;
+    att->updates++;
+    return true;
+  }
+
+  interval = sample->timestamp - att->lastTime;
+  if (interval <= 0)
+    return false;
+
+  if (interval > ATT_MAX_DT)
+  {
+    att->gaps++;
+    interval = ATT_MAX_DT;
+  }
+  att->lastTime = sample->timestamp;
+  att->updates++;
+
+  if (att->filter == ATT_FILTER_MAHONY)
+    _ATTmahony(att, sample, interval / 1000.0, useAccel);
+  else
+    _ATTcomplementary(att, sample, interval / 1000.0, useAccel);
+
+  return true;
+}
+
+/**
+ * Write a sample to the debug stream as a line of comma separated values:
+ * timestamp, the gyro axes and, if there is accelerometer data, the accelerometer
+ * axes.  host/benchmarks/attitude-replay.c can replay these lines.
+ * @param sample the sample
+ */
+void ATTwriteLog(tATTSamplePtr sample)
+{
+  if (sample->hasAccel)
+    writeDebugStreamLine("%d,%f,%f,%f,%f,%f,%f", sample->timestamp, sample->gyro[0], sample->gyro[1], sample->gyro[2],
+                         sample->accel[0], sample->accel[1], sample->accel[2]);
+  else
+    writeDebugStreamLine("%d,%f,%f,%f", sample->timestamp, sample->gyro[0], sample->gyro[1], sample->gyro[2]);
+}
+
+#ifdef __DIMU_H__
+/**
+ * Read a sample from a Dexter Industries IMU, the gyro and 10 bit
+ * accelerometer axes.  The IMU must have been configured with DIMUconfigIMU().
+ * @param dimu pointer to the IMU's data struct
+ * @param sample the sample to fill in
+ * @return true if no error occured, false if it did
+ */
+bool ATTreadDIMU(tDIMUptr dimu, tATTSamplePtr sample)
+{
+  if (!readSensor(dimu))
+    return false;
+
+  sample->timestamp = nPgmTime;
+  for (short i = 0; i < 3; i++)
+  {
+    sample->gyro[i] = inertialToFloat(dimu->axesGyro[i]);
+    sample->accel[i] = inertialToFloat(dimu->axesAccel10Bit[i]);
+  }
+  sample->hasAccel = true;
+  return true;
+}
+
+/**
+ * Feed a block of gyro samples from the Dexter Industries IMU's FIFO to the
+ * estimator, see DIMUreadGyroFIFO().  The accelerometer data is only used with
+ * the newest sample, the others are integrated from the gyro alone.
+ * @param att pointer to the estimator's data struct
+ * @param block the block of gyro samples
+ * @param ax X axis acceleration in G
+ * @param ay Y axis acceleration in G
+ * @param az Z axis acceleration in G
+ * @return the number of samples used
+ */
+short ATTupdateDIMUBlock(tATTPtr att, tDIMUGyroBlock &block, float ax, float ay, float az)
+{
+  tATTSample sample;
+  short used = 0;
+
+  sample.hasAccel = false;
+  sample.accel[0] = ax;
+  sample.accel[1] = ay;
+  sample.accel[2] = az;
+
+  for (short i = 0; i < block.count; i++)
+  {
+    sample.timestamp = block.timestamp[i];
+    sample.gyro[0] = inertialToFloat(block.x[i]);
+    sample.gyro[1] = inertialToFloat(block.y[i]);
+    sample.gyro[2] = inertialToFloat(block.z[i]);
+    sample.hasAccel = (i == block.count - 1);
+    if (ATTupdate(att, &sample))
+      used++;
+  }
+  return used;
+}
+#endif // __DIMU_H__
+
+#ifdef __MSIMU_H__
+#ifndef ATT_MSIMU_GYRO_SCALE
+#define ATT_MSIMU_GYRO_SCALE   0.00875   /*!< Degrees per second per AbsoluteIMU gyro unit, for the 2G/250 dps setting */
+#endif
+
+/**
+ * Read a sample from a Mindsensors AbsoluteIMU.  The gyro is scaled with
+ * ATT_MSIMU_GYRO_SCALE, define it before including this file if the sensor
+ * uses a different range.  The accelerometer reports in milli-G.
+ * @param link the port number
+ * @param sample the sample to fill in
+ * @return true if no error occured, false if it did
+ */
+bool ATTreadMSIMU(tSensors link, tATTSamplePtr sample)
+{
+  short x, y, z;
+
+  if (!MSIMUreadGyroAxes(link, x, y, z))
+    return false;
+
+  sample->timestamp = nPgmTime;
+  sample->gyro[0] = x * ATT_MSIMU_GYRO_SCALE;
+  sample->gyro[1] = y * ATT_MSIMU_GYRO_SCALE;
+  sample->gyro[2] = z * ATT_MSIMU_GYRO_SCALE;
+
+  if (!MSIMUreadAccelAxes(link, x, y, z))
+    return false;
+
+  sample->accel[0] = x / 1000.0;
+  sample->accel[1] = y / 1000.0;
+  sample->accel[2] = z / 1000.0;
+  sample->hasAccel = true;
+  return true;
+}
+#endif // __MSIMU_H__
+
+#ifdef __HTGYRO_H__
+/**
+ * Read a sample from a HiTechnic Gyro.  The gyro only measures the rotation
+ * around the Z axis, so only yaw is estimated.  The gyro must have been
+ * calibrated with sensorCalibrate() first.
+ * @param htgyroPtr pointer to the gyro's data struct
+ * @param sample the sample to fill in
+ * @return true if no error occured, false if it did
+ */
+bool ATTreadHTGYRO(tHTGYROPtr htgyroPtr, tATTSamplePtr sample)
+{
+  if (!readSensor(htgyroPtr))
+    return false;
+
+  sample->timestamp = nPgmTime;
+  sample->gyro[0] = 0;
+  sample->gyro[1] = 0;
+  sample->gyro[2] = inertialToFloat(htgyroPtr->rotation);
+  sample->hasAccel = false;
+  return true;
+}
+#endif // __HTGYRO_H__
+
+#endif // __ATTITUDE_H__
+
+/* @} */
+/* @} */
@@ -19,6 +19,7 @@
  * - 0.1: Initial release
  * - 0.2: Partial rewrite by Xander Soldaat to simplify API
  * - 0.3: Uses new array typedefs instead of structs
+ * - 0.4: Request and reply buffers are now kept per port in CTRFID_I2CData[]
  *
  * Credits:
  * - Big thanks to Xander Soldaat for giving his work on other sensors's drivers code for ROBOTC.<br>
@@ -32,7 +33,7 @@
  * \author Sylvain CACHEUX (sylcalego@cacheux.info)
  * \author Xander Soldaat (mightor@gmail.com), version 0.2 and up
  * \date 20 february 2011
- * \version 0.3
+ * \version 0.4
  * \example codatech-rfid-test1.c
  * \example codatech-rfid-test2.c
  */
@@ -106,8 +107,7 @@ bool _CTRFIDreadStatus(tSensors link, ubyte &_status);
 
 // ---------------------------- Global variables ---------------------------------
 /*!< Global variables */
-tByteArray CTRFID_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray CTRFID_I2CReply;      /*!< Array to hold I2C reply data   */
+tI2CData CTRFID_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 bool CTRFIDreadContinuous[4] = {false, false, false, false};  /*!< Is the sensor configured for Continuous mode? */
 bool CTRFIDinitialised[4] = {false, false, false, false};     /*!< Has the sensor been initialised? */
@@ -121,17 +121,17 @@ bool CTRFIDinitialised[4] = {false, false, false, false};     /*!< Has the senso
  * @return true if no error occured, false if it did
  */
 bool _CTRFIDsendCommand(tSensors link, ubyte command) {
-  memset(CTRFID_I2CRequest, 0, sizeof(tByteArray)); // init request
+  memset(CTRFID_I2CData[link].request, 0, sizeof(CTRFID_I2CData[link].request)); // init request
 
   if (!CTRFIDinitialised[link] && (command != CTRFID_CMD_STARTAPPFIRM))
     CTRFIDinit(link);
 
-  CTRFID_I2CRequest[0] = 3;                          // Message size
-  CTRFID_I2CRequest[1] = CTRFID_I2C_ADDR;            // I2C Address of RFID sensor
-  CTRFID_I2CRequest[2] = CTRFID_OFFSET + CTRFID_CMD; // Address of cmd registry
-  CTRFID_I2CRequest[3] = command;                    // Mode to set
+  CTRFID_I2CData[link].request[0] = 3;                          // Message size
+  CTRFID_I2CData[link].request[1] = CTRFID_I2C_ADDR;            // I2C Address of RFID sensor
+  CTRFID_I2CData[link].request[2] = CTRFID_OFFSET + CTRFID_CMD; // Address of cmd registry
+  CTRFID_I2CData[link].request[3] = command;                    // Mode to set
 
-  return writeI2C(link, CTRFID_I2CRequest);
+  return writeI2C(link, CTRFID_I2CData[link].request);
 }
 
 /**
@@ -142,13 +142,13 @@ bool _CTRFIDsendCommand(tSensors link, ubyte command) {
  * @return true if no error occured, false if it did
  */
 bool _CTRFIDsendDummy(tSensors link) {
-  memset(CTRFID_I2CRequest, 0, sizeof(tByteArray)); // init request
+  memset(CTRFID_I2CData[link].request, 0, sizeof(CTRFID_I2CData[link].request)); // init request
 
-  CTRFID_I2CRequest[0] = 1;                          // Message size
-  CTRFID_I2CRequest[1] = CTRFID_I2C_ADDR;            // I2C Address of RFID sensor
+  CTRFID_I2CData[link].request[0] = 1;                          // Message size
+  CTRFID_I2CData[link].request[1] = CTRFID_I2C_ADDR;            // I2C Address of RFID sensor
 
-  return writeI2C(link, CTRFID_I2CRequest);
-  memset(CTRFID_I2CRequest, 0, sizeof(tByteArray));
+  return writeI2C(link, CTRFID_I2CData[link].request);
+  memset(CTRFID_I2CData[link].request, 0, sizeof(CTRFID_I2CData[link].request));
 }
 
 /**
@@ -160,7 +160,7 @@ bool _CTRFIDsendDummy(tSensors link) {
  * @return true if no error occured, false if it did
  */
 bool _CTRFIDreadStatus(tSensors link, ubyte &_status) {
-  memset(CTRFID_I2CRequest, 0, sizeof(tByteArray)); // init request
+  memset(CTRFID_I2CData[link].request, 0, sizeof(CTRFID_I2CData[link].request)); // init request
 
   if(!_CTRFIDsendDummy(link))
     return false;
@@ -171,14 +171,14 @@ bool _CTRFIDreadStatus(tSensors link, ubyte &_status) {
   if (CTRFIDreadContinuous[link])
     return true;
 
-  CTRFID_I2CRequest[0] = 2;               // Message size
-  CTRFID_I2CRequest[1] = CTRFID_I2C_ADDR; // I2C Address
-  CTRFID_I2CRequest[2] = CTRFID_STATUS;   // Address for sensor's status
+  CTRFID_I2CData[link].request[0] = 2;               // Message size
+  CTRFID_I2CData[link].request[1] = CTRFID_I2C_ADDR; // I2C Address
+  CTRFID_I2CData[link].request[2] = CTRFID_STATUS;   // Address for sensor's status
 
-  if (!writeI2C(link, CTRFID_I2CRequest, CTRFID_I2CReply, 1))
+  if (!writeI2C(link, CTRFID_I2CData[link].request, CTRFID_I2CData[link].reply, 1))
     return false;
 
-  _status = CTRFID_I2CReply[0];
+  _status = CTRFID_I2CData[link].reply[0];
 
   return true;
 }
@@ -268,11 +268,11 @@ bool CTRFIDreadTransponder(tSensors link, string &transponderID) {
   }
 
   // Retrieve the transponder's address
-  memset(CTRFID_I2CRequest, 0, sizeof(tByteArray));
-  CTRFID_I2CRequest[0] = 2;                                        // Message size
-  CTRFID_I2CRequest[1] = CTRFID_I2C_ADDR;                     // I2C Address of RFID sensor
-  CTRFID_I2CRequest[2] = CTRFID_OFFSET + CTRFID_BYTE1;   // Address byte1 registry
-  if (!writeI2C(link, CTRFID_I2CRequest, CTRFID_I2CReply, 5))
+  memset(CTRFID_I2CData[link].request, 0, sizeof(CTRFID_I2CData[link].request));
+  CTRFID_I2CData[link].request[0] = 2;                                        // Message size
+  CTRFID_I2CData[link].request[1] = CTRFID_I2C_ADDR;                     // I2C Address of RFID sensor
+  CTRFID_I2CData[link].request[2] = CTRFID_OFFSET + CTRFID_BYTE1;   // Address byte1 registry
+  if (!writeI2C(link, CTRFID_I2CData[link].request, CTRFID_I2CData[link].reply, 5))
     return false;
 
   // formating the value read into a string of 10 chars
@@ -281,7 +281,7 @@ bool CTRFIDreadTransponder(tSensors link, string &transponderID) {
   strcpy(transponderID, "");
   for (short i=0;i<5;i++) {
     // "%02x" will pad the hex number with a zero to make it two digitslong at all times.
-    stringFormat(transponderID, "%s%02x", transponderID, CTRFID_I2CReply[i]);
+    stringFormat(transponderID, "%s%02x", transponderID, CTRFID_I2CData[link].reply[i]);
   }
   return true;
 }
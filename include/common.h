@@ -47,10 +47,31 @@
  *         Changed clearI2CError to take ubyte for address, thanks Aswin
  * - 0.15: Removed motor mux and sensor mux functions and types out
  * - 0.16: Added max() and min() functions by Mike Henning, Max Bareiss
+ * - 0.17: Added split-phase I2C API: startI2C(), pollI2C() and collectI2C()<br>
+ *         writeI2C() overloads are now wrappers around the split-phase API
+ * - 0.18: Replaced the sleep(1) polling in waitForI2CBus() with a tunable spin, yield and
+ *         sleep backoff, see I2CsetWaitPolicy()<br>
+ *         Added optional per-port I2C latency histogram (__COMMON_H_I2C_HISTOGRAM__)
+ * - 0.19: Added per-port I2C statistics, see I2CStats[] and I2CdumpStats()
+ * - 0.20: Added optional I2C transaction trace buffer (__COMMON_H_I2C_TRACE__)
+ * - 0.21: Added readI2CRegs() for chunked multi-register reads and the bufTo*() decoders
+ * - 0.22: The sensor type check is now only done when the port's SensorType[] changes
+ * - 0.23: Added a per-port I2C error recovery policy, see I2CsetRecoveryPolicy()<br>
+ *         clearI2CError(tI2CDataPtr) no longer sleeps between the dummy packets
+ * - 0.24: Added per-port bus ownership with FIFO ordering and a priority class<br>
+ *         (__COMMON_H_I2C_ARBITRATION__), see tI2CPriority and I2CdumpBusLock()
+ * - 0.25: pollI2C() no longer waits for the reply to be read on the EV3<br>
+ *         The I2C statistics and the bus ownership are now opt-in, define __COMMON_H_I2C_STATS__
+ *         and __COMMON_H_I2C_ARBITRATION__ as 1 to use them<br>
+ *         startI2C() fails instead of waiting forever for a port held by an uncollected
+ *         transaction of the same struct or owner<br>
+ *         The tI2CData request and reply buffers are now sized with MAX_ARR_SIZE<br>
+ *         I2CTraceFreezeOnError also freezes the trace on transactions that end as i2cXferSkipped<br>
+ *         The sensor type check caches the validated SensorType[], I2CinvalidatePortCheck() is gone
  *
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 27 April 2011
- * \version 0.16
+ * \version 0.25
  */
 
 #pragma systemFile
@@ -70,9 +91,25 @@
 #ifndef __COMMON_H_SENSOR_CHECK__
 #define __COMMON_H_SENSOR_CHECK__ 1
 #else
-#warn "sensor checking disabled, I hope you know what you are doing!"
+#warning "sensor checking disabled, I hope you know what you are doing!"
 #endif
 
+/*!< define this as 1 to keep per-port I2C statistics */
+#ifndef __COMMON_H_I2C_STATS__
+#define __COMMON_H_I2C_STATS__ 0
+#endif
+
+/*!< define this as 1 to add per-port bus ownership to startI2C(), needed when several tasks use one port */
+#ifndef __COMMON_H_I2C_ARBITRATION__
+#define __COMMON_H_I2C_ARBITRATION__ 0
+#endif
+
+/*!< define this to keep a per-port histogram of I2C transaction latencies */
+//#define __COMMON_H_I2C_HISTOGRAM__
+
+/*!< define this to keep a trace of the last I2C_TRACE_SIZE transactions */
+//#define __COMMON_H_I2C_TRACE__
+
 #include "firmwareVersion.h"
 #if (kRobotCVersionNumeric < 410)
 #error "These drivers are only supported on RobotC version 4.10 or higher"
@@ -87,6 +124,12 @@
 #define MAX_ARR_SIZE 17
 #endif
 
+#define I2C_MAX_REPLY 16      /*!< Maximum number of bytes in a single I2C reply */
+
+#if (MAX_ARR_SIZE < I2C_MAX_REPLY + 1)
+#error "MAX_ARR_SIZE must be at least 17 to hold a full I2C packet"
+#endif
+
 /**
  * This define returns the smaller of the two numbers
  */
@@ -142,15 +185,39 @@ typedef enum tMUXSensor {
   msensor_S4_4 = 15
 } tMUXSensor;
 
+/*!< State of a split-phase I2C transaction */
+typedef enum tI2CXferStatus {
+  i2cXferIdle = 0,          /*!< No transaction has been started */
+  i2cXferPending = 1,       /*!< Transaction has been sent, waiting for the bus */
+  i2cXferDone = 2,          /*!< Transaction completed, reply (if any) is available */
+  i2cXferFailed = 3,        /*!< Transaction failed */
+  i2cXferSkipped = 4        /*!< Transaction failed and the recovery policy chose not to retry it */
+} tI2CXferStatus;
+
+/*!< Priority of a transaction when several tasks want the same port */
+typedef enum tI2CPriority {
+  i2cPriorityNormal = 0,    /*!< Served in order of arrival */
+  i2cPriorityHigh = 1       /*!< Served before any waiting normal priority transaction, use this for control loops */
+} tI2CPriority;
+
 typedef struct
 {
-  ubyte request[17];
+  ubyte request[MAX_ARR_SIZE];
   ubyte requestLen;
-  ubyte reply[17];
+  ubyte reply[MAX_ARR_SIZE];
   ubyte replyLen;
   ubyte address;
   tSensors port;
   TSensorTypes type;
+  tI2CXferStatus status;
+  ubyte _retries;
+  bool _resend;
+  bool _reading;
+  long _retryTime;
+  long _startTime;
+  tI2CPriority priority;    /*!< Priority of the transaction when several tasks want the port */
+  ubyte owner;              /*!< Id of the task that started the transaction, 0 if not set */
+  ubyte _lockClass;
 } tI2CData, *tI2CDataPtr;
 
 /**
@@ -172,9 +239,782 @@ typedef short tIntArray[MAX_ARR_SIZE];
 void clearI2CError(tSensors link, ubyte address);
 void clearI2Cbus(tSensors link);
 
-bool waitForI2CBus(tSensors link);
-bool writeI2C(tSensors link, tByteArray &request, tByteArray &reply, short replylen);
-bool writeI2C(tSensors link, tByteArray &request);
+bool waitForI2CBus(tSensors link);
+void I2CsetWaitPolicy(tSensors link, short spinPolls, short yieldPolls, short maxSleep);
+void I2CresetWaitPolicy(tSensors link);
+void _I2Cresend(tI2CDataPtr data);
+tI2CXferStatus _I2Crecover(tI2CDataPtr data);
+bool startI2C(tI2CDataPtr data);
+tI2CXferStatus _I2CfinishXfer(tI2CDataPtr data, tI2CXferStatus status);
+tI2CXferStatus pollI2C(tI2CDataPtr data);
+bool collectI2C(tI2CDataPtr data);
+bool writeI2C(tI2CDataPtr data);
+bool writeI2C(tSensors link, tByteArray &request, tByteArray &reply, short replylen);
+bool writeI2C(tSensors link, tByteArray &request);
+bool readI2CRegs(tI2CDataPtr data, ubyte reg, ubyte *buffer, short numbytes, ubyte autoIncFlag = 0);
+bool readI2CRegs(tSensors link, ubyte address, ubyte reg, ubyte *buffer, short numbytes, ubyte autoIncFlag = 0);
+
+#if (__COMMON_H_I2C_STATS__ == 1)
+/*!< Reasons for a failed I2C transaction, used to index tI2CStats.failuresByStatus */
+typedef enum tI2CFailReason {
+  i2cFailBusError = 0,      /*!< ERR_COMM_BUS_ERR (NXT) or i2cStatusFailed (EV3) */
+  i2cFailBadConfig = 1,     /*!< i2cStatusBadConfig (EV3) */
+  i2cFailBusBusy = 2,       /*!< The bus could not be cleared before sending */
+  i2cFailOther = 3          /*!< Any other status */
+} tI2CFailReason;
+
+#define I2C_FAIL_REASONS 4  /*!< Number of tI2CFailReason values */
+
+/*!< Counters for the I2C traffic on a single port */
+typedef struct
+{
+  long transactions;        /*!< Number of transactions started */
+  long bytesSent;           /*!< Bytes sent, including the address bytes */
+  long bytesReceived;       /*!< Bytes read back */
+  long busWaitTime;         /*!< Time spent waiting for the bus, in ms */
+  long retries;             /*!< Number of requests that were sent again after an error */
+  long clearErrors;         /*!< Number of clearI2CError() calls */
+  long failures;            /*!< Number of failed transactions */
+  long failuresByStatus[I2C_FAIL_REASONS];  /*!< Failed transactions, by tI2CFailReason */
+  long maxLatency;          /*!< Longest transaction, in ms */
+  TI2CStatus lastStatus;    /*!< Bus status of the last failed transaction */
+} tI2CStats;
+
+tI2CStats I2CStats[4];      /*!< Array to hold the I2C statistics for each port */
+
+/**
+ * Clear the I2C statistics for a port
+ * @param link the port number
+ */
+void I2CresetStats(tSensors link) {
+  memset(&I2CStats[link], 0, sizeof(tI2CStats));
+}
+
+/**
+ * Write a summary of the I2C statistics for a port to the debug stream
+ * @param link the port number
+ */
+void I2CdumpStats(tSensors link) {
+  writeDebugStreamLine("I2C port[%d]: %d xfers, %d bytes out, %d bytes in", link,
+                       I2CStats[link].transactions, I2CStats[link].bytesSent, I2CStats[link].bytesReceived);
+  writeDebugStreamLine("  bus wait: %d ms, max latency: %d ms", I2CStats[link].busWaitTime, I2CStats[link].maxLatency);
+  writeDebugStreamLine("  retries: %d, clearI2CError: %d", I2CStats[link].retries, I2CStats[link].clearErrors);
+  writeDebugStreamLine("  failures: %d (bus: %d, config: %d, busy: %d, other: %d), last status: %d", I2CStats[link].failures,
+                       I2CStats[link].failuresByStatus[i2cFailBusError], I2CStats[link].failuresByStatus[i2cFailBadConfig],
+                       I2CStats[link].failuresByStatus[i2cFailBusBusy], I2CStats[link].failuresByStatus[i2cFailOther],
+                       I2CStats[link].lastStatus);
+}
+
+/**
+ * Write a summary of the I2C statistics for all ports that have seen traffic
+ * to the debug stream
+ */
+void I2CdumpStats() {
+  for (short i = 0; i < 4; i++) {
+    if (I2CStats[i].transactions > 0)
+      I2CdumpStats((tSensors)i);
+  }
+}
+
+/**
+ * Record a failed transaction.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param busy true if the bus could not be cleared before the request was sent
+ */
+void _I2CstatsFailure(tSensors link, bool busy) {
+  TI2CStatus i2cstatus = nI2CStatus[link];
+  tI2CFailReason reason = i2cFailOther;
+
+  if (busy)
+    reason = i2cFailBusBusy;
+#if defined(NXT)
+  else if (i2cstatus == ERR_COMM_BUS_ERR)
+    reason = i2cFailBusError;
+#else
+  else if (i2cstatus == i2cStatusFailed)
+    reason = i2cFailBusError;
+  else if (i2cstatus == i2cStatusBadConfig)
+    reason = i2cFailBadConfig;
+#endif
+
+  I2CStats[link].failures++;
+  I2CStats[link].failuresByStatus[reason]++;
+  I2CStats[link].lastStatus = i2cstatus;
+}
+#endif // __COMMON_H_I2C_STATS__
+
+#ifndef I2C_WAIT_SPIN_STD
+#define I2C_WAIT_SPIN_STD       2   /*!< Back-to-back bus polls before yielding, standard speed ports */
+#endif
+
+#ifndef I2C_WAIT_YIELD_STD
+#define I2C_WAIT_YIELD_STD      4   /*!< Polls with a yield in between before sleeping, standard speed ports */
+#endif
+
+#ifndef I2C_WAIT_SPIN_FAST
+#define I2C_WAIT_SPIN_FAST      8   /*!< Back-to-back bus polls before yielding, fast ports */
+#endif
+
+#ifndef I2C_WAIT_YIELD_FAST
+#define I2C_WAIT_YIELD_FAST     16  /*!< Polls with a yield in between before sleeping, fast ports */
+#endif
+
+#ifndef I2C_WAIT_MAX_SLEEP
+#define I2C_WAIT_MAX_SLEEP      1   /*!< Longest sleep between bus polls, in ms */
+#endif
+
+/*!< How to wait for the I2C bus on a port */
+typedef struct
+{
+  short spinPolls;    /*!< Number of back-to-back polls */
+  short yieldPolls;   /*!< Number of polls with abortTimeslice() between them */
+  short maxSleep;     /*!< Sleeps start at 1 ms and double up to this value */
+  bool custom;        /*!< Set by I2CsetWaitPolicy(), otherwise defaults depend on the port speed */
+} tI2CWaitPolicy;
+
+tI2CWaitPolicy I2CWaitPolicy[4];   /*!< Array to hold the wait policy for each port */
+
+/**
+ * Set the way the drivers wait for the I2C bus on a port.  The bus is first polled
+ * spinPolls times back-to-back, then yieldPolls times, giving up the rest of the time
+ * slice in between.  After that, the task sleeps between polls, starting at 1 ms and
+ * doubling up to maxSleep ms.
+ * @param link the port number
+ * @param spinPolls number of back-to-back polls
+ * @param yieldPolls number of polls with a yield in between
+ * @param maxSleep the longest sleep between polls, in ms
+ */
+void I2CsetWaitPolicy(tSensors link, short spinPolls, short yieldPolls, short maxSleep) {
+  I2CWaitPolicy[link].spinPolls = spinPolls;
+  I2CWaitPolicy[link].yieldPolls = yieldPolls;
+  I2CWaitPolicy[link].maxSleep = (maxSleep < 1) ? 1 : maxSleep;
+  I2CWaitPolicy[link].custom = true;
+}
+
+/**
+ * Go back to the default wait policy for a port, which depends on whether the
+ * port is configured as a fast I2C port or not.
+ * @param link the port number
+ */
+void I2CresetWaitPolicy(tSensors link) {
+  I2CWaitPolicy[link].custom = false;
+}
+
+/**
+ * Wait a little before polling the bus again.  The longer the wait has been going
+ * on, the less aggressively the bus is polled.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param polls the number of times the bus has been polled so far
+ */
+void _I2CwaitBackoff(tSensors link, short polls) {
+  short spinPolls = I2C_WAIT_SPIN_STD;
+  short yieldPolls = I2C_WAIT_YIELD_STD;
+  short maxSleep = I2C_WAIT_MAX_SLEEP;
+  short sleepTime = 1;
+
+  if (I2CWaitPolicy[link].custom) {
+    spinPolls = I2CWaitPolicy[link].spinPolls;
+    yieldPolls = I2CWaitPolicy[link].yieldPolls;
+    maxSleep = I2CWaitPolicy[link].maxSleep;
+  }
+#ifdef NXT
+  else {
+    switch (SensorType[link])
+    {
+      case sensorI2CCustomFast:
+      case sensorI2CCustomFast9V:
+      case sensorI2CCustomFastSkipStates9V:
+      case sensorI2CCustomFastSkipStates:
+        spinPolls = I2C_WAIT_SPIN_FAST;
+        yieldPolls = I2C_WAIT_YIELD_FAST;
+        break;
+    }
+  }
+#endif // NXT
+
+  if (polls < spinPolls)
+    return;
+
+#if (__COMMON_H_I2C_STATS__ == 1)
+  long waitStart = nPgmTime;
+#endif // __COMMON_H_I2C_STATS__
+
+  if (polls < (spinPolls + yieldPolls)) {
+    abortTimeslice();
+  } else {
+    // Sleep for 1, 2, 4, ... ms, up to maxSleep
+    for (short i = spinPolls + yieldPolls; (i < polls) && (sleepTime < maxSleep); i++)
+      sleepTime *= 2;
+    sleep(min2(sleepTime, maxSleep));
+  }
+
+#if (__COMMON_H_I2C_STATS__ == 1)
+  I2CStats[link].busWaitTime += nPgmTime - waitStart;
+#endif // __COMMON_H_I2C_STATS__
+}
+
+#ifndef I2C_RECOVERY_RETRIES
+#if defined(NXT)
+#define I2C_RECOVERY_RETRIES    1   /*!< Default number of times a failed request is sent again */
+#else
+#define I2C_RECOVERY_RETRIES    0   /*!< Default number of times a failed request is sent again */
+#endif
+#endif
+
+#ifndef I2C_RECOVERY_FLUSH
+#define I2C_RECOVERY_FLUSH      5   /*!< Default number of dummy packets clearI2CError() sends */
+#endif
+
+#define I2C_RECOVERY_TIERS      4   /*!< Number of steps in the retry backoff schedule */
+
+/*!< What to do when a transaction fails on the bus */
+typedef enum tI2CRecoveryMode {
+  i2cRecoverResend = 0,     /*!< Clear the bus and send the request again, up to maxRetries times */
+  i2cRecoverFailFast = 1    /*!< Give up straight away, the transaction ends as i2cXferSkipped */
+} tI2CRecoveryMode;
+
+/*!< How to recover from I2C errors on a port */
+typedef struct
+{
+  tI2CRecoveryMode mode;    /*!< Resend or fail fast */
+  short maxRetries;         /*!< Maximum number of times a request is sent again */
+  short backoff[I2C_RECOVERY_TIERS];  /*!< Delay in ms before each retry, the last one is used for all later retries */
+  short timeBudget;         /*!< Longest a transaction may take, retries included, in ms.  0 means no limit */
+  short flushPackets;       /*!< Number of dummy packets clearI2CError() sends */
+  bool initialised;         /*!< Set once the defaults have been loaded */
+} tI2CRecoveryPolicy;
+
+/*!< How often each part of the recovery policy fired on a port */
+typedef struct
+{
+  long tierCount[I2C_RECOVERY_TIERS];   /*!< Retries, by backoff tier */
+  long exhausted;           /*!< Transactions that still failed after maxRetries */
+  long overBudget;          /*!< Transactions abandoned because the next retry would start after the time budget ran out */
+  long failedFast;          /*!< Transactions abandoned straight away in fail-fast mode */
+} tI2CRecoveryStats;
+
+tI2CRecoveryPolicy I2CRecoveryPolicy[4];  /*!< Array to hold the recovery policy for each port */
+tI2CRecoveryStats I2CRecoveryStats[4];    /*!< Array to hold the recovery counters for each port */
+
+/**
+ * Load the default recovery policy for a port, if that hasn't been done yet.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ */
+void _I2CinitRecoveryPolicy(tSensors link) {
+  if (I2CRecoveryPolicy[link].initialised)
+    return;
+
+  I2CRecoveryPolicy[link].mode = i2cRecoverResend;
+  I2CRecoveryPolicy[link].maxRetries = I2C_RECOVERY_RETRIES;
+  for (short i = 0; i < I2C_RECOVERY_TIERS; i++)
+    I2CRecoveryPolicy[link].backoff[i] = 0;
+  I2CRecoveryPolicy[link].timeBudget = 0;
+  I2CRecoveryPolicy[link].flushPackets = I2C_RECOVERY_FLUSH;
+  I2CRecoveryPolicy[link].initialised = true;
+}
+
+/**
+ * Set the way a port recovers from bus errors.  In i2cRecoverResend mode the bus is
+ * cleared and the request sent again, up to maxRetries times, as long as the next
+ * attempt fits in timeBudget.  A transaction that runs out of retries ends as
+ * i2cXferFailed, one that runs out of time, or any failure in i2cRecoverFailFast
+ * mode, ends as i2cXferSkipped.  Time-critical loops can check for that and skip
+ * the reading instead of stalling.
+ * @param link the port number
+ * @param mode i2cRecoverResend or i2cRecoverFailFast
+ * @param maxRetries maximum number of times a request is sent again
+ * @param timeBudget longest a transaction may take, retries included, in ms.  0 means no limit
+ * @param flushPackets number of dummy packets sent to clear the bus
+ */
+void I2CsetRecoveryPolicy(tSensors link, tI2CRecoveryMode mode, short maxRetries, short timeBudget, short flushPackets) {
+  _I2CinitRecoveryPolicy(link);
+  I2CRecoveryPolicy[link].mode = mode;
+  I2CRecoveryPolicy[link].maxRetries = (maxRetries < 0) ? 0 : maxRetries;
+  I2CRecoveryPolicy[link].timeBudget = (timeBudget < 0) ? 0 : timeBudget;
+  I2CRecoveryPolicy[link].flushPackets = (flushPackets < 1) ? 1 : flushPackets;
+}
+
+/**
+ * Set the delay before each retry.  Retries after the fourth use the last delay.
+ * The delay does not block, pollI2C() keeps reporting the transaction as pending
+ * until it is time to send it again.
+ * @param link the port number
+ * @param first delay before the first retry, in ms
+ * @param second delay before the second retry, in ms
+ * @param third delay before the third retry, in ms
+ * @param rest delay before the fourth and later retries, in ms
+ */
+void I2CsetRecoveryBackoff(tSensors link, short first, short second, short third, short rest) {
+  _I2CinitRecoveryPolicy(link);
+  I2CRecoveryPolicy[link].backoff[0] = first;
+  I2CRecoveryPolicy[link].backoff[1] = second;
+  I2CRecoveryPolicy[link].backoff[2] = third;
+  I2CRecoveryPolicy[link].backoff[3] = rest;
+}
+
+/**
+ * Go back to the default recovery policy for a port: resend I2C_RECOVERY_RETRIES
+ * times without a delay and without a time budget.
+ * @param link the port number
+ */
+void I2CresetRecoveryPolicy(tSensors link) {
+  I2CRecoveryPolicy[link].initialised = false;
+}
+
+/**
+ * Clear the recovery counters for a port
+ * @param link the port number
+ */
+void I2CresetRecoveryStats(tSensors link) {
+  memset(&I2CRecoveryStats[link], 0, sizeof(tI2CRecoveryStats));
+}
+
+/**
+ * Write the recovery counters for a port to the debug stream
+ * @param link the port number
+ */
+void I2CdumpRecoveryStats(tSensors link) {
+  writeDebugStreamLine("I2C port[%d] recovery: retries by tier: %d %d %d %d", link,
+                       I2CRecoveryStats[link].tierCount[0], I2CRecoveryStats[link].tierCount[1],
+                       I2CRecoveryStats[link].tierCount[2], I2CRecoveryStats[link].tierCount[3]);
+  writeDebugStreamLine("  exhausted: %d, over budget: %d, failed fast: %d", I2CRecoveryStats[link].exhausted,
+                       I2CRecoveryStats[link].overBudget, I2CRecoveryStats[link].failedFast);
+}
+
+/**
+ * Number of dummy packets clearI2CError() should send on a port.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @return the number of packets
+ */
+short _I2CflushPackets(tSensors link) {
+  _I2CinitRecoveryPolicy(link);
+  return I2CRecoveryPolicy[link].flushPackets;
+}
+
+/**
+ * Clear the bus and send the request of a failed transaction again.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param data pointer to the I2C data struct of the transaction
+ */
+void _I2Cresend(tI2CDataPtr data) {
+  data->_resend = false;
+  data->_reading = false;
+  clearI2CError(data->port, data->address);
+  sendI2CMsg(data->port, &data->request[0], data->replyLen);
+}
+
+/**
+ * Apply the port's recovery policy to a transaction that failed on the bus.  The
+ * transaction is either sent again (now, or once the backoff delay is over) or
+ * finished as failed or skipped.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param data pointer to the I2C data struct of the transaction
+ * @return the state of the transaction
+ */
+tI2CXferStatus _I2Crecover(tI2CDataPtr data) {
+  tSensors link = data->port;
+  tI2CXferStatus result = i2cXferFailed;
+  short tier = 0;
+  short delay = 0;
+
+  _I2CinitRecoveryPolicy(link);
+
+  if (I2CRecoveryPolicy[link].mode == i2cRecoverFailFast) {
+    I2CRecoveryStats[link].failedFast++;
+    result = i2cXferSkipped;
+  }
+  else if (data->_retries >= I2CRecoveryPolicy[link].maxRetries) {
+    I2CRecoveryStats[link].exhausted++;
+  }
+  else {
+    tier = (data->_retries < I2C_RECOVERY_TIERS) ? data->_retries : I2C_RECOVERY_TIERS - 1;
+    delay = I2CRecoveryPolicy[link].backoff[tier];
+
+    if ((I2CRecoveryPolicy[link].timeBudget > 0) &&
+        (nPgmTime - data->_startTime + delay > I2CRecoveryPolicy[link].timeBudget)) {
+      I2CRecoveryStats[link].overBudget++;
+      result = i2cXferSkipped;
+    }
+    else {
+      data->_retries++;
+      I2CRecoveryStats[link].tierCount[tier]++;
+#if (__COMMON_H_I2C_STATS__ == 1)
+      I2CStats[link].retries++;
+#endif // __COMMON_H_I2C_STATS__
+
+      if (delay > 0) {
+        data->_resend = true;
+        data->_retryTime = nPgmTime + delay;
+      }
+      else
+        _I2Cresend(data);
+
+      return data->status;
+    }
+  }
+
+#ifdef __COMMON_H_DEBUG__
+  playSound(soundLowBuzz);
+  while (bSoundActive) {}
+#endif // __COMMON_H_DEBUG__
+#if (__COMMON_H_I2C_STATS__ == 1)
+  _I2CstatsFailure(link, false);
+#endif // __COMMON_H_I2C_STATS__
+  return _I2CfinishXfer(data, result);
+}
+
+#if (__COMMON_H_I2C_ARBITRATION__ == 1)
+#define I2C_LOCK_CLASSES  2   /*!< Number of tI2CPriority values */
+#define I2C_LOCK_OWNERS   8   /*!< Number of owner ids with their own wait counter */
+
+#ifndef I2C_LOCK_YIELDS
+#define I2C_LOCK_YIELDS   4   /*!< Yields while waiting for a port before sleeping between checks */
+#endif
+
+/*!< Ownership of a port, plus contention counters for each priority class */
+typedef struct
+{
+  word nextTicket[I2C_LOCK_CLASSES];    /*!< Next ticket to hand out */
+  word nowServing[I2C_LOCK_CLASSES];    /*!< Ticket whose turn it is */
+  bool busy;                            /*!< Set while a transaction owns the port */
+  tI2CDataPtr holder;                   /*!< Struct of the transaction that owns the port */
+  ubyte owner;                          /*!< Owner id of the transaction that owns the port */
+  long acquisitions[I2C_LOCK_CLASSES];  /*!< Number of times the port was taken */
+  long contended[I2C_LOCK_CLASSES];     /*!< Number of times the port was not free straight away */
+  long waitTime[I2C_LOCK_CLASSES];      /*!< Total time spent waiting for the port, in ms */
+  long maxWait[I2C_LOCK_CLASSES];       /*!< Longest wait for the port, in ms */
+} tI2CBusLock;
+
+tI2CBusLock I2CBusLock[4];                  /*!< Array to hold the ownership state of each port */
+long I2COwnerWaitTime[I2C_LOCK_OWNERS];     /*!< Total time spent waiting for any port, by owner id, in ms */
+
+/**
+ * Take ownership of the transaction's port.  Requests of the same priority are
+ * served in the order they arrived.  A waiting i2cPriorityHigh request goes before
+ * any i2cPriorityNormal one that hasn't got the port yet.  A request whose own struct,
+ * or whose owner id if it is not 0, already holds the port would wait for itself
+ * forever, it is turned down instead.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param data pointer to the I2C data struct of the transaction
+ * @return true if the port was taken, false if the struct or owner already holds it
+ */
+bool _I2CacquireBus(tI2CDataPtr data) {
+  tSensors link = data->port;
+  short cls = (data->priority == i2cPriorityHigh) ? 1 : 0;
+  short polls = 0;
+  long waitStart = nPgmTime;
+  long waited = 0;
+  word ticket = 0;
+
+  hogCPU();
+  if (I2CBusLock[link].busy && (I2CBusLock[link].holder == data)) {
+    releaseCPU();
+    return false;
+  }
+  if (I2CBusLock[link].busy && (data->owner != 0) && (I2CBusLock[link].owner == data->owner)) {
+    releaseCPU();
+    data->_lockClass = 0;
+    return false;
+  }
+  ticket = I2CBusLock[link].nextTicket[cls];
+  I2CBusLock[link].nextTicket[cls]++;
+  releaseCPU();
+
+  while (true) {
+    hogCPU();
+    if (!I2CBusLock[link].busy && (I2CBusLock[link].nowServing[cls] == ticket) &&
+        ((cls == 1) || (I2CBusLock[link].nextTicket[1] == I2CBusLock[link].nowServing[1]))) {
+      I2CBusLock[link].busy = true;
+      I2CBusLock[link].holder = data;
+      I2CBusLock[link].owner = data->owner;
+      releaseCPU();
+      break;
+    }
+    releaseCPU();
+
+    if (polls++ < I2C_LOCK_YIELDS)
+      abortTimeslice();
+    else
+      sleep(1);
+  }
+
+  data->_lockClass = cls + 1;
+  I2CBusLock[link].acquisitions[cls]++;
+
+  if (polls > 0) {
+    waited = nPgmTime - waitStart;
+    I2CBusLock[link].contended[cls]++;
+    I2CBusLock[link].waitTime[cls] += waited;
+    if (waited > I2CBusLock[link].maxWait[cls])
+      I2CBusLock[link].maxWait[cls] = waited;
+    if (data->owner < I2C_LOCK_OWNERS)
+      I2COwnerWaitTime[data->owner] += waited;
+  }
+
+  return true;
+}
+
+/**
+ * Give up ownership of the transaction's port, the next request in line gets it.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param data pointer to the I2C data struct of the transaction
+ */
+void _I2CreleaseBus(tI2CDataPtr data) {
+  if (data->_lockClass == 0)
+    return;
+
+  hogCPU();
+  I2CBusLock[data->port].nowServing[data->_lockClass - 1]++;
+  I2CBusLock[data->port].busy = false;
+  releaseCPU();
+  data->_lockClass = 0;
+}
+
+/**
+ * Forget about all owners and waiters of a port.  Only use this to recover after a
+ * task was stopped while it owned the port.
+ * @param link the port number
+ */
+void I2CresetBusLock(tSensors link) {
+  hogCPU();
+  for (short i = 0; i < I2C_LOCK_CLASSES; i++)
+    I2CBusLock[link].nowServing[i] = I2CBusLock[link].nextTicket[i];
+  I2CBusLock[link].busy = false;
+  releaseCPU();
+}
+
+/**
+ * Write the contention counters for a port to the debug stream
+ * @param link the port number
+ */
+void I2CdumpBusLock(tSensors link) {
+  writeDebugStreamLine("I2C port[%d] ownership:", link);
+  for (short i = 0; i < I2C_LOCK_CLASSES; i++) {
+    writeDebugStreamLine("  %s: %d taken, %d contended, waited %d ms (max %d ms)", (i == 0) ? "normal" : "high",
+                         I2CBusLock[link].acquisitions[i], I2CBusLock[link].contended[i],
+                         I2CBusLock[link].waitTime[i], I2CBusLock[link].maxWait[i]);
+  }
+}
+#endif // __COMMON_H_I2C_ARBITRATION__
+
+#ifdef __COMMON_H_I2C_HISTOGRAM__
+#define I2C_HIST_BUCKETS 8     /*!< Number of buckets in the latency histogram */
+
+/*!< Lower bound of each latency histogram bucket, in ms */
+const short I2CLatencyBucketStart[I2C_HIST_BUCKETS] = {0, 1, 2, 3, 4, 6, 10, 20};
+
+long I2CLatencyHist[4][I2C_HIST_BUCKETS];   /*!< Transaction latency histogram for each port */
+
+/**
+ * Add a transaction to the latency histogram.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param latency the time the transaction took, in ms
+ */
+void _I2ChistAdd(tSensors link, long latency) {
+  short bucket = I2C_HIST_BUCKETS - 1;
+
+  while ((bucket > 0) && (latency < I2CLatencyBucketStart[bucket]))
+    bucket--;
+
+  I2CLatencyHist[link][bucket]++;
+}
+
+/**
+ * Clear the latency histogram for a port
+ * @param link the port number
+ */
+void I2CresetHistogram(tSensors link) {
+  for (short i = 0; i < I2C_HIST_BUCKETS; i++)
+    I2CLatencyHist[link][i] = 0;
+}
+
+/**
+ * Find the histogram bucket that holds the specified percentile of transactions.
+ * @param link the port number
+ * @param percentile the percentile to look for, 50 for the median
+ * @return the lower bound of the bucket in ms, or -1 if there is no data
+ */
+short I2ClatencyPercentile(tSensors link, short percentile) {
+  long total = 0;
+  long count = 0;
+
+  for (short i = 0; i < I2C_HIST_BUCKETS; i++)
+    total += I2CLatencyHist[link][i];
+
+  if (total == 0)
+    return -1;
+
+  for (short i = 0; i < I2C_HIST_BUCKETS; i++) {
+    count += I2CLatencyHist[link][i];
+    if ((count * 100) >= (total * percentile))
+      return I2CLatencyBucketStart[i];
+  }
+  return I2CLatencyBucketStart[I2C_HIST_BUCKETS - 1];
+}
+
+/**
+ * Write the latency histogram for a port to the debug stream
+ * @param link the port number
+ */
+void I2CdumpHistogram(tSensors link) {
+  writeDebugStreamLine("I2C latency port[%d]: p50 >= %d ms, p99 >= %d ms", link,
+                       I2ClatencyPercentile(link, 50), I2ClatencyPercentile(link, 99));
+  for (short i = 0; i < (I2C_HIST_BUCKETS - 1); i++)
+    writeDebugStreamLine("  %2d-%2d ms: %d", I2CLatencyBucketStart[i], I2CLatencyBucketStart[i + 1] - 1, I2CLatencyHist[link][i]);
+  writeDebugStreamLine("    %2d+ ms: %d", I2CLatencyBucketStart[I2C_HIST_BUCKETS - 1], I2CLatencyHist[link][I2C_HIST_BUCKETS - 1]);
+}
+#endif // __COMMON_H_I2C_HISTOGRAM__
+
+#ifdef __COMMON_H_I2C_TRACE__
+#ifndef I2C_TRACE_SIZE
+#define I2C_TRACE_SIZE 32   /*!< Number of transactions kept in the trace buffer */
+#endif
+
+/*!< A single transaction in the I2C trace buffer */
+typedef struct
+{
+  long time;                /*!< nPgmTime at the start of the transaction */
+  ubyte port;               /*!< Sensor port */
+  ubyte address;            /*!< I2C address */
+  ubyte reg;                /*!< First byte after the address, usually the register */
+  ubyte requestLen;         /*!< Message size, including the address */
+  ubyte replyLen;           /*!< Number of bytes requested in reply */
+  ubyte retries;            /*!< Number of times the request was resent */
+  tI2CXferStatus status;    /*!< How the transaction ended */
+  short duration;           /*!< Time the transaction took, in ms */
+} tI2CTraceRecord;
+
+tI2CTraceRecord I2CTrace[I2C_TRACE_SIZE];   /*!< Ring buffer holding the trace */
+short I2CTraceHead = 0;                     /*!< Next record to be written */
+long I2CTraceCount = 0;                     /*!< Total number of records written */
+bool I2CTraceFrozen = false;                /*!< No more records are added while this is set */
+bool I2CTraceFreezeOnError = false;         /*!< Freeze the trace after the first transaction that ends as i2cXferFailed or i2cXferSkipped */
+
+/**
+ * Add a finished transaction to the trace buffer.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param data pointer to the I2C data struct of the transaction
+ */
+void _I2CtraceAdd(tI2CDataPtr data) {
+  short idx = I2CTraceHead;
+
+  if (I2CTraceFrozen)
+    return;
+
+  I2CTrace[idx].time = data->_startTime;
+  I2CTrace[idx].port = data->port;
+  I2CTrace[idx].address = data->request[1];
+  I2CTrace[idx].reg = data->request[2];
+  I2CTrace[idx].requestLen = data->request[0];
+  I2CTrace[idx].replyLen = data->replyLen;
+  I2CTrace[idx].retries = data->_retries;
+  I2CTrace[idx].status = data->status;
+  I2CTrace[idx].duration = nPgmTime - data->_startTime;
+
+  I2CTraceHead = (idx + 1) % I2C_TRACE_SIZE;
+  I2CTraceCount++;
+
+  if (I2CTraceFreezeOnError && (data->status == i2cXferFailed || data->status == i2cXferSkipped))
+    I2CTraceFrozen = true;
+}
+
+/**
+ * Clear the trace buffer and start recording again
+ */
+void I2CtraceReset() {
+  I2CTraceFrozen = true;
+  memset(&I2CTrace[0], 0, sizeof(I2CTrace));
+  I2CTraceHead = 0;
+  I2CTraceCount = 0;
+  I2CTraceFrozen = false;
+}
+
+/**
+ * Write the trace buffer to the debug stream, oldest transaction first.  Recording
+ * is paused while the dump is in progress, so call this from a task that is not
+ * time critical, or after the trace has been frozen.
+ */
+void I2CtraceDump() {
+  bool wasFrozen = I2CTraceFrozen;
+  short numRecords = min2(I2CTraceCount, I2C_TRACE_SIZE);
+  short idx = (I2CTraceHead - numRecords + I2C_TRACE_SIZE) % I2C_TRACE_SIZE;
+
+  I2CTraceFrozen = true;
+
+  writeDebugStreamLine("I2C trace: %d of %d transactions%s", numRecords, I2CTraceCount, wasFrozen ? " (frozen)" : "");
+  writeDebugStreamLine("    time port addr  reg out  in try st  ms");
+  for (short i = 0; i < numRecords; i++) {
+    writeDebugStreamLine("%8d %4d 0x%02X 0x%02X %3d %3d %3d %2d %3d", I2CTrace[idx].time, I2CTrace[idx].port,
+                         I2CTrace[idx].address, I2CTrace[idx].reg, I2CTrace[idx].requestLen, I2CTrace[idx].replyLen,
+                         I2CTrace[idx].retries, I2CTrace[idx].status, I2CTrace[idx].duration);
+    idx = (idx + 1) % I2C_TRACE_SIZE;
+  }
+
+  I2CTraceFrozen = wasFrozen;
+}
+#endif // __COMMON_H_I2C_TRACE__
+
+#if (__COMMON_H_SENSOR_CHECK__ == 1)
+#define I2C_PORT_UNCHECKED ((TSensorTypes)255)    /*!< Not a valid sensor type, marks a port that has not been validated yet */
+
+TSensorTypes I2CPortCheckedType[4] = {I2C_PORT_UNCHECKED, I2C_PORT_UNCHECKED, I2C_PORT_UNCHECKED, I2C_PORT_UNCHECKED};   /*!< The last SensorType[] validated for each port */
+
+/**
+ * Check that the port has been configured as an I2C sensor.  If it hasn't, this will
+ * complain loudly and stop the program.  The validated type is cached, the check is only
+ * done again when SensorType[] for the port no longer matches it.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ */
+void _I2CcheckSensorType(tSensors link)
+{
+  switch (SensorType[link])
+  {
+  	case sensorSONAR:											break;
+    case sensorI2CCustom:                 break;
+    case sensorI2CCustom9V:               break;
+#ifdef EV3
+		case sensorEV3_EnergyMeter:						break;  // for some reason, some I2C sensors are identified as this
+		case sensorEV3_GenericI2C:						break;
+#else // This is an NXT
+    case sensorI2CCustomFast:             break;
+    case sensorI2CCustomFast9V:           break;
+    case sensorI2CCustomFastSkipStates9V: break;
+    case sensorI2CCustomFastSkipStates:   break;
+#endif // EV3/NXT
+    default:
+      hogCPU();
+      playSound(soundException);
+      eraseDisplay();
+#ifdef EV3
+			setLEDColor(ledRedPulse);
+#endif // EV3
+      writeDebugStreamLine("ERROR, You have not setup the sensor port correctly. ");
+      writeDebugStreamLine("Please refer to one of the examples.");
+      writeDebugStreamLine("Detected SensorType on port[%d]: %d", link, SensorType[link]);
+      sleep(10000);
+      stopAllTasks();
+  }
+
+  I2CPortCheckedType[link] = SensorType[link];
+}
+#endif // __COMMON_H_SENSOR_CHECK__
 
 /**
  * Clear out the error state on I2C bus by sending a bunch of dummy
@@ -184,20 +1024,7 @@ bool writeI2C(tSensors link, tByteArray &request);
  */
 #ifdef NXT
 void clearI2CError(tI2CDataPtr data) {
-  ubyte error_array[2];
-  error_array[0] = 1;           // Message size
-  error_array[1] = data->address; // I2C Address
-
-#ifdef __COMMON_H_DEBUG__
-  eraseDisplay();
-  displayTextLine(3, "rxmit: %d", error_array[1]);
-  sleep(2000);
-#endif // __COMMON_H_DEBUG__
-
-  for (short i = 0; i < 5; i++) {
-    sendI2CMsg(data->port, &error_array[0], 0);
-    sleep(10);
-  }
+  clearI2CError(data->port, data->address);
 }
 #endif
 
@@ -213,13 +1040,17 @@ void clearI2CError(tSensors link, ubyte address) {
   error_array[0] = 1;           // Message size
   error_array[1] = address; // I2C Address
 
+#if (__COMMON_H_I2C_STATS__ == 1)
+  I2CStats[link].clearErrors++;
+#endif // __COMMON_H_I2C_STATS__
+
 #ifdef __COMMON_H_DEBUG__
   eraseDisplay();
   displayTextLine(3, "rxmit: %d", error_array[1]);
   sleep(2000);
 #endif // __COMMON_H_DEBUG__
 
-  for (short i = 0; i < 5; i++) {
+  for (short i = 0; i < _I2CflushPackets(link); i++) {
     sendI2CMsg(link, &error_array[0], 0);
     waitForI2CBus(link);
   }
@@ -233,6 +1064,8 @@ void clearI2CError(tSensors link, ubyte address) {
  */
 bool waitForI2CBus(tSensors link)
 {
+  short polls = 0;
+
   while (true)
   {
     TI2CStatus i2cstatus = nI2CStatus[link];
@@ -270,7 +1103,7 @@ bool waitForI2CBus(tSensors link)
   #endif // __COMMON_H_DEBUG__
         return false;
     }
-    sleep(1);
+    _I2CwaitBackoff(link, polls++);
   }
 }
 
@@ -283,6 +1116,8 @@ bool waitForI2CBus(tSensors link)
  */
 bool waitForI2CBus(tI2CDataPtr data)
 {
+  short polls = 0;
+
   while (true)
   {
     //i2cstatus = nI2CStatus[link];
@@ -318,46 +1153,47 @@ bool waitForI2CBus(tI2CDataPtr data)
   #endif // __COMMON_H_DEBUG__
         return false;
     }
-    sleep(1);
+    _I2CwaitBackoff(data->port, polls++);
   }
 }
 
-bool writeI2C(tI2CDataPtr data) {
+/**
+ * Start an I2C transaction without waiting for it to complete.  The bus is checked
+ * (and cleared, if needed) before the request is sent.  Use pollI2C() or collectI2C()
+ * to retrieve the result.  Transactions on different ports can be in flight at the
+ * same time.
+ *
+ * With __COMMON_H_I2C_ARBITRATION__ the transaction owns its port from here until it
+ * is done or has failed, other tasks wait their turn, see tI2CPriority.  Every startI2C()
+ * must therefore be followed by collectI2C(), or by pollI2C() until the transaction is
+ * no longer pending.  Starting a transaction with a struct whose previous transaction
+ * was never collected fails and gives up that transaction.  So does starting one while
+ * another struct with the same non-zero owner id holds the port.
+ *
+ * The ownership is kept with hogCPU() and releaseCPU().  ROBOTC does not nest these,
+ * so a task that called hogCPU() itself is no longer hogging the CPU once startI2C()
+ * returns.  Rely on the bus ownership to keep other tasks off the port instead.
+ * @param data pointer to the I2C data struct holding the request
+ * @return true if the request was sent, false if it could not be
+ */
+bool startI2C(tI2CDataPtr data) {
 #ifdef DEBUG_COMMON_H
-	writeDebugStreamLine("writeI2C(tI2CDataPtr data) called"); sleep(200);
+	writeDebugStreamLine("startI2C(tI2CDataPtr data) called"); sleep(200);
 #endif // DEBUG_COMMON_H
 
+  data->_startTime = nPgmTime;
+
 #if (__COMMON_H_SENSOR_CHECK__ == 1)
-  //TSensorTypes type = SensorType[link];
+  if (SensorType[data->port] != I2CPortCheckedType[data->port])
+    _I2CcheckSensorType(data->port);
+#endif // __COMMON_H_SENSOR_CHECK__
 
-  switch (SensorType[data->port])
-  {
-  	case sensorSONAR:											break;
-    case sensorI2CCustom:                 break;
-    case sensorI2CCustom9V:               break;
-#ifdef EV3
-		case sensorEV3_EnergyMeter:						break;  // for some reason, some I2C sensors are identified as this
-		case sensorEV3_GenericI2C:						break;
-#else // This is an NXT
-    case sensorI2CCustomFast:             break;
-    case sensorI2CCustomFast9V:           break;
-    case sensorI2CCustomFastSkipStates9V: break;
-    case sensorI2CCustomFastSkipStates:   break;
-#endif // EV3/NXT
-    default:
-      hogCPU();
-      playSound(soundException);
-      eraseDisplay();
-#ifdef EV3
-			setLEDColor(ledRedPulse);
-#endif // EV3
-      writeDebugStreamLine("ERROR, You have not setup the sensor port correctly. ");
-      writeDebugStreamLine("Please refer to one of the examples.");
-      writeDebugStreamLine("Detected SensorType on port[%d]: %d", data->port, SensorType[data->port]);
-      sleep(10000);
-      stopAllTasks();
+#if (__COMMON_H_I2C_ARBITRATION__ == 1)
+  if (!_I2CacquireBus(data)) {
+    _I2CfinishXfer(data, i2cXferFailed);
+    return false;
   }
-#endif // __COMMON_H_SENSOR_CHECK__
+#endif // __COMMON_H_I2C_ARBITRATION__
 
 #ifdef NXT
   if (!waitForI2CBus(data->port)) {
@@ -368,17 +1204,22 @@ bool writeI2C(tI2CDataPtr data) {
 
     // Let's try the bus again, see if the above packets flushed it out
     // clearI2CBus(link);
-    if (!waitForI2CBus(data->port))
+    if (!waitForI2CBus(data->port)) {
+#if (__COMMON_H_I2C_STATS__ == 1)
+      _I2CstatsFailure(data->port, true);
+#endif // __COMMON_H_I2C_STATS__
+      _I2CfinishXfer(data, i2cXferFailed);
       return false;
+    }
   }
 #endif
 
 #ifdef DEBUG_COMMON_H
-  writeDebugStreamLine("writeI2C: port: %d, addr: 0x%02X, len: %d", data->port, data->address, data->requestLen); sleep(200);
+  writeDebugStreamLine("startI2C: port: %d, addr: 0x%02X, len: %d", data->port, data->address, data->requestLen); sleep(200);
 #endif
 
 #ifdef DEBUG_COMMON_H
-  writeDebugStream("writeI2C: data->request: ");
+  writeDebugStream("startI2C: data->request: ");
 	for (int i = 0; i < (data->requestLen + 1); i++)
 	{
 		writeDebugStream("0x%02X ", data->request[i]);
@@ -386,189 +1227,374 @@ bool writeI2C(tI2CDataPtr data) {
 	writeDebugStream("\n");
 #endif // DEBUG_COMMON_H
 
+  data->_retries = 0;
+  data->_resend = false;
+  data->_reading = false;
+  data->status = i2cXferPending;
   sendI2CMsg(data->port, &data->request[0], data->replyLen);
 
-  if (!waitForI2CBus(data)) {
+#if (__COMMON_H_I2C_STATS__ == 1)
+  I2CStats[data->port].transactions++;
+  I2CStats[data->port].bytesSent += data->request[0];
+#endif // __COMMON_H_I2C_STATS__
+
+  return true;
+}
+
+/**
+ * Mark a transaction as finished and record its latency.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param data pointer to the I2C data struct of the transaction
+ * @param status the final state of the transaction
+ * @return the final state of the transaction
+ */
+tI2CXferStatus _I2CfinishXfer(tI2CDataPtr data, tI2CXferStatus status) {
+  data->status = status;
+
+#if (__COMMON_H_I2C_ARBITRATION__ == 1)
+  _I2CreleaseBus(data);
+#endif // __COMMON_H_I2C_ARBITRATION__
+
+#if (__COMMON_H_I2C_STATS__ == 1)
+  long latency = nPgmTime - data->_startTime;
+
+  if (latency > I2CStats[data->port].maxLatency)
+    I2CStats[data->port].maxLatency = latency;
+
+  if (status == i2cXferDone)
+    I2CStats[data->port].bytesReceived += data->replyLen;
+#endif // __COMMON_H_I2C_STATS__
+
+#ifdef __COMMON_H_I2C_HISTOGRAM__
+  _I2ChistAdd(data->port, nPgmTime - data->_startTime);
+#endif // __COMMON_H_I2C_HISTOGRAM__
+
+#ifdef __COMMON_H_I2C_TRACE__
+  _I2CtraceAdd(data);
+#endif // __COMMON_H_I2C_TRACE__
+
+  return status;
+}
+
+/**
+ * Check on the progress of a transaction started with startI2C().  This function
+ * does not wait for the bus.  When the transaction has completed, the reply (if any)
+ * is read into data->reply.  On the EV3 reading the reply is a transfer of its own,
+ * the transaction stays pending until a later poll sees it complete.  A failed transaction is handled according to the port's
+ * recovery policy, see I2CsetRecoveryPolicy().
+ * @param data pointer to the I2C data struct of the transaction
+ * @return the current state of the transaction
+ */
+tI2CXferStatus pollI2C(tI2CDataPtr data) {
+  if (data->status != i2cXferPending)
+    return data->status;
+
+  // A retry has been scheduled, send the request again once the backoff delay is over
+  if (data->_resend) {
+    if (nPgmTime >= data->_retryTime)
+      _I2Cresend(data);
+    return data->status;
+  }
+
+  switch (nI2CStatus[data->port])
+  {
+#if defined(NXT)
+    case NO_ERR:
+#else  // this must be an EV3
+		case i2cStatusStopped:
+    case i2cStatusNoError:
+#endif
+      if (data->replyLen > 0) {
+#ifdef DEBUG_COMMON_H
+        writeDebugStreamLine("pollI2C: initiating read: data->replyLen: %d", data->replyLen); sleep(200);
+#endif // DEBUG_COMMON_H
 #ifdef EV3
-	#ifdef DEBUG_COMMON_H
-			writeDebugStreamLine("waiting for the bus has failed");	 sleep(200);
-	#endif
-		return false;
-#else
-    clearI2CError(data->port, data->address);
-    sendI2CMsg(data->port, &data->request[0], data->replyLen);
-    if (!waitForI2CBus(data))
-      return false;
+        // The reply has been fetched by the previous poll's read
+        if (data->_reading)
+          return _I2CfinishXfer(data, i2cXferDone);
+#endif // EV3
+        readI2CReply(data->port, &data->reply[0], data->replyLen);
+#ifdef EV3
+        data->_reading = true;
+        return data->status;
+#endif // EV3
+      }
+      return _I2CfinishXfer(data, i2cXferDone);
+
+#if defined(NXT)
+    case ERR_COMM_BUS_ERR:
+      return _I2Crecover(data);
+#else  // this must be an EV3
+    case i2cStatusFailed:
+      // A failed read of the reply isn't retried, the request has already been acted on
+      if (data->_reading) {
+#if (__COMMON_H_I2C_STATS__ == 1)
+        _I2CstatsFailure(data->port, false);
+#endif // __COMMON_H_I2C_STATS__
+        return _I2CfinishXfer(data, i2cXferFailed);
+      }
+      return _I2Crecover(data);
+
+    case i2cStatusBadConfig:
+#ifdef DEBUG_COMMON_H
+      writeDebugStreamLine("waiting for the bus has failed");	 sleep(200);
+#endif // DEBUG_COMMON_H
+  #ifdef __COMMON_H_DEBUG__
+      playSound(soundLowBuzz);
+      while (bSoundActive) {}
+  #endif // __COMMON_H_DEBUG__
+#if (__COMMON_H_I2C_STATS__ == 1)
+      _I2CstatsFailure(data->port, false);
+#endif // __COMMON_H_I2C_STATS__
+      return _I2CfinishXfer(data, i2cXferFailed);
 #endif
+
+    default:
+      return data->status;
   }
+}
 
-  if (data->replyLen == 0)
-    return true;
+/**
+ * Wait for a transaction started with startI2C() to complete.
+ * @param data pointer to the I2C data struct of the transaction
+ * @return true if no error occured, false if it did
+ */
+bool collectI2C(tI2CDataPtr data) {
+  short polls = 0;
+
+  while (pollI2C(data) == i2cXferPending)
+    _I2CwaitBackoff(data->port, polls++);
+
+  return (data->status == i2cXferDone);
+}
+
+/**
+ * Write to the I2C bus and wait for the transaction to complete.  The reply, if any,
+ * is placed in data->reply.
+ *
+ * With __COMMON_H_I2C_ARBITRATION__ this ends any hogCPU() the calling task had,
+ * ROBOTC does not nest hogCPU() and releaseCPU(), see startI2C().  Code that used
+ * hogCPU() around writeI2C() to keep other tasks off the port can rely on the bus
+ * ownership instead.
+ * @param data pointer to the I2C data struct
+ * @return true if no error occured, false if it did
+ */
+bool writeI2C(tI2CDataPtr data) {
 #ifdef DEBUG_COMMON_H
-  writeDebugStreamLine("writeI2C: initiating read: data->replyLen: %d", data->replyLen); sleep(200);
+	writeDebugStreamLine("writeI2C(tI2CDataPtr data) called"); sleep(200);
 #endif // DEBUG_COMMON_H
 
-  readI2CReply(data->port, &data->reply[0], data->replyLen);
+  if (!startI2C(data))
+    return false;
 
-#ifdef EV3
-	return waitForI2CBus(data);
-#else
-	return true;
-#endif // EV3
+  return collectI2C(data);
 }
 
 /**
  * Write to the I2C bus. This function will clear the bus and wait for it be ready
- * before any bytes are sent.
+ * before any bytes are sent.  With __COMMON_H_I2C_ARBITRATION__ this ends any hogCPU()
+ * of the calling task, see writeI2C(tI2CDataPtr data).
  * @param link the port number
  * @param request the data to be sent
  * @return true if no error occured, false if it did
  */
 bool writeI2C(tSensors link, tByteArray &request) {
+  tI2CData data;
+
+  memcpy(data.request, request, sizeof(data.request));
+  data.requestLen = request[0];
+  data.replyLen = 0;
+  data.address = request[1];
+  data.port = link;
+  data.type = SensorType[link];
+  data.status = i2cXferIdle;
+  data.priority = i2cPriorityNormal;
+  data.owner = 0;
+
+  return writeI2C(&data);
+}
 
-#if (__COMMON_H_SENSOR_CHECK__ == 1)
-  //TSensorTypes type = SensorType[link];
+/**
+ * Write to the I2C bus. This function will clear the bus and wait for it be ready
+ * before any bytes are sent.  With __COMMON_H_I2C_ARBITRATION__ this ends any hogCPU()
+ * of the calling task, see writeI2C(tI2CDataPtr data).
+ * @param link the port number
+ * @param request the data to be sent
+ * @param reply array to hold received data
+ * @param replylen the number of bytes (if any) expected in reply to this command
+ * @return true if no error occured, false if it did
+ */
+bool writeI2C(tSensors link, tByteArray &request, tByteArray &reply, short replylen) {
+  tI2CData data;
 
-  switch (SensorType[link])
-  {
-  	case sensorSONAR:											break;
-    case sensorI2CCustom:                 break;
-    case sensorI2CCustom9V:               break;
-#ifdef EV3
-		case sensorEV3_EnergyMeter:						break;  // for some reason, some I2C sensors are identified as this
-		case sensorEV3_GenericI2C:						break;
-#else // This is an NXT
-    case sensorI2CCustomFast:             break;
-    case sensorI2CCustomFast9V:           break;
-    case sensorI2CCustomFastSkipStates9V: break;
-    case sensorI2CCustomFastSkipStates:   break;
-#endif // EV3/NXT
-    default:
-      hogCPU();
-      playSound(soundException);
-      eraseDisplay();
-#ifdef EV3
-			setLEDColor(ledRedPulse);
-#endif // EV3
-      writeDebugStreamLine("ERROR, You have not setup the sensor port correctly. ");
-      writeDebugStreamLine("Please refer to one of the examples.");
-      writeDebugStreamLine("Detected SensorType on port[%d]: %d", link, SensorType[link]);
-      sleep(10000);
-      stopAllTasks();
-    }
-#endif
+  memcpy(data.request, request, sizeof(data.request));
+  data.requestLen = request[0];
+  data.replyLen = replylen;
+  data.address = request[1];
+  data.port = link;
+  data.type = SensorType[link];
+  data.status = i2cXferIdle;
+  data.priority = i2cPriorityNormal;
+  data.owner = 0;
 
-// This is not required for the EV3
-#ifdef NXT
-  if (!waitForI2CBus(link)) {
-    clearI2CError(link, request[1]);
+  if (!writeI2C(&data))
+    return false;
 
-    // Let's try the bus again, see if the above packets flushed it out
-    // clearI2CBus(link);
-    if (!waitForI2CBus(link))
-      return false;
-  }
-#endif // __COMMON_H_SENSOR_CHECK__
+  // copy the input into the data array
+  memcpy(reply, data.reply, replylen);
 
-  sendI2CMsg(link, &request[0], 0);
+  return true;
+}
 
-  if (!waitForI2CBus(link)) {
-#ifdef EV3
-	#ifdef DEBUG_COMMON_H
-			writeDebugStreamLine("waiting for the bus has failed");	 sleep(200);
-	#endif
-		return false;
-#else
-    clearI2CError(link, request[1]);
-    sendI2CMsg(link, &request[0], 0);
-    if (!waitForI2CBus(link))
+/**
+ * Read a block of consecutive registers into buffer.  Reads larger than the 16 byte
+ * maximum reply size are split into as few transactions as possible, the register
+ * pointer is advanced by the number of bytes already read for each chunk.
+ *
+ * Devices that only auto-increment the register pointer when a particular bit in
+ * the register address is set (like the L3G4200D gyro on the DIMU) can pass that
+ * bit in autoIncFlag, it will be OR'd into every register address sent.
+ * @param data pointer to the I2C data struct, port and address must be set
+ * @param reg the first register to read
+ * @param buffer array to hold the data, must be at least numbytes long
+ * @param numbytes the number of bytes to read
+ * @param autoIncFlag bit to set in the register address to enable auto-increment
+ * @return true if no error occured, false if it did
+ */
+bool readI2CRegs(tI2CDataPtr data, ubyte reg, ubyte *buffer, short numbytes, ubyte autoIncFlag) {
+  short offset = 0;
+  short chunk = 0;
+
+  while (offset < numbytes) {
+    chunk = numbytes - offset;
+    if (chunk > I2C_MAX_REPLY)
+      chunk = I2C_MAX_REPLY;
+
+    data->request[0] = 2;
+    data->request[1] = data->address;
+    data->request[2] = (reg + offset) | autoIncFlag;
+    data->requestLen = 2;
+    data->replyLen = chunk;
+
+    if (!writeI2C(data))
       return false;
-#endif
+
+    memcpy(buffer + offset, data->reply, chunk);
+    offset += chunk;
   }
 
   return true;
 }
 
 /**
- * Write to the I2C bus. This function will clear the bus and wait for it be ready
- * before any bytes are sent.
+ * Read a block of consecutive registers into buffer.  Reads larger than the 16 byte
+ * maximum reply size are split into as few transactions as possible.
  * @param link the port number
- * @param request the data to be sent
- * @param reply array to hold received data
- * @param replylen the number of bytes (if any) expected in reply to this command
+ * @param address the I2C address of the device
+ * @param reg the first register to read
+ * @param buffer array to hold the data, must be at least numbytes long
+ * @param numbytes the number of bytes to read
+ * @param autoIncFlag bit to set in the register address to enable auto-increment
  * @return true if no error occured, false if it did
  */
-bool writeI2C(tSensors link, tByteArray &request, tByteArray &reply, short replylen) {
-  // clear the input data buffer
+bool readI2CRegs(tSensors link, ubyte address, ubyte reg, ubyte *buffer, short numbytes, ubyte autoIncFlag) {
+  tI2CData data;
 
-#if (__COMMON_H_SENSOR_CHECK__ == 1)
-  //TSensorTypes type = SensorType[link];
+  data.address = address;
+  data.port = link;
+  data.type = SensorType[link];
+  data.status = i2cXferIdle;
+  data.priority = i2cPriorityNormal;
+  data.owner = 0;
 
-  switch (SensorType[link])
-  {
-  	case sensorSONAR:											break;
-    case sensorI2CCustom:                 break;
-    case sensorI2CCustom9V:               break;
-#ifdef EV3
-		case sensorEV3_EnergyMeter:						break;  // for some reason, some I2C sensors are identified as this
-		case sensorEV3_GenericI2C:						break;
-#else // This is an NXT
-    case sensorI2CCustomFast:             break;
-    case sensorI2CCustomFast9V:           break;
-    case sensorI2CCustomFastSkipStates9V: break;
-    case sensorI2CCustomFastSkipStates:   break;
-#endif // EV3/NXT
-    default:
-      hogCPU();
-      playSound(soundException);
-      eraseDisplay();
-#ifdef EV3
-			setLEDColor(ledRedPulse);
-#endif // EV3
-      writeDebugStreamLine("ERROR, You have not setup the sensor port correctly. ");
-      writeDebugStreamLine("Please refer to one of the examples.");
-      writeDebugStreamLine("Detected SensorType on port[%d]: %d", link, SensorType[link]);
-      sleep(10000);
-      stopAllTasks();
-  }
-#endif // __COMMON_H_SENSOR_CHECK__
+  return readI2CRegs(&data, reg, buffer, numbytes, autoIncFlag);
+}
 
-// This is not required for the EV3
-#ifdef NXT
-  if (!waitForI2CBus(link)) {
-    clearI2CError(link, request[1]);
+/**
+ * Decode a signed 16 bit little endian value from a buffer.
+ * @param buffer the buffer holding the data
+ * @param offset position of the least significant byte
+ * @return the decoded value
+ */
+short bufToShortLE(ubyte *buffer, short offset) {
+  return (short)(buffer[offset] + ((short)buffer[offset + 1] << 8));
+}
 
-    // Let's try the bus again, see if the above packets flushed it out
-    // clearI2CBus(link);
-    if (!waitForI2CBus(link))
-      return false;
-  }
-#endif
+/**
+ * Decode a signed 16 bit big endian value from a buffer.
+ * @param buffer the buffer holding the data
+ * @param offset position of the most significant byte
+ * @return the decoded value
+ */
+short bufToShortBE(ubyte *buffer, short offset) {
+  return (short)(((short)buffer[offset] << 8) + buffer[offset + 1]);
+}
 
-  sendI2CMsg(link, &request[0], replylen);
+/**
+ * Decode an unsigned 16 bit little endian value from a buffer.
+ * @param buffer the buffer holding the data
+ * @param offset position of the least significant byte
+ * @return the decoded value
+ */
+long bufToUShortLE(ubyte *buffer, short offset) {
+  return (long)buffer[offset] + ((long)buffer[offset + 1] << 8);
+}
 
-  if (!waitForI2CBus(link)) {
-#ifdef EV3
-	#ifdef DEBUG_COMMON_H
-			writeDebugStreamLine("waiting for the bus has failed");	 sleep(200);
-	#endif
-		return false;
-#else
-    clearI2CError(link, request[1]);
-    sendI2CMsg(link, &request[0], replylen);
-    if (!waitForI2CBus(link))
-      return false;
-#endif
-  }
+/**
+ * Decode an unsigned 16 bit big endian value from a buffer.
+ * @param buffer the buffer holding the data
+ * @param offset position of the most significant byte
+ * @return the decoded value
+ */
+long bufToUShortBE(ubyte *buffer, short offset) {
+  return ((long)buffer[offset] << 8) + (long)buffer[offset + 1];
+}
 
-  // ask for the input to put into the data array
-  readI2CReply(link, &reply[0], replylen);
+/**
+ * Decode a signed 24 bit little endian value from a buffer, the result is sign extended.
+ * @param buffer the buffer holding the data
+ * @param offset position of the least significant byte
+ * @return the decoded value
+ */
+long bufToLong24LE(ubyte *buffer, short offset) {
+  long result = (long)buffer[offset] + ((long)buffer[offset + 1] << 8) + ((long)buffer[offset + 2] << 16);
+  if (result & 0x800000)
+    result -= 0x1000000;
+  return result;
+}
 
-#ifdef EV3
-	return waitForI2CBus(link);
-#else
-	return true;
-#endif // EV3
+/**
+ * Decode a signed 24 bit big endian value from a buffer, the result is sign extended.
+ * @param buffer the buffer holding the data
+ * @param offset position of the most significant byte
+ * @return the decoded value
+ */
+long bufToLong24BE(ubyte *buffer, short offset) {
+  long result = ((long)buffer[offset] << 16) + ((long)buffer[offset + 1] << 8) + (long)buffer[offset + 2];
+  if (result & 0x800000)
+    result -= 0x1000000;
+  return result;
+}
+
+/**
+ * Decode a 32 bit little endian value from a buffer.
+ * @param buffer the buffer holding the data
+ * @param offset position of the least significant byte
+ * @return the decoded value
+ */
+long bufToLongLE(ubyte *buffer, short offset) {
+  return (long)buffer[offset] + ((long)buffer[offset + 1] << 8) + ((long)buffer[offset + 2] << 16) + ((long)buffer[offset + 3] << 24);
+}
+
+/**
+ * Decode a 32 bit big endian value from a buffer.
+ * @param buffer the buffer holding the data
+ * @param offset position of the most significant byte
+ * @return the decoded value
+ */
+long bufToLongBE(ubyte *buffer, short offset) {
+  return ((long)buffer[offset] << 24) + ((long)buffer[offset + 1] << 16) + ((long)buffer[offset + 2] << 8) + (long)buffer[offset + 3];
 }
 
 
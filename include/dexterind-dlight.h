@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in DLIGHT_I2CData[]
  *
  * Credits:
  * - Big thanks to Dexter Industries for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 09 March 2013
- * \version 0.1
+ * \version 0.2
  * \example dexterind-dlight-test1.c
  */
 
@@ -58,7 +59,7 @@
 #define DLIGHT_CMD_DISABLE_BLINK  0xAA  /*!< dLight cmmand to disable blinking */
 #define DLIGHT_CMD_ENABLE_BLINK   0xFF  /*!< dLight cmmand to enable blinking  */
 
-tByteArray DLIGHT_I2CRequest;             /*!< Array to hold I2C command data */
+tI2CData DLIGHT_I2CData[4];               /*!< Per-port I2C request and reply buffers */
 
 /**
  * Initialise the dLight sensor.  Turns off blinking.
@@ -67,23 +68,23 @@ tByteArray DLIGHT_I2CRequest;             /*!< Array to hold I2C command data */
  * @return true if no error occured, false if it did
  */
 bool DLIGHTinit(tSensors link, ubyte addr){
-  DLIGHT_I2CRequest[0] = 4;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_MODE1;
-  DLIGHT_I2CRequest[3] = 0x01;
-  DLIGHT_I2CRequest[4] = 0x25;
+  DLIGHT_I2CData[link].request[0] = 4;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_MODE1;
+  DLIGHT_I2CData[link].request[3] = 0x01;
+  DLIGHT_I2CData[link].request[4] = 0x25;
 
-  if (!writeI2C(link, DLIGHT_I2CRequest))
+  if (!writeI2C(link, DLIGHT_I2CData[link].request))
     return false;
 
   sleep(50);
 
-  DLIGHT_I2CRequest[0] = 3;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_LEDOUT;
-  DLIGHT_I2CRequest[3] = DLIGHT_CMD_DISABLE_BLINK;
+  DLIGHT_I2CData[link].request[0] = 3;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_LEDOUT;
+  DLIGHT_I2CData[link].request[3] = DLIGHT_CMD_DISABLE_BLINK;
 
-  return writeI2C(link, DLIGHT_I2CRequest);
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 /**
@@ -96,14 +97,14 @@ bool DLIGHTinit(tSensors link, ubyte addr){
  * @return true if no error occured, false if it did
  */
 bool DLIGHTsetColor(tSensors link, ubyte addr, ubyte r, ubyte g, ubyte b){
-  DLIGHT_I2CRequest[0] = 5;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_RED;
-  DLIGHT_I2CRequest[3] = r;
-  DLIGHT_I2CRequest[4] = g;
-  DLIGHT_I2CRequest[5] = b;
-
-  return writeI2C(link, DLIGHT_I2CRequest);
+  DLIGHT_I2CData[link].request[0] = 5;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_RED;
+  DLIGHT_I2CData[link].request[3] = r;
+  DLIGHT_I2CData[link].request[4] = g;
+  DLIGHT_I2CData[link].request[5] = b;
+
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 /**
@@ -114,12 +115,12 @@ bool DLIGHTsetColor(tSensors link, ubyte addr, ubyte r, ubyte g, ubyte b){
  * @return true if no error occured, false if it did
  */
 bool DLIGHTsetExternal(tSensors link, ubyte addr, ubyte external){
-  DLIGHT_I2CRequest[0] = 3;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_EXTERNAL;
-  DLIGHT_I2CRequest[3] = external;
+  DLIGHT_I2CData[link].request[0] = 3;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_EXTERNAL;
+  DLIGHT_I2CData[link].request[3] = external;
 
-  return writeI2C(link, DLIGHT_I2CRequest);
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 /**
@@ -134,13 +135,13 @@ bool DLIGHTsetBlinking(tSensors link, ubyte addr, float BlinkRate, long DutyCycl
   BlinkRate*= 24;
   BlinkRate--;
 
-  DLIGHT_I2CRequest[0] = 4;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_BPCT;
-  DLIGHT_I2CRequest[3] = (255 * DutyCycle) / 100;
-  DLIGHT_I2CRequest[4] = round(BlinkRate);
-  writeDebugStreamLine("rate: %d, duty: %d", DLIGHT_I2CRequest[4], DLIGHT_I2CRequest[3]);
-  return writeI2C(link, DLIGHT_I2CRequest);
+  DLIGHT_I2CData[link].request[0] = 4;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_BPCT;
+  DLIGHT_I2CData[link].request[3] = (255 * DutyCycle) / 100;
+  DLIGHT_I2CData[link].request[4] = round(BlinkRate);
+  writeDebugStreamLine("rate: %d, duty: %d", DLIGHT_I2CData[link].request[4], DLIGHT_I2CData[link].request[3]);
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 /**
@@ -150,11 +151,11 @@ bool DLIGHTsetBlinking(tSensors link, ubyte addr, float BlinkRate, long DutyCycl
  * @return true if no error occured, false if it did
  */
 bool DLIGHTstartBlinking(tSensors link, ubyte addr){
-  DLIGHT_I2CRequest[0] = 3;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_LEDOUT;
-  DLIGHT_I2CRequest[3] = DLIGHT_CMD_ENABLE_BLINK;
-  return writeI2C(link, DLIGHT_I2CRequest);
+  DLIGHT_I2CData[link].request[0] = 3;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_LEDOUT;
+  DLIGHT_I2CData[link].request[3] = DLIGHT_CMD_ENABLE_BLINK;
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 /**
@@ -164,11 +165,11 @@ bool DLIGHTstartBlinking(tSensors link, ubyte addr){
  * @return true if no error occured, false if it did
  */
 bool DLIGHTstopBlinking(tSensors link, ubyte addr){
-  DLIGHT_I2CRequest[0] = 3;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_LEDOUT;
-  DLIGHT_I2CRequest[3] = DLIGHT_CMD_DISABLE_BLINK;
-  return writeI2C(link, DLIGHT_I2CRequest);
+  DLIGHT_I2CData[link].request[0] = 3;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_LEDOUT;
+  DLIGHT_I2CData[link].request[3] = DLIGHT_CMD_DISABLE_BLINK;
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 /**
@@ -179,11 +180,11 @@ bool DLIGHTstopBlinking(tSensors link, ubyte addr){
  */
 bool DLIGHTdisable(tSensors link, ubyte addr)
 {
-  DLIGHT_I2CRequest[0] = 3;
-  DLIGHT_I2CRequest[1] = addr;
-  DLIGHT_I2CRequest[2] = DLIGHT_REG_LEDOUT;
-  DLIGHT_I2CRequest[3] = DLIGHT_CMD_DISABLE_LEDS;
-  return writeI2C(link, DLIGHT_I2CRequest);
+  DLIGHT_I2CData[link].request[0] = 3;
+  DLIGHT_I2CData[link].request[1] = addr;
+  DLIGHT_I2CData[link].request[2] = DLIGHT_REG_LEDOUT;
+  DLIGHT_I2CData[link].request[3] = DLIGHT_CMD_DISABLE_LEDS;
+  return writeI2C(link, DLIGHT_I2CData[link].request);
 }
 
 #endif // __DLIGHT_H__
@@ -17,6 +17,8 @@
  * - 0.2: Added DGPSreadDistToDestination()
  * - 0.3: Changed from array structs to typedefs\n
  *        Fixed typos and ommissions in commands\n
+ * - 0.4: Registers are now read with readI2CRegs(), only the bytes that are needed are fetched\n
+ * - 0.5: Request and reply buffers are now kept per port in DGPS_I2CData[]\n
  *
  * Credits:
  * - Big thanks to Dexter Industries for providing me with the hardware necessary to write and test this.
@@ -27,7 +29,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 20 February 2011
- * \version 0.3
+ * \version 0.5
  * \example dexterind-gps-test1.c
  */
 
@@ -61,28 +63,21 @@ short DGPSreadTravHeading(tSensors link);
 bool DGPSsetDestination(tSensors link, long latitude, long longitude);
 short DGPSreadDistToDestination(tSensors link);
 
-tByteArray DGPS_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray DGPS_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData DGPS_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 long _DGPSreadRegister(tSensors link, unsigned byte command, short replysize) {
-  memset(DGPS_I2CRequest, 0, sizeof(tByteArray));
-
-  DGPS_I2CRequest[0] = 2;               // Message size
-  DGPS_I2CRequest[1] = DGPS_I2C_ADDR;   // I2C Address
-  DGPS_I2CRequest[2] = command;
-
-  if (!writeI2C(link, DGPS_I2CRequest, DGPS_I2CReply, 4))
+  if (!readI2CRegs(link, DGPS_I2C_ADDR, command, DGPS_I2CData[link].reply, replysize))
     return -1;
 
   // Reassemble the messages, depending on their expected size.
   if (replysize == 4)
-    return (long)DGPS_I2CReply[3] + ((long)DGPS_I2CReply[2] << 8) + ((long)DGPS_I2CReply[1] << 16) + ((long)DGPS_I2CReply[0] << 24);
+    return bufToLongBE(DGPS_I2CData[link].reply, 0);
   else if (replysize == 3)
-    return (long)DGPS_I2CReply[2] + ((long)DGPS_I2CReply[1] << 8) + ((long)DGPS_I2CReply[0] << 16);
+    return bufToLong24BE(DGPS_I2CData[link].reply, 0) & 0xFFFFFF;
   else if (replysize == 2)
-    return (long)DGPS_I2CReply[1] + ((long)DGPS_I2CReply[0] << 8);
+    return bufToUShortBE(DGPS_I2CData[link].reply, 0);
   else if (replysize == 1)
-    return (long)DGPS_I2CReply[0];
+    return (long)DGPS_I2CData[link].reply[0];
 
   return 0;
 }
@@ -163,31 +158,31 @@ short DGPSreadTravHeading(tSensors link) {
  * @return true if no error occured, false if it did
  */
 bool DGPSsetDestination(tSensors link, long latitude, long longitude) {
-  memset(DGPS_I2CRequest, 0, sizeof(tByteArray));
+  memset(DGPS_I2CData[link].request, 0, sizeof(DGPS_I2CData[link].request));
 
   // First we send the latitude
-  DGPS_I2CRequest[0] = 6;               // Message size
-  DGPS_I2CRequest[1] = DGPS_I2C_ADDR;   // I2C Address
-  DGPS_I2CRequest[2] = DGPS_CMD_SLAT;
-  DGPS_I2CRequest[3] = (latitude >> 24) & 0xFF;
-  DGPS_I2CRequest[4] = (latitude >> 16) & 0xFF;
-  DGPS_I2CRequest[5] = (latitude >>  8) & 0xFF;
-  DGPS_I2CRequest[6] = (latitude >>  0) & 0xFF;
-  if (!writeI2C(link, DGPS_I2CRequest))
+  DGPS_I2CData[link].request[0] = 6;               // Message size
+  DGPS_I2CData[link].request[1] = DGPS_I2C_ADDR;   // I2C Address
+  DGPS_I2CData[link].request[2] = DGPS_CMD_SLAT;
+  DGPS_I2CData[link].request[3] = (latitude >> 24) & 0xFF;
+  DGPS_I2CData[link].request[4] = (latitude >> 16) & 0xFF;
+  DGPS_I2CData[link].request[5] = (latitude >>  8) & 0xFF;
+  DGPS_I2CData[link].request[6] = (latitude >>  0) & 0xFF;
+  if (!writeI2C(link, DGPS_I2CData[link].request))
     return false;
 
   sleep(100);
 
   // Then send longitude
-  DGPS_I2CRequest[0] = 6;               // Message size
-  DGPS_I2CRequest[1] = DGPS_I2C_ADDR;   // I2C Address
-  DGPS_I2CRequest[2] = DGPS_CMD_SLONG;
-  DGPS_I2CRequest[3] = (longitude >> 24) & 0xFF;
-  DGPS_I2CRequest[4] = (longitude >> 16) & 0xFF;
-  DGPS_I2CRequest[5] = (longitude >>  8) & 0xFF;
-  DGPS_I2CRequest[6] = (longitude >>  0) & 0xFF;
-
-  return writeI2C(link, DGPS_I2CRequest);
+  DGPS_I2CData[link].request[0] = 6;               // Message size
+  DGPS_I2CData[link].request[1] = DGPS_I2C_ADDR;   // I2C Address
+  DGPS_I2CData[link].request[2] = DGPS_CMD_SLONG;
+  DGPS_I2CData[link].request[3] = (longitude >> 24) & 0xFF;
+  DGPS_I2CData[link].request[4] = (longitude >> 16) & 0xFF;
+  DGPS_I2CData[link].request[5] = (longitude >>  8) & 0xFF;
+  DGPS_I2CData[link].request[6] = (longitude >>  0) & 0xFF;
+
+  return writeI2C(link, DGPS_I2CData[link].request);
 }
 
 /**
@@ -14,6 +14,26 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in DIMU_I2CData[]
+ * - 0.3: DIMUreadAccelAxes10Bit() and DIMUreadAccelAxes8Bit() read all three axes in a single transaction
+ *        and now return a bool<br>
+ *        Calibration moved out of the DIMUreadAccelAxis10Bit() read path into DIMUcalAccelAxis()<br>
+ *        DIMUcalAccel() reads all three axes in one go
+ * - 0.4: Added gyro FIFO streaming, see DIMUstartGyroFIFO() and DIMUreadGyroFIFO()
+ * - 0.5: The tDIMU struct API is complete and no longer needs STRUCT_CODE_ENABLED, it keeps its own
+ *        divisors and offsets<br>
+ *        Gyro readings are now signed, negative rates used to come out as large positive ones<br>
+ *        _DIMUcalcOffset() now stores the average of its samples<br>
+ *        Fixed the gyro divisor for the 2000 dps range<br>
+ *        DIMUreadGyroAxis() subtracts the offset of the right axis<br>
+ *        DIMUreadGyroAxes() now returns a bool
+ * - 0.6: Rates, accelerations, scales and offsets are kept in a tInertial, see math-fixed.h<br>
+ *        tDIMU's accelDivisor and DIMU_Accel_divisor[] are replaced by accelScale and DIMU_Accel_scale[]
+ * - 0.7: DIMUconfigGyro() and DIMUconfigIMU() can estimate the gyro offsets while the gyro is being read,
+ *        instead of blocking to calibrate it, see gyro-bias.h
+ * - 0.8: The gyro offset estimation is now opt-in, define __DIMU_AUTOCAL__ as 1 to use it
+ * - 0.9: The struct API keeps the I2C address of the gyro or accelerometer it last talked to in
+ *        the tI2CData, so error recovery and readI2CRegs() go to the right device
  *
  * Credits:
  * - Big thanks to Dexter Industries for providing me with the hardware necessary to write and test this.
@@ -24,21 +44,30 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 07 August 2011
- * \version 0.1
+ * \version 0.9
  * \example dexterind-imu-test1.c
  * \example dexterind-imu-test2.c
+ * \example dexterind-imu-test4.c
+ * \example dexterind-imu-test5.c
  */
 
 #pragma systemFile
 
+/*!< define this as 1 to add the gyro offset estimation, see DIMUconfigGyro() */
+#ifndef __DIMU_AUTOCAL__
+#define __DIMU_AUTOCAL__ 0
+#endif
+
 #ifndef __COMMON_H__
 #include "common.h"
 #endif
 
-//#define STRUCT_CODE_ENABLED 1
+#ifndef __MATH_FIXED_H__
+#include "math-fixed.h"
+#endif
 
-#ifdef STRUCT_CODE_ENABLED
-#warn "You have enabled experimental code!"
+#if (__DIMU_AUTOCAL__ == 1) && !defined(__GYRO_BIAS_H__)
+#include "gyro-bias.h"
 #endif
 
 #define DIMU_GYRO_I2C_ADDR      0xD2  /*!< Gyro I2C address */
@@ -53,6 +82,19 @@
 #define DIMU_GYRO_CTRL_REG3     0x22  /*!< CTRL_REG3 for Gyro */
 #define DIMU_GYRO_CTRL_REG4     0x23  /*!< CTRL_REG4 for Gyro */
 #define DIMU_GYRO_CTRL_REG5     0x24  /*!< CTRL_REG5 for Gyro */
+#define DIMU_GYRO_FIFO_CTRL_REG 0x2E  /*!< FIFO_CTRL_REG for Gyro */
+#define DIMU_GYRO_FIFO_SRC_REG  0x2F  /*!< FIFO_SRC_REG for Gyro */
+
+#define DIMU_CTRL5_FIFO_EN      0x40  /*!< CTRL_REG5 FIFO enable bit */
+#define DIMU_FIFO_MODE_BYPASS   0x00  /*!< FIFO bypass mode */
+#define DIMU_FIFO_MODE_STREAM   0x40  /*!< FIFO stream mode, the oldest sample is dropped when the FIFO is full */
+#define DIMU_FIFO_SRC_OVRN      0x40  /*!< FIFO_SRC_REG overrun bit, the FIFO is full */
+#define DIMU_FIFO_SRC_EMPTY     0x20  /*!< FIFO_SRC_REG empty bit */
+#define DIMU_FIFO_SRC_LEVEL     0x1F  /*!< FIFO_SRC_REG mask for the number of stored samples */
+
+#define DIMU_GYRO_FIFO_DEPTH    32    /*!< Number of samples the gyro FIFO can hold */
+#define DIMU_GYRO_FIFO_CHUNK    2     /*!< Number of samples fetched per FIFO read, 12 bytes */
+#define DIMU_GYRO_SAMPLE_TIME   10    /*!< Time between gyro samples in ms, DIMUconfigGyro() sets a 100Hz output data rate */
 
 #define DIMU_GYRO_ALL_AXES      0x28  /*!< All Axes for Gyro */
 #define DIMU_GYRO_X_AXIS        0x2A  /*!< X Axis for Gyro */
@@ -70,6 +112,15 @@
 #define DIMU_ACC_X_AXIS         0x00  /*!< X Axis for Accel */
 #define DIMU_ACC_Y_AXIS         0x02  /*!< Y Axis for Accel */
 #define DIMU_ACC_Z_AXIS         0x04  /*!< Z Axis for Accel */
+#define DIMU_ACC_X_AXIS_8BIT    0x06  /*!< X Axis for Accel, 8 bit register, Y and Z follow */
+#define DIMU_ACC_DRIFT_REG      0x10  /*!< X Axis drift register for Accel, Y and Z follow */
+#define DIMU_ACC_MODE_CTRL      0x16  /*!< Mode control register for Accel */
+
+#define DIMU_GYRO_CAL_SAMPLES   10    /*!< Number of samples averaged to work out the gyro offsets */
+#if (__DIMU_AUTOCAL__ == 1)
+#define DIMU_GYRO_BIAS_THRESHOLD  0.5 /*!< Largest standard deviation of a still gyro in degrees per second, see gyro-bias.h */
+#endif
+#define DIMU_ACC_10BIT_SCALE    inertialFromFloat(1.0 / 64)   /*!< G per LSB for 10 bit accelerometer readings */
 
 #define DIMUreadGyroXAxis(X) DIMUreadGyroAxis(X, DIMU_GYRO_X_AXIS)
 #define DIMUreadGyroYAxis(X) DIMUreadGyroAxis(X, DIMU_GYRO_Y_AXIS)
@@ -83,108 +134,270 @@
 #define DIMUreadAccelYAxis8Bit(X) DIMUreadAccelAxis8Bit(X, DIMU_ACC_Y_AXIS)
 #define DIMUreadAccelZAxis8Bit(X) DIMUreadAccelAxis8Bit(X, DIMU_ACC_Z_AXIS)
 
-// for future use
-#ifdef STRUCT_CODE_ENABLED
 typedef struct
 {
   tI2CData I2CData;
-  float gyroDivisor;
-  float accelDivisor;
-  float axesAccel8Bit[3];
-  float axesAccel10Bit[3];
-  float axesGyro8Bit[3];
-  float axesGyro10Bit[3];
-} tDIMU, *tDIMUptr;
+  tInertial gyroDivisor;        /*!< Degrees per second per LSB for the configured gyro range */
+  tInertial accelScale;         /*!< G per LSB for 8 bit accelerometer readings */
+  tInertial gyroOffset[3];      /*!< Gyro offsets in degrees per second, x, y and z */
+  tInertial axesAccel8Bit[3];   /*!< Accelerometer data in G with 8 bit accuracy, x, y and z */
+  tInertial axesAccel10Bit[3];  /*!< Accelerometer data in G with 10 bit accuracy, x, y and z */
+  tInertial axesGyro[3];        /*!< Gyro data in degrees per second, x, y and z */
+#if (__DIMU_AUTOCAL__ == 1)
+  bool autoCal;                 /*!< The gyro offsets are estimated while the gyro is read */
+  tGyroBias gyroBias;           /*!< Gyro offset estimate in raw units, used when autoCal is set */
 #endif
+} tDIMU, *tDIMUptr;
 
-float DIMU_Gyro_divisor[4] = {0.0, 0.0, 0.0, 0.0}; /*!< Array to hold divisor data for 8 bit measurements */
-float DIMU_Accel_divisor[4] = {0.0, 0.0, 0.0, 0.0}; /*!< Array to hold divisor data for 8 bit measurements */
-float DIMU_Gyro_offset[12] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+tInertial DIMU_Gyro_divisor[4];   /*!< Array to hold the degrees per second per LSB of the gyros */
+tInertial DIMU_Accel_scale[4];    /*!< Array to hold the G per LSB of the accelerometers' 8 bit measurements */
+tInertial DIMU_Gyro_offset[12];   /*!< Array to hold the gyro offsets, three per port */
 
-tByteArray DIMU_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray DIMU_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData DIMU_I2CData[4];      /*!< Per-port I2C request and reply buffers */
+ubyte DIMU_Gyro_ctrl5[4];      /*!< CTRL_REG5 value written by DIMUconfigGyro(), without the FIFO enable bit */
+long DIMU_Gyro_FIFOtime[4];    /*!< Timestamp of the last sample read from the FIFO, 0 if there is none */
+#if (__DIMU_AUTOCAL__ == 1)
+bool DIMU_Gyro_autoCal[4];     /*!< The gyro offsets are estimated while the gyro is read */
+tGyroBias DIMU_Gyro_bias[4];   /*!< Gyro offset estimates in raw units, used when DIMU_Gyro_autoCal is set */
+#endif
 
-bool DIMUconfigGyro(tSensors link, ubyte range, bool lpfenable=true);
+/*!< A block of gyro samples drained from the FIFO, oldest first */
+typedef struct
+{
+  tInertial x[DIMU_GYRO_FIFO_DEPTH];      /*!< X axis data in degrees per second */
+  tInertial y[DIMU_GYRO_FIFO_DEPTH];      /*!< Y axis data in degrees per second */
+  tInertial z[DIMU_GYRO_FIFO_DEPTH];      /*!< Z axis data in degrees per second */
+  long timestamp[DIMU_GYRO_FIFO_DEPTH];   /*!< Estimated time at which each sample was taken */
+  short count;                            /*!< Number of samples in the block */
+  bool overrun;                           /*!< The FIFO was full, older samples may have been lost */
+} tDIMUGyroBlock;
+
+bool DIMUconfigGyro(tSensors link, ubyte range, bool lpfenable=true, bool autoCal=false);
 float DIMUreadGyroAxis(tSensors link, ubyte axis);
-void DIMUreadGyroAxes(tSensors link, float &_x, float &_y, float &_z);
+bool DIMUreadGyroAxes(tSensors link, float &_x, float &_y, float &_z);
 void _DIMUcalcOffset(tSensors link);
+bool DIMUstartGyroFIFO(tSensors link);
+bool DIMUstopGyroFIFO(tSensors link);
+short DIMUreadGyroFIFOLevel(tSensors link);
+bool DIMUreadGyroFIFO(tSensors link, tDIMUGyroBlock &block);
 bool DIMUconfigAccel(tSensors link, ubyte range);
 float DIMUreadAccelAxis8Bit(tSensors link, ubyte axis);
 bool DIMUsetAccelAxisOffset(tSensors link, ubyte drift_reg, ubyte drift_LSB, ubyte drift_MSB);
 float DIMUreadAccelAxis10Bit(tSensors link, ubyte axis, bool calibrate = false);
-void DIMUreadAccelAxes8Bit(tSensors link, float &_x, float &_y, float &_z);
-void DIMUreadAccelAxes10Bit(tSensors link, float &_x, float &_y, float &_z);
+float DIMUcalAccelAxis(tSensors link, ubyte axis);
+bool DIMUreadAccelAxes8Bit(tSensors link, float &_x, float &_y, float &_z);
+bool DIMUreadAccelAxes10Bit(tSensors link, float &_x, float &_y, float &_z);
 void DIMUcalAccel(tSensors link);
-bool DIMUconfigIMU(tSensors link, ubyte accelRange=DIMU_ACC_RANGE_8G, ubyte gyroRange=DIMU_GYRO_RANGE_250, bool lpfenable=true);
+bool DIMUconfigIMU(tSensors link, ubyte accelRange=DIMU_ACC_RANGE_8G, ubyte gyroRange=DIMU_GYRO_RANGE_250, bool lpfenable=true, bool autoCal=false);
 
-#ifdef STRUCT_CODE_ENABLED
 bool initSensor(tDIMUptr sensor, tSensors link);
-bool configGyro(tDIMUptr sensor, ubyte range, bool lpfenable=true);
-void DIMUreadGyroAxes(tDIMUptr sensor);
+bool DIMUconfigGyro(tDIMUptr sensor, ubyte range, bool lpfenable=true, bool autoCal=false);
+bool DIMUreadGyroAxes(tDIMUptr sensor);
+bool DIMUcalGyro(tDIMUptr sensor);
 bool DIMUconfigAccel(tDIMUptr sensor, ubyte range);
-void DIMUreadAccelAxes8Bit(tDIMUptr sensor);
-void DIMUreadAccelAxes10Bit(tDIMUptr sensor);
-void DIMUcalAccel(tDIMUptr sensor);
-bool DIMUconfigIMU(tDIMUptr sensor, ubyte accelRange=DIMU_ACC_RANGE_8G, ubyte gyroRange=DIMU_GYRO_RANGE_250, bool lpfenable=true);
-#endif
+bool DIMUreadAccelAxes8Bit(tDIMUptr sensor);
+bool DIMUreadAccelAxes10Bit(tDIMUptr sensor);
+bool DIMUcalAccel(tDIMUptr sensor);
+bool DIMUconfigIMU(tDIMUptr sensor, ubyte accelRange=DIMU_ACC_RANGE_8G, ubyte gyroRange=DIMU_GYRO_RANGE_250, bool lpfenable=true, bool autoCal=false);
+bool readSensor(tDIMUptr sensor);
+
+/**
+ * Turn the two registers of a gyro axis into a signed value.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param lsb the low register of the axis
+ * @param msb the high register of the axis
+ * @return the signed 16 bit reading
+ */
+short _DIMUgyroRaw(ubyte lsb, ubyte msb) {
+  return (short)(lsb + (msb << 8));
+}
+
+/**
+ * Turn the two registers of a 10 bit accelerometer axis into a signed value.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param lsb the low register of the axis
+ * @param msb the high register of the axis
+ * @return the signed 10 bit reading
+ */
+short _DIMUaccel10Bit(ubyte lsb, ubyte msb) {
+  short ureading = (lsb + (msb << 8)) & 0x3FF;  // unsigned sensor data
+  return (ureading > 511) ? ureading - 1024 : ureading;
+}
+
+/**
+ * Get the gyro's degrees per second per LSB for a range.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param range the operating range of the gyro
+ * @return the divisor
+ */
+tInertial _DIMUgyroDivisor(ubyte range) {
+  switch (range) {
+    case DIMU_GYRO_RANGE_500:  return inertialFromFloat(17.5 / 1000);   // Full scale range is 500 dps.
+    case DIMU_GYRO_RANGE_2000: return inertialFromFloat(70.0 / 1000);   // Full scale range is 2000 dps.
+  }
+  return inertialFromFloat(8.75 / 1000);                                // Full scale range is 250 dps.
+}
+
+/**
+ * Turn the two registers of a gyro axis into degrees per second.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param lsb the low register of the axis
+ * @param msb the high register of the axis
+ * @param divisor the degrees per second per LSB
+ * @param offset the offset of the axis
+ * @return the rate in degrees per second
+ */
+tInertial _DIMUgyroValue(ubyte lsb, ubyte msb, tInertial divisor, tInertial offset) {
+  return (_DIMUgyroRaw(lsb, msb) * divisor) - offset;
+}
+
+#if (__DIMU_AUTOCAL__ == 1)
+/**
+ * Set up a gyro offset estimate for a gyro range.  The stillness threshold is
+ * DIMU_GYRO_BIAS_THRESHOLD turned into raw units.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param biasPtr pointer to the offset estimate
+ * @param divisor the degrees per second per LSB of the gyro
+ */
+void _DIMUinitGyroBias(tGyroBiasPtr biasPtr, tInertial divisor) {
+  GYROBIASinit(biasPtr, 3, DIMU_GYRO_BIAS_THRESHOLD / inertialToFloat(divisor));
+}
+
+/**
+ * Add a sample of all three gyro axes to an offset estimate.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param biasPtr pointer to the offset estimate
+ * @param reply the buffer holding the sample
+ * @param start the index of the sample's first byte in reply
+ * @return true if the estimate was updated, false if it wasn't
+ */
+bool _DIMUupdateGyroBias(tGyroBiasPtr biasPtr, tByteArray &reply, short start) {
+  // The gyro's X and Y axes are swapped with regards to the accelerometer's
+  return GYROBIASupdate(biasPtr,
+                        _DIMUgyroRaw(reply[start + 2], reply[start + 3]),
+                        _DIMUgyroRaw(reply[start + 0], reply[start + 1]),
+                        _DIMUgyroRaw(reply[start + 4], reply[start + 5]));
+}
+
+/**
+ * Update the gyro offsets of a port from a sample, if they are estimated.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param start the index of the sample's first byte in the port's reply buffer
+ */
+void _DIMUtrackGyroOffset(tSensors link, short start) {
+  if (!DIMU_Gyro_autoCal[link] || !_DIMUupdateGyroBias(&DIMU_Gyro_bias[link], DIMU_I2CData[link].reply, start))
+    return;
+
+  for (short i = 0; i < 3; i++)
+    DIMU_Gyro_offset[(link*3)+i] = inertialMul(DIMU_Gyro_bias[link].bias[i], DIMU_Gyro_divisor[link]);
+}
+#endif // __DIMU_AUTOCAL__
+
+/**
+ * Get the accelerometer's G per LSB for 8 bit readings for a range.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param range the range at which to operate the Accelerometer, can be 2, 4 and 8G
+ * @return the scale
+ */
+tInertial _DIMUaccelScale(ubyte range) {
+  switch (range) {
+    case DIMU_ACC_RANGE_2G: return inertialFromFloat(1.0 / 64);
+    case DIMU_ACC_RANGE_4G: return inertialFromFloat(1.0 / 32);
+  }
+  return inertialFromFloat(1.0 / 16);
+}
+
+/**
+ * Work out the drift offset that makes an axis read 0G, or 1G for the Z axis.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param axis the specific axis
+ * @param sreading the signed 10 bit reading of the axis with its drift set to 0
+ * @return the drift offset
+ */
+short _DIMUaccelDrift(ubyte axis, short sreading) {
+  switch (axis) {
+    case DIMU_ACC_X_AXIS: return (  0 - sreading ) * 2;
+    case DIMU_ACC_Y_AXIS: return (  0 - sreading ) * 2;
+    case DIMU_ACC_Z_AXIS: return ( 64 - sreading ) * 2;
+  }
+  return 0;
+}
 
 /**
  * Configure the gyro
  * @param link the port number
  * @param range the operating range of the gyro
  * @param lpfenable Enable built-in Low Pass Filter to reduce spikes in data, optional, defaults to true.
+ * @param autoCal Estimate the offsets while the gyro is read instead of calibrating it now, needs __DIMU_AUTOCAL__, optional, defaults to false.
  * @return true if no error occured, false if it did
  */
-bool DIMUconfigGyro(tSensors link, ubyte range, bool lpfenable){
-  memset(DIMU_I2CRequest, 0, sizeof(DIMU_I2CRequest));
+bool DIMUconfigGyro(tSensors link, ubyte range, bool lpfenable, bool autoCal){
+  memset(DIMU_I2CData[link].request, 0, sizeof(DIMU_I2CData[link].request));
 
   // Setup the size and address, same for all requests.
-  DIMU_I2CRequest[0] = 3;    // Sending address, register, value. Optional, defaults to true
-  DIMU_I2CRequest[1] = 0xD2; // I2C Address of gyro.
+  DIMU_I2CData[link].request[0] = 3;    // Sending address, register, value. Optional, defaults to true
+  DIMU_I2CData[link].request[1] = 0xD2; // I2C Address of gyro.
 
   // Write CTRL_REG2
   // No High Pass Filter
-  DIMU_I2CRequest[2] = DIMU_GYRO_CTRL_REG2;
-  DIMU_I2CRequest[3] = 0x00;
-  if (!writeI2C(link, DIMU_I2CRequest))
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_CTRL_REG2;
+  DIMU_I2CData[link].request[3] = 0x00;
+  if (!writeI2C(link, DIMU_I2CData[link].request))
     return false;
 
   // Write CTRL_REG3
   // No interrupts.  Date ready.
   ////////////////////////////////////////////////////////////////////////////
-  DIMU_I2CRequest[2] = DIMU_GYRO_CTRL_REG3;      // Register address of CTRL_REG3
-  DIMU_I2CRequest[3] = 0x08;      // No interrupts.  Date ready.
-  if(!writeI2C(link, DIMU_I2CRequest))
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_CTRL_REG3;      // Register address of CTRL_REG3
+  DIMU_I2CData[link].request[3] = 0x08;      // No interrupts.  Date ready.
+  if(!writeI2C(link, DIMU_I2CData[link].request))
     return false;
 
   // Write CTRL_REG4
   // Full scale range.
-  DIMU_I2CRequest[2] = DIMU_GYRO_CTRL_REG4;
-  DIMU_I2CRequest[3] = range + DIMU_CTRL4_BLOCKDATA;
-  writeI2C(link, DIMU_I2CRequest);
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_CTRL_REG4;
+  DIMU_I2CData[link].request[3] = range + DIMU_CTRL4_BLOCKDATA;
+  if (!writeI2C(link, DIMU_I2CData[link].request))
+    return false;
 
   //Write CTRL_REG5
-  DIMU_I2CRequest[2] = DIMU_GYRO_CTRL_REG5;      // Register address of CTRL_REG5
-  DIMU_I2CRequest[3] = (lpfenable) ? 0x02 : 0x00;      // filtering - low pass
-  if (!writeI2C(link, DIMU_I2CRequest))
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_CTRL_REG5;      // Register address of CTRL_REG5
+  DIMU_I2CData[link].request[3] = (lpfenable) ? 0x02 : 0x00;      // filtering - low pass
+  if (!writeI2C(link, DIMU_I2CData[link].request))
     return false;
+  DIMU_Gyro_ctrl5[link] = DIMU_I2CData[link].request[3];
 
   // Write CTRL_REG1
   // Enable all axes. Disable power down.
-  DIMU_I2CRequest[2] = DIMU_GYRO_CTRL_REG1;
-  DIMU_I2CRequest[3] = 0x0F;
-  if (!writeI2C(link, DIMU_I2CRequest))
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_CTRL_REG1;
+  DIMU_I2CData[link].request[3] = 0x0F;
+  if (!writeI2C(link, DIMU_I2CData[link].request))
     return false;
 
   // Set DIMU_Gyro_divisor so that the output of our gyro axis readings can be turned
   // into scaled values.
   ///////////////////////////////////////////////////////////////////////////
-  if(range == DIMU_GYRO_RANGE_250)
-    DIMU_Gyro_divisor[link] = 8.75/1000;  // Full scale range is 250 dps.
-  else if (range == DIMU_GYRO_RANGE_500)
-    DIMU_Gyro_divisor[link] = 17.5/1000;	// Full scale range is 500 dps.
-  else if (range == DIMU_GYRO_RANGE_2000)
-    DIMU_Gyro_divisor[link] = 70/1000;    // Full scale range is 2000 dps.
+  DIMU_Gyro_divisor[link] = _DIMUgyroDivisor(range);
+
+#if (__DIMU_AUTOCAL__ == 1)
+  // The offsets start at 0 and are worked out from the first still samples
+  DIMU_Gyro_autoCal[link] = autoCal;
+  if (autoCal) {
+    _DIMUinitGyroBias(&DIMU_Gyro_bias[link], DIMU_Gyro_divisor[link]);
+    memset(&DIMU_Gyro_offset[link*3], 0, 3 * sizeof(tInertial));
+    return true;
+  }
+#endif // __DIMU_AUTOCAL__
 
 	_DIMUcalcOffset(link);
 
@@ -198,80 +411,264 @@ bool DIMUconfigGyro(tSensors link, ubyte range, bool lpfenable){
  * @return the axis data in degrees per second
  */
 float DIMUreadGyroAxis(tSensors link, ubyte axis){
-  // ubyte _msb = 0;
-  // ubyte _lsb = 0;
+  short offsetIndex = 0;
 
-	word tmpAxis;
+  DIMU_I2CData[link].request[0] = 2;                   // Message size
+  DIMU_I2CData[link].request[1] = DIMU_GYRO_I2C_ADDR;  // I2C Address
+  DIMU_I2CData[link].request[2] = axis + 0x80;            // Register address
 
-  DIMU_I2CRequest[0] = 2;                   // Message size
-  DIMU_I2CRequest[1] = DIMU_GYRO_I2C_ADDR;  // I2C Address
-  DIMU_I2CRequest[2] = axis + 0x80;            // Register address
-
-  if (!writeI2C(link, DIMU_I2CRequest, DIMU_I2CReply, 2)) {
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 2)) {
     writeDebugStreamLine("error write");
     return 0;
   }
 
-  tmpAxis = DIMU_I2CReply[0]+(DIMU_I2CReply[1]<<8);
-  return (float)tmpAxis * DIMU_Gyro_divisor[link] - DIMU_Gyro_offset[(link*3)+axis];
-  //return (DIMU_I2CReply[0]+((word)(DIMU_I2CReply[1]<<8)))/DIMU_Gyro_divisor[link];
+  switch (axis) {
+    case DIMU_GYRO_X_AXIS: offsetIndex = 0; break;
+    case DIMU_GYRO_Y_AXIS: offsetIndex = 1; break;
+    case DIMU_GYRO_Z_AXIS: offsetIndex = 2; break;
+  }
+
+  return inertialToFloat(_DIMUgyroValue(DIMU_I2CData[link].reply[0], DIMU_I2CData[link].reply[1], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+offsetIndex]));
 }
 
 /**
- * Read all three axes of the gyro
+ * Read all three axes of the gyro, without converting them to float.
+ *
+ * Note: this is an internal function and should not be called directly.
  * @param link the port number
  * @param _x data for x axis in degrees per second
  * @param _y data for y axis in degrees per second
  * @param _z data for z axis in degrees per second
  * @return true if no error occured, false if it did
  */
-void DIMUreadGyroAxes(tSensors link, float &_x, float &_y, float &_z){
-  DIMU_I2CRequest[0] = 2;                   // Message size
-  DIMU_I2CRequest[1] = DIMU_GYRO_I2C_ADDR;  // I2C Address
-  DIMU_I2CRequest[2] = DIMU_GYRO_ALL_AXES + 0x80;            // Register address
+bool _DIMUreadGyroAxes(tSensors link, tInertial &_x, tInertial &_y, tInertial &_z){
+  DIMU_I2CData[link].request[0] = 2;                   // Message size
+  DIMU_I2CData[link].request[1] = DIMU_GYRO_I2C_ADDR;  // I2C Address
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_ALL_AXES + 0x80;            // Register address
 
-  if (!writeI2C(link, DIMU_I2CRequest, DIMU_I2CReply, 6)) {
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 6)) {
     writeDebugStreamLine("error write");
-    return;
+    return false;
   }
 
-  _y = (DIMU_I2CReply[0]+((word)(DIMU_I2CReply[1]<<8)))*DIMU_Gyro_divisor[link];
-  _x = (DIMU_I2CReply[2]+((word)(DIMU_I2CReply[3]<<8)))*DIMU_Gyro_divisor[link];
-  _z = (DIMU_I2CReply[4]+((word)(DIMU_I2CReply[5]<<8)))*DIMU_Gyro_divisor[link];
+#if (__DIMU_AUTOCAL__ == 1)
+  _DIMUtrackGyroOffset(link, 0);
+#endif
+
+  _y = _DIMUgyroValue(DIMU_I2CData[link].reply[0], DIMU_I2CData[link].reply[1], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+1]);
+  _x = _DIMUgyroValue(DIMU_I2CData[link].reply[2], DIMU_I2CData[link].reply[3], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+0]);
+  _z = _DIMUgyroValue(DIMU_I2CData[link].reply[4], DIMU_I2CData[link].reply[5], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+2]);
+
+  return true;
+}
+
+/**
+ * Read all three axes of the gyro
+ * @param link the port number
+ * @param _x data for x axis in degrees per second
+ * @param _y data for y axis in degrees per second
+ * @param _z data for z axis in degrees per second
+ * @return true if no error occured, false if it did
+ */
+bool DIMUreadGyroAxes(tSensors link, float &_x, float &_y, float &_z){
+  tInertial x, y, z;
 
-  _x -= DIMU_Gyro_offset[(link*3)+0];
-  _y -= DIMU_Gyro_offset[(link*3)+1];
-  _z -= DIMU_Gyro_offset[(link*3)+2];
+  if (!_DIMUreadGyroAxes(link, x, y, z))
+    return false;
 
+  _x = inertialToFloat(x);
+  _y = inertialToFloat(y);
+  _z = inertialToFloat(z);
+  return true;
 }
 
 
-// Internal function.
+/**
+ * Work out the gyro's offsets by averaging a number of samples.  The
+ * sensor must be stationary.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ */
 void _DIMUcalcOffset(tSensors link)
 {
-	const int numSamples = 10;
+	tInertial totalX = 0;
+	tInertial totalY = 0;
+	tInertial totalZ = 0;
+	tInertial x, y, z;
 
-	float totalX, totalY, totalZ = 0;
-	float x, y, z;
+	// The readings must not have the old offsets taken off
+	DIMU_Gyro_offset[(link*3)+0] = 0;
+	DIMU_Gyro_offset[(link*3)+1] = 0;
+	DIMU_Gyro_offset[(link*3)+2] = 0;
 
-	for (int i = 0; i < numSamples; i++)
+	for (short i = 0; i < DIMU_GYRO_CAL_SAMPLES; i++)
 	{
-		DIMUreadGyroAxes(link, x, y, z);
+		_DIMUreadGyroAxes(link, x, y, z);
 		totalX += x;
 		totalY += y;
 		totalZ += z;
 		sleep(50);
 	}
 
-	totalX /= numSamples;
-	totalY /= numSamples;
-	totalZ /= numSamples;
+	DIMU_Gyro_offset[(link*3)+0] = totalX / DIMU_GYRO_CAL_SAMPLES;
+	DIMU_Gyro_offset[(link*3)+1] = totalY / DIMU_GYRO_CAL_SAMPLES;
+	DIMU_Gyro_offset[(link*3)+2] = totalZ / DIMU_GYRO_CAL_SAMPLES;
+}
+
+
+/**
+ * Write a single gyro register.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param reg the register to write to
+ * @param value the value to write
+ * @return true if no error occured, false if it did
+ */
+bool _DIMUwriteGyroReg(tSensors link, ubyte reg, ubyte value) {
+  DIMU_I2CData[link].request[0] = 3;                   // Message size
+  DIMU_I2CData[link].request[1] = DIMU_GYRO_I2C_ADDR;  // I2C Address
+  DIMU_I2CData[link].request[2] = reg;
+  DIMU_I2CData[link].request[3] = value;
+  return writeI2C(link, DIMU_I2CData[link].request);
+}
+
+/**
+ * Enable the gyro's FIFO in stream mode.  The gyro keeps the last
+ * DIMU_GYRO_FIFO_DEPTH samples, which can be fetched with DIMUreadGyroFIFO().
+ * The gyro must be configured with DIMUconfigGyro() first.
+ * @param link the port number
+ * @return true if no error occured, false if it did
+ */
+bool DIMUstartGyroFIFO(tSensors link) {
+  DIMU_Gyro_FIFOtime[link] = 0;
+
+  // Go through bypass mode to empty the FIFO
+  if (!_DIMUwriteGyroReg(link, DIMU_GYRO_FIFO_CTRL_REG, DIMU_FIFO_MODE_BYPASS))
+    return false;
+
+  if (!_DIMUwriteGyroReg(link, DIMU_GYRO_CTRL_REG5, DIMU_Gyro_ctrl5[link] | DIMU_CTRL5_FIFO_EN))
+    return false;
 
-	DIMU_Gyro_offset[(link*3)+0] = x;
-	DIMU_Gyro_offset[(link*3)+1] = y;
-	DIMU_Gyro_offset[(link*3)+2] = z;
+  return _DIMUwriteGyroReg(link, DIMU_GYRO_FIFO_CTRL_REG, DIMU_FIFO_MODE_STREAM);
 }
 
+/**
+ * Disable the gyro's FIFO, DIMUreadGyroAxes() will return the latest sample again.
+ * @param link the port number
+ * @return true if no error occured, false if it did
+ */
+bool DIMUstopGyroFIFO(tSensors link) {
+  if (!_DIMUwriteGyroReg(link, DIMU_GYRO_FIFO_CTRL_REG, DIMU_FIFO_MODE_BYPASS))
+    return false;
+
+  return _DIMUwriteGyroReg(link, DIMU_GYRO_CTRL_REG5, DIMU_Gyro_ctrl5[link]);
+}
+
+/**
+ * Read the gyro's FIFO_SRC_REG.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @return the register value or -1 if an error occured
+ */
+short _DIMUreadGyroFIFOSrc(tSensors link) {
+  DIMU_I2CData[link].request[0] = 2;                        // Message size
+  DIMU_I2CData[link].request[1] = DIMU_GYRO_I2C_ADDR;       // I2C Address
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_FIFO_SRC_REG;   // Register address
+
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 1))
+    return -1;
+
+  return DIMU_I2CData[link].reply[0];
+}
+
+/**
+ * Get the number of samples waiting in the gyro's FIFO
+ * @param link the port number
+ * @return the number of samples or -1 if an error occured
+ */
+short DIMUreadGyroFIFOLevel(tSensors link) {
+  short src = _DIMUreadGyroFIFOSrc(link);
+
+  if (src < 0)
+    return -1;
+  else if ((src & DIMU_FIFO_SRC_EMPTY) != 0)
+    return 0;
+  else if ((src & DIMU_FIFO_SRC_OVRN) != 0)
+    return DIMU_GYRO_FIFO_DEPTH;
+
+  return src & DIMU_FIFO_SRC_LEVEL;
+}
+
+/**
+ * Drain the gyro's FIFO.  The samples are fetched DIMU_GYRO_FIFO_CHUNK at a
+ * time.  The timestamps are worked out from the output data rate, counting on
+ * from the previous block.  The newest sample is never later than the time the
+ * FIFO level was read, the timestamps start over from that time after an
+ * overrun or when they have drifted more than a sample period.\n
+ * Each read of DIMU_GYRO_FIFO_CHUNK samples takes about as long as the gyro
+ * takes to produce them, so call this often to keep the FIFO from filling up.
+ * @param link the port number
+ * @param block the block to fill with samples, oldest first
+ * @return true if no error occured, false if it did
+ */
+bool DIMUreadGyroFIFO(tSensors link, tDIMUGyroBlock &block) {
+  short src = 0;
+  long readTime = 0;
+  long lastTime = 0;
+  short level = 0;
+  short chunk = 0;
+  short index = 0;
+
+  block.count = 0;
+  block.overrun = false;
+
+  src = _DIMUreadGyroFIFOSrc(link);
+  readTime = nPgmTime;
+  if (src < 0)
+    return false;
+
+  if ((src & DIMU_FIFO_SRC_EMPTY) != 0)
+    return true;
+
+  block.overrun = (src & DIMU_FIFO_SRC_OVRN) != 0;
+  level = (block.overrun) ? DIMU_GYRO_FIFO_DEPTH : src & DIMU_FIFO_SRC_LEVEL;
+
+  DIMU_I2CData[link].request[0] = 2;                              // Message size
+  DIMU_I2CData[link].request[1] = DIMU_GYRO_I2C_ADDR;             // I2C Address
+  DIMU_I2CData[link].request[2] = DIMU_GYRO_ALL_AXES + 0x80;      // The read pointer wraps around to the next sample
+
+  while (block.count < level) {
+    chunk = min2(level - block.count, DIMU_GYRO_FIFO_CHUNK);
+    if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, chunk * 6))
+      return false;
+
+    for (short i = 0; i < chunk; i++) {
+      index = block.count;
+#if (__DIMU_AUTOCAL__ == 1)
+      _DIMUtrackGyroOffset(link, i * 6);
+#endif
+      block.y[index] = _DIMUgyroValue(DIMU_I2CData[link].reply[(i * 6) + 0], DIMU_I2CData[link].reply[(i * 6) + 1], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+1]);
+      block.x[index] = _DIMUgyroValue(DIMU_I2CData[link].reply[(i * 6) + 2], DIMU_I2CData[link].reply[(i * 6) + 3], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+0]);
+      block.z[index] = _DIMUgyroValue(DIMU_I2CData[link].reply[(i * 6) + 4], DIMU_I2CData[link].reply[(i * 6) + 5], DIMU_Gyro_divisor[link], DIMU_Gyro_offset[(link*3)+2]);
+      block.count++;
+    }
+  }
+
+  // Work back from the time the level was read if there's nothing to count on from
+  lastTime = DIMU_Gyro_FIFOtime[link] + (block.count * DIMU_GYRO_SAMPLE_TIME);
+  if (block.overrun || (DIMU_Gyro_FIFOtime[link] == 0) ||
+      (lastTime > readTime) || (lastTime < readTime - DIMU_GYRO_SAMPLE_TIME))
+    lastTime = readTime;
+
+  for (short i = 0; i < block.count; i++)
+    block.timestamp[i] = lastTime - ((block.count - 1 - i) * DIMU_GYRO_SAMPLE_TIME);
+
+  DIMU_Gyro_FIFOtime[link] = lastTime;
+  return true;
+}
 
 /**
  * Wait for the I2C bus to be ready for the next message
@@ -280,20 +677,16 @@ void _DIMUcalcOffset(tSensors link)
  * @return true if no error occured, false if it did
  */
 bool DIMUconfigAccel(tSensors link, ubyte range) {
-  switch(range) {
-    case DIMU_ACC_RANGE_2G: DIMU_Accel_divisor[link] = 64.0; break;
-    case DIMU_ACC_RANGE_4G: DIMU_Accel_divisor[link] = 32.0; break;
-    case DIMU_ACC_RANGE_8G: DIMU_Accel_divisor[link] = 16.0; break;
-  }
+  DIMU_Accel_scale[link] = _DIMUaccelScale(range);
 
-  DIMU_I2CRequest[0] = 3;                 // Sending address, register, value.
-  DIMU_I2CRequest[1] = DIMU_ACC_I2C_ADDR; // I2C Address of Accelerometer.
+  DIMU_I2CData[link].request[0] = 3;                 // Sending address, register, value.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR; // I2C Address of Accelerometer.
 
   //Set the Mode Control - P.25 of Documentation
   ////////////////////////////////////////////////////////////////////////////
-  DIMU_I2CRequest[2] = 0x16;                   // Register address of Mode Control
-  DIMU_I2CRequest[3] = range | DIMU_ACC_MODE_MEAS;
-  if (!writeI2C(link, DIMU_I2CRequest))     // (Port 1, Message Array, Reply Size)
+  DIMU_I2CData[link].request[2] = DIMU_ACC_MODE_CTRL;     // Register address of Mode Control
+  DIMU_I2CData[link].request[3] = range | DIMU_ACC_MODE_MEAS;
+  if (!writeI2C(link, DIMU_I2CData[link].request))     // (Port 1, Message Array, Reply Size)
     return false;
 
   DIMUcalAccel(link);
@@ -308,20 +701,20 @@ bool DIMUconfigAccel(tSensors link, ubyte range) {
  */
 float DIMUreadAccelAxis8Bit(tSensors link, ubyte axis){
   short sensorReading = 0;
-  DIMU_I2CRequest[0] = 2;      // Sending address, register.
-  DIMU_I2CRequest[1] = DIMU_ACC_I2C_ADDR;   // I2C Address of accl.
+  DIMU_I2CData[link].request[0] = 2;      // Sending address, register.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;   // I2C Address of accl.
 
   switch (axis) {
-    case DIMU_ACC_X_AXIS: DIMU_I2CRequest[2] = 0x06; break;
-    case DIMU_ACC_Y_AXIS: DIMU_I2CRequest[2] = 0x07; break;
-    case DIMU_ACC_Z_AXIS: DIMU_I2CRequest[2] = 0x08; break;
+    case DIMU_ACC_X_AXIS: DIMU_I2CData[link].request[2] = 0x06; break;
+    case DIMU_ACC_Y_AXIS: DIMU_I2CData[link].request[2] = 0x07; break;
+    case DIMU_ACC_Z_AXIS: DIMU_I2CData[link].request[2] = 0x08; break;
   }
 
-  if (!writeI2C(link, DIMU_I2CRequest, DIMU_I2CReply, 1))
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 1))
     return 0;
 
-  sensorReading = (short)DIMU_I2CReply[0];
-  return ((sensorReading > 128) ? sensorReading - 256 : sensorReading) / DIMU_Accel_divisor[link];
+  sensorReading = (short)DIMU_I2CData[link].reply[0];
+  return inertialToFloat(((sensorReading > 127) ? sensorReading - 256 : sensorReading) * DIMU_Accel_scale[link]);
 }
 
 /**
@@ -333,184 +726,459 @@ float DIMUreadAccelAxis8Bit(tSensors link, ubyte axis){
  * @return true if no error occured, false if it did
  */
 bool DIMUsetAccelAxisOffset(tSensors link, ubyte drift_reg, ubyte drift_LSB, ubyte drift_MSB){
-  DIMU_I2CRequest[0] = 3;                     // Sending address, register, value.
-  DIMU_I2CRequest[1] = DIMU_ACC_I2C_ADDR;     // I2C Address of accl.
+  DIMU_I2CData[link].request[0] = 3;                     // Sending address, register, value.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;     // I2C Address of accl.
 
-  DIMU_I2CRequest[2] = drift_reg;             // Register of the data we're writing to.
-  DIMU_I2CRequest[3] = drift_LSB;             // The drift value to write for calibration.
-  if (!writeI2C(link, DIMU_I2CRequest))
+  DIMU_I2CData[link].request[2] = drift_reg;             // Register of the data we're writing to.
+  DIMU_I2CData[link].request[3] = drift_LSB;             // The drift value to write for calibration.
+  if (!writeI2C(link, DIMU_I2CData[link].request))
     return false;
 
-  DIMU_I2CRequest[2] = drift_reg + 1;
-  DIMU_I2CRequest[3] = drift_MSB;
-  return writeI2C(link, DIMU_I2CRequest);
+  DIMU_I2CData[link].request[2] = drift_reg + 1;
+  DIMU_I2CData[link].request[3] = drift_MSB;
+  return writeI2C(link, DIMU_I2CData[link].request);
+}
+
+/**
+ * Work out the drift offset that makes an axis read 0G, or 1G for the
+ * Z axis, and write it to the axis' drift registers, see _DIMUaccelDrift().
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param axis the specific axis
+ * @param sreading the signed 10 bit reading of the axis with its drift set to 0
+ * @return true if no error occured, false if it did
+ */
+bool _DIMUsetAccelDrift(tSensors link, ubyte axis, short sreading) {
+  short drift_offset = _DIMUaccelDrift(axis, sreading);
+
+  return DIMUsetAccelAxisOffset(link, DIMU_ACC_DRIFT_REG + axis, drift_offset & 0x00ff, (drift_offset & 0xff00 ) >> 8);
 }
 
 /**
  * Read the specified accelerometer axis, returns an 10 bit answer
  * @param link the port number
  * @param axis the specific axis
- * @param calibrate optional argument, if set to to true, the sensor will calibrate this axis first.
+ * @param calibrate optional argument, if set to to true, the sensor will calibrate this axis first, see DIMUcalAccelAxis()
  * @return gravity in G with 10 bit accuracy
  */
 float DIMUreadAccelAxis10Bit(tSensors link, ubyte axis, bool calibrate){
-  short ureading = 0;  // unsigned sensor data
-  short sreading = 0;  // signed sensor data
-  short drift_offset = 0;
+  if (calibrate == true)
+    return DIMUcalAccelAxis(link, axis);
 
-  if (calibrate == true) {
-    DIMUsetAccelAxisOffset(link, 0x10 + axis, 0x00, 0x00);
-    sleep(50);
-  }
+  DIMU_I2CData[link].request[0] = 2;          // Sending address, register.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;  // I2C Address of accl.
+  DIMU_I2CData[link].request[2] = axis;        // First Register of the data we're requesting.
+
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 2))
+    return 0;
+
+  return inertialToFloat(_DIMUaccel10Bit(DIMU_I2CData[link].reply[0], DIMU_I2CData[link].reply[1]) * DIMU_ACC_10BIT_SCALE);
+}
+
+/**
+ * Calibrate a single accelerometer axis.  The sensor must be stationary and
+ * assumes the Z axis is facing up.
+ * @param link the port number
+ * @param axis the specific axis
+ * @return gravity in G with 10 bit accuracy, as read before the calibration was applied
+ */
+float DIMUcalAccelAxis(tSensors link, ubyte axis){
+  short sreading = 0;
+
+  DIMUsetAccelAxisOffset(link, DIMU_ACC_DRIFT_REG + axis, 0x00, 0x00);
+  sleep(50);
 
-  DIMU_I2CRequest[0] = 2;          // Sending address, register.
-  DIMU_I2CRequest[1] = DIMU_ACC_I2C_ADDR;  // I2C Address of accl.
-  DIMU_I2CRequest[2] = axis;        // First Register of the data we're requesting.
+  DIMU_I2CData[link].request[0] = 2;          // Sending address, register.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;  // I2C Address of accl.
+  DIMU_I2CData[link].request[2] = axis;        // First Register of the data we're requesting.
 
-  if (!writeI2C(link, DIMU_I2CRequest, DIMU_I2CReply, 2))
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 2))
     return 0;
 
-  ureading = DIMU_I2CReply[0] + (DIMU_I2CReply[1] << 8) & 0x3FF;
-  sreading = (ureading > 511) ? ureading - 1024 : ureading;
-  //sreading = (ureading & 0x200) ? -(((~ureading) & 0x3FF)+1) : ureading;
+  sreading = _DIMUaccel10Bit(DIMU_I2CData[link].reply[0], DIMU_I2CData[link].reply[1]);
 
-  if (calibrate == true) {
-    sleep(50);
-    switch (axis) {
-      case DIMU_ACC_X_AXIS: drift_offset = (  0 - sreading ) * 2; break;
-      case DIMU_ACC_Y_AXIS: drift_offset = (  0 - sreading ) * 2; break;
-      case DIMU_ACC_Z_AXIS: drift_offset = ( 64 - sreading ) * 2; break;
-    }
-    DIMUsetAccelAxisOffset(link, 0x10 + axis, drift_offset & 0x00ff, (drift_offset & 0xff00 ) >> 8);
-  }
+  sleep(50);
+  _DIMUsetAccelDrift(link, axis, sreading);
 
-  return sreading / 64.0;
+  return inertialToFloat(sreading * DIMU_ACC_10BIT_SCALE);
 }
 
 /**
- * Read the specified accelerometer axis, returns an 8 bit answer
+ * Read all three accelerometer axes with 8 bit accuracy.  The axes are read
+ * in a single transaction.
  * @param link the port number
  * @param _x variable to hold X axis data
  * @param _y variable to hold Y axis data
  * @param _z variable to hold Z axis data
+ * @return true if no error occured, false if it did
  */
-void DIMUreadAccelAxes8Bit(tSensors link, float &_x, float &_y, float &_z){
-  _x = DIMUreadAccelAxis8Bit(link, DIMU_ACC_X_AXIS);
-  _y = DIMUreadAccelAxis8Bit(link, DIMU_ACC_Y_AXIS);
-  _z = DIMUreadAccelAxis8Bit(link, DIMU_ACC_Z_AXIS);
+bool DIMUreadAccelAxes8Bit(tSensors link, float &_x, float &_y, float &_z){
+  short sensorReading[3];
+
+  DIMU_I2CData[link].request[0] = 2;                      // Sending address, register.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;      // I2C Address of accl.
+  DIMU_I2CData[link].request[2] = DIMU_ACC_X_AXIS_8BIT;   // X, Y and Z are next to each other
+
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 3))
+    return false;
+
+  for (short i = 0; i < 3; i++) {
+    sensorReading[i] = (short)DIMU_I2CData[link].reply[i];
+    if (sensorReading[i] > 127)
+      sensorReading[i] -= 256;
+  }
+
+  _x = inertialToFloat(sensorReading[0] * DIMU_Accel_scale[link]);
+  _y = inertialToFloat(sensorReading[1] * DIMU_Accel_scale[link]);
+  _z = inertialToFloat(sensorReading[2] * DIMU_Accel_scale[link]);
+  return true;
 }
 
 /**
- * Read the specified accelerometer axis, returns an 10 bit answer
+ * Read all three accelerometer axes with 10 bit accuracy.  The axes are read
+ * in a single transaction.
  * @param link the port number
  * @param _x variable to hold X axis data
  * @param _y variable to hold Y axis data
  * @param _z variable to hold Z axis data
+ * @return true if no error occured, false if it did
  */
-void DIMUreadAccelAxes10Bit(tSensors link, float &_x, float &_y, float &_z){
-  _x = DIMUreadAccelAxis10Bit(link, DIMU_ACC_X_AXIS);
-  _y = DIMUreadAccelAxis10Bit(link, DIMU_ACC_Y_AXIS);
-  _z = DIMUreadAccelAxis10Bit(link, DIMU_ACC_Z_AXIS);
+bool DIMUreadAccelAxes10Bit(tSensors link, float &_x, float &_y, float &_z){
+  DIMU_I2CData[link].request[0] = 2;                  // Sending address, register.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;  // I2C Address of accl.
+  DIMU_I2CData[link].request[2] = DIMU_ACC_X_AXIS;    // X, Y and Z are next to each other
+
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 6))
+    return false;
+
+  _x = inertialToFloat(_DIMUaccel10Bit(DIMU_I2CData[link].reply[0], DIMU_I2CData[link].reply[1]) * DIMU_ACC_10BIT_SCALE);
+  _y = inertialToFloat(_DIMUaccel10Bit(DIMU_I2CData[link].reply[2], DIMU_I2CData[link].reply[3]) * DIMU_ACC_10BIT_SCALE);
+  _z = inertialToFloat(_DIMUaccel10Bit(DIMU_I2CData[link].reply[4], DIMU_I2CData[link].reply[5]) * DIMU_ACC_10BIT_SCALE);
+  return true;
 }
 
 /**
  * Calibrate the Accelerometer.  The sensor must be stationary and assumes the Z axis is facing up.
+ * The drift of all three axes is cleared first, so the axes can be read in one go.
  * @param link the port number
  */
 void DIMUcalAccel(tSensors link){
-  DIMUreadAccelAxis10Bit(link, DIMU_ACC_X_AXIS, true);      // Get x axis data.
-  DIMUreadAccelAxis10Bit(link, DIMU_ACC_Y_AXIS, true);      // Get y axis data.
-  DIMUreadAccelAxis10Bit(link, DIMU_ACC_Z_AXIS, true);      // Get z axis data.
+  short sreading[3];
+
+  DIMUsetAccelAxisOffset(link, DIMU_ACC_DRIFT_REG + DIMU_ACC_X_AXIS, 0x00, 0x00);
+  DIMUsetAccelAxisOffset(link, DIMU_ACC_DRIFT_REG + DIMU_ACC_Y_AXIS, 0x00, 0x00);
+  DIMUsetAccelAxisOffset(link, DIMU_ACC_DRIFT_REG + DIMU_ACC_Z_AXIS, 0x00, 0x00);
+  sleep(50);
+
+  DIMU_I2CData[link].request[0] = 2;                  // Sending address, register.
+  DIMU_I2CData[link].request[1] = DIMU_ACC_I2C_ADDR;  // I2C Address of accl.
+  DIMU_I2CData[link].request[2] = DIMU_ACC_X_AXIS;    // X, Y and Z are next to each other
+
+  if (!writeI2C(link, DIMU_I2CData[link].request, DIMU_I2CData[link].reply, 6))
+    return;
+
+  for (short i = 0; i < 3; i++)
+    sreading[i] = _DIMUaccel10Bit(DIMU_I2CData[link].reply[i * 2], DIMU_I2CData[link].reply[(i * 2) + 1]);
+
+  sleep(50);
+  _DIMUsetAccelDrift(link, DIMU_ACC_X_AXIS, sreading[0]);
+  _DIMUsetAccelDrift(link, DIMU_ACC_Y_AXIS, sreading[1]);
+  _DIMUsetAccelDrift(link, DIMU_ACC_Z_AXIS, sreading[2]);
   sleep(100);
 }
 
-bool DIMUconfigIMU(tSensors link, ubyte accelRange, ubyte gyroRange, bool lpfenable)
+bool DIMUconfigIMU(tSensors link, ubyte accelRange, ubyte gyroRange, bool lpfenable, bool autoCal)
 {
-  if (!DIMUconfigGyro(link, gyroRange, lpfenable))
+  if (!DIMUconfigGyro(link, gyroRange, lpfenable, autoCal))
     return false;
 
   return DIMUconfigAccel(link, accelRange);
 }
 
-#ifdef STRUCT_CODE_ENABLED
-bool DIMUconfigGyro(tDIMUptr sensor, ubyte range, bool lpfenable)
+/**
+ * Write a single register on the gyro or accelerometer.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param sensor pointer to the sensor's data struct
+ * @param address the I2C address of the gyro or accelerometer
+ * @param reg the register to write to
+ * @param value the value to write
+ * @return true if no error occured, false if it did
+ */
+bool _DIMUwriteReg(tDIMUptr sensor, ubyte address, ubyte reg, ubyte value)
 {
-  // Setup the size and address, same for all requests.
-  sensor->I2CData.request[0] = 3;    // Sending address, register, value. Optional, defaults to true
-  sensor->I2CData.request[1] = 0xD2; // I2C Address of gyro.
+  sensor->I2CData.address = address;
+  sensor->I2CData.request[0] = 3;        // Sending address, register, value.
+  sensor->I2CData.request[1] = sensor->I2CData.address;
+  sensor->I2CData.request[2] = reg;
+  sensor->I2CData.request[3] = value;
+  sensor->I2CData.requestLen = 3;
+  sensor->I2CData.replyLen = 0;
+  return writeI2C(&sensor->I2CData);
+}
 
-  // Write CTRL_REG2
+/**
+ * Read a number of registers from the gyro or accelerometer into the reply buffer.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param sensor pointer to the sensor's data struct
+ * @param address the I2C address of the gyro or accelerometer
+ * @param reg the first register to read
+ * @param numbytes the number of registers to read
+ * @return true if no error occured, false if it did
+ */
+bool _DIMUreadRegs(tDIMUptr sensor, ubyte address, ubyte reg, short numbytes)
+{
+  sensor->I2CData.address = address;
+  sensor->I2CData.request[0] = 2;        // Sending address, register.
+  sensor->I2CData.request[1] = sensor->I2CData.address;
+  sensor->I2CData.request[2] = reg;
+  sensor->I2CData.requestLen = 2;
+  sensor->I2CData.replyLen = numbytes;
+  return writeI2C(&sensor->I2CData);
+}
+
+/**
+ * Initialise the sensor's data struct and port
+ *
+ * @param sensor pointer to the sensor's data struct
+ * @param link the sensor port
+ * @return true if no error occured, false if it did
+ */
+bool initSensor(tDIMUptr sensor, tSensors link)
+{
+  memset(sensor, 0, sizeof(tDIMU));
+  sensor->I2CData.address = DIMU_GYRO_I2C_ADDR;
+  sensor->I2CData.port = link;
+  sensor->I2CData.type = sensorI2CCustom;
+
+  // Ensure the sensor is configured correctly
+  if (SensorType[sensor->I2CData.port] != sensor->I2CData.type)
+    SensorType[sensor->I2CData.port] = sensor->I2CData.type;
+
+  return true;
+}
+
+/**
+ * Configure the gyro and work out its offsets, see DIMUcalGyro().  With autoCal
+ * the offsets are estimated by DIMUreadGyroAxes() whenever the gyro is still
+ * instead, see gyro-bias.h.  autoCal is only available when __DIMU_AUTOCAL__ is 1,
+ * otherwise the gyro is always calibrated here.
+ * @param sensor pointer to the sensor's data struct
+ * @param range the operating range of the gyro
+ * @param lpfenable Enable built-in Low Pass Filter to reduce spikes in data, optional, defaults to true.
+ * @param autoCal Estimate the offsets while the gyro is read instead of calibrating it now, needs __DIMU_AUTOCAL__, optional, defaults to false.
+ * @return true if no error occured, false if it did
+ */
+bool DIMUconfigGyro(tDIMUptr sensor, ubyte range, bool lpfenable, bool autoCal)
+{
   // No High Pass Filter
-  sensor->I2CData.request[2] = DIMU_GYRO_CTRL_REG2;
-  sensor->I2CData.request[3] = 0x00;
-  if (!writeI2C(&sensor->I2CData))
+  if (!_DIMUwriteReg(sensor, DIMU_GYRO_I2C_ADDR, DIMU_GYRO_CTRL_REG2, 0x00))
     return false;
 
-  // Write CTRL_REG3
   // No interrupts.  Date ready.
-  ////////////////////////////////////////////////////////////////////////////
-  sensor->I2CData.request[2] = DIMU_GYRO_CTRL_REG3;      // Register address of CTRL_REG3
-  sensor->I2CData.request[3] = 0x08;      // No interrupts.  Date ready.
-  if (!writeI2C(&sensor->I2CData))
+  if (!_DIMUwriteReg(sensor, DIMU_GYRO_I2C_ADDR, DIMU_GYRO_CTRL_REG3, 0x08))
     return false;
 
-  // Write CTRL_REG4
   // Full scale range.
-  sensor->I2CData.request = DIMU_GYRO_CTRL_REG4;
-  sensor->I2CData.request[3] = range + DIMU_CTRL4_BLOCKDATA;
-  if (!writeI2C(&sensor->I2CData))
+  if (!_DIMUwriteReg(sensor, DIMU_GYRO_I2C_ADDR, DIMU_GYRO_CTRL_REG4, range + DIMU_CTRL4_BLOCKDATA))
+    return false;
 
-  //Write CTRL_REG5
-  sensor->I2CData.request[2] = DIMU_GYRO_CTRL_REG5;      // Register address of CTRL_REG5
-  sensor->I2CData.request[3] = (lpfenable) ? 0x02 : 0x00;      // filtering - low pass
-  if (!writeI2C(&sensor->I2CData))
+  // filtering - low pass
+  if (!_DIMUwriteReg(sensor, DIMU_GYRO_I2C_ADDR, DIMU_GYRO_CTRL_REG5, (lpfenable) ? 0x02 : 0x00))
     return false;
 
-  // Write CTRL_REG1
   // Enable all axes. Disable power down.
-  sensor->I2CData.request[2] = DIMU_GYRO_CTRL_REG1;
-  sensor->I2CData.request[3] = 0x0F;
-  if (!writeI2C(&sensor->I2CData))
+  if (!_DIMUwriteReg(sensor, DIMU_GYRO_I2C_ADDR, DIMU_GYRO_CTRL_REG1, 0x0F))
     return false;
 
-  // Set DIMU_Gyro_divisor so that the output of our gyro axis readings can be turned
-  // into scaled values.
-  ///////////////////////////////////////////////////////////////////////////
-  if(range == DIMU_GYRO_RANGE_250)
-    DIMU_Gyro_divisor[link] = 8.75/1000;  // Full scale range is 250 dps.
-  else if (range == DIMU_GYRO_RANGE_500)
-    DIMU_Gyro_divisor[link] = 17.5/1000;	// Full scale range is 500 dps.
-  else if (range == DIMU_GYRO_RANGE_2000)
-    DIMU_Gyro_divisor[link] = 70/1000;    // Full scale range is 2000 dps.
+  sensor->gyroDivisor = _DIMUgyroDivisor(range);
+
+#if (__DIMU_AUTOCAL__ == 1)
+  sensor->autoCal = autoCal;
+  if (autoCal) {
+    _DIMUinitGyroBias(&sensor->gyroBias, sensor->gyroDivisor);
+    memset(sensor->gyroOffset, 0, sizeof(sensor->gyroOffset));
+    return true;
+  }
+#endif // __DIMU_AUTOCAL__
+
+  return DIMUcalGyro(sensor);
+}
+
+/**
+ * Read all three axes of the gyro into sensor->axesGyro
+ * @param sensor pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool DIMUreadGyroAxes(tDIMUptr sensor)
+{
+  if (!_DIMUreadRegs(sensor, DIMU_GYRO_I2C_ADDR, DIMU_GYRO_ALL_AXES + 0x80, 6))
+    return false;
 
+#if (__DIMU_AUTOCAL__ == 1)
+  if (sensor->autoCal && _DIMUupdateGyroBias(&sensor->gyroBias, sensor->I2CData.reply, 0)) {
+    for (short i = 0; i < 3; i++)
+      sensor->gyroOffset[i] = inertialMul(sensor->gyroBias.bias[i], sensor->gyroDivisor);
+  }
+#endif // __DIMU_AUTOCAL__
+
+  // The gyro's X and Y axes are swapped with regards to the accelerometer's
+  sensor->axesGyro[1] = _DIMUgyroValue(sensor->I2CData.reply[0], sensor->I2CData.reply[1], sensor->gyroDivisor, sensor->gyroOffset[1]);
+  sensor->axesGyro[0] = _DIMUgyroValue(sensor->I2CData.reply[2], sensor->I2CData.reply[3], sensor->gyroDivisor, sensor->gyroOffset[0]);
+  sensor->axesGyro[2] = _DIMUgyroValue(sensor->I2CData.reply[4], sensor->I2CData.reply[5], sensor->gyroDivisor, sensor->gyroOffset[2]);
   return true;
 }
 
-void DIMUreadGyroAxes(tDIMUptr sensor)
+/**
+ * Work out the gyro's offsets by averaging a number of samples.  The
+ * sensor must be stationary.
+ * @param sensor pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool DIMUcalGyro(tDIMUptr sensor)
 {
+  tInertial total[3];
+
+  memset(total, 0, sizeof(total));
+  memset(sensor->gyroOffset, 0, sizeof(sensor->gyroOffset));
+
+  for (short i = 0; i < DIMU_GYRO_CAL_SAMPLES; i++)
+  {
+    if (!DIMUreadGyroAxes(sensor))
+      return false;
+    for (short j = 0; j < 3; j++)
+      total[j] += sensor->axesGyro[j];
+    sleep(50);
+  }
+
+  for (short j = 0; j < 3; j++)
+    sensor->gyroOffset[j] = total[j] / DIMU_GYRO_CAL_SAMPLES;
 
+  return true;
 }
+
+/**
+ * Configure and calibrate the accelerometer
+ * @param sensor pointer to the sensor's data struct
+ * @param range the range at which to operate the Accelerometer, can be 2, 4 and 8G
+ * @return true if no error occured, false if it did
+ */
 bool DIMUconfigAccel(tDIMUptr sensor, ubyte range)
 {
+  sensor->accelScale = _DIMUaccelScale(range);
+
+  // Set the Mode Control - P.25 of Documentation
+  if (!_DIMUwriteReg(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_MODE_CTRL, range | DIMU_ACC_MODE_MEAS))
+    return false;
+
+  return DIMUcalAccel(sensor);
+}
+
+/**
+ * Read all three accelerometer axes with 8 bit accuracy into sensor->axesAccel8Bit
+ * @param sensor pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool DIMUreadAccelAxes8Bit(tDIMUptr sensor)
+{
+  short sensorReading = 0;
+
+  if (!_DIMUreadRegs(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_X_AXIS_8BIT, 3))
+    return false;
 
+  for (short i = 0; i < 3; i++)
+  {
+    sensorReading = (short)sensor->I2CData.reply[i];
+    if (sensorReading > 127)
+      sensorReading -= 256;
+    sensor->axesAccel8Bit[i] = sensorReading * sensor->accelScale;
+  }
+  return true;
 }
-void DIMUreadAccelAxes8Bit(tDIMUptr sensor)
+
+/**
+ * Read all three accelerometer axes with 10 bit accuracy into sensor->axesAccel10Bit
+ * @param sensor pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool DIMUreadAccelAxes10Bit(tDIMUptr sensor)
 {
+  if (!_DIMUreadRegs(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_X_AXIS, 6))
+    return false;
 
+  for (short i = 0; i < 3; i++)
+    sensor->axesAccel10Bit[i] = _DIMUaccel10Bit(sensor->I2CData.reply[i * 2], sensor->I2CData.reply[(i * 2) + 1]) * DIMU_ACC_10BIT_SCALE;
+  return true;
 }
-void DIMUreadAccelAxes10Bit(tDIMUptr sensor)
+
+/**
+ * Calibrate the Accelerometer.  The sensor must be stationary and assumes the Z axis is facing up.
+ * @param sensor pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool DIMUcalAccel(tDIMUptr sensor)
 {
+  short sreading[3];
+  short drift_offset = 0;
 
+  for (short i = 0; i < 6; i++)
+  {
+    if (!_DIMUwriteReg(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_DRIFT_REG + i, 0x00))
+      return false;
+  }
+  sleep(50);
+
+  if (!_DIMUreadRegs(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_X_AXIS, 6))
+    return false;
+
+  for (short i = 0; i < 3; i++)
+    sreading[i] = _DIMUaccel10Bit(sensor->I2CData.reply[i * 2], sensor->I2CData.reply[(i * 2) + 1]);
+
+  sleep(50);
+  for (short i = 0; i < 3; i++)
+  {
+    drift_offset = _DIMUaccelDrift(i * 2, sreading[i]);
+    if (!_DIMUwriteReg(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_DRIFT_REG + (i * 2), drift_offset & 0x00ff))
+      return false;
+    if (!_DIMUwriteReg(sensor, DIMU_ACC_I2C_ADDR, DIMU_ACC_DRIFT_REG + (i * 2) + 1, (drift_offset & 0xff00) >> 8))
+      return false;
+  }
+  sleep(100);
+  return true;
 }
-void DIMUcalAccel(tDIMUptr sensor)
+
+/**
+ * Configure both the gyro and the accelerometer
+ * @param sensor pointer to the sensor's data struct
+ * @param accelRange the range at which to operate the Accelerometer, can be 2, 4 and 8G
+ * @param gyroRange the operating range of the gyro
+ * @param lpfenable Enable built-in Low Pass Filter to reduce spikes in data, optional, defaults to true.
+ * @param autoCal Estimate the gyro offsets while the gyro is read instead of calibrating it now, needs __DIMU_AUTOCAL__, optional, defaults to false.
+ * @return true if no error occured, false if it did
+ */
+bool DIMUconfigIMU(tDIMUptr sensor, ubyte accelRange, ubyte gyroRange, bool lpfenable, bool autoCal)
 {
+  if (!DIMUconfigGyro(sensor, gyroRange, lpfenable, autoCal))
+    return false;
 
+  return DIMUconfigAccel(sensor, accelRange);
 }
-bool DIMUconfigIMU(tDIMUptr sensor, ubyte accelRange, ubyte gyroRange, bool lpfenable)
+
+/**
+ * Read all three gyro axes and all three accelerometer axes with 10 bit
+ * accuracy, one transaction each.
+ * @param sensor pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool readSensor(tDIMUptr sensor)
 {
+  if (!DIMUreadGyroAxes(sensor))
+    return false;
 
+  return DIMUreadAccelAxes10Bit(sensor);
 }
-#endif
 
 #endif // __DIMU_H__
 
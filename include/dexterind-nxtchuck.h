@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in NXTCHUCK_I2CData[]
  *
  * Credits:
  * - Big thanks to Dexter Industries for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 02 November 2012
- * \version 0.1
+ * \version 0.2
  * \example dexterind-nxtchuck-test1.c
  */
 
@@ -74,8 +75,7 @@
 #define NXTCHUCK_CC_BTN_B  0x4000 // b button
 #define NXTCHUCK_CC_BTN_ZL 0x8000 // Left-Z button
 
-tByteArray NXTCHUCK_I2CRequest;        /*!< Array to hold I2C command data */
-tByteArray NXTCHUCK_I2CReply;          /*!< Array to hold I2C reply data */
+tI2CData NXTCHUCK_I2CData[4];          /*!< Per-port I2C request and reply buffers */
 
 bool NXTCHUCKinitialised[] = {false, false, false, false};  /*!< Has the NXTChuck been initialised yet? */
 
@@ -147,12 +147,12 @@ ubyte _NXTChuckDataInit2[] = {3, 0xA4, 0xFB, 0x00}; /*!< Second of two arrays wr
  */
 bool _NXTChuckInit(tSensors link){
   writeDebugStreamLine("initialising");
-    memcpy(NXTCHUCK_I2CRequest, _NXTChuckDataInit1, sizeof(_NXTChuckDataInit1));
-    if (!writeI2C(link, NXTCHUCK_I2CRequest))
+    memcpy(NXTCHUCK_I2CData[link].request, _NXTChuckDataInit1, sizeof(_NXTChuckDataInit1));
+    if (!writeI2C(link, NXTCHUCK_I2CData[link].request))
       return false;
 
-    memcpy(NXTCHUCK_I2CRequest, _NXTChuckDataInit2, sizeof(_NXTChuckDataInit2));
-    return writeI2C(link, NXTCHUCK_I2CRequest);
+    memcpy(NXTCHUCK_I2CData[link].request, _NXTChuckDataInit2, sizeof(_NXTChuckDataInit2));
+    return writeI2C(link, NXTCHUCK_I2CData[link].request);
 }
 
 /**
@@ -173,17 +173,17 @@ bool __NXTChuckReadRaw(tSensors link, ubyte _reg, tByteArray &data){
     NXTCHUCKinitialised[link] = true;
   }
 
-  NXTCHUCK_I2CRequest[0] = 2;
-  NXTCHUCK_I2CRequest[1] = NXTCHUCK_I2C_ADDRESS;
-  NXTCHUCK_I2CRequest[2] = _reg;
+  NXTCHUCK_I2CData[link].request[0] = 2;
+  NXTCHUCK_I2CData[link].request[1] = NXTCHUCK_I2C_ADDRESS;
+  NXTCHUCK_I2CData[link].request[2] = _reg;
 
-  if (!writeI2C(link, NXTCHUCK_I2CRequest))
+  if (!writeI2C(link, NXTCHUCK_I2CData[link].request))
     return false;
 
-  NXTCHUCK_I2CRequest[0] = 1;
-  NXTCHUCK_I2CRequest[1] = NXTCHUCK_I2C_ADDRESS;
+  NXTCHUCK_I2CData[link].request[0] = 1;
+  NXTCHUCK_I2CData[link].request[1] = NXTCHUCK_I2C_ADDRESS;
 
-  return writeI2C(link, NXTCHUCK_I2CRequest, data, 6);
+  return writeI2C(link, NXTCHUCK_I2CData[link].request, data, 6);
 }
 
 /**
@@ -193,12 +193,12 @@ bool __NXTChuckReadRaw(tSensors link, ubyte _reg, tByteArray &data){
  * @return true if no error occured, false if it did
  */
 bool NXTChuckreadIdent(tSensors link, tNunchuck &nunchuck){
-  if(__NXTChuckReadRaw(link, 0xFA, NXTCHUCK_I2CReply)){
+  if(__NXTChuckReadRaw(link, 0xFA, NXTCHUCK_I2CData[link].reply)){
 
 #ifdef __NUNHUCK__DEBUG__
     for (short i = 0; i < 6; i++)
     {
-      writeDebugStream("0x%02X ", NXTCHUCK_I2CReply[i]);
+      writeDebugStream("0x%02X ", NXTCHUCK_I2CData[link].reply[i]);
     }
 
     writeDebugStreamLine(" ");
@@ -210,17 +210,17 @@ bool NXTChuckreadIdent(tSensors link, tNunchuck &nunchuck){
       writeDebugStream("Comparing: ");
       for (short j = 0; j < 6; j++)
       {
-        writeDebugStream("0x%02X ", NXTCHUCK_I2CReply[j]);
+        writeDebugStream("0x%02X ", NXTCHUCK_I2CData[link].reply[j]);
       }
       writeDebugStream("   and   ");
       for (short j = 0; j < 6; j++)
       {
         writeDebugStream("0x%02X ", NXTChuckIdentLookup[i][j]);
       }
-      writeDebugStreamLine(": %d", memcmp(&NXTChuckIdentLookup[i][0], &NXTCHUCK_I2CReply[0], 6));
+      writeDebugStreamLine(": %d", memcmp(&NXTChuckIdentLookup[i][0], &NXTCHUCK_I2CData[link].reply[0], 6));
 #endif // __NUNHUCK__DEBUG__
 
-      if (memcmp(&NXTChuckIdentLookup[i][0], &NXTCHUCK_I2CReply[0], 6) == 0)
+      if (memcmp(&NXTChuckIdentLookup[i][0], &NXTCHUCK_I2CData[link].reply[0], 6) == 0)
       {
         nunchuck.ident = i + 2;
         return true;
@@ -239,16 +239,16 @@ bool NXTChuckreadIdent(tSensors link, tNunchuck &nunchuck){
  * @return true if no error occured, false if it did
  */
 bool NXTChuckreadSensor(tSensors link, tNunchuck &nunchuck){
-  if(__NXTChuckReadRaw(link, 0x00, NXTCHUCK_I2CReply))
+  if(__NXTChuckReadRaw(link, 0x00, NXTCHUCK_I2CData[link].reply))
   {
-    nunchuck.stickX = NXTCHUCK_I2CReply[0];
-    nunchuck.stickY = NXTCHUCK_I2CReply[1];
+    nunchuck.stickX = NXTCHUCK_I2CData[link].reply[0];
+    nunchuck.stickY = NXTCHUCK_I2CData[link].reply[1];
 
-    nunchuck.accelX = (NXTCHUCK_I2CReply[2] << 2) | ((NXTCHUCK_I2CReply[5] >> 2) & 0x03);
-    nunchuck.accelY = (NXTCHUCK_I2CReply[3] << 2) | ((NXTCHUCK_I2CReply[5] >> 4) & 0x03);
-    nunchuck.accelZ = (NXTCHUCK_I2CReply[4] << 2) | ((NXTCHUCK_I2CReply[5] >> 6) & 0x03);
+    nunchuck.accelX = (NXTCHUCK_I2CData[link].reply[2] << 2) | ((NXTCHUCK_I2CData[link].reply[5] >> 2) & 0x03);
+    nunchuck.accelY = (NXTCHUCK_I2CData[link].reply[3] << 2) | ((NXTCHUCK_I2CData[link].reply[5] >> 4) & 0x03);
+    nunchuck.accelZ = (NXTCHUCK_I2CData[link].reply[4] << 2) | ((NXTCHUCK_I2CData[link].reply[5] >> 6) & 0x03);
 
-    nunchuck.buttons = (~NXTCHUCK_I2CReply[5]) & 0x03;
+    nunchuck.buttons = (~NXTCHUCK_I2CData[link].reply[5]) & 0x03;
     nunchuck.buttonC = (nunchuck.buttons & NXTCHUCK_N_BTN_C) ? true : false;
     nunchuck.buttonZ = (nunchuck.buttons & NXTCHUCK_N_BTN_Z) ? true : false;
 
@@ -264,17 +264,17 @@ bool NXTChuckreadSensor(tSensors link, tNunchuck &nunchuck){
  * @return true if no error occured, false if it did
  */
 bool NXTChuckReadClassicController(tSensors link, tClassicCtrl &controller){
-  if(__NXTChuckReadRaw(link, 0x00, NXTCHUCK_I2CReply))
+  if(__NXTChuckReadRaw(link, 0x00, NXTCHUCK_I2CData[link].reply))
   {
-    controller.stickLX = NXTCHUCK_I2CReply[0] & 0x3F;                                        // Unpack the data into usable values
-    controller.stickLY = NXTCHUCK_I2CReply[1] & 0x3F;
-    controller.triggerL = ((NXTCHUCK_I2CReply[2] >> 2) & 0x18) | ((NXTCHUCK_I2CReply[3] >> 5) & 0x07);
+    controller.stickLX = NXTCHUCK_I2CData[link].reply[0] & 0x3F;                                        // Unpack the data into usable values
+    controller.stickLY = NXTCHUCK_I2CData[link].reply[1] & 0x3F;
+    controller.triggerL = ((NXTCHUCK_I2CData[link].reply[2] >> 2) & 0x18) | ((NXTCHUCK_I2CData[link].reply[3] >> 5) & 0x07);
 
-    controller.stickRX = ((NXTCHUCK_I2CReply[0] >> 3) & 0x18) | ((NXTCHUCK_I2CReply[1] >> 5) & 0x06) | ((NXTCHUCK_I2CReply[2] >> 7) & 0x01);
-    controller.stickRY = NXTCHUCK_I2CReply[2] & 0x1F;
-    controller.triggerR = NXTCHUCK_I2CReply[3] & 0x1F;
+    controller.stickRX = ((NXTCHUCK_I2CData[link].reply[0] >> 3) & 0x18) | ((NXTCHUCK_I2CData[link].reply[1] >> 5) & 0x06) | ((NXTCHUCK_I2CData[link].reply[2] >> 7) & 0x01);
+    controller.stickRY = NXTCHUCK_I2CData[link].reply[2] & 0x1F;
+    controller.triggerR = NXTCHUCK_I2CData[link].reply[3] & 0x1F;
 
-    controller.buttons = ~(NXTCHUCK_I2CReply[4] | (NXTCHUCK_I2CReply[5] << 8)) & 0xFFFE;
+    controller.buttons = ~(NXTCHUCK_I2CData[link].reply[4] | (NXTCHUCK_I2CData[link].reply[5] << 8)) & 0xFFFE;
 
     controller.buttonTriggerR = (controller.buttons & NXTCHUCK_CC_BTN_RT) ? true : false;
     controller.buttonTriggerL = (controller.buttons & NXTCHUCK_CC_BTN_LT) ? true : false;
@@ -0,0 +1,202 @@
+/*!@addtogroup other
+ * @{
+ * @defgroup gyrobias Gyro Bias Estimation Library
+ * Gyro Bias Estimation Library
+ * @{
+ */
+
+#ifndef __GYRO_BIAS_H__
+#define __GYRO_BIAS_H__
+/** \file gyro-bias.h
+ * \brief Online gyro bias estimation for ROBOTC.
+ *
+ * gyro-bias.h keeps an estimate of a gyro's bias while the gyro is being used,
+ * instead of a blocking calibration at startup.  The raw samples are taken in
+ * windows of GYROBIAS_WINDOW.  A window in which the standard deviation of every
+ * axis stays below a threshold counts as still, and its mean is used:
+ * - The first GYROBIAS_WARMUP still windows are averaged, the first one replaces
+ *   whatever the bias was before.
+ * - After that, every still window moves the bias 1/GYROBIAS_GAIN of the way to its
+ *   mean, so it follows the drift that comes with changes in temperature.  A still
+ *   window whose mean is more than GYROBIAS_MAX_STEP thresholds away from the bias
+ *   is taken to be a slow, steady turn and is not used.
+ *
+ * The sums are kept in longs relative to the first sample of the window, so
+ * the test costs a few integer operations per sample.  Samples more than
+ * GYROBIAS_MAX_STEP thresholds from that first sample end the window early.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#pragma systemFile
+
+#ifndef __COMMON_H__
+#include "common.h"
+#endif
+
+#ifndef __MATH_FIXED_H__
+#include "math-fixed.h"
+#endif
+
+#define GYROBIAS_WINDOW     16    /*!< Number of samples in a stillness test */
+#define GYROBIAS_WARMUP     4     /*!< Number of still windows that are averaged before the bias is tracked */
+#define GYROBIAS_GAIN       8     /*!< After the warm-up, a still window moves the bias 1/GYROBIAS_GAIN of the way to its mean */
+#define GYROBIAS_MAX_STEP   4     /*!< Furthest a sample or still window may be from the reference, in thresholds */
+
+typedef struct
+{
+  short axes;             /*!< Number of axes, 1 to 3 */
+  short threshold;        /*!< Largest standard deviation of a still axis, in raw units */
+  short count;            /*!< Number of samples in the current window */
+  bool moving;            /*!< A sample of the current window was too far from the first */
+  short first[3];         /*!< First sample of the current window, the sums are relative to it */
+  long sum[3];            /*!< Sum of the samples of the current window */
+  long sumSq[3];          /*!< Sum of the squared samples of the current window */
+  tInertial bias[3];      /*!< Estimated bias in raw units, x, y and z */
+  long windows;           /*!< Number of still windows that were used */
+  long rejected;          /*!< Number of still windows that were too far from the bias */
+} tGyroBias, *tGyroBiasPtr;
+
+void GYROBIASinit(tGyroBiasPtr biasPtr, short axes, short threshold);
+bool GYROBIASupdate(tGyroBiasPtr biasPtr, short x, short y = 0, short z = 0);
+
+/**
+ * Initialise a bias estimate
+ * @param biasPtr pointer to the bias estimate
+ * @param axes the number of axes, 1 to 3
+ * @param threshold the largest standard deviation of a still axis, in raw units
+ */
+void GYROBIASinit(tGyroBiasPtr biasPtr, short axes, short threshold)
+{
+  memset(biasPtr, 0, sizeof(tGyroBias));
+  biasPtr->axes = axes;
+  biasPtr->threshold = (threshold < 1) ? 1 : threshold;
+}
+
+/**
+ * Add a sample of one axis to the current window.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param biasPtr pointer to the bias estimate
+ * @param axis the axis, 0 to 2
+ * @param raw the raw value of the axis
+ */
+void _GYROBIASaddSample(tGyroBiasPtr biasPtr, short axis, short raw)
+{
+  short diff;
+
+  if (biasPtr->count == 0)
+  {
+    biasPtr->first[axis] = raw;
+    biasPtr->sum[axis] = 0;
+    biasPtr->sumSq[axis] = 0;
+  }
+
+  diff = raw - biasPtr->first[axis];
+  if ((diff > GYROBIAS_MAX_STEP * biasPtr->threshold) || (diff < -GYROBIAS_MAX_STEP * biasPtr->threshold))
+  {
+    biasPtr->moving = true;
+    return;
+  }
+
+  biasPtr->sum[axis] += diff;
+  biasPtr->sumSq[axis] += (long)diff * diff;
+}
+
+/**
+ * Check if an axis was still during the current window.  The variance is
+ * compared as n * sum of squares - sum^2 against n^2 * threshold^2.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param biasPtr pointer to the bias estimate
+ * @param axis the axis, 0 to 2
+ * @return true if the axis was still, false if it wasn't
+ */
+bool _GYROBIASisStill(tGyroBiasPtr biasPtr, short axis)
+{
+  long n = GYROBIAS_WINDOW;
+  long limit = n * n * biasPtr->threshold * biasPtr->threshold;
+
+  return ((n * biasPtr->sumSq[axis]) - (biasPtr->sum[axis] * biasPtr->sum[axis])) <= limit;
+}
+
+/**
+ * Add a sample to the bias estimate.  Every GYROBIAS_WINDOW samples the window
+ * is tested and, if the gyro was still, the bias is updated.
+ * @param biasPtr pointer to the bias estimate
+ * @param x the raw value of the x axis
+ * @param y the raw value of the y axis, optional
+ * @param z the raw value of the z axis, optional
+ * @return true if the bias was updated, false if it wasn't
+ */
+bool GYROBIASupdate(tGyroBiasPtr biasPtr, short x, short y, short z)
+{
+  tInertial mean[3];
+  tInertial maxStep;
+  short axis;
+
+  if (biasPtr->count == 0)
+    biasPtr->moving = false;
+
+  _GYROBIASaddSample(biasPtr, 0, x);
+  if (biasPtr->axes > 1)
+    _GYROBIASaddSample(biasPtr, 1, y);
+  if (biasPtr->axes > 2)
+    _GYROBIASaddSample(biasPtr, 2, z);
+
+  // A window that saw movement is thrown away straight away
+  if (biasPtr->moving)
+  {
+    biasPtr->count = 0;
+    return false;
+  }
+
+  biasPtr->count++;
+  if (biasPtr->count < GYROBIAS_WINDOW)
+    return false;
+  biasPtr->count = 0;
+
+  for (axis = 0; axis < biasPtr->axes; axis++)
+  {
+    if (!_GYROBIASisStill(biasPtr, axis))
+      return false;
+    mean[axis] = inertialFromInt(biasPtr->first[axis]) + inertialFromRatio(biasPtr->sum[axis], GYROBIAS_WINDOW);
+  }
+
+  if (biasPtr->windows < GYROBIAS_WARMUP)
+  {
+    biasPtr->windows++;
+    for (axis = 0; axis < biasPtr->axes; axis++)
+      biasPtr->bias[axis] += (mean[axis] - biasPtr->bias[axis]) / biasPtr->windows;
+    return true;
+  }
+
+  maxStep = inertialFromInt(GYROBIAS_MAX_STEP * biasPtr->threshold);
+  for (axis = 0; axis < biasPtr->axes; axis++)
+  {
+    if (((mean[axis] - biasPtr->bias[axis]) > maxStep) || ((mean[axis] - biasPtr->bias[axis]) < -maxStep))
+    {
+      biasPtr->rejected++;
+      return false;
+    }
+  }
+
+  biasPtr->windows++;
+  for (axis = 0; axis < biasPtr->axes; axis++)
+    biasPtr->bias[axis] += (mean[axis] - biasPtr->bias[axis]) / GYROBIAS_GAIN;
+  return true;
+}
+
+#endif // __GYRO_BIAS_H__
+
+/* @} */
+/* @} */
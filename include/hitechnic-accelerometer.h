@@ -37,6 +37,7 @@
  * \version 0.7
  * \example hitechnic-accelerometer-test1.c
  * \example hitechnic-accelerometer-SMUX-test1.c
+ * \example hitechnic-accelerometer-SMUX-test2.c
  */
 
 #pragma systemFile
@@ -21,6 +21,18 @@
  * - 0.3: Removed some of the functions requiring SPORT/MPORT macros
  * - 0.4: Removed "NW - No Wait" functions\n
  *        Replaced array structs with typedefs\n
+ * - 0.5: Added HTGYROreadAllRot() to read all gyros on a SMUX at once
+ * - 0.6: Rotations and offsets are kept in a tInertial, see math-fixed.h<br>
+ *        Fixed the size of the memset in initSensor()
+ * - 0.7: Added an optional integrator task that keeps a timestamped heading,
+ *        see HTGYROstartIntegrator() (__HTGYRO_INTEGRATOR__)
+ * - 0.8: Added online offset estimation as an alternative to the blocking calibration,
+ *        see HTGYROenableAutoCal() and gyro-bias.h
+ * - 0.9: The integrator task is now opt-in, define __HTGYRO_INTEGRATOR__ as 1 to use it<br>
+ *        The integrator reads the SMUX with its own buffer and keeps at most HTGYRO_INT_MAX_GYROS gyros<br>
+ *        HTGYROstartIntegrator() returns false when there is no room for another gyro<br>
+ *        The offset estimation is now opt-in, define __HTGYRO_AUTOCAL__ as 1 to use it<br>
+ *        The integrator drops SMUX samples taken while the SMUX is halted or reconfigured
  *
  * Credits:
  * - Big thanks to HiTechnic for providing me with the hardware necessary to write and test this.
@@ -31,19 +43,61 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 20 February 2011
- * \version 0.4
+ * \version 0.9
  * \example hitechnic-gyro-test1.c
  * \example hitechnic-gyro-test2.c
  * \example hitechnic-gyro-SMUX-test1.c
+ * \example hitechnic-gyro-test3.c
  */
 
 #pragma systemFile
+
+/*!< define this as 1 to add the integrator task */
+#ifndef __HTGYRO_INTEGRATOR__
+#define __HTGYRO_INTEGRATOR__ 0
+#endif
+
+// The integrator reads SMUXes from its own task, it needs the bus ownership in common.h
+#if (__HTGYRO_INTEGRATOR__ == 1) && !defined(__COMMON_H_I2C_ARBITRATION__)
+#define __COMMON_H_I2C_ARBITRATION__ 1
+#endif
+
+/*!< define this as 1 to add the offset estimation, see HTGYROenableAutoCal() */
+#ifndef __HTGYRO_AUTOCAL__
+#define __HTGYRO_AUTOCAL__ 0
+#endif
+
 #include "hitechnic-sensormux.h"
 
 #ifndef __COMMON_H__
 #include "common.h"
 #endif
 
+#ifndef __MATH_FIXED_H__
+#include "math-fixed.h"
+#endif
+
+#if (__HTGYRO_AUTOCAL__ == 1) && !defined(__GYRO_BIAS_H__)
+#include "gyro-bias.h"
+#endif
+
+#if (__HTGYRO_INTEGRATOR__ == 1) && (__COMMON_H_I2C_ARBITRATION__ == 0)
+#error "The gyro integrator needs __COMMON_H_I2C_ARBITRATION__, define it as 1 before including any driver"
+#endif
+
+#ifndef HTGYRO_INT_PERIOD
+#define HTGYRO_INT_PERIOD     5     /*!< Time between two samples of the integrator, in ms */
+#endif
+
+#ifndef HTGYRO_INT_MAX_GYROS
+#define HTGYRO_INT_MAX_GYROS  2     /*!< Number of gyros the integrator can keep, can be overridden in your own program */
+#endif
+
+#define HTGYRO_INT_DEADBAND   1.0   /*!< Default dead-band of the integrator, in degrees per second */
+#if (__HTGYRO_AUTOCAL__ == 1)
+#define HTGYRO_BIAS_THRESHOLD 2     /*!< Largest standard deviation of a still gyro, in raw units, see gyro-bias.h */
+#endif
+
 // This ensures the correct sensor types are used.
 #if defined(NXT)
 TSensorTypes HTGyroType = sensorAnalogInactive;
@@ -54,16 +108,61 @@ TSensorTypes HTGyroType = sensorLightInactive;
 typedef struct
 {
   tI2CData I2CData;
-  float rotation;
-  float offset;
+  tInertial rotation;      /*!< Rotation in raw sensor units, with the offset taken off */
+  tInertial offset;        /*!< Offset in raw sensor units */
   bool smux;
   tMUXSensor smuxport;
+#if (__HTGYRO_AUTOCAL__ == 1)
+  bool autoCal;            /*!< The offset is estimated by readSensor(), see HTGYROenableAutoCal() */
+  tGyroBias bias;          /*!< Offset estimate used when autoCal is set */
+#endif
 } tHTGYRO, *tHTGYROPtr;
 
+typedef tInertial tHTGYRORotations[4]; /*!< Array to hold the rotation of all four SMUX channels */
+
+#if (__HTGYRO_INTEGRATOR__ == 1)
+/*!< Heading kept by the integrator task, see HTGYROreadIntegral() */
+typedef struct
+{
+  float heading;          /*!< Integrated heading in degrees */
+  tInertial rate;         /*!< Latest rate in degrees per second, after the dead-band */
+  tInertial offset;       /*!< Offset in raw sensor units that was taken off the latest sample */
+  long timestamp;         /*!< nPgmTime of the latest sample */
+  long samples;           /*!< Number of samples taken since the integrator was started */
+  short periodMin;        /*!< Shortest time between two samples, in ms */
+  short periodMax;        /*!< Longest time between two samples, in ms */
+  long periods;           /*!< Number of times between samples in periodSum, a dropped sample starts a new run */
+  long periodSum;         /*!< Sum of the times between samples, in ms */
+  long periodErrSq;       /*!< Sum of the squared differences between the times between samples and HTGYRO_INT_PERIOD */
+  float periodMean;       /*!< Mean time between samples in ms, worked out by HTGYROreadIntegral() */
+  float periodJitter;     /*!< RMS difference between the times between samples and HTGYRO_INT_PERIOD in ms, worked out by HTGYROreadIntegral() */
+  long dropped;           /*!< Samples dropped because the SMUX could not be read, or was halted or reconfigured while it was */
+} tHTGYROIntegral;
+
+tHTGYROIntegral HTGYROintegrals[HTGYRO_INT_MAX_GYROS * 2];  /*!< Two integrals per gyro, the task fills one while the other is read */
+short HTGYROintKey[HTGYRO_INT_MAX_GYROS];        /*!< Port and channel of the gyro in each slot, as port * 4 + channel */
+ubyte HTGYROintActive[HTGYRO_INT_MAX_GYROS];     /*!< Index of the integral that was completed last */
+long HTGYROintSeq[HTGYRO_INT_MAX_GYROS];         /*!< Bumped when the active integral changes, readers retry when it does */
+bool HTGYROintEnabled[HTGYRO_INT_MAX_GYROS];     /*!< The integrator samples the gyro in this slot, a disabled slot is free */
+bool HTGYROintReset[HTGYRO_INT_MAX_GYROS];       /*!< The heading should be set to 0 with the next sample */
+bool HTGYROintGap[HTGYRO_INT_MAX_GYROS];         /*!< A sample was dropped, the next one starts the trapezoid over */
+tInertial HTGYROintOffset[HTGYRO_INT_MAX_GYROS]; /*!< Offset used by the integrator for each gyro */
+tInertial HTGYROintDeadband[HTGYRO_INT_MAX_GYROS]; /*!< Rates closer to 0 than this are taken as 0 */
+#if (__HTGYRO_AUTOCAL__ == 1)
+bool HTGYROintAutoCal[HTGYRO_INT_MAX_GYROS];     /*!< The offset is estimated by the integrator */
+tGyroBias HTGYROintBias[HTGYRO_INT_MAX_GYROS];   /*!< Offset estimates of the integrator */
+#endif
+bool HTGYROintSMUX[4];                /*!< The gyros on this port are connected through a SMUX */
+bool HTGYROintRunning = false;        /*!< The integrator task is running */
+#endif // __HTGYRO_INTEGRATOR__
+
 bool initSensor(tHTGYROPtr htgyroPtr, tSensors port);
 bool initSensor(tHTGYROPtr htgyroPtr, tMUXSensor muxsensor);
 bool readSensor(tHTGYROPtr htgyroPtr);
 bool sensorCalibrate(tHTGYROPtr htgyroPtr);
+#if (__HTGYRO_AUTOCAL__ == 1)
+void HTGYROenableAutoCal(tHTGYROPtr htgyroPtr, bool enable = true);
+#endif
 
 float HTGYROreadRot(tSensors link);
 float HTGYROstartCal(tSensors link);
@@ -75,12 +174,32 @@ float HTGYROreadRot(tMUXSensor muxsensor);
 float HTGYROstartCal(tMUXSensor muxsensor);
 float HTGYROreadCal(tMUXSensor muxsensor);
 void HTGYROsetCal(tMUXSensor muxsensor, short offset);
+bool HTGYROreadAllRot(tSensors link, tHTGYRORotations &rotations);
+#endif // __HTSMUX_SUPPORT__
+
+#if (__HTGYRO_INTEGRATOR__ == 1)
+bool HTGYROstartIntegrator(tSensors link, float deadband = HTGYRO_INT_DEADBAND, bool autoCal = false);
+bool HTGYROstartIntegrator(tHTGYROPtr htgyroPtr, float deadband = HTGYRO_INT_DEADBAND, bool autoCal = false);
+void HTGYROstopIntegrator(tSensors link);
+void HTGYROstopIntegrator(tHTGYROPtr htgyroPtr);
+void HTGYROresetIntegrator(tSensors link);
+void HTGYROresetIntegrator(tHTGYROPtr htgyroPtr);
+bool HTGYROreadIntegral(tSensors link, tHTGYROIntegral &integral);
+bool HTGYROreadIntegral(tHTGYROPtr htgyroPtr, tHTGYROIntegral &integral);
+#ifdef __HTSMUX_SUPPORT__
+bool HTGYROstartIntegrator(tMUXSensor muxsensor, float deadband = HTGYRO_INT_DEADBAND, bool autoCal = false);
+void HTGYROstopIntegrator(tMUXSensor muxsensor);
+void HTGYROresetIntegrator(tMUXSensor muxsensor);
+bool HTGYROreadIntegral(tMUXSensor muxsensor, tHTGYROIntegral &integral);
 #endif // __HTSMUX_SUPPORT__
+#endif // __HTGYRO_INTEGRATOR__
 
-float HTGYRO_offsets[][] = {{620.0, 620.0, 620.0, 620.0}, /*!< Array for offset values.  Default is 620 */
-                          {620.0, 620.0, 620.0, 620.0},
-                          {620.0, 620.0, 620.0, 620.0},
-                          {620.0, 620.0, 620.0, 620.0}};
+#define HTGYRO_DEFAULT_OFFSET   inertialFromInt(620)   /*!< Default offset */
+
+tInertial HTGYRO_offsets[4][4] = {{HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET}, /*!< Array for offset values */
+                                  {HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET},
+                                  {HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET},
+                                  {HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET, HTGYRO_DEFAULT_OFFSET}};
 
 /**
  * Read the value of the gyro
@@ -94,7 +213,7 @@ float HTGYROreadRot(tSensors link) {
     sleep(100);
   }
 
-  return (SensorValue[link] - HTGYRO_offsets[link][0]);
+  return inertialToFloat(inertialFromInt(SensorValue[link]) - HTGYRO_offsets[link][0]);
 }
 
 /**
@@ -104,7 +223,26 @@ float HTGYROreadRot(tSensors link) {
  */
 #ifdef __HTSMUX_SUPPORT__
 float HTGYROreadRot(tMUXSensor muxsensor) {
-  return HTSMUXreadAnalogue(muxsensor) - HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)];
+  return inertialToFloat(inertialFromInt(HTSMUXreadAnalogue(muxsensor)) - HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)]);
+}
+
+/**
+ * Read the rotation of the gyros on all four channels of a SMUX with a
+ * single I2C transaction.  The offsets are the same as used by HTGYROreadRot().
+ * @param link the SMUX port number
+ * @param rotations array to hold the rotation of channels 1 to 4
+ * @return true if no error occured, false if it did
+ */
+bool HTGYROreadAllRot(tSensors link, tHTGYRORotations &rotations) {
+  tHTSMUXAnalogue values;
+
+  if (!HTSMUXreadAllAnalogue(link, values))
+    return false;
+
+  for (short i = 0; i < 4; i++)
+    rotations[i] = inertialFromInt(values[i]) - HTGYRO_offsets[link][i];
+
+  return true;
 }
 #endif // __HTSMUX_SUPPORT__
 
@@ -129,10 +267,10 @@ float HTGYROstartCal(tSensors link) {
   }
 
   // Store new offset
-  HTGYRO_offsets[link][0] = (_avgdata / 50.0);
+  HTGYRO_offsets[link][0] = inertialFromRatio(_avgdata, 50);
 
   // Return new offset value
-  return HTGYRO_offsets[link][0];
+  return inertialToFloat(HTGYRO_offsets[link][0]);
 }
 
 /**
@@ -151,10 +289,10 @@ float HTGYROstartCal(tMUXSensor muxsensor) {
   }
 
   // Store new offset
-  HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)] = (_avgdata / 50.0);
+  HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)] = inertialFromRatio(_avgdata, 50);
 
   // Return new offset value
-  return HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)];
+  return inertialToFloat(HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)]);
 }
 #endif // __HTSMUX_SUPPORT__
 
@@ -165,7 +303,7 @@ float HTGYROstartCal(tMUXSensor muxsensor) {
  */
 //#define HTGYROsetCal(link, offset) HTGYRO_offsets[link][0] = offset
 void HTGYROsetCal(tSensors link, short offset) {
-  HTGYRO_offsets[link][0] = offset;
+  HTGYRO_offsets[link][0] = inertialFromInt(offset);
 }
 
 /**
@@ -176,7 +314,7 @@ void HTGYROsetCal(tSensors link, short offset) {
 #ifdef __HTSMUX_SUPPORT__
 //#define HTGYROsetCal(muxsensor, offset) HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)] = offset
 void HTGYROsetCal(tMUXSensor muxsensor, short offset) {
-  HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)] = offset;
+  HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)] = inertialFromInt(offset);
 }
 #endif // __HTSMUX_SUPPORT__
 
@@ -186,7 +324,7 @@ void HTGYROsetCal(tMUXSensor muxsensor, short offset) {
  * @return the offset value for the gyro
  */
 float HTGYROreadCal(tSensors link) {
-  return HTGYRO_offsets[link][0];
+  return inertialToFloat(HTGYRO_offsets[link][0]);
 }
 
 /**
@@ -196,7 +334,7 @@ float HTGYROreadCal(tSensors link) {
  */
 #ifdef __HTSMUX_SUPPORT__
 float HTGYROreadCal(tMUXSensor muxsensor) {
-  return HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)];
+  return inertialToFloat(HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)]);
 }
 #endif // __HTSMUX_SUPPORT__
 
@@ -209,7 +347,7 @@ float HTGYROreadCal(tMUXSensor muxsensor) {
  */
 bool initSensor(tHTGYROPtr htgyroPtr, tSensors port)
 {
-  memset(htgyroPtr, 0, sizeof(tHTGYROPtr));
+  memset(htgyroPtr, 0, sizeof(tHTGYRO));
   htgyroPtr->I2CData.port = port;
   htgyroPtr->I2CData.type = HTGyroType;
   htgyroPtr->smux = false;
@@ -230,7 +368,7 @@ bool initSensor(tHTGYROPtr htgyroPtr, tSensors port)
  */
 bool initSensor(tHTGYROPtr htgyroPtr, tMUXSensor muxsensor)
 {
-  memset(htgyroPtr, 0, sizeof(tHTGYROPtr));
+  memset(htgyroPtr, 0, sizeof(tHTGYRO));
   htgyroPtr->I2CData.port = (tSensors)SPORT(muxsensor);
   htgyroPtr->I2CData.type = sensorI2CCustom;
   htgyroPtr->smux = true;
@@ -251,19 +389,28 @@ bool initSensor(tHTGYROPtr htgyroPtr, tMUXSensor muxsensor)
  */
 bool readSensor(tHTGYROPtr htgyroPtr)
 {
+  short raw;
+
   memset(htgyroPtr->I2CData.request, 0, sizeof(htgyroPtr->I2CData.request));
 
   if (htgyroPtr->smux)
-    htgyroPtr->rotation = HTSMUXreadAnalogue(htgyroPtr->smuxport) - htgyroPtr->offset;
+    raw = HTSMUXreadAnalogue(htgyroPtr->smuxport);
   else
-    htgyroPtr->rotation = SensorValue[htgyroPtr->I2CData.port] - htgyroPtr->offset;
+    raw = SensorValue[htgyroPtr->I2CData.port];
 
-    return true;
+#if (__HTGYRO_AUTOCAL__ == 1)
+  if (htgyroPtr->autoCal && GYROBIASupdate(&htgyroPtr->bias, raw))
+    htgyroPtr->offset = htgyroPtr->bias.bias[0];
+#endif
+
+  htgyroPtr->rotation = inertialFromInt(raw) - htgyroPtr->offset;
+
+  return true;
 }
 
 bool sensorCalibrate(tHTGYROPtr htgyroPtr)
 {
-  float avgdata = 0.0;
+  long avgdata = 0;
 
   // Take 50 readings and average them out
   for (short i = 0; i < 50; i++)
@@ -275,11 +422,480 @@ bool sensorCalibrate(tHTGYROPtr htgyroPtr)
 
     sleep(50);
   }
-  htgyroPtr->offset = avgdata / 50;
+  htgyroPtr->offset = inertialFromRatio(avgdata, 50);
 
 	return true;
 }
 
+#if (__HTGYRO_AUTOCAL__ == 1)
+/**
+ * Estimate the offset while the gyro is being read, instead of calibrating
+ * it with sensorCalibrate().  readSensor() updates the offset whenever the
+ * gyro has been still for a while, see gyro-bias.h.  Until then, the offset
+ * that was set before is used.
+ * @param htgyroPtr pointer to the sensor's data struct
+ * @param enable true to estimate the offset, false to keep it as it is
+ */
+void HTGYROenableAutoCal(tHTGYROPtr htgyroPtr, bool enable)
+{
+  if (enable && !htgyroPtr->autoCal)
+    GYROBIASinit(&htgyroPtr->bias, 1, HTGYRO_BIAS_THRESHOLD);
+  htgyroPtr->autoCal = enable;
+}
+#endif // __HTGYRO_AUTOCAL__
+
+#if (__HTGYRO_INTEGRATOR__ == 1)
+/**
+ * Get the integrator's key of the gyro on a sensor port or SMUX channel.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param htgyroPtr pointer to the sensor's data struct
+ * @return the key, port * 4 + channel
+ */
+short _HTGYROintKey(tHTGYROPtr htgyroPtr) {
+  if (htgyroPtr->smux)
+    return (SPORT(htgyroPtr->smuxport) * 4) + MPORT(htgyroPtr->smuxport);
+  return htgyroPtr->I2CData.port * 4;
+}
+
+/**
+ * Find the integrator's slot of a gyro.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param key the integrator's key of the gyro, port * 4 + channel
+ * @return the slot, -1 if the gyro isn't being integrated
+ */
+short _HTGYROintSlot(short key) {
+  for (short slot = 0; slot < HTGYRO_INT_MAX_GYROS; slot++) {
+    if (HTGYROintEnabled[slot] && HTGYROintKey[slot] == key)
+      return slot;
+  }
+  return -1;
+}
+
+/**
+ * Add a new rate to a gyro's integral.  The heading is moved on by the
+ * average of the new and the previous rate over the time between them.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param slot the integrator's slot of the gyro
+ * @param raw the raw value of the gyro
+ * @param timestamp the time the value was read, in ms
+ */
+void _HTGYROintSample(short slot, short raw, long timestamp) {
+  short next = (slot * 2) + (1 - HTGYROintActive[slot]);
+  short period;
+  tInertial rate;
+
+#if (__HTGYRO_AUTOCAL__ == 1)
+  if (HTGYROintAutoCal[slot] && GYROBIASupdate(&HTGYROintBias[slot], raw))
+    HTGYROintOffset[slot] = HTGYROintBias[slot].bias[0];
+#endif
+
+  rate = inertialFromInt(raw) - HTGYROintOffset[slot];
+  if ((rate < HTGYROintDeadband[slot]) && (rate > -HTGYROintDeadband[slot]))
+    rate = 0;
+
+  memcpy(HTGYROintegrals[next], HTGYROintegrals[(slot * 2) + HTGYROintActive[slot]], sizeof(tHTGYROIntegral));
+
+  if (HTGYROintegrals[next].samples > 0 && !HTGYROintGap[slot]) {
+    period = timestamp - HTGYROintegrals[next].timestamp;
+    HTGYROintegrals[next].heading += inertialToFloat(HTGYROintegrals[next].rate + rate) * period / 2000.0;
+    HTGYROintegrals[next].periods++;
+    HTGYROintegrals[next].periodSum += period;
+    HTGYROintegrals[next].periodErrSq += (long)(period - HTGYRO_INT_PERIOD) * (period - HTGYRO_INT_PERIOD);
+    if (period < HTGYROintegrals[next].periodMin)
+      HTGYROintegrals[next].periodMin = period;
+    if (period > HTGYROintegrals[next].periodMax)
+      HTGYROintegrals[next].periodMax = period;
+  }
+
+  if (HTGYROintReset[slot]) {
+    HTGYROintegrals[next].heading = 0;
+    HTGYROintReset[slot] = false;
+  }
+
+  HTGYROintegrals[next].rate = rate;
+  HTGYROintegrals[next].offset = HTGYROintOffset[slot];
+  HTGYROintegrals[next].timestamp = timestamp;
+  HTGYROintegrals[next].samples++;
+  HTGYROintGap[slot] = false;
+
+  // The active index has to change before the sequence number, see HTGYROreadIntegral()
+  HTGYROintActive[slot] = 1 - HTGYROintActive[slot];
+  HTGYROintSeq[slot]++;
+}
+
+#ifdef __HTSMUX_SUPPORT__
+/**
+ * Count a sample that could not be taken.  The heading is left alone for the
+ * time until the next good sample, which starts the trapezoid over.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param slot the integrator's slot of the gyro
+ */
+void _HTGYROintDrop(short slot) {
+  short next = (slot * 2) + (1 - HTGYROintActive[slot]);
+
+  memcpy(HTGYROintegrals[next], HTGYROintegrals[(slot * 2) + HTGYROintActive[slot]], sizeof(tHTGYROIntegral));
+  HTGYROintegrals[next].dropped++;
+  HTGYROintGap[slot] = true;
+
+  // The active index has to change before the sequence number, see HTGYROreadIntegral()
+  HTGYROintActive[slot] = 1 - HTGYROintActive[slot];
+  HTGYROintSeq[slot]++;
+}
+
+/**
+ * Check whether the SMUX driver has halted the SMUX, or has it scanning.  Its
+ * analogue values are stale or meaningless until it runs again.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the SMUX port number
+ * @return true if the SMUX is halted or scanning, false if it isn't
+ */
+bool _HTGYROintSMUXhalted(short link) {
+  return (HTSMUXdata[link].status == HTSMUX_STAT_HALT) || (HTSMUXdata[link].status == HTSMUX_STAT_BUSY);
+}
+#endif // __HTSMUX_SUPPORT__
+
+/**
+ * Sample every gyro that has the integrator enabled, every HTGYRO_INT_PERIOD ms.
+ * The gyros on a SMUX are read with a single transaction into the task's own
+ * buffer, HTSMUXdata[] is left to the program.  The SMUX channels are set up by
+ * HTGYROstartIntegrator().  A SMUX that is halted, or that is halted or reconfigured
+ * by another task while it is read, has its samples dropped, see tHTGYROIntegral.dropped.
+ * It stays that way until the SMUX is set running again, which any read through the
+ * SMUX driver does.  When a round of samples takes too long, the next one
+ * starts straight away instead of trying to catch up.  The task ends by itself
+ * when no gyro has the integrator enabled, stopping it from the outside could
+ * leave the bus locked.
+ */
+task HTGYROintegrator() {
+  long next = nPgmTime;
+  long timestamp;
+  bool enabled = true;
+#ifdef __HTSMUX_SUPPORT__
+  ubyte values[4 * HTSMUX_AN_ENTRY_SIZE];
+  bool read;
+  bool valid;
+  short channel;
+  long configGen;
+#endif
+
+  while (enabled) {
+    enabled = false;
+    for (short link = 0; link < 4; link++) {
+#ifdef __HTSMUX_SUPPORT__
+      read = false;
+      valid = false;
+#endif
+      for (short slot = 0; slot < HTGYRO_INT_MAX_GYROS; slot++) {
+        if (!HTGYROintEnabled[slot] || (HTGYROintKey[slot] / 4) != link)
+          continue;
+        enabled = true;
+
+#ifdef __HTSMUX_SUPPORT__
+        if (HTGYROintSMUX[link]) {
+          // All four channels are read once per round, for the first gyro on this SMUX
+          if (!read) {
+            read = true;
+            configGen = HTSMUXdata[link].configGen;
+            valid = !_HTGYROintSMUXhalted(link) &&
+                    readI2CRegs((tSensors)link, HTSMUX_I2C_ADDR, HTSMUX_ANALOG, values, 4 * HTSMUX_AN_ENTRY_SIZE);
+            timestamp = nPgmTime;
+
+            // Another task may have halted or reconfigured the SMUX while it was read
+            if (_HTGYROintSMUXhalted(link) || configGen != HTSMUXdata[link].configGen)
+              valid = false;
+          }
+          if (valid) {
+            channel = HTGYROintKey[slot] % 4;
+            _HTGYROintSample(slot, ((short)values[channel * 2] * 4) + values[(channel * 2) + 1], timestamp);
+          } else {
+            _HTGYROintDrop(slot);
+          }
+          continue;
+        }
+#endif // __HTSMUX_SUPPORT__
+
+        _HTGYROintSample(slot, SensorValue[link], nPgmTime);
+      }
+    }
+
+    // HTGYROstartIntegrator() must not see the task running after it decided to stop
+    hogCPU();
+    if (!enabled)
+      HTGYROintRunning = false;
+    releaseCPU();
+
+    if (enabled) {
+      next += HTGYRO_INT_PERIOD;
+      if (next - nPgmTime > 0)
+        sleep(next - nPgmTime);
+      else
+        next = nPgmTime;
+    }
+  }
+}
+
+/**
+ * Start integrating a gyro.  A gyro that is already being integrated keeps
+ * its slot and starts over.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param key the integrator's key of the gyro, port * 4 + channel
+ * @param offset the offset of the gyro
+ * @param deadband rates closer to 0 than this, in degrees per second, are taken as 0
+ * @param autoCal estimate the offset while integrating, see gyro-bias.h, needs __HTGYRO_AUTOCAL__
+ * @return true if the gyro is being integrated, false if all HTGYRO_INT_MAX_GYROS slots are in use
+ */
+bool _HTGYROstartIntegrator(short key, tInertial offset, float deadband, bool autoCal) {
+  short slot;
+
+  // The task must not be halfway through a sample of this gyro while it is set up
+  hogCPU();
+  slot = _HTGYROintSlot(key);
+  for (short i = 0; (slot < 0) && (i < HTGYRO_INT_MAX_GYROS); i++) {
+    if (!HTGYROintEnabled[i])
+      slot = i;
+  }
+
+  if (slot < 0) {
+    releaseCPU();
+    return false;
+  }
+
+  HTGYROintEnabled[slot] = false;
+  HTGYROintKey[slot] = key;
+  memset(HTGYROintegrals[slot * 2], 0, sizeof(tHTGYROIntegral));
+  memset(HTGYROintegrals[(slot * 2) + 1], 0, sizeof(tHTGYROIntegral));
+  HTGYROintegrals[slot * 2].periodMin = 32767;
+  HTGYROintegrals[(slot * 2) + 1].periodMin = 32767;
+  HTGYROintActive[slot] = 0;
+  HTGYROintSeq[slot] = 0;
+  HTGYROintReset[slot] = false;
+  HTGYROintGap[slot] = false;
+  HTGYROintOffset[slot] = offset;
+  HTGYROintDeadband[slot] = inertialFromFloat(deadband);
+#if (__HTGYRO_AUTOCAL__ == 1)
+  HTGYROintAutoCal[slot] = autoCal;
+  GYROBIASinit(&HTGYROintBias[slot], 1, HTGYRO_BIAS_THRESHOLD);
+#endif
+  HTGYROintEnabled[slot] = true;
+  if (!HTGYROintRunning) {
+    HTGYROintRunning = true;
+    startTask(HTGYROintegrator);
+  }
+  releaseCPU();
+
+  return true;
+}
+
+/**
+ * Make a consistent copy of the latest integral of a gyro and work out the
+ * mean and jitter of the time between samples.  If the integrator publishes a
+ * new integral while the copy is made, it is made again.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param key the integrator's key of the gyro, port * 4 + channel
+ * @param integral the struct to copy the integral into
+ * @return true if there was an integral, false if the integrator hasn't taken a sample yet
+ */
+bool _HTGYROreadIntegral(short key, tHTGYROIntegral &integral) {
+  short slot = _HTGYROintSlot(key);
+  long seq;
+
+  if (slot < 0 || HTGYROintSeq[slot] == 0)
+    return false;
+
+  do {
+    seq = HTGYROintSeq[slot];
+    memcpy(integral, HTGYROintegrals[(slot * 2) + HTGYROintActive[slot]], sizeof(tHTGYROIntegral));
+  } while (seq != HTGYROintSeq[slot]);
+
+  if (integral.periods > 0) {
+    integral.periodMean = (float)integral.periodSum / integral.periods;
+    integral.periodJitter = sqrt((float)integral.periodErrSq / integral.periods);
+  }
+
+  return integral.samples != 0;
+}
+
+/**
+ * Stop integrating a gyro and free its slot.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param key the integrator's key of the gyro, port * 4 + channel
+ */
+void _HTGYROstopIntegrator(short key) {
+  short slot = _HTGYROintSlot(key);
+
+  if (slot >= 0)
+    HTGYROintEnabled[slot] = false;
+}
+
+/**
+ * Set the heading of a gyro to 0 with its next sample.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param key the integrator's key of the gyro, port * 4 + channel
+ */
+void _HTGYROresetIntegrator(short key) {
+  short slot = _HTGYROintSlot(key);
+
+  if (slot >= 0)
+    HTGYROintReset[slot] = true;
+}
+
+/**
+ * Start integrating the gyro on a sensor port in the background.  A sample is
+ * taken every HTGYRO_INT_PERIOD ms and timestamped, the heading follows from
+ * the trapezoidal rule.  The offset is the one used by HTGYROreadRot(), with autoCal
+ * it is only used until the integrator has seen the gyro being still.
+ * @param link the HTGYRO port number
+ * @param deadband rates closer to 0 than this, in degrees per second, are taken as 0
+ * @param autoCal estimate the offset while integrating, see gyro-bias.h, needs __HTGYRO_AUTOCAL__
+ * @return true if the gyro is being integrated, false if all HTGYRO_INT_MAX_GYROS slots are in use
+ */
+bool HTGYROstartIntegrator(tSensors link, float deadband, bool autoCal) {
+  // Make sure the sensor is configured as type sensorRawValue
+  if (SensorType[link] != HTGyroType) {
+    SensorType[link] = HTGyroType;
+    sleep(100);
+  }
+
+  HTGYROintSMUX[link] = false;
+  return _HTGYROstartIntegrator(link * 4, HTGYRO_offsets[link][0], deadband, autoCal);
+}
+
+/**
+ * Start integrating the gyro on a SMUX channel in the background.  A sample is
+ * taken every HTGYRO_INT_PERIOD ms and timestamped, the heading follows from
+ * the trapezoidal rule.  The offset is the one used by HTGYROreadRot(), with autoCal
+ * it is only used until the integrator has seen the gyro being still.  The
+ * channel is configured and the SMUX set running here, the task only reads it.
+ * @param muxsensor the SMUX sensor port number
+ * @param deadband rates closer to 0 than this, in degrees per second, are taken as 0
+ * @param autoCal estimate the offset while integrating, see gyro-bias.h, needs __HTGYRO_AUTOCAL__
+ * @return true if the gyro is being integrated, false if the SMUX could not be set up or all HTGYRO_INT_MAX_GYROS slots are in use
+ */
+#ifdef __HTSMUX_SUPPORT__
+bool HTGYROstartIntegrator(tMUXSensor muxsensor, float deadband, bool autoCal) {
+  if (!HTSMUXsetAnalogueActive(muxsensor))
+    return false;
+
+  HTGYROintSMUX[SPORT(muxsensor)] = true;
+  return _HTGYROstartIntegrator((SPORT(muxsensor) * 4) + MPORT(muxsensor), HTGYRO_offsets[SPORT(muxsensor)][MPORT(muxsensor)], deadband, autoCal);
+}
+#endif // __HTSMUX_SUPPORT__
+
+/**
+ * Start integrating a gyro in the background, see HTGYROstartIntegrator(tSensors link, float deadband, bool autoCal).
+ * The offset is the one in the struct.
+ * @param htgyroPtr pointer to the sensor's data struct
+ * @param deadband rates closer to 0 than this, in degrees per second, are taken as 0
+ * @param autoCal estimate the offset while integrating, see gyro-bias.h, needs __HTGYRO_AUTOCAL__
+ * @return true if the gyro is being integrated, false if the SMUX could not be set up or all HTGYRO_INT_MAX_GYROS slots are in use
+ */
+bool HTGYROstartIntegrator(tHTGYROPtr htgyroPtr, float deadband, bool autoCal) {
+#ifdef __HTSMUX_SUPPORT__
+  if (htgyroPtr->smux && !HTSMUXsetAnalogueActive(htgyroPtr->smuxport))
+    return false;
+#endif // __HTSMUX_SUPPORT__
+
+  HTGYROintSMUX[htgyroPtr->I2CData.port] = htgyroPtr->smux;
+  return _HTGYROstartIntegrator(_HTGYROintKey(htgyroPtr), htgyroPtr->offset, deadband, autoCal);
+}
+
+/**
+ * Stop integrating the gyro on a sensor port.  The integrator task ends after
+ * its current round of samples when no other gyro uses it.
+ * @param link the HTGYRO port number
+ */
+void HTGYROstopIntegrator(tSensors link) {
+  _HTGYROstopIntegrator(link * 4);
+}
+
+/**
+ * Stop integrating the gyro on a SMUX channel.  The integrator task ends after
+ * its current round of samples when no other gyro uses it.
+ * @param muxsensor the SMUX sensor port number
+ */
+#ifdef __HTSMUX_SUPPORT__
+void HTGYROstopIntegrator(tMUXSensor muxsensor) {
+  _HTGYROstopIntegrator((SPORT(muxsensor) * 4) + MPORT(muxsensor));
+}
+#endif // __HTSMUX_SUPPORT__
+
+/**
+ * Stop integrating a gyro.  The integrator task ends after its current round
+ * of samples when no other gyro uses it.
+ * @param htgyroPtr pointer to the sensor's data struct
+ */
+void HTGYROstopIntegrator(tHTGYROPtr htgyroPtr) {
+  _HTGYROstopIntegrator(_HTGYROintKey(htgyroPtr));
+}
+
+/**
+ * Set the heading of the gyro on a sensor port to 0 with its next sample
+ * @param link the HTGYRO port number
+ */
+void HTGYROresetIntegrator(tSensors link) {
+  _HTGYROresetIntegrator(link * 4);
+}
+
+/**
+ * Set the heading of the gyro on a SMUX channel to 0 with its next sample
+ * @param muxsensor the SMUX sensor port number
+ */
+#ifdef __HTSMUX_SUPPORT__
+void HTGYROresetIntegrator(tMUXSensor muxsensor) {
+  _HTGYROresetIntegrator((SPORT(muxsensor) * 4) + MPORT(muxsensor));
+}
+#endif // __HTSMUX_SUPPORT__
+
+/**
+ * Set the heading of a gyro to 0 with its next sample
+ * @param htgyroPtr pointer to the sensor's data struct
+ */
+void HTGYROresetIntegrator(tHTGYROPtr htgyroPtr) {
+  _HTGYROresetIntegrator(_HTGYROintKey(htgyroPtr));
+}
+
+/**
+ * Read the heading, rate and sample timing of the gyro on a sensor port
+ * @param link the HTGYRO port number
+ * @param integral the struct to copy the integral into
+ * @return true if there was an integral, false if the integrator hasn't taken a sample yet
+ */
+bool HTGYROreadIntegral(tSensors link, tHTGYROIntegral &integral) {
+  return _HTGYROreadIntegral(link * 4, integral);
+}
+
+/**
+ * Read the heading, rate and sample timing of the gyro on a SMUX channel
+ * @param muxsensor the SMUX sensor port number
+ * @param integral the struct to copy the integral into
+ * @return true if there was an integral, false if the integrator hasn't taken a sample yet
+ */
+#ifdef __HTSMUX_SUPPORT__
+bool HTGYROreadIntegral(tMUXSensor muxsensor, tHTGYROIntegral &integral) {
+  return _HTGYROreadIntegral((SPORT(muxsensor) * 4) + MPORT(muxsensor), integral);
+}
+#endif // __HTSMUX_SUPPORT__
+
+/**
+ * Read the heading, rate and sample timing of a gyro
+ * @param htgyroPtr pointer to the sensor's data struct
+ * @param integral the struct to copy the integral into
+ * @return true if there was an integral, false if the integrator hasn't taken a sample yet
+ */
+bool HTGYROreadIntegral(tHTGYROPtr htgyroPtr, tHTGYROIntegral &integral) {
+  return _HTGYROreadIntegral(_HTGYROintKey(htgyroPtr), integral);
+}
+#endif // __HTGYRO_INTEGRATOR__
+
 #endif // __HTGYRO_H__
 
 /* @} */
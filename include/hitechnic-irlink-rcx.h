@@ -16,6 +16,7 @@
  * Changelog:
  * - 1.0: Initial release
  * - 1.1: HTRCXreadResp now clears entire IR read buffer after read
+ * - 1.2: Request and reply buffers are now kept per port in HTRCX_I2CData[]
  *
  * Credits:
  * - Big thanks to HiTechnic for providing me with the hardware necessary to write and test this.
@@ -26,7 +27,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 31 October 2010
- * \version 1.1
+ * \version 1.2
  * \example hitechnic-irlink-rcx-test1.c
  */
 
@@ -36,8 +37,7 @@
 #include "common.h"
 #endif
 
-tByteArray HTRCXI2CRequest;
-tByteArray HTRCXI2CReply;
+tI2CData HTRCX_I2CData[4]; /*!< Per-port I2C request and reply buffers */
 tByteArray HTRCXIRMsg;
 
 byte HTRCXCmdToggle = 0;
@@ -63,20 +63,20 @@ bool HTRCXmotorPwr(tSensors link, unsigned byte _motor, unsigned byte power);
  * @return true if no error occured, false if it did
  */
 bool HTRCXsendHeader(tSensors link) {
-  memset(HTRCXI2CRequest, 0, sizeof(tByteArray));
+  memset(HTRCX_I2CData[link].request, 0, sizeof(HTRCX_I2CData[link].request));
 
   // Send the 0x55 0x55 0x00 IR message header
-  HTRCXI2CRequest[0] = 8;
-  HTRCXI2CRequest[1] = 0x02;
-  HTRCXI2CRequest[2] = 0x4A;
-  HTRCXI2CRequest[3] = 0x55;
-  HTRCXI2CRequest[4] = 0xFF;
-  HTRCXI2CRequest[5] = 0x00;
-  HTRCXI2CRequest[6] = 0x03;
-  HTRCXI2CRequest[7] = 0x00;
-  HTRCXI2CRequest[8] = 0x01;
-
-  return writeI2C(link, HTRCXI2CRequest);
+  HTRCX_I2CData[link].request[0] = 8;
+  HTRCX_I2CData[link].request[1] = 0x02;
+  HTRCX_I2CData[link].request[2] = 0x4A;
+  HTRCX_I2CData[link].request[3] = 0x55;
+  HTRCX_I2CData[link].request[4] = 0xFF;
+  HTRCX_I2CData[link].request[5] = 0x00;
+  HTRCX_I2CData[link].request[6] = 0x03;
+  HTRCX_I2CData[link].request[7] = 0x00;
+  HTRCX_I2CData[link].request[8] = 0x01;
+
+  return writeI2C(link, HTRCX_I2CData[link].request);
 }
 
 /**
@@ -134,30 +134,30 @@ void HTRCXencode(tSensors link, tByteArray &iBuffer, tByteArray &oBuffer) {
  * @return true if no error occured, false if it did
  */
 bool HTRCXreadResp(tSensors link, tByteArray &response) {
-  memset(HTRCXI2CRequest, 0, sizeof(tByteArray));
-  memset(HTRCXI2CReply, 0, sizeof(tByteArray));
+  memset(HTRCX_I2CData[link].request, 0, sizeof(HTRCX_I2CData[link].request));
+  memset(HTRCX_I2CData[link].reply, 0, sizeof(HTRCX_I2CData[link].reply));
   memset(response, 0, sizeof(tByteArray));
 
-  HTRCXI2CRequest[0] = 2;
-  HTRCXI2CRequest[1] = 0x02;
-  HTRCXI2CRequest[2] = 0x50;
+  HTRCX_I2CData[link].request[0] = 2;
+  HTRCX_I2CData[link].request[1] = 0x02;
+  HTRCX_I2CData[link].request[2] = 0x50;
 
-  if (!writeI2C(link, HTRCXI2CRequest, HTRCXI2CReply, 16))
+  if (!writeI2C(link, HTRCX_I2CData[link].request, HTRCX_I2CData[link].reply, 16))
     return false;
 
   // Print the contents
-  // printBuffer(HTRCXI2CReply);
+  // printBuffer(HTRCX_I2CData[link].reply);
 
-  if ((HTRCXI2CReply[0] > 0) && (HTRCXI2CReply[0] < 16)) {
-    memcpy(response, HTRCXI2CReply, HTRCXI2CReply[0]);
+  if ((HTRCX_I2CData[link].reply[0] > 0) && (HTRCX_I2CData[link].reply[0] < 16)) {
+    memcpy(response, HTRCX_I2CData[link].reply, HTRCX_I2CData[link].reply[0]);
   }
 
-  memset(HTRCXI2CRequest, 0, sizeof(tByteArray));
+  memset(HTRCX_I2CData[link].request, 0, sizeof(HTRCX_I2CData[link].request));
   // Clear the buffer count
-  HTRCXI2CRequest[0] = 16;
-  HTRCXI2CRequest[1] = 0x02;
-  HTRCXI2CRequest[2] = 0x50;
-  return writeI2C(link, HTRCXI2CRequest);
+  HTRCX_I2CData[link].request[0] = 16;
+  HTRCX_I2CData[link].request[1] = 0x02;
+  HTRCX_I2CData[link].request[2] = 0x50;
+  return writeI2C(link, HTRCX_I2CData[link].request);
 }
 
 /**
@@ -176,8 +176,8 @@ bool HTRCXplaySound(tSensors link, unsigned byte sound) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -197,8 +197,8 @@ bool HTRCXsendByte(tSensors link, unsigned byte data) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -220,8 +220,8 @@ bool HTRCXsendWord(tSensors link, short data) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -244,8 +244,8 @@ bool HTRCXmotorOn(tSensors link, unsigned byte _motor) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -268,8 +268,8 @@ bool HTRCXmotorOff(tSensors link, unsigned byte _motor) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -292,8 +292,8 @@ bool HTRCXmotorFwd(tSensors link, unsigned byte _motor) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -316,8 +316,8 @@ bool HTRCXmotorRev(tSensors link, unsigned byte _motor) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
@@ -343,8 +343,8 @@ bool HTRCXmotorPwr(tSensors link, unsigned byte _motor, unsigned byte power) {
 
   HTRCXsendHeader(link);
   sleep(12);
-  HTRCXencode(link, HTRCXIRMsg, HTRCXI2CRequest);
-  writeI2C(link, HTRCXI2CRequest);
+  HTRCXencode(link, HTRCXIRMsg, HTRCX_I2CData[link].request);
+  writeI2C(link, HTRCX_I2CData[link].request);
   sleep(12);
 
   return true;
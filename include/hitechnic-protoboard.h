@@ -29,6 +29,8 @@
  *        Removed HTPB_SMUXData, reuses HTPB_I2CReply to reduce memory overhead.
  * - 0.8: Changed type of masks from signed byte to unsigned byte to prevent truncation in ROBOTC 1.9x
  * - 0.9: Replaced functions requiring SPORT/MPORT macros
+ * - 0.10: Request and reply buffers are now kept per port in HTPB_I2CData[]
+ * - 0.11: Use HTSMUXensureConfig() so a SMUX channel is only configured once
  *
  * License: You may use this code as you wish, provided you give credit where its due.
  *
@@ -36,7 +38,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 24 September 2009
- * \version 0.9
+ * \version 0.11
  * \example hitechnic-protoboard-test1.c
  * \example hitechnic-protoboard-test2.c
  * \example hitechnic-protoboard-test3.c
@@ -68,8 +70,7 @@
 #define HTPB_DIGCTRL  0x0C      /*!< Controls direction of digital ports */
 #define HTPB_SRATE    0x0D      /*!< Controls sample rate, default set to 10ms */
 
-tByteArray HTPB_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray HTPB_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData HTPB_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 ubyte HTPBreadIO(tSensors link, ubyte mask);
 bool HTPBwriteIO(tSensors link, ubyte mask);
@@ -92,15 +93,15 @@ tConfigParams HTPB_config = {HTSMUX_CHAN_I2C + HTSMUX_CHAN_9V, 14, 0x02, 0x42};
  * @param mask the specified digital ports
  */
 ubyte HTPBreadIO(tSensors link, ubyte mask) {
-  memset(HTPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[link].request, 0, sizeof(HTPB_I2CData[link].request));
 
-  HTPB_I2CRequest[0] = 2;                         // Message size
-  HTPB_I2CRequest[1] = HTPB_I2C_ADDR;             // I2C Address
-  HTPB_I2CRequest[2] = HTPB_OFFSET + HTPB_DIGIN;  // Start digital output read address
+  HTPB_I2CData[link].request[0] = 2;                         // Message size
+  HTPB_I2CData[link].request[1] = HTPB_I2C_ADDR;             // I2C Address
+  HTPB_I2CData[link].request[2] = HTPB_OFFSET + HTPB_DIGIN;  // Start digital output read address
 
-  writeI2C(link, HTPB_I2CRequest, HTPB_I2CReply, 1);
+  writeI2C(link, HTPB_I2CData[link].request, HTPB_I2CData[link].reply, 1);
 
-  return HTPB_I2CReply[0] & mask;
+  return HTPB_I2CData[link].reply[0] & mask;
 }
 
 /**
@@ -110,15 +111,14 @@ ubyte HTPBreadIO(tSensors link, ubyte mask) {
  */
 #ifdef __HTSMUX_SUPPORT__
 ubyte HTPBreadIO(tMUXSensor muxsensor, ubyte mask) {
-  memset(HTPB_I2CReply, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[SPORT(muxsensor)].reply, 0, sizeof(HTPB_I2CData[SPORT(muxsensor)].reply));
 
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, HTPB_config);
+  HTSMUXensureConfig(muxsensor, HTPB_config);
 
-  if (!HTSMUXreadPort(muxsensor, HTPB_I2CReply, 1, HTPB_DIGIN))
+  if (!HTSMUXreadPort(muxsensor, HTPB_I2CData[SPORT(muxsensor)].reply, 1, HTPB_DIGIN))
     return 0;
 
-  return HTPB_I2CReply[0] & mask;
+  return HTPB_I2CData[SPORT(muxsensor)].reply[0] & mask;
 }
 #endif // __HTSMUX_SUPPORT__
 
@@ -129,14 +129,14 @@ ubyte HTPBreadIO(tMUXSensor muxsensor, ubyte mask) {
  * @return true if no error occured, false if it did
  */
 bool HTPBwriteIO(tSensors link, ubyte mask) {
-  memset(HTPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[link].request, 0, sizeof(HTPB_I2CData[link].request));
 
-  HTPB_I2CRequest[0] = 3;                         // Message size
-  HTPB_I2CRequest[1] = HTPB_I2C_ADDR;             // I2C Address
-  HTPB_I2CRequest[2] = HTPB_OFFSET + HTPB_DIGOUT; // Start digital output read address
-  HTPB_I2CRequest[3] = mask;                      // The specified digital ports
+  HTPB_I2CData[link].request[0] = 3;                         // Message size
+  HTPB_I2CData[link].request[1] = HTPB_I2C_ADDR;             // I2C Address
+  HTPB_I2CData[link].request[2] = HTPB_OFFSET + HTPB_DIGOUT; // Start digital output read address
+  HTPB_I2CData[link].request[3] = mask;                      // The specified digital ports
 
-  return writeI2C(link, HTPB_I2CRequest);
+  return writeI2C(link, HTPB_I2CData[link].request);
 }
 
 /**
@@ -146,14 +146,14 @@ bool HTPBwriteIO(tSensors link, ubyte mask) {
  * @return true if no error occured, false if it did
  */
 bool HTPBsetupIO(tSensors link, ubyte mask) {
-  memset(HTPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[link].request, 0, sizeof(HTPB_I2CData[link].request));
 
-  HTPB_I2CRequest[0] = 3;                           // Message size
-  HTPB_I2CRequest[1] = HTPB_I2C_ADDR;               // I2C Address
-  HTPB_I2CRequest[2] = HTPB_OFFSET + HTPB_DIGCTRL;  // Start digital input/output control address
-  HTPB_I2CRequest[3] = mask;                        // The specified digital ports
+  HTPB_I2CData[link].request[0] = 3;                           // Message size
+  HTPB_I2CData[link].request[1] = HTPB_I2C_ADDR;               // I2C Address
+  HTPB_I2CData[link].request[2] = HTPB_OFFSET + HTPB_DIGCTRL;  // Start digital input/output control address
+  HTPB_I2CData[link].request[3] = mask;                        // The specified digital ports
 
-  return writeI2C(link, HTPB_I2CRequest);
+  return writeI2C(link, HTPB_I2CData[link].request);
 }
 
 /**
@@ -164,14 +164,14 @@ bool HTPBsetupIO(tSensors link, ubyte mask) {
  * @return the value of the ADC channel, or -1 if an error occurred
  */
 short HTPBreadADC(tSensors link, byte channel, byte width) {
-  memset(HTPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[link].request, 0, sizeof(HTPB_I2CData[link].request));
 
   short _adcVal = 0;
-  HTPB_I2CRequest[0] = 2;                                       // Message size
-  HTPB_I2CRequest[1] = HTPB_I2C_ADDR;                           // I2C Address
-  HTPB_I2CRequest[2] = HTPB_OFFSET + HTPB_A0_U + (channel * 2); // Start digital output read address
+  HTPB_I2CData[link].request[0] = 2;                                       // Message size
+  HTPB_I2CData[link].request[1] = HTPB_I2C_ADDR;                           // I2C Address
+  HTPB_I2CData[link].request[2] = HTPB_OFFSET + HTPB_A0_U + (channel * 2); // Start digital output read address
                                                                     // with channel offset
-  if (!writeI2C(link, HTPB_I2CRequest, HTPB_I2CReply, 2))
+  if (!writeI2C(link, HTPB_I2CData[link].request, HTPB_I2CData[link].reply, 2))
     return -1;
 
   // Convert the bytes into and short
@@ -180,9 +180,9 @@ short HTPBreadADC(tSensors link, byte channel, byte width) {
   // We'll need to shift the 1st byte left by 2 and or 2nd byte onto it.
   // If 8 bits is all we want, we just return the first byte and be done with it.
   if (width == 8)
-    _adcVal = HTPB_I2CReply[0];
+    _adcVal = HTPB_I2CData[link].reply[0];
   else
-    _adcVal = (HTPB_I2CReply[0] * 4) + HTPB_I2CReply[1];
+    _adcVal = (HTPB_I2CData[link].reply[0] * 4) + HTPB_I2CData[link].reply[1];
 
   return _adcVal;
 }
@@ -197,12 +197,11 @@ short HTPBreadADC(tSensors link, byte channel, byte width) {
 #ifdef __HTSMUX_SUPPORT__
 short HTPBreadADC(tMUXSensor muxsensor, byte channel, byte width) {
   short _adcVal = 0;
-  memset(HTPB_I2CReply, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[SPORT(muxsensor)].reply, 0, sizeof(HTPB_I2CData[SPORT(muxsensor)].reply));
 
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, HTPB_config);
+  HTSMUXensureConfig(muxsensor, HTPB_config);
 
-  if (!HTSMUXreadPort(muxsensor, HTPB_I2CReply, 2, HTPB_A0_U + (channel * 2)))
+  if (!HTSMUXreadPort(muxsensor, HTPB_I2CData[SPORT(muxsensor)].reply, 2, HTPB_A0_U + (channel * 2)))
     return -1;
 
   // Convert the bytes into and short
@@ -211,9 +210,9 @@ short HTPBreadADC(tMUXSensor muxsensor, byte channel, byte width) {
   // We'll need to shift the 1st byte left by 2 and or 2nd byte onto it.
   // If 8 bits is all we want, we just return the first byte and be done with it.
   if (width == 8)
-    _adcVal = HTPB_I2CReply[0];
+    _adcVal = HTPB_I2CData[SPORT(muxsensor)].reply[0];
   else
-    _adcVal = (HTPB_I2CReply[0] * 4) + HTPB_I2CReply[1];
+    _adcVal = (HTPB_I2CData[SPORT(muxsensor)].reply[0] * 4) + HTPB_I2CData[SPORT(muxsensor)].reply[1];
 
   return _adcVal;
 }
@@ -231,13 +230,13 @@ short HTPBreadADC(tMUXSensor muxsensor, byte channel, byte width) {
  * @return true if no error occured, false if it did
  */
 bool HTPBreadAllADC(tSensors link, short &adch0, short &adch1, short &adch2, short &adch3, short &adch4, byte width) {
-  memset(HTPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[link].request, 0, sizeof(HTPB_I2CData[link].request));
 
-  HTPB_I2CRequest[0] = 2;                       // Message size
-  HTPB_I2CRequest[1] = HTPB_I2C_ADDR;           // I2C Address
-  HTPB_I2CRequest[2] = HTPB_OFFSET + HTPB_A0_U; // Start digital output read address
+  HTPB_I2CData[link].request[0] = 2;                       // Message size
+  HTPB_I2CData[link].request[1] = HTPB_I2C_ADDR;           // I2C Address
+  HTPB_I2CData[link].request[2] = HTPB_OFFSET + HTPB_A0_U; // Start digital output read address
 
-  if (!writeI2C(link, HTPB_I2CRequest, HTPB_I2CReply, 10))
+  if (!writeI2C(link, HTPB_I2CData[link].request, HTPB_I2CData[link].reply, 10))
     return false;
 
   // Convert the bytes into and short
@@ -246,17 +245,17 @@ bool HTPBreadAllADC(tSensors link, short &adch0, short &adch1, short &adch2, sho
   // We'll need to shift the 1st byte left by 2 and or 2nd byte onto it.
   // If 8 bits is all we want, we just return the first byte and be done with it.
   if (width == 8) {
-    adch0 = (short)HTPB_I2CReply[0];
-    adch1 = (short)HTPB_I2CReply[2];
-    adch2 = (short)HTPB_I2CReply[4];
-    adch3 = (short)HTPB_I2CReply[6];
-    adch4 = (short)HTPB_I2CReply[8];
+    adch0 = (short)HTPB_I2CData[link].reply[0];
+    adch1 = (short)HTPB_I2CData[link].reply[2];
+    adch2 = (short)HTPB_I2CData[link].reply[4];
+    adch3 = (short)HTPB_I2CData[link].reply[6];
+    adch4 = (short)HTPB_I2CData[link].reply[8];
   } else {
-    adch0 = ((short)HTPB_I2CReply[0] << 2) + (short)HTPB_I2CReply[1];
-    adch1 = ((short)HTPB_I2CReply[2] << 2) + (short)HTPB_I2CReply[3];
-    adch2 = ((short)HTPB_I2CReply[4] << 2) + (short)HTPB_I2CReply[5];
-    adch3 = ((short)HTPB_I2CReply[6] << 2) + (short)HTPB_I2CReply[7];
-    adch4 = ((short)HTPB_I2CReply[8] << 2) + (short)HTPB_I2CReply[9];
+    adch0 = ((short)HTPB_I2CData[link].reply[0] << 2) + (short)HTPB_I2CData[link].reply[1];
+    adch1 = ((short)HTPB_I2CData[link].reply[2] << 2) + (short)HTPB_I2CData[link].reply[3];
+    adch2 = ((short)HTPB_I2CData[link].reply[4] << 2) + (short)HTPB_I2CData[link].reply[5];
+    adch3 = ((short)HTPB_I2CData[link].reply[6] << 2) + (short)HTPB_I2CData[link].reply[7];
+    adch4 = ((short)HTPB_I2CData[link].reply[8] << 2) + (short)HTPB_I2CData[link].reply[9];
   }
   return true;
 }
@@ -274,12 +273,11 @@ bool HTPBreadAllADC(tSensors link, short &adch0, short &adch1, short &adch2, sho
  */
 #ifdef __HTSMUX_SUPPORT__
 bool HTPBreadAllADC(tMUXSensor muxsensor, short &adch0, short &adch1, short &adch2, short &adch3, short &adch4, byte width) {
-  memset(HTPB_I2CReply, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[SPORT(muxsensor)].reply, 0, sizeof(HTPB_I2CData[SPORT(muxsensor)].reply));
 
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, HTPB_config);
+  HTSMUXensureConfig(muxsensor, HTPB_config);
 
-  if (!HTSMUXreadPort(muxsensor, HTPB_I2CReply, 10, HTPB_A0_U))
+  if (!HTSMUXreadPort(muxsensor, HTPB_I2CData[SPORT(muxsensor)].reply, 10, HTPB_A0_U))
     return false;
 
   // Convert the bytes into and short
@@ -288,17 +286,17 @@ bool HTPBreadAllADC(tMUXSensor muxsensor, short &adch0, short &adch1, short &adc
   // We'll need to shift the 1st byte left by 2 and or 2nd byte onto it.
   // If 8 bits is all we want, we just return the first byte and be done with it.
   if (width == 8) {
-    adch0 = (short)HTPB_I2CReply[0];
-    adch1 = (short)HTPB_I2CReply[2];
-    adch2 = (short)HTPB_I2CReply[4];
-    adch3 = (short)HTPB_I2CReply[6];
-    adch4 = (short)HTPB_I2CReply[8];
+    adch0 = (short)HTPB_I2CData[SPORT(muxsensor)].reply[0];
+    adch1 = (short)HTPB_I2CData[SPORT(muxsensor)].reply[2];
+    adch2 = (short)HTPB_I2CData[SPORT(muxsensor)].reply[4];
+    adch3 = (short)HTPB_I2CData[SPORT(muxsensor)].reply[6];
+    adch4 = (short)HTPB_I2CData[SPORT(muxsensor)].reply[8];
   } else {
-    adch0 = ((short)HTPB_I2CReply[0] << 2) + (short)HTPB_I2CReply[1];
-    adch1 = ((short)HTPB_I2CReply[2] << 2) + (short)HTPB_I2CReply[3];
-    adch2 = ((short)HTPB_I2CReply[4] << 2) + (short)HTPB_I2CReply[5];
-    adch3 = ((short)HTPB_I2CReply[6] << 2) + (short)HTPB_I2CReply[7];
-    adch4 = ((short)HTPB_I2CReply[8] << 2) + (short)HTPB_I2CReply[9];
+    adch0 = ((short)HTPB_I2CData[SPORT(muxsensor)].reply[0] << 2) + (short)HTPB_I2CData[SPORT(muxsensor)].reply[1];
+    adch1 = ((short)HTPB_I2CData[SPORT(muxsensor)].reply[2] << 2) + (short)HTPB_I2CData[SPORT(muxsensor)].reply[3];
+    adch2 = ((short)HTPB_I2CData[SPORT(muxsensor)].reply[4] << 2) + (short)HTPB_I2CData[SPORT(muxsensor)].reply[5];
+    adch3 = ((short)HTPB_I2CData[SPORT(muxsensor)].reply[6] << 2) + (short)HTPB_I2CData[SPORT(muxsensor)].reply[7];
+    adch4 = ((short)HTPB_I2CData[SPORT(muxsensor)].reply[8] << 2) + (short)HTPB_I2CData[SPORT(muxsensor)].reply[9];
   }
   return true;
 }
@@ -311,22 +309,22 @@ bool HTPBreadAllADC(tMUXSensor muxsensor, short &adch0, short &adch1, short &adc
  * @return true if no error occured, false if it did
  */
 bool HTPBsetSamplingTime(tSensors link, byte interval) {
-  memset(HTPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTPB_I2CData[link].request, 0, sizeof(HTPB_I2CData[link].request));
 
   // Correct the value of the interval if it is out of bounds
   if (interval < 4) interval = 4;
   if (interval > 100) interval = 100;
 
-  HTPB_I2CRequest[0] = 3;                       // Message size
-  HTPB_I2CRequest[1] = HTPB_I2C_ADDR;           // I2C Address
-  HTPB_I2CRequest[2] = HTPB_OFFSET + HTPB_A0_U; // Start sampling time address
-  HTPB_I2CRequest[3] = interval;                // Sample time interval
+  HTPB_I2CData[link].request[0] = 3;                       // Message size
+  HTPB_I2CData[link].request[1] = HTPB_I2C_ADDR;           // I2C Address
+  HTPB_I2CData[link].request[2] = HTPB_OFFSET + HTPB_A0_U; // Start sampling time address
+  HTPB_I2CData[link].request[3] = interval;                // Sample time interval
 
   // Correct the value of the interval if it is out of bounds
-  if (interval < 4) HTPB_I2CRequest[3] = 4;
-  if (interval > 100) HTPB_I2CRequest[3] = 100;
+  if (interval < 4) HTPB_I2CData[link].request[3] = 4;
+  if (interval > 100) HTPB_I2CData[link].request[3] = 100;
 
-  if (!writeI2C(link, HTPB_I2CRequest))
+  if (!writeI2C(link, HTPB_I2CData[link].request))
     return false;
 
   return true;
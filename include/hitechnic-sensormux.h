@@ -19,18 +19,51 @@
  *
  * Changelog:
  * - 0.1: Initial release, split off from common.h
+ * - 0.2: Request and reply buffers are now kept per port in HTSMUX_I2CData[]
+ * - 0.3: Channel configuration and mode are cached per channel, a configured channel is no longer
+ *        halted and reconfigured on every read<br>
+ *        Added HTSMUXensureConfig(), HTSMUXinvalidateChannel() and HTSMUXinvalidateConfig()
+ * - 0.4: Added HTSMUXreadAllAnalogue() to read all four analogue channels in one transaction
+ * - 0.5: Added an optional poller task that keeps a snapshot of the configured channels,
+ *        see HTSMUXstartPoller() (__HTSMUX_POLLER__)
+ * - 0.6: Added HTSMUXscanPorts(), the scan results are kept in a data file and reused when
+ *        the SMUX still matches them
+ * - 0.7: Each SMUX has its own tHTSMUX struct with its status, sensor types, channel cache and
+ *        I2C buffers, SMUXes on different ports can be used from different tasks<br>
+ *        HALT and RUN are no longer sent when the SMUX is already halted or running<br>
+ *        Removed HTSMUXstatus[], HTSMUXSensorTypes[] and HTSMUX_I2CData[], use HTSMUXdata[] instead
+ * - 0.8: The poller task is now opt-in, define __HTSMUX_POLLER__ as 1 to use it
+ * - 0.9: The saved scan results are only reused when the SMUX still holds the configuration
+ *        the autodetect set up for an I2C sensor, a SMUX with only analogue sensors is always scanned<br>
+ *        HTSMUXreadAllAnalogue() only sets up unconfigured channels that were detected as analogue
  *
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 18 January 2011
- * \version 0.1
+ * \version 0.9
+ * \example hitechnic-sensormux-test1.c
+ * \example hitechnic-sensormux-test2.c
  */
 
 #pragma systemFile
 
+/*!< define this as 1 to add the poller task */
+#ifndef __HTSMUX_POLLER__
+#define __HTSMUX_POLLER__ 0
+#endif
+
+// The poller shares the port with the program, it needs the bus ownership in common.h
+#if (__HTSMUX_POLLER__ == 1) && !defined(__COMMON_H_I2C_ARBITRATION__)
+#define __COMMON_H_I2C_ARBITRATION__ 1
+#endif
+
 #ifndef __COMMON_H__
 #include "common.h"
 #endif
 
+#if (__HTSMUX_POLLER__ == 1) && (__COMMON_H_I2C_ARBITRATION__ == 0)
+#error "The SMUX poller needs __COMMON_H_I2C_ARBITRATION__, define it as 1 before including any driver"
+#endif
+
 #define __HTSMUX_SUPPORT__
 
 #ifndef MAX_ARR_SIZE
@@ -61,6 +94,12 @@
 #define HTSMUX_I2C_BUF          0x40  /*!< I2C buffer register offset */
 #define HTSMUX_BF_ENTRY_SIZE    0x10  /*!< Number of registers per buffer */
 
+#define HTSMUX_SCAN_TIME        500   /*!< Time the SMUX needs to detect the attached sensors, in ms */
+#define HTSMUXDAT               "htsmux.dat" /*!< Datafile for the SMUX scan results */
+
+#define HTSMUX_POLL_SIZE        0x4A  /*!< Number of registers from HTSMUX_ANALOG to the end of the last I2C buffer */
+#define HTSMUX_POLL_INTERVAL    5     /*!< Time between two sweeps of the poller, in ms */
+
 // Command fields
 #define HTSMUX_CMD_HALT         0x00  /*!< Halt multiplexer command */
 #define HTSMUX_CMD_AUTODETECT   0x01  /*!< Start auto-detect function command */
@@ -98,30 +137,87 @@ typedef enum HTSMUXSensorType {
   HTSMUXSensorNone = 0x0F
 } HTSMUXSensorType;
 
-/*!< array to hold SMUX status info */
-ubyte HTSMUXstatus[4] = {HTSMUX_STAT_NOTHING, HTSMUX_STAT_NOTHING, HTSMUX_STAT_NOTHING, HTSMUX_STAT_NOTHING};
-
-/*!< Array for holding sensor types */
-HTSMUXSensorType HTSMUXSensorTypes[16] = {HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone,
-                                          HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone,
-                                          HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone,
-                                          HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone, HTSMUXSensorNone};
-
-tByteArray HTSMUX_I2CRequest;     /*!< Array to hold I2C command data */
-tByteArray HTSMUX_I2CReply;       /*!< Array to hold I2C reply data */
-
 typedef ubyte tConfigParams[4];   /*!< Array to hold SMUX channel info */
+typedef short tHTSMUXAnalogue[4]; /*!< Array to hold the analogue values of all four SMUX channels */
 
 tConfigParams Analogue_config = {HTSMUX_CHAN_NONE, 0, 0, 0}; /*!< Array to hold SMUX config data for sensor */
 
+/*!< Struct to hold the configuration last written to a SMUX channel */
 typedef struct
 {
-  tI2CData I2CData;
-  ubyte status;
-  HTSMUXSensorType sensorTypes[4];
-  tConfigParams configParams[4];
+  bool configValid;             /*!< config holds what the channel is configured with */
+  bool modeValid;               /*!< mode holds the channel's current mode */
+  tConfigParams config;         /*!< Last configuration written to the channel */
+  ubyte mode;                   /*!< Last mode written to the channel */
+} tHTSMUXChannelState;
+
+/*!< Struct to hold the state of a single SMUX */
+typedef struct
+{
+  tI2CData I2CData;                 /*!< The SMUX's own request and reply buffers */
+  bool initialised;                 /*!< initSensor() has been called */
+  ubyte status;                     /*!< Last command sent, HTSMUX_STAT_NOTHING if unknown */
+  long haltTime;                    /*!< Time the SMUX was halted, in ms */
+  HTSMUXSensorType sensorTypes[4];  /*!< Sensor type of each channel */
+  tHTSMUXChannelState channels[4];  /*!< Configuration state cache for each channel */
+  long configGen;                   /*!< Bumped every time a channel is (re)configured */
+  long scanTime;                    /*!< Time the last HTSMUXscanPorts() took, in ms */
+  bool scanReused;                  /*!< The last HTSMUXscanPorts() reused the saved results */
+  bool polled;                      /*!< The poller task keeps a snapshot of this SMUX */
+  long commandsSkipped;             /*!< HALT and RUN commands not sent because the SMUX was already in that state */
 } tHTSMUX, *tHTSMUXPtr;
 
+/*!< SMUX state for each port, this is what the tMUXSensor functions use */
+tHTSMUX HTSMUXdata[4];
+
+/*!< Scan results of a single SMUX, as kept in HTSMUXDAT */
+typedef struct
+{
+  bool valid;                   /*!< The SMUX on this port has been scanned */
+  ubyte status;                 /*!< Status register after the scan, part of the fingerprint */
+  HTSMUXSensorType types[4];    /*!< Detected sensor types */
+  tConfigParams config[4];      /*!< Channel configuration set up by the scan, that of the first I2C sensor is part of the fingerprint */
+} tHTSMUXScanRecord;
+
+tHTSMUXScanRecord HTSMUXscanRecords[4];     /*!< Scan results for each port, loaded from HTSMUXDAT */
+bool HTSMUXscanRecordsLoaded = false;       /*!< HTSMUXDAT has been read */
+
+#if (__HTSMUX_POLLER__ == 1)
+/*!< Copy of the SMUX registers, made by the poller task */
+typedef struct
+{
+  ubyte regs[HTSMUX_POLL_SIZE]; /*!< Registers HTSMUX_ANALOG and up */
+  ubyte analogue;               /*!< Bitmask of the channels whose analogue value is valid */
+  ubyte i2c;                    /*!< Bitmask of the channels whose I2C buffer is valid */
+  ubyte i2cCount[4];            /*!< Number of valid bytes in each I2C buffer */
+  long configGen;               /*!< Value of the SMUX's configGen when the sweep started */
+  long sequence;                /*!< Number of the sweep that made this snapshot */
+  long timestamp;               /*!< Time the sweep finished, in ms */
+  short transactions;           /*!< Number of I2C transactions the sweep took */
+} tHTSMUXSnapshot;
+
+tHTSMUXSnapshot HTSMUXsnapshots[8];  /*!< Two snapshots per port, the poller fills one while the other is read */
+ubyte HTSMUXsnapshotActive[4];       /*!< Index of the snapshot that was completed last */
+long HTSMUXsnapshotSeq[4];           /*!< Bumped when the active snapshot changes, readers retry when it does */
+bool HTSMUXpollerRunning = false;    /*!< The poller task is running */
+#endif // __HTSMUX_POLLER__
+
+bool initSensor(tHTSMUXPtr smuxPtr, tSensors port);
+byte HTSMUXreadStatus(tHTSMUXPtr smuxPtr);
+bool HTSMUXsendCommand(tHTSMUXPtr smuxPtr, byte command);
+bool HTSMUXsetMode(tHTSMUXPtr smuxPtr, byte channel, byte mode);
+bool HTSMUXsetAnalogueActive(tHTSMUXPtr smuxPtr, byte channel);
+bool HTSMUXsetAnalogueInactive(tHTSMUXPtr smuxPtr, byte channel);
+bool HTSMUXreadPort(tHTSMUXPtr smuxPtr, byte channel, tByteArray &result, short numbytes, short offset = 0);
+short HTSMUXreadAnalogue(tHTSMUXPtr smuxPtr, byte channel);
+bool HTSMUXreadAllAnalogue(tHTSMUXPtr smuxPtr, tHTSMUXAnalogue &values);
+bool HTSMUXreadPowerStatus(tHTSMUXPtr smuxPtr);
+bool HTSMUXconfigChannel(tHTSMUXPtr smuxPtr, byte channel, tConfigParams &configparams);
+bool HTSMUXensureConfig(tHTSMUXPtr smuxPtr, byte channel, tConfigParams &configparams);
+void HTSMUXinvalidateChannel(tHTSMUXPtr smuxPtr, byte channel);
+void HTSMUXinvalidateConfig(tHTSMUXPtr smuxPtr);
+bool HTSMUXscanPorts(tHTSMUXPtr smuxPtr, bool force = false);
+
 byte HTSMUXreadStatus(tSensors link);
 HTSMUXSensorType HTSMUXreadSensorType(tMUXSensor muxsensor);
 bool HTSMUXsendCommand(tSensors link, byte command);
@@ -130,8 +226,59 @@ bool HTSMUXsetMode(tMUXSensor muxsensor, byte mode);
 bool HTSMUXsetAnalogueActive(tMUXSensor muxsensor);
 bool HTSMUXsetAnalogueInactive(tMUXSensor muxsensor);
 short HTSMUXreadAnalogue(tMUXSensor muxsensor);
+bool HTSMUXreadAllAnalogue(tSensors link, tHTSMUXAnalogue &values);
 bool HTSMUXreadPowerStatus(tSensors link);
 bool HTSMUXconfigChannel(tMUXSensor muxsensor, tConfigParams &configparams);
+bool HTSMUXensureConfig(tMUXSensor muxsensor, tConfigParams &configparams);
+void HTSMUXinvalidateChannel(tMUXSensor muxsensor);
+void HTSMUXinvalidateConfig(tSensors link);
+bool HTSMUXscanPorts(tSensors link, bool force = false);
+
+#if (__HTSMUX_POLLER__ == 1)
+void HTSMUXstartPoller(tSensors link);
+void HTSMUXstopPoller(tSensors link);
+bool HTSMUXreadSnapshot(tSensors link, tHTSMUXSnapshot &snapshot);
+bool _HTSMUXreadFromSnapshot(tHTSMUXPtr smuxPtr, short reg, short numbytes, tByteArray &result);
+#endif // __HTSMUX_POLLER__
+
+/**
+ * Initialise the SMUX's data struct.  The SMUX on each port has one in
+ * HTSMUXdata[], which is set up automatically when it is first used.  Give
+ * each task its own struct to drive SMUXes on different ports from
+ * different tasks.
+ *
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param port the SMUX port number
+ * @return true if no error occured, false if it did
+ */
+bool initSensor(tHTSMUXPtr smuxPtr, tSensors port)
+{
+  memset(smuxPtr, 0, sizeof(tHTSMUX));
+  smuxPtr->I2CData.address = HTSMUX_I2C_ADDR;
+  smuxPtr->I2CData.port = port;
+  smuxPtr->I2CData.type = sensorI2CCustom;
+  smuxPtr->status = HTSMUX_STAT_NOTHING;
+  for (short i = 0; i < 4; i++)
+    smuxPtr->sensorTypes[i] = HTSMUXSensorNone;
+  smuxPtr->initialised = true;
+
+  // Ensure the sensor is configured correctly
+  if (SensorType[smuxPtr->I2CData.port] != smuxPtr->I2CData.type)
+    SensorType[smuxPtr->I2CData.port] = smuxPtr->I2CData.type;
+
+  return true;
+}
+
+/**
+ * Make sure the SMUX struct for a port has been initialised.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the SMUX port number
+ */
+void _HTSMUXcheckInit(tSensors link) {
+  if (!HTSMUXdata[link].initialised)
+    initSensor(&HTSMUXdata[link], link);
+}
 
 /**
  * Read the status of the SMUX
@@ -143,20 +290,32 @@ bool HTSMUXconfigChannel(tMUXSensor muxsensor, tConfigParams &configparams);
  * - D2 - HTSMUX_STAT_BUSY: Auto-dected in progress status
  * - D3 - HTSMUX_STAT_HALT: Multiplexer is halted
  * - D4 - HTSMUX_STAT_ERROR: Command error detected
- * @param link the SMUX port number
+ * @param smuxPtr pointer to the SMUX's data struct
  * @return the status byte
  */
-byte HTSMUXreadStatus(tSensors link) {
-  memset(HTSMUX_I2CRequest, 0, sizeof(tByteArray));
+byte HTSMUXreadStatus(tHTSMUXPtr smuxPtr) {
+  memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
 
-  HTSMUX_I2CRequest[0] = 2;               // Message size
-  HTSMUX_I2CRequest[1] = HTSMUX_I2C_ADDR; // I2C Address
-  HTSMUX_I2CRequest[2] = HTSMUX_STATUS;
+  smuxPtr->I2CData.request[0] = 2;               // Message size
+  smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR; // I2C Address
+  smuxPtr->I2CData.request[2] = HTSMUX_STATUS;
+  smuxPtr->I2CData.requestLen = 2;
+  smuxPtr->I2CData.replyLen = 1;
 
-  if (!writeI2C(link, HTSMUX_I2CRequest, HTSMUX_I2CReply, 1))
+  if (!writeI2C(&smuxPtr->I2CData))
     return -1;
 
-  return HTSMUX_I2CReply[0];
+  return smuxPtr->I2CData.reply[0];
+}
+
+/**
+ * Read the status of the SMUX
+ * @param link the SMUX port number
+ * @return the status byte
+ */
+byte HTSMUXreadStatus(tSensors link) {
+  _HTSMUXcheckInit(link);
+  return HTSMUXreadStatus(&HTSMUXdata[link]);
 }
 
 /**
@@ -165,7 +324,93 @@ byte HTSMUXreadStatus(tSensors link) {
  * @return the status byte
  */
 HTSMUXSensorType HTSMUXreadSensorType(tMUXSensor muxsensor) {
-  return HTSMUXSensorTypes[muxsensor];
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXdata[SPORT(muxsensor)].sensorTypes[MPORT(muxsensor)];
+}
+
+/**
+ * Send a command to the SMUX.
+ *
+ * command can be one of the following:
+ * - HTSMUX_CMD_HALT
+ * - HTSMUX_CMD_AUTODETECT
+ * - HTSMUX_CMD_RUN
+ *
+ * HALT and RUN are not sent if the SMUX is known to be halted or running already.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param command the command to be sent to the SMUX
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXsendCommand(tHTSMUXPtr smuxPtr, byte command) {
+  if ((command == HTSMUX_CMD_HALT && smuxPtr->status == HTSMUX_STAT_HALT) ||
+      (command == HTSMUX_CMD_RUN && smuxPtr->status == HTSMUX_STAT_NORMAL)) {
+    smuxPtr->commandsSkipped++;
+    return true;
+  }
+
+  memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
+
+  smuxPtr->I2CData.request[0] = 3;               // Message size
+  smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR; // I2C Address
+  smuxPtr->I2CData.request[2] = HTSMUX_COMMAND;
+  smuxPtr->I2CData.request[3] = command;
+  smuxPtr->I2CData.requestLen = 3;
+  smuxPtr->I2CData.replyLen = 0;
+
+  switch(command) {
+    case HTSMUX_CMD_HALT:
+        smuxPtr->status = HTSMUX_STAT_HALT;
+        smuxPtr->haltTime = nPgmTime;
+        break;
+    case HTSMUX_CMD_AUTODETECT:
+        // The scan overwrites the configuration of every channel
+        HTSMUXinvalidateConfig(smuxPtr);
+        smuxPtr->status = HTSMUX_STAT_BUSY;
+        break;
+    case HTSMUX_CMD_RUN:
+        smuxPtr->status = HTSMUX_STAT_NORMAL;
+        break;
+  }
+
+  if (!writeI2C(&smuxPtr->I2CData)) {
+    // We no longer know what state the SMUX is in
+    smuxPtr->status = HTSMUX_STAT_NOTHING;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Send a command to the SMUX.
+ * @param link the SMUX port number
+ * @param command the command to be sent to the SMUX
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXsendCommand(tSensors link, byte command) {
+  _HTSMUXcheckInit(link);
+  return HTSMUXsendCommand(&HTSMUXdata[link], command);
+}
+
+/**
+ * Halt the SMUX and give it 50ms to settle.  Nothing is sent if the SMUX
+ * is halted already, and it only waits for what's left of the 50ms.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @return true if no error occured, false if it did
+ */
+bool _HTSMUXhalt(tHTSMUXPtr smuxPtr) {
+  long settled;
+
+  if (!HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_HALT))
+    return false;
+
+  settled = nPgmTime - smuxPtr->haltTime;
+  if (settled < 50)
+    sleep(50 - settled);
+
+  return true;
 }
 
 /**
@@ -177,129 +422,347 @@ HTSMUXSensorType HTSMUXreadSensorType(tMUXSensor muxsensor) {
  * - HTSMUX_CHAN_DIG0_HIGH
  * - HTSMUX_CHAN_DIG1_HIGH
  * - HTSMUX_CHAN_I2C_SLOW
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ * @param mode the mode to set the channel to
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXsetMode(tHTSMUXPtr smuxPtr, byte channel, byte mode) {
+  // Nothing to do if the channel is already in this mode
+  if (smuxPtr->channels[channel].modeValid && smuxPtr->channels[channel].mode == (ubyte)mode)
+    return true;
+
+  // If we're in the middle of a scan, abort this call
+  if (smuxPtr->status == HTSMUX_STAT_BUSY)
+    return false;
+
+  // Always make sure the SMUX is in the halted state
+  if (!_HTSMUXhalt(smuxPtr))
+    return false;
+
+  memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
+
+  smuxPtr->I2CData.request[0] = 3;               // Message size
+  smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR; // I2C Address
+  smuxPtr->I2CData.request[2] = HTSMUX_CH_OFFSET + HTSMUX_MODE + (HTSMUX_CH_ENTRY_SIZE * channel);
+  smuxPtr->I2CData.request[3] = mode;
+  smuxPtr->I2CData.requestLen = 3;
+  smuxPtr->I2CData.replyLen = 0;
+
+  if (!writeI2C(&smuxPtr->I2CData))
+  {
+    HTSMUXinvalidateConfig(smuxPtr);
+    return false;
+  }
+
+  smuxPtr->channels[channel].mode = mode;
+  smuxPtr->channels[channel].modeValid = true;
+  return true;
+}
+
+/**
+ * Set the mode of a SMUX channel.
  * @param muxsensor the SMUX sensor port number
  * @param mode the mode to set the channel to
  * @return true if no error occured, false if it did
  */
 bool HTSMUXsetMode(tMUXSensor muxsensor, byte mode) {
-  tSensors link = (tSensors)SPORT(muxsensor);
-  byte channel = MPORT(muxsensor);
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXsetMode(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor), mode);
+}
 
-  // If we're in the middle of a scan, abort this call
-  if (HTSMUXstatus[link] == HTSMUX_STAT_BUSY) {
+/**
+ * Write a channel's configuration and update the cache.  The SMUX is left
+ * halted, so several channels can be configured in one go.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ * @param configparams parameters for the channel's configuration
+ * @return true if no error occured, false if it did
+ */
+bool _HTSMUXwriteConfig(tHTSMUXPtr smuxPtr, byte channel, tConfigParams &configparams) {
+  // Always make sure the SMUX is in the halted state
+  if (!_HTSMUXhalt(smuxPtr))
+    return false;
+
+  memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
+
+  smuxPtr->I2CData.request[0] = 7;               // Message size
+  smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR; // I2C Address
+  smuxPtr->I2CData.request[2] = HTSMUX_CH_OFFSET + (HTSMUX_CH_ENTRY_SIZE * channel);
+  smuxPtr->I2CData.request[3] = configparams[0];
+  smuxPtr->I2CData.request[4] = 0x00;
+  smuxPtr->I2CData.request[5] = configparams[1];
+  smuxPtr->I2CData.request[6] = configparams[2];
+  smuxPtr->I2CData.request[7] = configparams[3];
+  smuxPtr->I2CData.requestLen = 7;
+  smuxPtr->I2CData.replyLen = 0;
+
+  if (!writeI2C(&smuxPtr->I2CData))
+  {
+    HTSMUXinvalidateConfig(smuxPtr);
     return false;
-  } else if (HTSMUXstatus[link] != HTSMUX_STAT_HALT) {
-    // Always make sure the SMUX is in the halted state
-    if (!HTSMUXsendCommand(link, HTSMUX_CMD_HALT))
-      return false;
-    sleep(50);
   }
 
-  memset(HTSMUX_I2CRequest, 0, sizeof(tByteArray));
+  memcpy(smuxPtr->channels[channel].config, configparams, sizeof(tConfigParams));
+  smuxPtr->channels[channel].configValid = true;
+  smuxPtr->channels[channel].mode = configparams[0];
+  smuxPtr->channels[channel].modeValid = true;
+  smuxPtr->configGen++;
+
+  smuxPtr->sensorTypes[channel] = HTSMUXSensorCustom;
+  return true;
+}
 
-  HTSMUX_I2CRequest[0] = 3;               // Message size
-  HTSMUX_I2CRequest[1] = HTSMUX_I2C_ADDR; // I2C Address
-  HTSMUX_I2CRequest[2] = HTSMUX_CH_OFFSET + HTSMUX_MODE + (HTSMUX_CH_ENTRY_SIZE * channel);
-  HTSMUX_I2CRequest[3] = mode;
+/**
+ * Configure the SMUX for a specific sensor.\n
+ * The parameters are as follows:
+ * - Channel mode
+ * - Number of bytes to request from attached sensor
+ * - I2C address
+ * - I2C register to request
+ *
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ * @param configparams parameters for the channel's configuration
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXconfigChannel(tHTSMUXPtr smuxPtr, byte channel, tConfigParams &configparams) {
+  if (!_HTSMUXwriteConfig(smuxPtr, channel, configparams))
+    return false;
 
-  return writeI2C(link, HTSMUX_I2CRequest);
+  return HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN);
 }
 
 /**
- * Set the mode of an analogue channel to Active (turn the light on)
+ * Configure the SMUX for a specific sensor.
+ *
  * @param muxsensor the SMUX sensor port number
+ * @param configparams parameters for the channel's configuration
  * @return true if no error occured, false if it did
  */
-bool HTSMUXsetAnalogueActive(tMUXSensor muxsensor) {
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, Analogue_config);
+bool HTSMUXconfigChannel(tMUXSensor muxsensor, tConfigParams &configparams) {
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXconfigChannel(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor), configparams);
+}
 
-  if (!HTSMUXsetMode(muxsensor, HTSMUX_CHAN_DIG0_HIGH))
-    return false;
+/**
+ * Configure a SMUX channel, unless it was already configured with the same
+ * parameters.  The SMUX has to be halted for 50ms to change a channel, so this
+ * should be used in the read path instead of HTSMUXconfigChannel().  If the
+ * channel is configured, the SMUX is left halted and the next read starts it
+ * again.
+ *
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ * @param configparams parameters for the channel's configuration
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXensureConfig(tHTSMUXPtr smuxPtr, byte channel, tConfigParams &configparams) {
+  if (smuxPtr->channels[channel].configValid &&
+      smuxPtr->channels[channel].config[0] == configparams[0] &&
+      smuxPtr->channels[channel].config[1] == configparams[1] &&
+      smuxPtr->channels[channel].config[2] == configparams[2] &&
+      smuxPtr->channels[channel].config[3] == configparams[3])
+    return true;
 
-  return HTSMUXsendCommand((tSensors)SPORT(muxsensor), HTSMUX_CMD_RUN);
+  return _HTSMUXwriteConfig(smuxPtr, channel, configparams);
 }
 
 /**
- * Set the mode of an analogue channel to Inactive (turn the light off)
+ * Configure a SMUX channel, unless it was already configured with the same
+ * parameters.
+ *
  * @param muxsensor the SMUX sensor port number
+ * @param configparams parameters for the channel's configuration
  * @return true if no error occured, false if it did
  */
-bool HTSMUXsetAnalogueInactive(tMUXSensor muxsensor) {
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, Analogue_config);
+bool HTSMUXensureConfig(tMUXSensor muxsensor, tConfigParams &configparams) {
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXensureConfig(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor), configparams);
+}
 
-  if (!HTSMUXsetMode(muxsensor, 0))
-    return false;
+/**
+ * Forget the cached configuration of a SMUX channel, the next read will
+ * configure it again.  Use this when the channel may have been changed
+ * behind the driver's back, for example when a sensor was swapped.
+ *
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ */
+void HTSMUXinvalidateChannel(tHTSMUXPtr smuxPtr, byte channel) {
+  smuxPtr->channels[channel].configValid = false;
+  smuxPtr->channels[channel].modeValid = false;
+  smuxPtr->configGen++;
+}
 
-  return HTSMUXsendCommand((tSensors)SPORT(muxsensor), HTSMUX_CMD_RUN);
+/**
+ * Forget the cached configuration of a SMUX channel.
+ *
+ * @param muxsensor the SMUX sensor port number
+ */
+void HTSMUXinvalidateChannel(tMUXSensor muxsensor) {
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  HTSMUXinvalidateChannel(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor));
 }
 
 /**
- * Send a command to the SMUX.
+ * Forget the cached configuration of all the channels of a SMUX and its
+ * halt/run state, for example after it has been power cycled.
  *
- * command can be one of the following:
- * - HTSMUX_CMD_HALT
- * - HTSMUX_CMD_AUTODETECT
- * - HTSMUX_CMD_RUN
+ * @param smuxPtr pointer to the SMUX's data struct
+ */
+void HTSMUXinvalidateConfig(tHTSMUXPtr smuxPtr) {
+  for (short i = 0; i < 4; i++)
+    HTSMUXinvalidateChannel(smuxPtr, i);
+  smuxPtr->status = HTSMUX_STAT_NOTHING;
+}
+
+/**
+ * Forget the cached configuration of all the channels of a SMUX.
  *
- * in progress.
  * @param link the SMUX port number
- * @param command the command to be sent to the SMUX
+ */
+void HTSMUXinvalidateConfig(tSensors link) {
+  _HTSMUXcheckInit(link);
+  HTSMUXinvalidateConfig(&HTSMUXdata[link]);
+}
+
+/**
+ * Set the mode of an analogue channel to Active (turn the light on)
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
  * @return true if no error occured, false if it did
  */
-bool HTSMUXsendCommand(tSensors link, byte command) {
-  memset(HTSMUX_I2CRequest, 0, sizeof(tByteArray));
+bool HTSMUXsetAnalogueActive(tHTSMUXPtr smuxPtr, byte channel) {
+  if (!HTSMUXensureConfig(smuxPtr, channel, Analogue_config))
+    return false;
 
-  HTSMUX_I2CRequest[0] = 3;               // Message size
-  HTSMUX_I2CRequest[1] = HTSMUX_I2C_ADDR; // I2C Address
-  HTSMUX_I2CRequest[2] = HTSMUX_COMMAND;
-  HTSMUX_I2CRequest[3] = command;
+  if (!HTSMUXsetMode(smuxPtr, channel, HTSMUX_CHAN_DIG0_HIGH))
+    return false;
 
-  switch(command) {
-    case HTSMUX_CMD_HALT:
-        HTSMUXstatus[link] = HTSMUX_STAT_HALT;
-        break;
-    case HTSMUX_CMD_AUTODETECT:
-        HTSMUXstatus[link] = HTSMUX_STAT_BUSY;
-        break;
-    case HTSMUX_CMD_RUN:
-        HTSMUXstatus[link] = HTSMUX_STAT_NORMAL;
-        break;
-  }
+  return HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN);
+}
+
+/**
+ * Set the mode of an analogue channel to Active (turn the light on)
+ * @param muxsensor the SMUX sensor port number
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXsetAnalogueActive(tMUXSensor muxsensor) {
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXsetAnalogueActive(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor));
+}
+
+/**
+ * Set the mode of an analogue channel to Inactive (turn the light off)
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXsetAnalogueInactive(tHTSMUXPtr smuxPtr, byte channel) {
+  if (!HTSMUXensureConfig(smuxPtr, channel, Analogue_config))
+    return false;
+
+  if (!HTSMUXsetMode(smuxPtr, channel, 0))
+    return false;
+
+  return HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN);
+}
 
-  return writeI2C(link, HTSMUX_I2CRequest);
+/**
+ * Set the mode of an analogue channel to Inactive (turn the light off)
+ * @param muxsensor the SMUX sensor port number
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXsetAnalogueInactive(tMUXSensor muxsensor) {
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXsetAnalogueInactive(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor));
 }
 
 /**
  * Read the value returned by the sensor attached the SMUX. This function
  * is for I2C sensors.
- * @param muxsensor the SMUX sensor port number
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
  * @param result array to hold values returned from SMUX
  * @param numbytes the size of the I2C reply
  * @param offset the offset used to start reading from
  * @return true if no error occured, false if it did
  */
-bool HTSMUXreadPort(tMUXSensor muxsensor, tByteArray &result, short numbytes, short offset) {
-  tSensors link = (tSensors)SPORT(muxsensor);
-  byte channel = MPORT(muxsensor);
+bool HTSMUXreadPort(tHTSMUXPtr smuxPtr, byte channel, tByteArray &result, short numbytes, short offset) {
+#if (__HTSMUX_POLLER__ == 1)
+  // Serve the read from the poller's snapshot if it has this data
+  if (_HTSMUXreadFromSnapshot(smuxPtr, HTSMUX_I2C_BUF + (HTSMUX_BF_ENTRY_SIZE * channel) + offset, numbytes, result))
+    return true;
+#endif // __HTSMUX_POLLER__
 
-  memset(HTSMUX_I2CRequest, 0, sizeof(tByteArray));
-  if (HTSMUXstatus[link] != HTSMUX_STAT_NORMAL)
-    HTSMUXsendCommand(link, HTSMUX_CMD_RUN);
+  if (!HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN))
+    return false;
 
-  HTSMUX_I2CRequest[0] = 2;                 // Message size
-  HTSMUX_I2CRequest[1] = HTSMUX_I2C_ADDR;   // I2C Address
-  HTSMUX_I2CRequest[2] = HTSMUX_I2C_BUF + (HTSMUX_BF_ENTRY_SIZE * channel) + offset;
+  memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
+  smuxPtr->I2CData.request[0] = 2;                 // Message size
+  smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR;   // I2C Address
+  smuxPtr->I2CData.request[2] = HTSMUX_I2C_BUF + (HTSMUX_BF_ENTRY_SIZE * channel) + offset;
+  smuxPtr->I2CData.requestLen = 2;
+  smuxPtr->I2CData.replyLen = numbytes;
 
-  if (!writeI2C(link, HTSMUX_I2CRequest, HTSMUX_I2CReply, numbytes))
+  if (!writeI2C(&smuxPtr->I2CData))
     return false;
 
-  memcpy(result, HTSMUX_I2CReply, sizeof(tByteArray));
+  memcpy(result, smuxPtr->I2CData.reply, sizeof(smuxPtr->I2CData.reply));
 
   return true;
 }
 
+/**
+ * Read the value returned by the sensor attached the SMUX. This function
+ * is for I2C sensors.
+ * @param muxsensor the SMUX sensor port number
+ * @param result array to hold values returned from SMUX
+ * @param numbytes the size of the I2C reply
+ * @param offset the offset used to start reading from
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXreadPort(tMUXSensor muxsensor, tByteArray &result, short numbytes, short offset) {
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXreadPort(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor), result, numbytes, offset);
+}
+
+/**
+ * Read the value returned by the sensor attached the SMUX. This function
+ * is for analogue sensors.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param channel the SMUX channel, 0-3
+ * @return the value of the sensor or -1 if an error occurred.
+ */
+short HTSMUXreadAnalogue(tHTSMUXPtr smuxPtr, byte channel) {
+  // Only reconfigures the channel if it's not already set up for analogue sensors
+  if (!HTSMUXensureConfig(smuxPtr, channel, Analogue_config))
+    return -1;
+
+#if (__HTSMUX_POLLER__ == 1)
+  if (_HTSMUXreadFromSnapshot(smuxPtr, HTSMUX_ANALOG + (HTSMUX_AN_ENTRY_SIZE * channel), 2, smuxPtr->I2CData.reply))
+    return ((short)smuxPtr->I2CData.reply[0] * 4) + smuxPtr->I2CData.reply[1];
+#endif // __HTSMUX_POLLER__
+
+  if (!HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN))
+    return -1;
+
+  memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
+  smuxPtr->I2CData.request[0] = 2;               // Message size
+  smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR; // I2C Address
+  smuxPtr->I2CData.request[2] = HTSMUX_ANALOG + (HTSMUX_AN_ENTRY_SIZE * channel);
+  smuxPtr->I2CData.requestLen = 2;
+  smuxPtr->I2CData.replyLen = 2;
+
+  if (!writeI2C(&smuxPtr->I2CData))
+    return -1;
+
+  return ((short)smuxPtr->I2CData.reply[0] * 4) + smuxPtr->I2CData.reply[1];
+}
+
 /**
  * Read the value returned by the sensor attached the SMUX. This function
  * is for analogue sensors.
@@ -307,24 +770,65 @@ bool HTSMUXreadPort(tMUXSensor muxsensor, tByteArray &result, short numbytes, sh
  * @return the value of the sensor or -1 if an error occurred.
  */
 short HTSMUXreadAnalogue(tMUXSensor muxsensor) {
-  tSensors link = (tSensors)SPORT(muxsensor);
-  byte channel = MPORT(muxsensor);
+  _HTSMUXcheckInit((tSensors)SPORT(muxsensor));
+  return HTSMUXreadAnalogue(&HTSMUXdata[SPORT(muxsensor)], MPORT(muxsensor));
+}
+
+/**
+ * Read the values of all four analogue channels of the SMUX.  The analogue
+ * registers are one contiguous block, so this takes a single transaction.\n
+ * Channels that were detected as analogue by HTSMUXscanPorts() but have not
+ * been configured yet are set up for analogue sensors.  All other channels are
+ * left alone, the values of channels with I2C sensors should be ignored.  Use
+ * HTSMUXsetAnalogueActive() or HTSMUXsetAnalogueInactive() to set up an analogue
+ * channel on a SMUX that hasn't been scanned.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param values array to hold the values of channels 1 to 4
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXreadAllAnalogue(tHTSMUXPtr smuxPtr, tHTSMUXAnalogue &values) {
+  // All unconfigured analogue channels are set up while the SMUX is halted once
+  for (short i = 0; i < 4; i++)
+  {
+    if (!smuxPtr->channels[i].configValid && (smuxPtr->sensorTypes[i] == HTSMUXAnalogue))
+      if (!_HTSMUXwriteConfig(smuxPtr, i, Analogue_config))
+        return false;
+  }
 
-  memset(HTSMUX_I2CRequest, 0, sizeof(tByteArray));
-  if (HTSMUXstatus[link] != HTSMUX_STAT_NORMAL)
-    HTSMUXsendCommand(link, HTSMUX_CMD_RUN);
+#if (__HTSMUX_POLLER__ == 1)
+  if (!_HTSMUXreadFromSnapshot(smuxPtr, HTSMUX_ANALOG, 4 * HTSMUX_AN_ENTRY_SIZE, smuxPtr->I2CData.reply))
+#endif // __HTSMUX_POLLER__
+  {
+    if (!HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN))
+      return false;
 
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, Analogue_config);
+    memset(smuxPtr->I2CData.request, 0, sizeof(smuxPtr->I2CData.request));
+    smuxPtr->I2CData.request[0] = 2;               // Message size
+    smuxPtr->I2CData.request[1] = HTSMUX_I2C_ADDR; // I2C Address
+    smuxPtr->I2CData.request[2] = HTSMUX_ANALOG;
+    smuxPtr->I2CData.requestLen = 2;
+    smuxPtr->I2CData.replyLen = 4 * HTSMUX_AN_ENTRY_SIZE;
 
-  HTSMUX_I2CRequest[0] = 2;               // Message size
-  HTSMUX_I2CRequest[1] = HTSMUX_I2C_ADDR;   // I2C Address
-  HTSMUX_I2CRequest[2] = HTSMUX_ANALOG + (HTSMUX_AN_ENTRY_SIZE * channel);
+    if (!writeI2C(&smuxPtr->I2CData))
+      return false;
+  }
 
-  if (!writeI2C(link, HTSMUX_I2CRequest, HTSMUX_I2CReply, 2))
-    return -1;
+  for (short i = 0; i < 4; i++)
+    values[i] = ((short)smuxPtr->I2CData.reply[i * 2] * 4) + smuxPtr->I2CData.reply[(i * 2) + 1];
+
+  return true;
+}
 
-  return ((short)HTSMUX_I2CReply[0] * 4) + HTSMUX_I2CReply[1];
+/**
+ * Read the values of all four analogue channels of the SMUX in a single
+ * transaction.
+ * @param link the SMUX port number
+ * @param values array to hold the values of channels 1 to 4
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXreadAllAnalogue(tSensors link, tHTSMUXAnalogue &values) {
+  _HTSMUXcheckInit(link);
+  return HTSMUXreadAllAnalogue(&HTSMUXdata[link], values);
 }
 
 /**
@@ -351,51 +855,504 @@ void HTSMUXsensorTypeToString(HTSMUXSensorType muxsensor, string &sensorName) {
 /**
  * Check if the battery is low
  *
- * @param link the SMUX port number
+ * @param smuxPtr pointer to the SMUX's data struct
  * @return true if there is a power source problem
  */
-bool HTSMUXreadPowerStatus(tSensors link) {
-  if ((HTSMUXreadStatus(link) & HTSMUX_STAT_BATT) == HTSMUX_STAT_BATT)
+bool HTSMUXreadPowerStatus(tHTSMUXPtr smuxPtr) {
+  if ((HTSMUXreadStatus(smuxPtr) & HTSMUX_STAT_BATT) == HTSMUX_STAT_BATT)
     return true;
   else
     return false;
 }
 
 /**
- * Configure the SMUX for a specific sensor.\n
- * The parameters are as follows:
- * - Channel mode
- * - Number of bytes to request from attached sensor
- * - I2C address
- * - I2C register to request
+ * Check if the battery is low
  *
- * @param muxsensor the SMUX sensor port number
- * @param configparams parameters for the channel's configuration
+ * @param link the SMUX port number
  * @return true if there is a power source problem
  */
-bool HTSMUXconfigChannel(tMUXSensor muxsensor, tConfigParams &configparams) {
-  memset(HTSMUX_I2CRequest, 0, sizeof(tByteArray));
+bool HTSMUXreadPowerStatus(tSensors link) {
+  _HTSMUXcheckInit(link);
+  return HTSMUXreadPowerStatus(&HTSMUXdata[link]);
+}
+
+/**
+ * Read the scan results from a data file.  Nothing is loaded if the
+ * file is missing or its checksum doesn't match.
+ *
+ * Note: this is an internal function and should not be called directly.
+ */
+void _HTSMUXreadScanFile() {
+  HTSMUXscanRecordsLoaded = true;
+  memset(HTSMUXscanRecords, 0, sizeof(HTSMUXscanRecords));
+
+#ifdef NXT
+  TFileHandle hFileHandle;
+  TFileIOResult nIoResult;
+  short nFileSize;
+  short sum = 0;
+  short checksum = 0;
+  ubyte data = 0;
+  tHTSMUXScanRecord records[4];
+
+  OpenRead(hFileHandle, nIoResult, HTSMUXDAT, nFileSize);
+  if (nIoResult != ioRsltSuccess) {
+    Close(hFileHandle, nIoResult);
+    return;
+  }
+
+  for (short link = 0; link < 4; link++) {
+    ReadByte(hFileHandle, nIoResult, data);
+    records[link].valid = (data != 0);
+    sum += data;
+    ReadByte(hFileHandle, nIoResult, records[link].status);
+    sum += records[link].status;
+    for (short i = 0; i < 4; i++) {
+      ReadByte(hFileHandle, nIoResult, data);
+      records[link].types[i] = (HTSMUXSensorType)data;
+      sum += data;
+      for (short j = 0; j < 4; j++) {
+        ReadByte(hFileHandle, nIoResult, records[link].config[i][j]);
+        sum += records[link].config[i][j];
+      }
+    }
+  }
+  ReadShort(hFileHandle, nIoResult, checksum);
+  Close(hFileHandle, nIoResult);
+
+  // A short or damaged file is ignored, the SMUX will simply be scanned again
+  if (nIoResult != ioRsltSuccess || checksum != sum)
+    return;
+
+  memcpy(HTSMUXscanRecords, records, sizeof(HTSMUXscanRecords));
+#endif // NXT
+}
+
+/**
+ * Write the scan results of all ports to a data file.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @return true if no error occured, false if it did
+ */
+bool _HTSMUXwriteScanFile() {
+#ifdef NXT
+  TFileHandle hFileHandle;
+  TFileIOResult nIoResult;
+  short nFileSize = 96;
+  short sum = 0;
+
+  // Delete the old data file and open a new one for writing
+  Delete(HTSMUXDAT, nIoResult);
+  OpenWrite(hFileHandle, nIoResult, HTSMUXDAT, nFileSize);
+  if (nIoResult != ioRsltSuccess) {
+    Close(hFileHandle, nIoResult);
+    return false;
+  }
+
+  for (short link = 0; link < 4; link++) {
+    WriteByte(hFileHandle, nIoResult, HTSMUXscanRecords[link].valid ? 1 : 0);
+    sum += HTSMUXscanRecords[link].valid ? 1 : 0;
+    WriteByte(hFileHandle, nIoResult, HTSMUXscanRecords[link].status);
+    sum += HTSMUXscanRecords[link].status;
+    for (short i = 0; i < 4; i++) {
+      WriteByte(hFileHandle, nIoResult, (ubyte)HTSMUXscanRecords[link].types[i]);
+      sum += (ubyte)HTSMUXscanRecords[link].types[i];
+      for (short j = 0; j < 4; j++) {
+        WriteByte(hFileHandle, nIoResult, HTSMUXscanRecords[link].config[i][j]);
+        sum += HTSMUXscanRecords[link].config[i][j];
+      }
+    }
+  }
+  WriteShort(hFileHandle, nIoResult, sum);
+  if (nIoResult != ioRsltSuccess) {
+    Close(hFileHandle, nIoResult);
+    return false;
+  }
+
+  Close(hFileHandle, nIoResult);
+  return (nIoResult == ioRsltSuccess);
+#else
+  return false;
+#endif // NXT
+}
+
+/**
+ * Copy the scan results of a SMUX into the sensor type array and the
+ * channel configuration cache.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ */
+void _HTSMUXapplyScanRecord(tHTSMUXPtr smuxPtr) {
+  tSensors link = smuxPtr->I2CData.port;
+
+  for (short i = 0; i < 4; i++) {
+    smuxPtr->sensorTypes[i] = HTSMUXscanRecords[link].types[i];
+    memcpy(smuxPtr->channels[i].config, HTSMUXscanRecords[link].config[i], sizeof(tConfigParams));
+    smuxPtr->channels[i].mode = HTSMUXscanRecords[link].config[i][0];
+    smuxPtr->channels[i].configValid = (HTSMUXscanRecords[link].types[i] != HTSMUXSensorNone);
+    smuxPtr->channels[i].modeValid = smuxPtr->channels[i].configValid;
+  }
+  smuxPtr->configGen++;
+}
+
+/**
+ * Check the SMUX against its saved scan results.  The status register must be
+ * the same and the first channel that had an I2C sensor detected must still
+ * hold the type, mode and I2C settings the autodetect set up for it.  A reset
+ * or unconfigured SMUX reports every channel as analogue, so only a completed
+ * autodetect leaves these behind.  When no I2C sensor was detected, there is
+ * nothing to tell the two apart and the SMUX has to be scanned again.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @return true if the saved results can be used
+ */
+bool _HTSMUXcheckFingerprint(tHTSMUXPtr smuxPtr) {
+  tSensors link = smuxPtr->I2CData.port;
+  ubyte regs[1 + (HTSMUX_CH_ENTRY_SIZE * 4)];
+  ubyte status;
+  short channel = -1;
+  short entry;
+
+  if (!HTSMUXscanRecords[link].valid)
+    return false;
+
+  for (short i = 0; (channel < 0) && (i < 4); i++) {
+    if ((HTSMUXscanRecords[link].types[i] != HTSMUXAnalogue) &&
+        (HTSMUXscanRecords[link].types[i] != HTSMUXSensorNone) &&
+        ((HTSMUXscanRecords[link].config[i][0] & HTSMUX_CHAN_I2C) != 0))
+      channel = i;
+  }
+
+  if (channel < 0)
+    return false;
+
+  // Status, followed by the channel registers up to and including those of the I2C channel
+  if (!readI2CRegs(link, HTSMUX_I2C_ADDR, HTSMUX_STATUS, &regs[0], 1 + (HTSMUX_CH_ENTRY_SIZE * (channel + 1))))
+    return false;
+
+  // The SMUX may be halted or running, that's not part of the fingerprint
+  status = regs[0] & ~HTSMUX_STAT_HALT;
+  if (status != (HTSMUXscanRecords[link].status & ~HTSMUX_STAT_HALT))
+    return false;
+
+  entry = 1 + (HTSMUX_CH_ENTRY_SIZE * channel);
+  if ((regs[entry + HTSMUX_TYPE] != HTSMUXscanRecords[link].types[channel]) ||
+      (regs[entry + HTSMUX_MODE] != HTSMUXscanRecords[link].config[channel][0]) ||
+      (regs[entry + HTSMUX_I2C_COUNT] != HTSMUXscanRecords[link].config[channel][1]) ||
+      (regs[entry + HTSMUX_I2C_DADDR] != HTSMUXscanRecords[link].config[channel][2]) ||
+      (regs[entry + HTSMUX_I2C_MADDR] != HTSMUXscanRecords[link].config[channel][3]))
+    return false;
+
+  smuxPtr->status = ((regs[0] & HTSMUX_STAT_HALT) != 0) ? HTSMUX_STAT_HALT : HTSMUX_STAT_NORMAL;
+  return true;
+}
+
+/**
+ * Let the SMUX detect the attached sensors and set up its channels.\n
+ * The results are saved in a data file.  The next time the SMUX is scanned,
+ * even from another program, a single read checks if the SMUX still matches
+ * the saved results and the 550ms scan is skipped if it does.  This needs an
+ * I2C sensor on the SMUX, see _HTSMUXcheckFingerprint().  Use force after
+ * swapping sensors, the fingerprint can't see that.
+ *
+ * Use the scanTime and scanReused fields to see what the last scan did.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param force always scan, even if the saved results match
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXscanPorts(tHTSMUXPtr smuxPtr, bool force) {
+  tSensors link = smuxPtr->I2CData.port;
+  long start = nPgmTime;
+  ubyte regs[HTSMUX_CH_ENTRY_SIZE * 4];
+
+  if (!HTSMUXscanRecordsLoaded)
+    _HTSMUXreadScanFile();
+
+  smuxPtr->scanReused = false;
+
+  // Fast path, the SMUX is the way we left it
+  if (!force && _HTSMUXcheckFingerprint(smuxPtr)) {
+    _HTSMUXapplyScanRecord(smuxPtr);
+    HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN);
+    smuxPtr->scanReused = true;
+    smuxPtr->scanTime = nPgmTime - start;
+    return true;
+  }
 
   // Always make sure the SMUX is in the halted state
-  if (!HTSMUXsendCommand((tSensors)SPORT(muxsensor), HTSMUX_CMD_HALT))
+  if (!_HTSMUXhalt(smuxPtr))
+    return false;
+
+  // Commence scanning the ports and allow it to complete
+  if (!HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_AUTODETECT))
+    return false;
+  sleep(HTSMUX_SCAN_TIME);
+
+  // The SMUX halts again when it's done
+  smuxPtr->status = HTSMUX_STAT_HALT;
+  smuxPtr->haltTime = nPgmTime;
+
+  // Read back the configuration the scan set up for each channel
+  if (!readI2CRegs(link, HTSMUX_I2C_ADDR, HTSMUX_CH_OFFSET, &regs[0], sizeof(regs)))
+    return false;
+
+  for (short i = 0; i < 4; i++) {
+    HTSMUXscanRecords[link].types[i] = (HTSMUXSensorType)regs[(i * HTSMUX_CH_ENTRY_SIZE) + HTSMUX_TYPE];
+    HTSMUXscanRecords[link].config[i][0] = regs[(i * HTSMUX_CH_ENTRY_SIZE) + HTSMUX_MODE];
+    HTSMUXscanRecords[link].config[i][1] = regs[(i * HTSMUX_CH_ENTRY_SIZE) + HTSMUX_I2C_COUNT];
+    HTSMUXscanRecords[link].config[i][2] = regs[(i * HTSMUX_CH_ENTRY_SIZE) + HTSMUX_I2C_DADDR];
+    HTSMUXscanRecords[link].config[i][3] = regs[(i * HTSMUX_CH_ENTRY_SIZE) + HTSMUX_I2C_MADDR];
+  }
+
+  HTSMUXscanRecords[link].status = HTSMUXreadStatus(smuxPtr);
+  HTSMUXscanRecords[link].valid = true;
+  _HTSMUXapplyScanRecord(smuxPtr);
+
+  // Failing to save the results only makes the next scan slower
+  _HTSMUXwriteScanFile();
+
+  if (!HTSMUXsendCommand(smuxPtr, HTSMUX_CMD_RUN))
     return false;
-  sleep(50);
-
-  HTSMUX_I2CRequest[0] = 7;               // Message size
-  HTSMUX_I2CRequest[1] = HTSMUX_I2C_ADDR; // I2C Address
-  HTSMUX_I2CRequest[2] = HTSMUX_CH_OFFSET + (HTSMUX_CH_ENTRY_SIZE * MPORT(muxsensor));
-  HTSMUX_I2CRequest[3] = configparams[0];
-  HTSMUX_I2CRequest[4] = 0x00;
-  HTSMUX_I2CRequest[5] = configparams[1];
-  HTSMUX_I2CRequest[6] = configparams[2];
-  HTSMUX_I2CRequest[7] = configparams[3];
-
-  if (!writeI2C((tSensors)SPORT(muxsensor), HTSMUX_I2CRequest))
+
+  smuxPtr->scanTime = nPgmTime - start;
+  return true;
+}
+
+/**
+ * Let the SMUX detect the attached sensors and set up its channels.
+ *
+ * Use HTSMUXdata[link].scanTime and HTSMUXdata[link].scanReused to see what
+ * the last scan did.
+ * @param link the SMUX port number
+ * @param force always scan, even if the saved results match
+ * @return true if no error occured, false if it did
+ */
+bool HTSMUXscanPorts(tSensors link, bool force) {
+  _HTSMUXcheckInit(link);
+  return HTSMUXscanPorts(&HTSMUXdata[link], force);
+}
+
+#if (__HTSMUX_POLLER__ == 1)
+/**
+ * Check if the poller needs a register for the current configuration
+ * of the SMUX.  Analogue channels need their two analogue registers, I2C
+ * channels the part of their buffer the sensor's reply is copied into.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param reg the register
+ * @return true if the register should be read
+ */
+bool _HTSMUXpollNeeded(tHTSMUXPtr smuxPtr, short reg) {
+  short channel;
+
+  if (reg < HTSMUX_ANALOG + (4 * HTSMUX_AN_ENTRY_SIZE)) {
+    channel = (reg - HTSMUX_ANALOG) / HTSMUX_AN_ENTRY_SIZE;
+    return smuxPtr->channels[channel].configValid &&
+           ((smuxPtr->channels[channel].config[0] & HTSMUX_CHAN_I2C) == 0);
+  }
+
+  if (reg < HTSMUX_I2C_BUF)
     return false;
 
-  HTSMUXSensorTypes[muxsensor] = HTSMUXSensorCustom;
-  return HTSMUXsendCommand((tSensors)SPORT(muxsensor), HTSMUX_CMD_RUN);
+  channel = (reg - HTSMUX_I2C_BUF) / HTSMUX_BF_ENTRY_SIZE;
+  return smuxPtr->channels[channel].configValid &&
+         ((smuxPtr->channels[channel].config[0] & HTSMUX_CHAN_I2C) != 0) &&
+         (reg - HTSMUX_I2C_BUF - (channel * HTSMUX_BF_ENTRY_SIZE) < smuxPtr->channels[channel].config[1]);
+}
+
+/**
+ * Read all the registers the current configuration of the SMUX needs into
+ * a snapshot.  Each transaction starts at the first register that is still
+ * needed and reads up to 16 bytes, so neighbouring channels share a read.
+ * An analogue sensor on channel 1 and 6 bytes of I2C data on channel 1
+ * are read with a single transaction, for example.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param snapshot the snapshot to fill
+ * @return true if no error occured, false if it did
+ */
+bool _HTSMUXsweep(tHTSMUXPtr smuxPtr, tHTSMUXSnapshot &snapshot) {
+  short reg = HTSMUX_ANALOG;
+  short last;
+  short len;
+
+  snapshot.configGen = smuxPtr->configGen;
+  snapshot.analogue = 0;
+  snapshot.i2c = 0;
+  snapshot.transactions = 0;
+
+  for (short i = 0; i < 4; i++) {
+    snapshot.i2cCount[i] = 0;
+    if (!smuxPtr->channels[i].configValid)
+      continue;
+    if ((smuxPtr->channels[i].config[0] & HTSMUX_CHAN_I2C) != 0) {
+      snapshot.i2c |= (1 << i);
+      snapshot.i2cCount[i] = smuxPtr->channels[i].config[1];
+    } else {
+      snapshot.analogue |= (1 << i);
+    }
+  }
+
+  while (reg < HTSMUX_ANALOG + HTSMUX_POLL_SIZE) {
+    if (!_HTSMUXpollNeeded(smuxPtr, reg)) {
+      reg++;
+      continue;
+    }
+
+    // Find the last needed register within reach of this read
+    last = reg;
+    for (short i = reg + 1; (i < reg + I2C_MAX_REPLY) && (i < HTSMUX_ANALOG + HTSMUX_POLL_SIZE); i++)
+      if (_HTSMUXpollNeeded(smuxPtr, i))
+        last = i;
+
+    len = last - reg + 1;
+    if (!readI2CRegs(smuxPtr->I2CData.port, HTSMUX_I2C_ADDR, reg, &snapshot.regs[reg - HTSMUX_ANALOG], len))
+      return false;
+
+    snapshot.transactions++;
+    reg += len;
+  }
+
+  snapshot.timestamp = nPgmTime;
+  return true;
+}
+
+/**
+ * Sweep the configured channels of every SMUX that has the poller enabled
+ * and publish the results.  The sweep is written into the snapshot that is
+ * not active, which is then made the active one.  The task ends by itself
+ * when no SMUX has the poller enabled, stopping it from the outside could
+ * leave the bus locked.
+ */
+task HTSMUXpoller() {
+  short next;
+  bool enabled = true;
+
+  while (enabled) {
+    enabled = false;
+    for (short link = 0; link < 4; link++) {
+      if (!HTSMUXdata[link].polled)
+        continue;
+      enabled = true;
+
+      // Don't get in the way of a channel being configured
+      if (HTSMUXdata[link].status != HTSMUX_STAT_NORMAL)
+        continue;
+
+      next = (link * 2) + (1 - HTSMUXsnapshotActive[link]);
+      HTSMUXsnapshots[next].sequence = HTSMUXsnapshotSeq[link] + 1;
+      if (!_HTSMUXsweep(&HTSMUXdata[link], HTSMUXsnapshots[next]))
+        continue;
+
+      // The active index has to change before the sequence number, see HTSMUXreadSnapshot()
+      HTSMUXsnapshotActive[link] = 1 - HTSMUXsnapshotActive[link];
+      HTSMUXsnapshotSeq[link]++;
+    }
+
+    // HTSMUXstartPoller() must not see the task running after it decided to stop
+    hogCPU();
+    if (!enabled)
+      HTSMUXpollerRunning = false;
+    releaseCPU();
+
+    if (enabled)
+      sleep(HTSMUX_POLL_INTERVAL);
+  }
+}
+
+/**
+ * Start sweeping the configured channels of a SMUX in the background.
+ * Reads of channels the poller covers are served from its latest snapshot
+ * instead of the bus.  Channels configured after the poller was started are
+ * picked up from the next sweep onwards.\n
+ * The poller only covers the SMUX's struct in HTSMUXdata[], reads through
+ * a struct of your own always go to the bus.
+ * @param link the SMUX port number
+ */
+void HTSMUXstartPoller(tSensors link) {
+  _HTSMUXcheckInit(link);
+  HTSMUXsnapshots[link * 2].sequence = 0;
+  HTSMUXsnapshots[(link * 2) + 1].sequence = 0;
+
+  hogCPU();
+  HTSMUXdata[link].polled = true;
+  if (!HTSMUXpollerRunning) {
+    HTSMUXpollerRunning = true;
+    startTask(HTSMUXpoller);
+  }
+  releaseCPU();
+}
+
+/**
+ * Stop sweeping a SMUX, reads go straight to the bus again.  The poller
+ * task ends after its current sweep when no other SMUX uses it.
+ * @param link the SMUX port number
+ */
+void HTSMUXstopPoller(tSensors link) {
+  HTSMUXdata[link].polled = false;
+  HTSMUXsnapshotSeq[link]++;
+}
+
+/**
+ * Make a consistent copy of the latest snapshot of a SMUX.  If the poller
+ * publishes a new snapshot while the copy is made, it is made again.
+ * @param link the SMUX port number
+ * @param snapshot the struct to copy the snapshot into
+ * @return true if there was a snapshot, false if the poller hasn't completed a sweep yet
+ */
+bool HTSMUXreadSnapshot(tSensors link, tHTSMUXSnapshot &snapshot) {
+  long seq;
+
+  if (!HTSMUXdata[link].polled || HTSMUXsnapshotSeq[link] == 0)
+    return false;
+
+  do {
+    seq = HTSMUXsnapshotSeq[link];
+    memcpy(snapshot, HTSMUXsnapshots[(link * 2) + HTSMUXsnapshotActive[link]], sizeof(tHTSMUXSnapshot));
+  } while (seq != HTSMUXsnapshotSeq[link]);
+
+  return snapshot.sequence != 0;
+}
+
+/**
+ * Copy registers from the latest snapshot, if it holds all of them and the
+ * SMUX has not been reconfigured since it was made.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param reg the first register
+ * @param numbytes the number of registers to copy
+ * @param result array to copy the registers into
+ * @return true if the registers were copied, false if they need to be read from the bus
+ */
+bool _HTSMUXreadFromSnapshot(tHTSMUXPtr smuxPtr, short reg, short numbytes, tByteArray &result) {
+  tSensors link = smuxPtr->I2CData.port;
+  long seq;
+  tHTSMUXSnapshot *snapshot;
+
+  if (!smuxPtr->polled || HTSMUXsnapshotSeq[link] == 0)
+    return false;
+
+  for (short i = reg; i < reg + numbytes; i++)
+    if (!_HTSMUXpollNeeded(smuxPtr, i))
+      return false;
+
+  do {
+    seq = HTSMUXsnapshotSeq[link];
+    snapshot = &HTSMUXsnapshots[(link * 2) + HTSMUXsnapshotActive[link]];
+    if (snapshot->sequence == 0 || snapshot->configGen != smuxPtr->configGen)
+      return false;
+    memset(result, 0, sizeof(tByteArray));
+    memcpy(result, &snapshot->regs[reg - HTSMUX_ANALOG], numbytes);
+  } while (seq != HTSMUXsnapshotSeq[link]);
+
+  return true;
 }
+#endif // __HTSMUX_POLLER__
 
 #endif // __HTSMUX_H__
 
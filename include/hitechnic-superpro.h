@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in HTSPB_I2CData[]
  *
  * License: You may use this code as you wish, provided you give credit where its due.
  *
@@ -21,7 +22,7 @@
 
  * \author Gustav Jansson (gus_at_hitechnic.com)
  * \date 10 October 2011
- * \version 0.1
+ * \version 0.2
  * \example hitechnic-superpro-exp1.c
  * \example hitechnic-superpro-exp2.c
  * \example hitechnic-superpro-exp3.c
@@ -68,8 +69,7 @@
 #define DAC_MODE_TRIANGLEWAVE 5 /*!< Triangle wave output. */
 #define DAC_MODE_PWMVOLTAGE   6 /*!< PWM square wave output. */
 
-tByteArray HTSPB_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray HTSPB_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData HTSPB_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 ubyte HTSPBreadIO(tSensors link, ubyte mask);
 bool HTSPBwriteIO(tSensors link, ubyte mask);
@@ -85,16 +85,16 @@ bool HTSPBsetSamplingTime(tSensors link, byte interval);
  * @return 8 bits representing the state of the specified IOs
  */
 ubyte HTSPBreadIO(tSensors link, ubyte mask) {
-  memset(HTSPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTSPB_I2CData[link].request, 0, sizeof(HTSPB_I2CData[link].request));
 
-  HTSPB_I2CRequest[0] = 2;                         // Message size
-  HTSPB_I2CRequest[1] = HTSPB_I2C_ADDR;             // I2C Address
-  HTSPB_I2CRequest[2] = HTSPB_OFFSET + HTSPB_DIGIN;  // Start digital output read address
+  HTSPB_I2CData[link].request[0] = 2;                         // Message size
+  HTSPB_I2CData[link].request[1] = HTSPB_I2C_ADDR;             // I2C Address
+  HTSPB_I2CData[link].request[2] = HTSPB_OFFSET + HTSPB_DIGIN;  // Start digital output read address
 
-  if (!writeI2C(link, HTSPB_I2CRequest, HTSPB_I2CReply, 1))
+  if (!writeI2C(link, HTSPB_I2CData[link].request, HTSPB_I2CData[link].reply, 1))
     return 0;
 
-  return HTSPB_I2CReply[0] & mask;
+  return HTSPB_I2CData[link].reply[0] & mask;
 }
 
 /**
@@ -104,14 +104,14 @@ ubyte HTSPBreadIO(tSensors link, ubyte mask) {
  * @return true if no error occured, false if it did
  */
 bool HTSPBwriteIO(tSensors link, ubyte mask) {
-  memset(HTSPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTSPB_I2CData[link].request, 0, sizeof(HTSPB_I2CData[link].request));
 
-  HTSPB_I2CRequest[0] = 3;                         // Message size
-  HTSPB_I2CRequest[1] = HTSPB_I2C_ADDR;             // I2C Address
-  HTSPB_I2CRequest[2] = HTSPB_OFFSET + HTSPB_DIGOUT; // Start digital output read address
-  HTSPB_I2CRequest[3] = mask;                      // The specified digital ports
+  HTSPB_I2CData[link].request[0] = 3;                         // Message size
+  HTSPB_I2CData[link].request[1] = HTSPB_I2C_ADDR;             // I2C Address
+  HTSPB_I2CData[link].request[2] = HTSPB_OFFSET + HTSPB_DIGOUT; // Start digital output read address
+  HTSPB_I2CData[link].request[3] = mask;                      // The specified digital ports
 
-  return writeI2C(link, HTSPB_I2CRequest);
+  return writeI2C(link, HTSPB_I2CData[link].request);
 }
 
 /**
@@ -121,14 +121,14 @@ bool HTSPBwriteIO(tSensors link, ubyte mask) {
  * @return true if no error occured, false if it did
  */
 bool HTSPBsetupIO(tSensors link, ubyte mask) {
-  memset(HTSPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTSPB_I2CData[link].request, 0, sizeof(HTSPB_I2CData[link].request));
 
-  HTSPB_I2CRequest[0] = 3;                           // Message size
-  HTSPB_I2CRequest[1] = HTSPB_I2C_ADDR;               // I2C Address
-  HTSPB_I2CRequest[2] = HTSPB_OFFSET + HTSPB_DIGCTRL;  // Start digital input/output control address
-  HTSPB_I2CRequest[3] = mask;                        // The specified digital ports
+  HTSPB_I2CData[link].request[0] = 3;                           // Message size
+  HTSPB_I2CData[link].request[1] = HTSPB_I2C_ADDR;               // I2C Address
+  HTSPB_I2CData[link].request[2] = HTSPB_OFFSET + HTSPB_DIGCTRL;  // Start digital input/output control address
+  HTSPB_I2CData[link].request[3] = mask;                        // The specified digital ports
 
-  return writeI2C(link, HTSPB_I2CRequest);
+  return writeI2C(link, HTSPB_I2CData[link].request);
 }
 
 /**
@@ -139,14 +139,14 @@ bool HTSPBsetupIO(tSensors link, ubyte mask) {
  * @return the value of the ADC channel, or -1 if an error occurred
  */
 short HTSPBreadADC(tSensors link, byte channel, byte width) {
-  memset(HTSPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTSPB_I2CData[link].request, 0, sizeof(HTSPB_I2CData[link].request));
 
   short _adcVal = 0;
-  HTSPB_I2CRequest[0] = 2;                                       // Message size
-  HTSPB_I2CRequest[1] = HTSPB_I2C_ADDR;                           // I2C Address
-  HTSPB_I2CRequest[2] = HTSPB_OFFSET + HTSPB_A0_U + (channel * 2); // Start digital output read address
+  HTSPB_I2CData[link].request[0] = 2;                                       // Message size
+  HTSPB_I2CData[link].request[1] = HTSPB_I2C_ADDR;                           // I2C Address
+  HTSPB_I2CData[link].request[2] = HTSPB_OFFSET + HTSPB_A0_U + (channel * 2); // Start digital output read address
                                                                     // with channel offset
-  if (!writeI2C(link, HTSPB_I2CRequest, HTSPB_I2CReply, 2))
+  if (!writeI2C(link, HTSPB_I2CData[link].request, HTSPB_I2CData[link].reply, 2))
     return -1;
 
   // Convert the bytes into and short
@@ -155,9 +155,9 @@ short HTSPBreadADC(tSensors link, byte channel, byte width) {
   // We'll need to shift the 1st byte left by 2 and or 2nd byte onto it.
   // If 8 bits is all we want, we just return the first byte and be done with it.
   if (width == 8)
-    _adcVal = HTSPB_I2CReply[0];
+    _adcVal = HTSPB_I2CData[link].reply[0];
   else
-    _adcVal = (HTSPB_I2CReply[0] * 4) + HTSPB_I2CReply[1];
+    _adcVal = (HTSPB_I2CData[link].reply[0] * 4) + HTSPB_I2CData[link].reply[1];
 
   return _adcVal;
 }
@@ -173,13 +173,13 @@ short HTSPBreadADC(tSensors link, byte channel, byte width) {
  * @return true if no error occured, false if it did
  */
 bool HTSPBreadAllADC(tSensors link, short &adch0, short &adch1, short &adch2, short &adch3, byte width) {
-  memset(HTSPB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HTSPB_I2CData[link].request, 0, sizeof(HTSPB_I2CData[link].request));
 
-  HTSPB_I2CRequest[0] = 2;                       // Message size
-  HTSPB_I2CRequest[1] = HTSPB_I2C_ADDR;           // I2C Address
-  HTSPB_I2CRequest[2] = HTSPB_OFFSET + HTSPB_A0_U; // Start digital output read address
+  HTSPB_I2CData[link].request[0] = 2;                       // Message size
+  HTSPB_I2CData[link].request[1] = HTSPB_I2C_ADDR;           // I2C Address
+  HTSPB_I2CData[link].request[2] = HTSPB_OFFSET + HTSPB_A0_U; // Start digital output read address
 
-  if (!writeI2C(link, HTSPB_I2CRequest, HTSPB_I2CReply, 10))
+  if (!writeI2C(link, HTSPB_I2CData[link].request, HTSPB_I2CData[link].reply, 10))
     return false;
 
   // Convert the bytes into and short
@@ -188,15 +188,15 @@ bool HTSPBreadAllADC(tSensors link, short &adch0, short &adch1, short &adch2, sh
   // We'll need to shift the 1st byte left by 2 and or 2nd byte onto it.
   // If 8 bits is all we want, we just return the first byte and be done with it.
   if (width == 8) {
-    adch0 = (short)HTSPB_I2CReply[0];
-    adch1 = (short)HTSPB_I2CReply[2];
-    adch2 = (short)HTSPB_I2CReply[4];
-    adch3 = (short)HTSPB_I2CReply[6];
+    adch0 = (short)HTSPB_I2CData[link].reply[0];
+    adch1 = (short)HTSPB_I2CData[link].reply[2];
+    adch2 = (short)HTSPB_I2CData[link].reply[4];
+    adch3 = (short)HTSPB_I2CData[link].reply[6];
   } else {
-    adch0 = ((short)HTSPB_I2CReply[0] << 2) + (short)HTSPB_I2CReply[1];
-    adch1 = ((short)HTSPB_I2CReply[2] << 2) + (short)HTSPB_I2CReply[3];
-    adch2 = ((short)HTSPB_I2CReply[4] << 2) + (short)HTSPB_I2CReply[5];
-    adch3 = ((short)HTSPB_I2CReply[6] << 2) + (short)HTSPB_I2CReply[7];
+    adch0 = ((short)HTSPB_I2CData[link].reply[0] << 2) + (short)HTSPB_I2CData[link].reply[1];
+    adch1 = ((short)HTSPB_I2CData[link].reply[2] << 2) + (short)HTSPB_I2CData[link].reply[3];
+    adch2 = ((short)HTSPB_I2CData[link].reply[4] << 2) + (short)HTSPB_I2CData[link].reply[5];
+    adch3 = ((short)HTSPB_I2CData[link].reply[6] << 2) + (short)HTSPB_I2CData[link].reply[7];
   }
   return true;
 }
@@ -211,18 +211,18 @@ bool HTSPBreadAllADC(tSensors link, short &adch0, short &adch1, short &adch2, sh
  * @return true if no error occured, false if it did
  */
 bool HTSPBwriteAnalog(tSensors link, byte dac, byte mode, short freq, short volt) {
-  memset(HTSPB_I2CRequest, 0, sizeof(tByteArray));
-
-  HTSPB_I2CRequest[0] = 7;                          // Message size
-  HTSPB_I2CRequest[1] = HTSPB_I2C_ADDR;             // I2C Address
-  HTSPB_I2CRequest[2] = HTSPB_OFFSET + dac;         // Start analog output write address
-  HTSPB_I2CRequest[3] = mode;                       // The specified analog mode
-  HTSPB_I2CRequest[4] = freq/256;                   // High byte of frequency
-  HTSPB_I2CRequest[5] = freq&255;                   // Low byte of frequency
-  HTSPB_I2CRequest[6] = volt/4;                     // High 8 bits of voltage
-  HTSPB_I2CRequest[7] = volt&3;                     // Low 2 bits of voltage
-
-  return writeI2C(link, HTSPB_I2CRequest);
+  memset(HTSPB_I2CData[link].request, 0, sizeof(HTSPB_I2CData[link].request));
+
+  HTSPB_I2CData[link].request[0] = 7;                          // Message size
+  HTSPB_I2CData[link].request[1] = HTSPB_I2C_ADDR;             // I2C Address
+  HTSPB_I2CData[link].request[2] = HTSPB_OFFSET + dac;         // Start analog output write address
+  HTSPB_I2CData[link].request[3] = mode;                       // The specified analog mode
+  HTSPB_I2CData[link].request[4] = freq/256;                   // High byte of frequency
+  HTSPB_I2CData[link].request[5] = freq&255;                   // Low byte of frequency
+  HTSPB_I2CData[link].request[6] = volt/4;                     // High 8 bits of voltage
+  HTSPB_I2CData[link].request[7] = volt&3;                     // Low 2 bits of voltage
+
+  return writeI2C(link, HTSPB_I2CData[link].request);
 }
 
 #endif // __HTSPB_H__
@@ -14,6 +14,11 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Added a background sampler that debounces the switches and queues press and release
+ *        events, see HTTMUXstartSampler() (__HTTMUX_SAMPLER__)<br>
+ *        initSensor() now clears the whole struct
+ * - 0.3: The sampler is now opt-in, define __HTTMUX_SAMPLER__ as 1 to use it<br>
+ *        The debouncing and event queue are shared with the Mindsensors Touch MUX, see touch-events.h
  *
  * Credits:
  * - Big thanks to HiTechnic for providing me with the hardware necessary to write and test this.
@@ -24,8 +29,9 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 15 March 2009
- * \version 0.1
+ * \version 0.3
  * \example hitechnic-touchmux-test1.c
+ * \example hitechnic-touchmux-test2.c
  */
 
 #pragma systemFile
@@ -34,6 +40,17 @@
 #include "common.h"
 #endif
 
+/*!< define this as 1 to add the sampler task */
+#ifndef __HTTMUX_SAMPLER__
+#define __HTTMUX_SAMPLER__ 0
+#endif
+
+#if (__HTTMUX_SAMPLER__ == 1) && !defined(__TOUCH_EVENTS_H__)
+#include "touch-events.h"
+#endif
+
+#define HTTMUX_SAMPLE_INTERVAL    5   /*!< Time between two samples of the sampler, in ms */
+
 typedef struct
 {
   tI2CData I2CData;
@@ -41,9 +58,23 @@ typedef struct
   bool status[4];
 } tHTTMUX, *tHTTMUXPtr;
 
+#if (__HTTMUX_SAMPLER__ == 1)
+typedef tTouchEvent tHTTMUXEvent;             /*!< A switch being pressed or released, see touch-events.h */
+
+tTouchEvents HTTMUXsamplers[4];               /*!< Sampler state and event queue of each port */
+bool HTTMUXsamplerRunning = false;            /*!< The sampler task is running */
+#endif // __HTTMUX_SAMPLER__
+
 bool initSensor(tHTTMUXPtr httmuxPtr, tSensors port);
 bool readSensor(tHTTMUXPtr httmuxPtr);
 
+#if (__HTTMUX_SAMPLER__ == 1)
+void HTTMUXstartSampler(tHTTMUXPtr httmuxPtr);
+void HTTMUXstopSampler(tHTTMUXPtr httmuxPtr);
+bool HTTMUXreadEvent(tHTTMUXPtr httmuxPtr, tHTTMUXEvent &event);
+void HTTMUXflushEvents(tHTTMUXPtr httmuxPtr);
+#endif // __HTTMUX_SAMPLER__
+
 
 /**
  * Initialise the sensor's data struct and port
@@ -54,7 +85,7 @@ bool readSensor(tHTTMUXPtr httmuxPtr);
  */
 bool initSensor(tHTTMUXPtr httmuxPtr, tSensors port)
 {
-  memset(httmuxPtr, 0, sizeof(tHTTMUXPtr));
+  memset(httmuxPtr, 0, sizeof(tHTTMUX));
   httmuxPtr->I2CData.port = port;
   httmuxPtr->I2CData.type = sensorRawValue;
 
@@ -67,25 +98,43 @@ bool initSensor(tHTTMUXPtr httmuxPtr, tSensors port)
 
 
 /**
- * Read all the sensor's data
+ * Turn a raw sensor value into the status of the switches.
  *
- * @param httmuxPtr pointer to the sensor's data struct
- * @return true if no error occured, false if it did
+ * Note: this is an internal function and should not be called directly.
+ * @param raw the raw value of the sensor
+ * @return the status of the switches, one bit per switch
  */
-bool readSensor(tHTTMUXPtr httmuxPtr)
+ubyte _HTTMUXdecode(short raw)
 {
   long muxvalue = 0;
   long switches = 0;
 
   // Voodoo magic starts here.  This is taken straight from the Touch MUX pamphlet.
   // No small furry animals were hurt during the calculation of this algorithm.
-  muxvalue = 1023 - SensorRaw[httmuxPtr->I2CData.port];
+  muxvalue = 1023 - raw;
   switches = 339 * muxvalue;
   switches /= (1023 - muxvalue);
   switches += 5;
   switches /= 10;
 
-  httmuxPtr->statusMask = switches;
+  return switches;
+}
+
+/**
+ * Read all the sensor's data.  If the sampler is running for the port, its
+ * debounced status is used instead of reading the sensor.
+ *
+ * @param httmuxPtr pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool readSensor(tHTTMUXPtr httmuxPtr)
+{
+#if (__HTTMUX_SAMPLER__ == 1)
+  if (HTTMUXsamplers[httmuxPtr->I2CData.port].enabled)
+    httmuxPtr->statusMask = HTTMUXsamplers[httmuxPtr->I2CData.port].state;
+  else
+#endif // __HTTMUX_SAMPLER__
+  httmuxPtr->statusMask = _HTTMUXdecode(SensorRaw[httmuxPtr->I2CData.port]);
   for (int i = 0; i < 4; i++)
   {
   	httmuxPtr->status[i] = (httmuxPtr->statusMask & (1 << i)) ? true : false;
@@ -93,6 +142,94 @@ bool readSensor(tHTTMUXPtr httmuxPtr)
 
   return true;
 }
+
+#if (__HTTMUX_SAMPLER__ == 1)
+/**
+ * Sample the switches of every port that has the sampler enabled and pass
+ * them to TOUCHEVTupdate() to be debounced and queued.  The task ends by
+ * itself when no port has the sampler enabled.
+ */
+task HTTMUXsampler()
+{
+  bool enabled = true;
+
+  while (enabled)
+  {
+    enabled = false;
+    for (short link = 0; link < 4; link++)
+    {
+      if (!HTTMUXsamplers[link].enabled)
+        continue;
+      enabled = true;
+      TOUCHEVTupdate(&HTTMUXsamplers[link], _HTTMUXdecode(SensorRaw[link]), nPgmTime);
+    }
+
+    // HTTMUXstartSampler() must not see the task running after it decided to stop
+    hogCPU();
+    if (!enabled)
+      HTTMUXsamplerRunning = false;
+    releaseCPU();
+
+    if (enabled)
+      sleep(HTTMUX_SAMPLE_INTERVAL);
+  }
+}
+
+/**
+ * Start sampling the switches in the background.  Presses and releases are
+ * queued as events, read them with HTTMUXreadEvent().  readSensor() uses the
+ * debounced status without reading the sensor.
+ *
+ * @param httmuxPtr pointer to the sensor's data struct
+ */
+void HTTMUXstartSampler(tHTTMUXPtr httmuxPtr)
+{
+  tSensors link = httmuxPtr->I2CData.port;
+
+  hogCPU();
+  TOUCHEVTinit(&HTTMUXsamplers[link], _HTTMUXdecode(SensorRaw[link]));
+  HTTMUXsamplers[link].enabled = true;
+  if (!HTTMUXsamplerRunning)
+  {
+    HTTMUXsamplerRunning = true;
+    startTask(HTTMUXsampler);
+  }
+  releaseCPU();
+}
+
+/**
+ * Stop sampling the switches.  The sampler task ends by itself when no
+ * other port uses it.
+ *
+ * @param httmuxPtr pointer to the sensor's data struct
+ */
+void HTTMUXstopSampler(tHTTMUXPtr httmuxPtr)
+{
+  HTTMUXsamplers[httmuxPtr->I2CData.port].enabled = false;
+}
+
+/**
+ * Take the oldest event from the queue.
+ *
+ * @param httmuxPtr pointer to the sensor's data struct
+ * @param event the struct to copy the event into
+ * @return true if there was an event, false if the queue was empty
+ */
+bool HTTMUXreadEvent(tHTTMUXPtr httmuxPtr, tHTTMUXEvent &event)
+{
+  return TOUCHEVTread(&HTTMUXsamplers[httmuxPtr->I2CData.port], event);
+}
+
+/**
+ * Throw away all the events in the queue.
+ *
+ * @param httmuxPtr pointer to the sensor's data struct
+ */
+void HTTMUXflushEvents(tHTTMUXPtr httmuxPtr)
+{
+  TOUCHEVTflush(&HTTMUXsamplers[httmuxPtr->I2CData.port]);
+}
+#endif // __HTTMUX_SAMPLER__
 #endif // __HTTMUX_H__
 
 /* @} */
@@ -16,6 +16,7 @@
  * - 0.1: Initial release
  * - 0.2: Replaced array structs with typedefs\n
  *        Uses new split off include file MMUX-common.h
+ * - 0.3: Request and reply buffers are now kept per port in HDMMUX_I2CData[]
  *
  * Credits:
  * - Big thanks to Holit Data Systems for providing me with the hardware necessary to write and test this.
@@ -31,7 +32,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 20 February 2011
- * \version 0.2
+ * \version 0.3
  * \example holitdata-motormux-test1.c
  * \example holitdata-motormux-test2.c
  */
@@ -84,8 +85,7 @@
 #define HDMMUX_ROT_BRAKE        0x01
 #define HDMMUX_ROT_FLOAT        0x00
 
-tByteArray HDMMUX_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray HDMMUX_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData HDMMUX_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 // Function prototypes
 void HDMMUXinit();
@@ -137,20 +137,20 @@ void HDMMUXinit(){
  * @return true if no error occured, false if it did
  */
 bool HDMMUXreadStatus(tSensors link, ubyte &motorStatus, long &tachoA, long &tachoB, long &tachoC) {
-  memset(HDMMUX_I2CRequest, 0, sizeof(tByteArray));
+  memset(HDMMUX_I2CData[link].request, 0, sizeof(HDMMUX_I2CData[link].request));
 
-  HDMMUX_I2CRequest[0]  = 10;               // Message size
-  HDMMUX_I2CRequest[1]  = HDMMUX_I2C_ADDR; // I2C Address
+  HDMMUX_I2CData[link].request[0]  = 10;               // Message size
+  HDMMUX_I2CData[link].request[1]  = HDMMUX_I2C_ADDR; // I2C Address
 
-  if (!writeI2C(link, HDMMUX_I2CRequest, HDMMUX_I2CReply, 13))
+  if (!writeI2C(link, HDMMUX_I2CData[link].request, HDMMUX_I2CData[link].reply, 13))
     return false;
 
-  motorStatus = HDMMUX_I2CReply[0];
+  motorStatus = HDMMUX_I2CData[link].reply[0];
 
   // Assemble and assign the encoder values
-  tachoA = (HDMMUX_I2CReply[1] << 24) + (HDMMUX_I2CReply[2] << 16) + (HDMMUX_I2CReply[3] << 8) + (HDMMUX_I2CReply[4] << 0);
-  tachoB = (HDMMUX_I2CReply[5] << 24) + (HDMMUX_I2CReply[6] << 16) + (HDMMUX_I2CReply[7] << 8) + (HDMMUX_I2CReply[8] << 0);
-  tachoC = (HDMMUX_I2CReply[9] << 24) + (HDMMUX_I2CReply[10] << 16) + (HDMMUX_I2CReply[11] << 8) + (HDMMUX_I2CReply[12] << 0);
+  tachoA = (HDMMUX_I2CData[link].reply[1] << 24) + (HDMMUX_I2CData[link].reply[2] << 16) + (HDMMUX_I2CData[link].reply[3] << 8) + (HDMMUX_I2CData[link].reply[4] << 0);
+  tachoB = (HDMMUX_I2CData[link].reply[5] << 24) + (HDMMUX_I2CData[link].reply[6] << 16) + (HDMMUX_I2CData[link].reply[7] << 8) + (HDMMUX_I2CData[link].reply[8] << 0);
+  tachoC = (HDMMUX_I2CData[link].reply[9] << 24) + (HDMMUX_I2CData[link].reply[10] << 16) + (HDMMUX_I2CData[link].reply[11] << 8) + (HDMMUX_I2CData[link].reply[12] << 0);
 
   return true;
 }
@@ -169,21 +169,21 @@ bool HDMMUXreadStatus(tSensors link, ubyte &motorStatus, long &tachoA, long &tac
  * @return true if no error occured, false if it did
  */
 bool HDMMUXsendCommand(tSensors link, ubyte mode, ubyte channel, ubyte rotparams, long duration, byte power, byte steering) {
-  memset(HDMMUX_I2CRequest, 0, sizeof(tByteArray));
-
-  HDMMUX_I2CRequest[0]  = 10;               // Message size
-  HDMMUX_I2CRequest[1]  = HDMMUX_I2C_ADDR; // I2C Address
-  HDMMUX_I2CRequest[2]  = mode;
-  HDMMUX_I2CRequest[3]  = channel;
-  HDMMUX_I2CRequest[4]  = rotparams;
-  HDMMUX_I2CRequest[5]  = (duration >> 24) & 0xFF;
-  HDMMUX_I2CRequest[6]  = (duration >> 16) & 0xFF;
-  HDMMUX_I2CRequest[7]  = (duration >>  8) & 0xFF;
-  HDMMUX_I2CRequest[8]  = (duration >>  0) & 0xFF;
-  HDMMUX_I2CRequest[9]  = power;
-  HDMMUX_I2CRequest[10] = (byte)(steering & 0xFF);
-
-  return writeI2C(link, HDMMUX_I2CRequest);
+  memset(HDMMUX_I2CData[link].request, 0, sizeof(HDMMUX_I2CData[link].request));
+
+  HDMMUX_I2CData[link].request[0]  = 10;               // Message size
+  HDMMUX_I2CData[link].request[1]  = HDMMUX_I2C_ADDR; // I2C Address
+  HDMMUX_I2CData[link].request[2]  = mode;
+  HDMMUX_I2CData[link].request[3]  = channel;
+  HDMMUX_I2CData[link].request[4]  = rotparams;
+  HDMMUX_I2CData[link].request[5]  = (duration >> 24) & 0xFF;
+  HDMMUX_I2CData[link].request[6]  = (duration >> 16) & 0xFF;
+  HDMMUX_I2CData[link].request[7]  = (duration >>  8) & 0xFF;
+  HDMMUX_I2CData[link].request[8]  = (duration >>  0) & 0xFF;
+  HDMMUX_I2CData[link].request[9]  = power;
+  HDMMUX_I2CData[link].request[10] = (byte)(steering & 0xFF);
+
+  return writeI2C(link, HDMMUX_I2CData[link].request);
 }
 
 /**
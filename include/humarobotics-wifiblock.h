@@ -15,6 +15,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in HRWB_I2CData[]
  *
  * Credits:
  * - Big thanks to HumaRobotics for providing me with the hardware necessary to write and test this.
@@ -25,7 +26,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 02 April 2012
- * \version 0.1
+ * \version 0.2
  * \example humarobotics-wifiblock-test1.c
  */
 
@@ -149,8 +150,7 @@
 #define HRWB_UDP_STATUS_RESERVED2   0x40      /*!< RESERVED */
 #define HRWB_UDP_STATUS_REQ_ERROR   0x80      /*!< Bit mask for checking if an error has occurred */
 
-tByteArray HRWB_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray HRWB_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData HRWB_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 tByteArray HRWB_scratch;          /*!< Array to hold scratch data */
 tHugeByteArray HRWB_HugeArray;    /*!< Array to hold scratch data, only more of it */
 
@@ -268,17 +268,17 @@ void stringToIp(const string address, tIPaddr &addr)
 bool HRWBwriteRegMasked(tSensors link, short reg, ubyte data, ubyte mask)
 {
   // writeDebugStreamLine("writeRegMasked");
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
 
-  HRWB_I2CRequest[0] =  6;                  //Message Size, here 7 Bytes
-  HRWB_I2CRequest[1] =  HRWB_I2C_ADDR;
-  HRWB_I2CRequest[2] =  HRWB_MASKED_WRITE;
-  HRWB_I2CRequest[3] =  (reg >> 8) & 0xFF;  //Read address register - Msb
-  HRWB_I2CRequest[4] =  reg & 0xFF;         //Read address register - Lsb
-  HRWB_I2CRequest[5] =  mask;               //data
-  HRWB_I2CRequest[6] =  data;               //mask
+  HRWB_I2CData[link].request[0] =  6;                  //Message Size, here 7 Bytes
+  HRWB_I2CData[link].request[1] =  HRWB_I2C_ADDR;
+  HRWB_I2CData[link].request[2] =  HRWB_MASKED_WRITE;
+  HRWB_I2CData[link].request[3] =  (reg >> 8) & 0xFF;  //Read address register - Msb
+  HRWB_I2CData[link].request[4] =  reg & 0xFF;         //Read address register - Lsb
+  HRWB_I2CData[link].request[5] =  mask;               //data
+  HRWB_I2CData[link].request[6] =  data;               //mask
 
-  return writeI2C(link, HRWB_I2CRequest);
+  return writeI2C(link, HRWB_I2CData[link].request);
 }
 
 /**
@@ -291,16 +291,16 @@ bool HRWBwriteRegMasked(tSensors link, short reg, ubyte data, ubyte mask)
 bool HRWBwriteReg(tSensors link, short reg, ubyte data)
 {
   // writeDebugStreamLine("writeReg");
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
 
-  HRWB_I2CRequest[0] =  5;                  //Message Size, here 7 Bytes
-  HRWB_I2CRequest[1] =  HRWB_I2C_ADDR;
-  HRWB_I2CRequest[2] =  HRWB_SIMPLE_WRITE;
-  HRWB_I2CRequest[3] =  (reg >> 8) & 0xFF;  //Read address register - Msb
-  HRWB_I2CRequest[4] =  reg & 0xFF;         //Read address register - Lsb
-  HRWB_I2CRequest[5] =  data;                //Msb SensorType Register
+  HRWB_I2CData[link].request[0] =  5;                  //Message Size, here 7 Bytes
+  HRWB_I2CData[link].request[1] =  HRWB_I2C_ADDR;
+  HRWB_I2CData[link].request[2] =  HRWB_SIMPLE_WRITE;
+  HRWB_I2CData[link].request[3] =  (reg >> 8) & 0xFF;  //Read address register - Msb
+  HRWB_I2CData[link].request[4] =  reg & 0xFF;         //Read address register - Lsb
+  HRWB_I2CData[link].request[5] =  data;                //Msb SensorType Register
 
-  return writeI2C(link, HRWB_I2CRequest);
+  return writeI2C(link, HRWB_I2CData[link].request);
 }
 
 /**
@@ -318,17 +318,17 @@ bool _HRWBwriteRegPrivate(tSensors link, short reg, tByteArray &data, short size
   if (size > 12)
     return false;
 
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
 
-  HRWB_I2CRequest[0] =  4 + size;                  //Message Size, here 7 Bytes
-  HRWB_I2CRequest[1] =  HRWB_I2C_ADDR;
-  HRWB_I2CRequest[2] =  HRWB_SIMPLE_WRITE;
-  HRWB_I2CRequest[3] =  (reg >> 8) & 0xFF;  //Read address register - Msb
-  HRWB_I2CRequest[4] =  reg & 0xFF;         //Read address register - Lsb
+  HRWB_I2CData[link].request[0] =  4 + size;                  //Message Size, here 7 Bytes
+  HRWB_I2CData[link].request[1] =  HRWB_I2C_ADDR;
+  HRWB_I2CData[link].request[2] =  HRWB_SIMPLE_WRITE;
+  HRWB_I2CData[link].request[3] =  (reg >> 8) & 0xFF;  //Read address register - Msb
+  HRWB_I2CData[link].request[4] =  reg & 0xFF;         //Read address register - Lsb
 
-  memcpy(&HRWB_I2CRequest[5], data, size);
+  memcpy(&HRWB_I2CData[link].request[5], data, size);
 
-  return writeI2C(link, HRWB_I2CRequest);
+  return writeI2C(link, HRWB_I2CData[link].request);
 }
 
 /**
@@ -414,7 +414,7 @@ bool HRWBwriteReg(tSensors link, short reg, tBigByteArray &data, short size)
 }
 
 /**
- * Read a register.  Data read is stored in HRWB_I2CReply
+ * Read a register.  Data read is stored in HRWB_I2CData[link].reply
  * @param link the port number
  * @param reg register to read
  * @param size amount of data to read
@@ -423,18 +423,18 @@ bool HRWBwriteReg(tSensors link, short reg, tBigByteArray &data, short size)
 bool HRWBreadReg(tSensors link, short reg, short size)
 {
   // writeDebugStreamLine("readReg");
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
-
-  HRWB_I2CRequest[0] =  7;                  //Message Size, here 7 Bytes
-  HRWB_I2CRequest[1] =  HRWB_I2C_ADDR;
-  HRWB_I2CRequest[2] =  HRWB_SIMPLE_WRITE;
-  HRWB_I2CRequest[3] =  0x01;               //Read address register - Msb
-  HRWB_I2CRequest[4] =  0x00;               //Read address register - Lsb
-  HRWB_I2CRequest[5] =  (reg >> 8) & 0xFF;  //Msb SensorType Register
-  HRWB_I2CRequest[6] =  reg & 0xFF;         //Lsb SensorType Register
-  HRWB_I2CRequest[7] =  size & 0xFF;        //Size of the returned message
-
-  return writeI2C(link, HRWB_I2CRequest, HRWB_I2CReply, size);
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
+
+  HRWB_I2CData[link].request[0] =  7;                  //Message Size, here 7 Bytes
+  HRWB_I2CData[link].request[1] =  HRWB_I2C_ADDR;
+  HRWB_I2CData[link].request[2] =  HRWB_SIMPLE_WRITE;
+  HRWB_I2CData[link].request[3] =  0x01;               //Read address register - Msb
+  HRWB_I2CData[link].request[4] =  0x00;               //Read address register - Lsb
+  HRWB_I2CData[link].request[5] =  (reg >> 8) & 0xFF;  //Msb SensorType Register
+  HRWB_I2CData[link].request[6] =  reg & 0xFF;         //Lsb SensorType Register
+  HRWB_I2CData[link].request[7] =  size & 0xFF;        //Size of the returned message
+
+  return writeI2C(link, HRWB_I2CData[link].request, HRWB_I2CData[link].reply, size);
 }
 
 /**
@@ -449,7 +449,7 @@ bool HRWBreadBigReg(tSensors link, short reg, short size)
   // writeDebugStreamLine("readBigReg");
   short bytesleft = size;
   short requestlen = 0;
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
   memset(HRWB_HugeArray, 0, sizeof(HRWB_HugeArray));
 
   for (short i =  0; i < ((size/16) + 1); i++)
@@ -457,7 +457,7 @@ bool HRWBreadBigReg(tSensors link, short reg, short size)
     requestlen = (bytesleft > 16) ? 16 : bytesleft;
     if (!HRWBreadReg(link, reg + (i*16), requestlen))
       return false;
-    memcpy(&HRWB_HugeArray[16 * i], HRWB_I2CReply, requestlen);
+    memcpy(&HRWB_HugeArray[16 * i], HRWB_I2CData[link].reply, requestlen);
     bytesleft -= 16;
     sleep(10);
   }
@@ -472,9 +472,9 @@ bool HRWBreadBigReg(tSensors link, short reg, short size)
 short HRWBreadHTTPCode(tSensors link)
 {
   string tmpResultCode;
-  HRWBreadReg(WifiBlockPort, HRWB_HTTP_RESULT_CODE, 3);
-  HRWB_I2CReply[3] = 0;
-  memcpy(tmpResultCode, HRWB_I2CReply, 4);
+  HRWBreadReg(link, HRWB_HTTP_RESULT_CODE, 3);
+  HRWB_I2CData[link].reply[3] = 0;
+  memcpy(tmpResultCode, HRWB_I2CData[link].reply, 4);
   return atoi(tmpResultCode);
 }
 
@@ -486,7 +486,7 @@ short HRWBreadHTTPCode(tSensors link)
 bool HRWBresetWifiBlock(tSensors link)
 {
   // writeDebugStreamLine("resetWifiBlock");
-  return HRWBwriteRegMasked(WifiBlockPort, HRWB_RESET, 1, HRWB_RESET_WIFIBLOCK);
+  return HRWBwriteRegMasked(link, HRWB_RESET, 1, HRWB_RESET_WIFIBLOCK);
 }
 
 /**
@@ -497,7 +497,7 @@ bool HRWBresetWifiBlock(tSensors link)
 float HRWBreadBatt(tSensors link)
 {
   HRWBreadReg(link, HRWB_BATTLVL, 1);
-  return (float)HRWB_I2CReply[0]/10.0;
+  return (float)HRWB_I2CData[link].reply[0]/10.0;
 
 }
 
@@ -513,7 +513,7 @@ bool HRWBreadSensorType (tSensors link, string &sType)
   if (!HRWBreadReg(link, HRWB_SENSORTYPE, 4))
     return false;
 
-  stringFromChars(sType, &HRWB_I2CReply[0]);
+  stringFromChars(sType, &HRWB_I2CData[link].reply[0]);
 
   return true;
 }
@@ -569,28 +569,28 @@ bool HRWBscanChannel(tSensors link, ubyte channel) {
   string tmpString;
   char tmpCharArray[20];
   short SSIDcount = 0;
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
 
   writeDebugStreamLine("channel: %d", channel);
   if (!HRWBwriteReg(link, HRWB_WIFI_SCANSEL, channel))
     return false;
 
   // Start scan
-  HRWB_I2CRequest[0] =  6;                  //Message Size, here 7 Bytes
-  HRWB_I2CRequest[1] =  HRWB_I2C_ADDR;
-  HRWB_I2CRequest[2] =  HRWB_MASKED_WRITE;
-  HRWB_I2CRequest[3] =  0x02;               //Read address register - Msb
-  HRWB_I2CRequest[4] =  0x00;               //Read address register - Lsb
-  HRWB_I2CRequest[5] =  0x04;               //Msb SensorType Register
-  HRWB_I2CRequest[6] =  0x04;               //Lsb SensorType Register
+  HRWB_I2CData[link].request[0] =  6;                  //Message Size, here 7 Bytes
+  HRWB_I2CData[link].request[1] =  HRWB_I2C_ADDR;
+  HRWB_I2CData[link].request[2] =  HRWB_MASKED_WRITE;
+  HRWB_I2CData[link].request[3] =  0x02;               //Read address register - Msb
+  HRWB_I2CData[link].request[4] =  0x00;               //Read address register - Lsb
+  HRWB_I2CData[link].request[5] =  0x04;               //Msb SensorType Register
+  HRWB_I2CData[link].request[6] =  0x04;               //Lsb SensorType Register
 
-  if (!writeI2C(link, HRWB_I2CRequest, 0))
+  if (!writeI2C(link, HRWB_I2CData[link].request, 0))
     return false;
 
   // Wait for scan to be done
   while (true) {
     HRWBreadReg(link, HRWB_WIFI_STATUS, 1);
-    if ((HRWB_I2CReply[0] & 0x08) == 0x08)
+    if ((HRWB_I2CData[link].reply[0] & 0x08) == 0x08)
       break;
     sleep(100);
   }
@@ -608,7 +608,7 @@ bool HRWBscanWifi(tSensors link)
 {
   char tmpCharArray[20];
   short SSIDcount = 0;
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
 
   if (!HRWBwriteRegMasked(link, HRWB_WIFI_STATUS, HRWB_WIFI_STATUS_START_SCAN, HRWB_WIFI_STATUS_START_SCAN))
     return false;
@@ -616,14 +616,14 @@ bool HRWBscanWifi(tSensors link)
   // Wait for scan to be done
   while (true) {
     HRWBreadReg(link, HRWB_WIFI_STATUS, 1);
-    if ((HRWB_I2CReply[0] &  HRWB_WIFI_STATUS_SCAN_DONE) == HRWB_WIFI_STATUS_SCAN_DONE)
+    if ((HRWB_I2CData[link].reply[0] &  HRWB_WIFI_STATUS_SCAN_DONE) == HRWB_WIFI_STATUS_SCAN_DONE)
       break;
     sleep(100);
   }
 
   // Fetch number of SSIDs found.
   HRWBreadReg(link, HRWB_WIFI_SCANRESULT, 1);
-  SSIDcount = HRWB_I2CReply[0];
+  SSIDcount = HRWB_I2CData[link].reply[0];
   writeDebugStreamLine("SSID count: %d", SSIDcount);
   if (SSIDcount == 0)
     return false;
@@ -648,7 +648,7 @@ bool HRWBscanWifi(tSensors link)
 bool HRWBconfigNetwork(tSensors link, tNetworkInfo &netInfo) {
   bool done = false;
   ubyte status;
-  memset(HRWB_I2CRequest, 0, sizeof(tByteArray));
+  memset(HRWB_I2CData[link].request, 0, sizeof(HRWB_I2CData[link].request));
 
   // switch off the wifi
   if (!HRWBdisableWifi(link))
@@ -694,7 +694,7 @@ bool HRWBconfigNetwork(tSensors link, tNetworkInfo &netInfo) {
   while(!done) {
     if (!HRWBreadReg(link, HRWB_WIFI_STATUS, 1))
       return false;
-    status = HRWB_I2CReply[0];
+    status = HRWB_I2CData[link].reply[0];
 
     if ((status & HRWB_WIFI_STATUS_CONN_STAT) == HRWB_WIFI_STATUS_CONN_STAT)
     {
@@ -721,7 +721,7 @@ bool HRWBdoGET(tSensors link, tGetRequest &getrequest) {
   tmpPort[1] = (getrequest.port >> 0) & 0xFF;
 
   HRWBreadReg(link, HRWB_GET_STATUS, 1);
-  status = HRWB_I2CReply[0];
+  status = HRWB_I2CData[link].reply[0];
 
   if (status & HRWB_GET_STATUS_READY != HRWB_GET_STATUS_READY)
   {
@@ -747,7 +747,7 @@ bool HRWBdoGET(tSensors link, tGetRequest &getrequest) {
     if (!HRWBreadReg(link, HRWB_GET_STATUS, 1))
       return false;
 
-    status = HRWB_I2CReply[0];
+    status = HRWB_I2CData[link].reply[0];
 
     if ((status & HRWB_GET_STATUS_REQ_ERROR) == HRWB_GET_STATUS_REQ_ERROR)
     {
@@ -769,7 +769,7 @@ bool HRWBdoGET(tSensors link, tGetRequest &getrequest) {
   sleep(1000);
   if (!HRWBreadReg(link, HRWB_GET_LENGTH, 1))
     return false;
-  getrequest.RXDataLen = HRWB_I2CReply[0];
+  getrequest.RXDataLen = HRWB_I2CData[link].reply[0];
 
   writeDebugStreamLine("res length: %d", getrequest.RXDataLen);
   if (!HRWBreadBigReg(link, HRWB_GET_DATA, getrequest.RXDataLen))
@@ -795,7 +795,7 @@ bool HRWBdoPOST(tSensors link, tPostRequest &postrequest) {
   tmpPort[1] = (postrequest.port >> 0) & 0xFF;
 
   HRWBreadReg(link, HRWB_POST_STATUS, 1);
-  status = HRWB_I2CReply[0];
+  status = HRWB_I2CData[link].reply[0];
 
   if (status & HRWB_POST_STATUS_READY != HRWB_POST_STATUS_READY)
     return false;
@@ -821,7 +821,7 @@ bool HRWBdoPOST(tSensors link, tPostRequest &postrequest) {
   while(!done) {
     if (!HRWBreadReg(link, HRWB_POST_STATUS, 1))
       return false;
-    status = HRWB_I2CReply[0];
+    status = HRWB_I2CData[link].reply[0];
 
     if ((status & HRWB_POST_STATUS_REQ_ERROR) == HRWB_POST_STATUS_REQ_ERROR)
     {
@@ -852,7 +852,7 @@ bool HRWBdoTCP(tSensors link, tTCPRequest &tcprequest) {
   ubyte status = 0;
   bool done = false;
   HRWBreadReg(link, HRWB_TCP_STATUS, 1);
-  status = HRWB_I2CReply[0];
+  status = HRWB_I2CData[link].reply[0];
   ubyte tmpPort[2];
 
   tmpPort[0] = (tcprequest.port >> 8) & 0xFF;
@@ -885,7 +885,7 @@ bool HRWBdoTCP(tSensors link, tTCPRequest &tcprequest) {
   while(!done) {
     if (!HRWBreadReg(link, HRWB_TCP_STATUS, 1))
       return false;
-    status = HRWB_I2CReply[0];
+    status = HRWB_I2CData[link].reply[0];
 
     if ((status & HRWB_TCP_STATUS_REQ_ERROR) == HRWB_TCP_STATUS_REQ_ERROR)
     {
@@ -903,7 +903,7 @@ bool HRWBdoTCP(tSensors link, tTCPRequest &tcprequest) {
   sleep(100);
   if (!HRWBreadReg(link, HRWB_TCP_RX_LENGTH, 1))
     return false;
-  tcprequest.RXDataLen = HRWB_I2CReply[0];
+  tcprequest.RXDataLen = HRWB_I2CData[link].reply[0];
 
   writeDebugStreamLine("res length: %d", tcprequest.RXDataLen);
   if (!HRWBreadBigReg(link, HRWB_TCP_RX_DATA, 32))
@@ -925,7 +925,7 @@ bool HRWBdoUDP(tSensors link, tUDPRequest &udprequest) {
   ubyte status = 0;
   bool done = false;
   HRWBreadReg(link, HRWB_UDP_STATUS, 1);
-  status = HRWB_I2CReply[0];
+  status = HRWB_I2CData[link].reply[0];
   ubyte tmpsPort[2];
   ubyte tmpdPort[2];
 
@@ -965,7 +965,7 @@ bool HRWBdoUDP(tSensors link, tUDPRequest &udprequest) {
   while(!done) {
     if (!HRWBreadReg(link, HRWB_UDP_STATUS, 1))
       return false;
-    status = HRWB_I2CReply[0];
+    status = HRWB_I2CData[link].reply[0];
 
     if ((status & HRWB_UDP_STATUS_REQ_ERROR) == HRWB_UDP_STATUS_REQ_ERROR)
     {
@@ -983,7 +983,7 @@ bool HRWBdoUDP(tSensors link, tUDPRequest &udprequest) {
   sleep(100);
   if (!HRWBreadReg(link, HRWB_UDP_RX_LENGTH, 1))
     return false;
-  udprequest.RXDataLen = HRWB_I2CReply[0];
+  udprequest.RXDataLen = HRWB_I2CData[link].reply[0];
 
   //writeDebugStreamLine("res length: %d", udprequest.RXDataLen);
   if (!HRWBreadBigReg(link, HRWB_UDP_RX_DATA, 32))
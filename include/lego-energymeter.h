@@ -15,6 +15,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in LEGOEM_I2CData[]
  *
  * Credits :
  * - David Cosimano for sending me one of these.
@@ -26,7 +27,7 @@
 
  * \author Xander Soldaat (mightor@gmail.com)
  * \date 22 August 2010
- * \version 0.1
+ * \version 0.2
  * \example lego-energymeter-test1.c
  */
 
@@ -50,8 +51,7 @@ bool LEGOEMreadData(tSensors link, float &voltageIn, float &currentIn, float &vo
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // global variables
-tByteArray       LEGOEM_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray       LEGOEM_I2CReply;      /*!< Array to hold I2C reply data   */
+tI2CData LEGOEM_I2CData[4];            /*!< Per-port I2C request and reply buffers */
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -70,22 +70,22 @@ tByteArray       LEGOEM_I2CReply;      /*!< Array to hold I2C reply data   */
  * @return true if no error occured, false if it did
  */
 bool LEGOEMreadData(tSensors link, float &voltageIn, float &currentIn, float &voltageOut, float &currentOut, short &joule, float &wattIn, float &wattOut) {
-  memset(LEGOEM_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOEM_I2CData[link].request, 0, sizeof(LEGOEM_I2CData[link].request));
 
-  LEGOEM_I2CRequest[0] = 2;                // Message size
-  LEGOEM_I2CRequest[1] = LEGOEM_I2C_ADDR;  // I2C Address
-  LEGOEM_I2CRequest[2] = LEGOEM_I2C_REG;   // Value address
+  LEGOEM_I2CData[link].request[0] = 2;                // Message size
+  LEGOEM_I2CData[link].request[1] = LEGOEM_I2C_ADDR;  // I2C Address
+  LEGOEM_I2CData[link].request[2] = LEGOEM_I2C_REG;   // Value address
 
-  if (!writeI2C(link, LEGOEM_I2CRequest, LEGOEM_I2CReply, LEGOEM_I2C_SIZE))
+  if (!writeI2C(link, LEGOEM_I2CData[link].request, LEGOEM_I2CData[link].reply, LEGOEM_I2C_SIZE))
     return false;
 
-  voltageIn  = (float)(LEGOEM_I2CReply[0]  + (LEGOEM_I2CReply[1]  << 8)) / 1000;
-  currentIn  = (float)(LEGOEM_I2CReply[2]  + (LEGOEM_I2CReply[3]  << 8)) / 1000;
-  voltageOut = (float)(LEGOEM_I2CReply[4]  + (LEGOEM_I2CReply[5]  << 8)) / 1000;
-  currentOut = (float)(LEGOEM_I2CReply[6]  + (LEGOEM_I2CReply[7]  << 8)) / 1000;
-  joule      =         LEGOEM_I2CReply[8]  + (LEGOEM_I2CReply[9]  << 8);
-  wattIn     = (float)(LEGOEM_I2CReply[10] + (LEGOEM_I2CReply[11] << 8)) / 1000;
-  wattOut    = (float)(LEGOEM_I2CReply[12] + (LEGOEM_I2CReply[13] << 8)) / 1000;
+  voltageIn  = (float)(LEGOEM_I2CData[link].reply[0]  + (LEGOEM_I2CData[link].reply[1]  << 8)) / 1000;
+  currentIn  = (float)(LEGOEM_I2CData[link].reply[2]  + (LEGOEM_I2CData[link].reply[3]  << 8)) / 1000;
+  voltageOut = (float)(LEGOEM_I2CData[link].reply[4]  + (LEGOEM_I2CData[link].reply[5]  << 8)) / 1000;
+  currentOut = (float)(LEGOEM_I2CData[link].reply[6]  + (LEGOEM_I2CData[link].reply[7]  << 8)) / 1000;
+  joule      =         LEGOEM_I2CData[link].reply[8]  + (LEGOEM_I2CData[link].reply[9]  << 8);
+  wattIn     = (float)(LEGOEM_I2CData[link].reply[10] + (LEGOEM_I2CData[link].reply[11] << 8)) / 1000;
+  wattOut    = (float)(LEGOEM_I2CData[link].reply[12] + (LEGOEM_I2CData[link].reply[13] << 8)) / 1000;
   return true;
 }
 
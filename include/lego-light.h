@@ -15,6 +15,7 @@
  * Changelog:
  * - 0.1: Initial release
  * - 0.2: Make use of new calls for analogue SMUX sensors in common.h
+ * - 0.3: Added LSvalRawAll() to read all light sensors on a SMUX at once
  *
  * License: You may use this code as you wish, provided you give credit where its due.
  *
@@ -22,7 +23,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 25 November 2009
- * \version 0.2
+ * \version 0.3
  * \example lego-light-test1.c
  * \example lego-light-test2.c
  * \example lego-light-SMUX-test1.c
@@ -57,6 +58,7 @@ void LSsetInactive(tSensors link);
 short LSvalNorm(tMUXSensor muxsensor);
 void LScalLow(tMUXSensor muxsensor);
 short LSvalRaw(tMUXSensor muxsensor);
+bool LSvalRawAll(tSensors link, tHTSMUXAnalogue &values);
 void LScalHigh(tMUXSensor muxsensor);
 void LSsetActive(tMUXSensor muxsensor);
 void LSsetInactive(tMUXSensor muxsensor);
@@ -86,6 +88,23 @@ short LSvalRaw(tSensors link) {
 short LSvalRaw(tMUXSensor muxsensor) {
   return 1023 - HTSMUXreadAnalogue(muxsensor);
 }
+
+/**
+ * Read the raw values of the light sensors on all four channels of a SMUX
+ * with a single I2C transaction.
+ * @param link the SMUX port number
+ * @param values array to hold the raw values of channels 1 to 4
+ * @return true if no error occured, false if it did
+ */
+bool LSvalRawAll(tSensors link, tHTSMUXAnalogue &values) {
+  if (!HTSMUXreadAllAnalogue(link, values))
+    return false;
+
+  for (short i = 0; i < 4; i++)
+    values[i] = 1023 - values[i];
+
+  return true;
+}
 #endif // __HTSMUX_SUPPORT__
 
 /**
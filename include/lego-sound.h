@@ -13,6 +13,7 @@
  * Changelog:
  * - 0.1: Initial release
  * - 0.2: Make use of new calls for analogue SMUX sensors in common.h
+ * - 0.3: Added SNDreadRawAll() to read all sound sensors on a SMUX at once
  *
  * License: You may use this code as you wish, provided you give credit where its due.
  *
@@ -20,7 +21,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 25 November 2009
- * \version 0.2
+ * \version 0.3
  * \example lego-sound-SMUX-test1.c
  */
 
@@ -32,6 +33,7 @@
 
 #ifdef __HTSMUX_SUPPORT__
 short SNDreadRaw(tMUXSensor muxsensor);
+bool SNDreadRawAll(tSensors link, tHTSMUXAnalogue &values);
 short SNDreadNorm(tMUXSensor muxsensor);
 void SNDsetDBA(tMUXSensor muxsensor);
 void SNDsetDB(tMUXSensor muxsensor);
@@ -45,6 +47,23 @@ short SNDreadRaw(tMUXSensor muxsensor) {
   return 1023 - HTSMUXreadAnalogue(muxsensor);
 }
 
+/**
+ * Get the raw values of the sound sensors on all four channels of a SMUX
+ * with a single I2C transaction.
+ * @param link the SMUX port number
+ * @param values array to hold the raw values of channels 1 to 4
+ * @return true if no error occured, false if it did
+ */
+bool SNDreadRawAll(tSensors link, tHTSMUXAnalogue &values) {
+  if (!HTSMUXreadAllAnalogue(link, values))
+    return false;
+
+  for (short i = 0; i < 4; i++)
+    values[i] = 1023 - values[i];
+
+  return true;
+}
+
 /**
  * Get the processed value from the sensor.
  * @param muxsensor the SMUX sensor port number
@@ -16,6 +16,7 @@
  * Changelog:
  * - 0.1: Initial release
  * - 0.2: Partial rewrite by Xander Soldaat to simplify API
+ * - 0.3: Request and reply buffers are now kept per port in LEGOTMP_I2CData[]
  *
  * Credits :
  * - Based on http://focus.ti.com/lit/ds/symlink/tmp275.pdf (Thank to Xander Soldaat who found the internal design)
@@ -28,7 +29,7 @@
  * \author Sylvain CACHEUX (sylcalego@cacheux.info)
  * \author Xander Soldaat (mightor@gmail.com), version 0.2
  * \date 15 february 2010
- * \version 0.2
+ * \version 0.3
  * \example lego-temp-test1.c
  * \example lego-temp-test2.c
  */
@@ -68,8 +69,7 @@ tLEGOTMPAccuracy _LEGOTMPconvertAccuracy(ubyte config);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // global variables
-tByteArray       LEGOTMP_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray       LEGOTMP_I2CReply;      /*!< Array to hold I2C reply data   */
+tI2CData LEGOTMP_I2CData[4];            /*!< Per-port I2C request and reply buffers */
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -82,16 +82,16 @@ tByteArray       LEGOTMP_I2CReply;      /*!< Array to hold I2C reply data   */
  * @return true if no error occured, false if it did
  */
 bool _LEGOTMPreadConfig(tSensors link, ubyte &config) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
 
-  LEGOTMP_I2CRequest[0] = 2;                // Message size
-  LEGOTMP_I2CRequest[1] = LEGOTMP_I2C_ADDR; // I2C Address
-  LEGOTMP_I2CRequest[2] = LEGOTMP_CONFIG;   // Value address
+  LEGOTMP_I2CData[link].request[0] = 2;                // Message size
+  LEGOTMP_I2CData[link].request[1] = LEGOTMP_I2C_ADDR; // I2C Address
+  LEGOTMP_I2CData[link].request[2] = LEGOTMP_CONFIG;   // Value address
 
-  if (!writeI2C(link, LEGOTMP_I2CRequest, LEGOTMP_I2CReply, 1))
+  if (!writeI2C(link, LEGOTMP_I2CData[link].request, LEGOTMP_I2CData[link].reply, 1))
     return false;
 
-  config = LEGOTMP_I2CReply[0];
+  config = LEGOTMP_I2CData[link].reply[0];
 
   return true;
 }
@@ -105,14 +105,14 @@ bool _LEGOTMPreadConfig(tSensors link, ubyte &config) {
  * @return true if no error occured, false if it did
  */
 bool _LEGOTMPsetConfig(tSensors link, ubyte &config) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
 
-  LEGOTMP_I2CRequest[0] = 3;                // Message size
-  LEGOTMP_I2CRequest[1] = LEGOTMP_I2C_ADDR; // I2C Address
-  LEGOTMP_I2CRequest[2] = LEGOTMP_CONFIG;   // Value address
-  LEGOTMP_I2CRequest[3] = config;           // Value to be set
+  LEGOTMP_I2CData[link].request[0] = 3;                // Message size
+  LEGOTMP_I2CData[link].request[1] = LEGOTMP_I2C_ADDR; // I2C Address
+  LEGOTMP_I2CData[link].request[2] = LEGOTMP_CONFIG;   // Value address
+  LEGOTMP_I2CData[link].request[3] = config;           // Value to be set
 
-  return writeI2C(link, LEGOTMP_I2CRequest);
+  return writeI2C(link, LEGOTMP_I2CData[link].request);
 }
 
 /**
@@ -160,7 +160,7 @@ tLEGOTMPAccuracy _LEGOTMPconvertAccuracy(ubyte config) {
  * @return true if no error occured, false if it did
  */
 bool LEGOTMPreadTemp(tSensors link, float &temp) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
   short b1;
   float b2;
   ubyte config;
@@ -201,32 +201,32 @@ bool LEGOTMPreadTemp(tSensors link, float &temp) {
   }
 
   // clear the array again
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
-  LEGOTMP_I2CRequest[0] = 2;                // Message size
-  LEGOTMP_I2CRequest[1] = LEGOTMP_I2C_ADDR; // I2C Address
-  LEGOTMP_I2CRequest[2] = LEGOTMP_TEMP;     // Value address
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
+  LEGOTMP_I2CData[link].request[0] = 2;                // Message size
+  LEGOTMP_I2CData[link].request[1] = LEGOTMP_I2C_ADDR; // I2C Address
+  LEGOTMP_I2CData[link].request[2] = LEGOTMP_TEMP;     // Value address
 
-  if (!writeI2C(link, LEGOTMP_I2CRequest, LEGOTMP_I2CReply, 2))
+  if (!writeI2C(link, LEGOTMP_I2CData[link].request, LEGOTMP_I2CData[link].reply, 2))
     return false;
 
-  b1 = (short)LEGOTMP_I2CReply[0];
+  b1 = (short)LEGOTMP_I2CData[link].reply[0];
 
   switch (_LEGOTMPconvertAccuracy(config)) {
     case A_MIN:
       ///128 to have only the most significant bit (9 bits accuracy - 8 (b1) = 1 bit to keep)
-      b2 = ((short)LEGOTMP_I2CReply[1] >> 7) * 0.5;
+      b2 = ((short)LEGOTMP_I2CData[link].reply[1] >> 7) * 0.5;
       break;
     case A_MEAN1:
       ///64 to have only the 2 most significant bits
-      b2 = ((short)LEGOTMP_I2CReply[1] >> 6) * 0.25;
+      b2 = ((short)LEGOTMP_I2CData[link].reply[1] >> 6) * 0.25;
       break;
     case A_MEAN2:
       ///32 to have only the 3 most significant bits
-      b2 = ((short)LEGOTMP_I2CReply[1] >> 5) * 0.125;
+      b2 = ((short)LEGOTMP_I2CData[link].reply[1] >> 5) * 0.125;
       break;
     case A_MAX:
       ///16 to have only the 4 most significant bits
-      b2 = ((short)LEGOTMP_I2CReply[1] >> 4) * 0.0625;
+      b2 = ((short)LEGOTMP_I2CData[link].reply[1] >> 4) * 0.0625;
       break;
   }
 
@@ -243,7 +243,7 @@ bool LEGOTMPreadTemp(tSensors link, float &temp) {
  * @return true if no error occured, false if it did
  */
 bool LEGOTMPreadAccuracy(tSensors link, tLEGOTMPAccuracy &accuracy) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
   ubyte config;
 
   if (!_LEGOTMPreadConfig(link, config))
@@ -261,7 +261,7 @@ bool LEGOTMPreadAccuracy(tSensors link, tLEGOTMPAccuracy &accuracy) {
  * @return true if no error occured, false if it did
  */
 bool LEGOTMPsetAccuracy(tSensors link, tLEGOTMPAccuracy accuracy) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
   ubyte config;
 
   // reading the configuration registry to know the other bits values
@@ -308,7 +308,7 @@ bool LEGOTMPsetAccuracy(tSensors link, tLEGOTMPAccuracy accuracy) {
  * @return true if no error occured, false if it did
  */
 bool LEGOTMPsetSingleShot(tSensors link) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
   ubyte config;
 
   // reading the configuration registry to know the other bits values
@@ -336,7 +336,7 @@ bool LEGOTMPsetSingleShot(tSensors link) {
  * @return true if no error occured, false if it did
  */
 bool LEGOTMPsetContinuous(tSensors link) {
-  memset(LEGOTMP_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOTMP_I2CData[link].request, 0, sizeof(LEGOTMP_I2CData[link].request));
   ubyte config;
 
   // reading the configuration registry to know the other bits values
@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Added TSreadAllStates() to read all touch sensors on a SMUX at once
  *
  * License: You may use this code as you wish, provided you give credit where its due.
  *
@@ -21,9 +22,10 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 08 December 2009
- * \version 0.1
+ * \version 0.2
  * \example lego-touch-test1.c
  * \example lego-touch-SMUX-test1.c
+ * \example lego-touch-SMUX-test2.c
  */
 
 #pragma systemFile
@@ -37,6 +39,7 @@ bool TSreadState(tSensors link);
 
 #ifdef __HTSMUX_SUPPORT__
 bool TSreadState(tMUXSensor muxsensor);
+ubyte TSreadAllStates(tSensors link);
 #endif
 
 /**
@@ -63,6 +66,26 @@ bool TSreadState(tSensors link) {
 bool TSreadState(tMUXSensor muxsensor) {
   return (HTSMUXreadAnalogue(muxsensor) < 500) ? true : false;
 }
+
+/**
+ * Read the state of the touch sensors on all four channels of a SMUX
+ * with a single I2C transaction.
+ * @param link the SMUX port number
+ * @return a bitmask, bit 0 is set when the sensor on channel 1 is pressed, bit 1 for channel 2, etc.
+ */
+ubyte TSreadAllStates(tSensors link) {
+  tHTSMUXAnalogue values;
+  ubyte states = 0;
+
+  if (!HTSMUXreadAllAnalogue(link, values))
+    return 0;
+
+  for (short i = 0; i < 4; i++)
+    if (values[i] < 500)
+      states |= (1 << i);
+
+  return states;
+}
 #endif
 
 #endif // __LEGOTS_H__
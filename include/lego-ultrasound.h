@@ -19,10 +19,12 @@
  * Changelog:
  * - 0.1: Initial release
  * - 0.2: Added support for additional commands
+ * - 0.3: Request and reply buffers are now kept per port in LEGOUS_I2CData[]
+ * - 0.4: Use HTSMUXensureConfig() so a SMUX channel is only configured once
  *
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 10 December 2010
- * \version 0.2
+ * \version 0.4
  * \example lego-ultrasound-SMUX-test1.c
  */
 
@@ -58,8 +60,7 @@ short USreadDist(tMUXSensor muxsensor);
 tConfigParams LEGOUS_config = {HTSMUX_CHAN_I2C + HTSMUX_CHAN_9V + HTSMUX_CHAN_I2C_SLOW, 1, 0x02, 0x42}; /*!< Array to hold SMUX config data for sensor */
 #endif // __HTSMUX_SUPPORT__
 
-tByteArray LEGOUS_I2CRequest;
-tByteArray LEGOUS_I2CReply;
+tI2CData LEGOUS_I2CData[4]; /*!< Per-port I2C request and reply buffers */
 
 /**
  * Get the distance value from the sensor
@@ -69,14 +70,13 @@ tByteArray LEGOUS_I2CReply;
 #ifdef __HTSMUX_SUPPORT__
 short USreadDist(tMUXSensor muxsensor) {
 
-  if (HTSMUXSensorTypes[muxsensor] != HTSMUXSensorCustom)
-    HTSMUXconfigChannel(muxsensor, LEGOUS_config);
+  HTSMUXensureConfig(muxsensor, LEGOUS_config);
 
-  if (!HTSMUXreadPort(muxsensor, LEGOUS_I2CReply, 1, 0)) {
+  if (!HTSMUXreadPort(muxsensor, LEGOUS_I2CData[SPORT(muxsensor)].reply, 1, 0)) {
     return 255;
   }
 
-  return (short)LEGOUS_I2CReply[0];
+  return (short)LEGOUS_I2CData[SPORT(muxsensor)].reply[0];
 }
 #endif
 
@@ -86,16 +86,16 @@ short USreadDist(tMUXSensor muxsensor) {
  * @return distance from the sensor or 255 if no valid range has been specified.
  */
 short USreadDist(tSensors link) {
-  memset(LEGOUS_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOUS_I2CData[link].request, 0, sizeof(LEGOUS_I2CData[link].request));
 
-  LEGOUS_I2CRequest[0] = 2;                // Message size
-  LEGOUS_I2CRequest[1] = LEGOUS_I2C_ADDR;  // I2C Address
-  LEGOUS_I2CRequest[2] = LEGOUS_REG_DATA;  // Start direction register
+  LEGOUS_I2CData[link].request[0] = 2;                // Message size
+  LEGOUS_I2CData[link].request[1] = LEGOUS_I2C_ADDR;  // I2C Address
+  LEGOUS_I2CData[link].request[2] = LEGOUS_REG_DATA;  // Start direction register
 
-  if (!writeI2C(link, LEGOUS_I2CRequest, LEGOUS_I2CReply, 1))
+  if (!writeI2C(link, LEGOUS_I2CData[link].request, LEGOUS_I2CData[link].reply, 1))
     return -1;
 
-  return LEGOUS_I2CReply[0];
+  return LEGOUS_I2CData[link].reply[0];
 }
 
 /**
@@ -106,16 +106,16 @@ short USreadDist(tSensors link) {
  * @return distance from the sensor or 255 if no valid range has been specified.
  */
 bool USreadDistances(tSensors link, tByteArray &distances) {
-  memset(LEGOUS_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOUS_I2CData[link].request, 0, sizeof(LEGOUS_I2CData[link].request));
 
-  LEGOUS_I2CRequest[0] = 2;                // Message size
-  LEGOUS_I2CRequest[1] = LEGOUS_I2C_ADDR;  // I2C Address
-  LEGOUS_I2CRequest[2] = LEGOUS_REG_DATA;  // Start direction register
+  LEGOUS_I2CData[link].request[0] = 2;                // Message size
+  LEGOUS_I2CData[link].request[1] = LEGOUS_I2C_ADDR;  // I2C Address
+  LEGOUS_I2CData[link].request[2] = LEGOUS_REG_DATA;  // Start direction register
 
-  if (!writeI2C(link, LEGOUS_I2CRequest, LEGOUS_I2CReply, 8))
+  if (!writeI2C(link, LEGOUS_I2CData[link].request, LEGOUS_I2CData[link].reply, 8))
     return false;
 
-  memcpy(distances, LEGOUS_I2CReply, sizeof(tByteArray));
+  memcpy(distances, LEGOUS_I2CData[link].reply, sizeof(LEGOUS_I2CData[link].reply));
   return true;
 }
 
@@ -128,14 +128,14 @@ bool USreadDistances(tSensors link, tByteArray &distances) {
  * @return true if no error occured, false if it did
  */
 bool _USsendCmd(tSensors link, ubyte command) {
-  memset(LEGOUS_I2CRequest, 0, sizeof(tByteArray));
+  memset(LEGOUS_I2CData[link].request, 0, sizeof(LEGOUS_I2CData[link].request));
 
-  LEGOUS_I2CRequest[0] = 3;                // Message size
-  LEGOUS_I2CRequest[1] = LEGOUS_I2C_ADDR;  // I2C Address
-  LEGOUS_I2CRequest[2] = LEGOUS_REG_CMD;   // command register
-  LEGOUS_I2CRequest[3] = command;          // command
+  LEGOUS_I2CData[link].request[0] = 3;                // Message size
+  LEGOUS_I2CData[link].request[1] = LEGOUS_I2C_ADDR;  // I2C Address
+  LEGOUS_I2CData[link].request[2] = LEGOUS_REG_CMD;   // command register
+  LEGOUS_I2CData[link].request[3] = command;          // command
 
-  return writeI2C(link, LEGOUS_I2CRequest);
+  return writeI2C(link, LEGOUS_I2CData[link].request);
 }
 
 /**
@@ -0,0 +1,87 @@
+/*!@addtogroup other
+ * @{
+ * @defgroup fixed Fixed Point Library
+ * Fixed Point Library
+ * @{
+ */
+
+#ifndef __MATH_FIXED_H__
+#define __MATH_FIXED_H__
+/** \file math-fixed.h
+ * \brief Q16.16 fixed point numbers and the inertial sensor value type
+ *
+ * math-fixed.h provides Q16.16 fixed point numbers, stored in a long.  The upper
+ * 16 bits are the whole part, the lower 16 bits the fraction.\n
+ * The NXT has no FPU, every float operation is done in software.  The inertial
+ * drivers (dexterind-imu.h, hitechnic-gyro.h) keep their rates, accelerations and
+ * offsets in a tInertial.  That's a float by default.  Define __INERTIAL_FIXED__
+ * as 1 before including the drivers to make it a Q16.16 long.  The drivers then
+ * scale raw readings with integer math only.  Functions that return a float
+ * convert the value at the very end.  Struct members and sample blocks stay
+ * in Q16.16, turn them into floats with inertialToFloat() where needed.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ *
+ * Changelog:
+ * - 0.1: Initial release
+ * - 0.2: Added fix16Mul() and inertialMul()
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.2
+ */
+
+#pragma systemFile
+
+/*!< define this as 1 to keep inertial sensor values in Q16.16 fixed point instead of float */
+#ifndef __INERTIAL_FIXED__
+#define __INERTIAL_FIXED__ 0
+#endif
+
+#define FIX16_ONE             65536   /*!< 1.0 in Q16.16 */
+
+#define fix16FromInt(i)       ((long)(i) << 16)                                     /*!< Convert an integer to Q16.16 */
+#define fix16FromFloat(f)     ((long)(((f) * 65536.0) + (((f) < 0) ? -0.5 : 0.5)))  /*!< Convert a float to Q16.16, rounded */
+#define fix16ToFloat(x)       ((x) / 65536.0)                                       /*!< Convert a Q16.16 number to a float */
+#define fix16ToInt(x)         ((x) >> 16)                                           /*!< Convert a Q16.16 number to an integer, rounded down */
+#define fix16FromRatio(n, d)  (fix16FromInt((n) / (d)) + (fix16FromInt((n) % (d)) / (d)))  /*!< Q16.16 value of n / d, without overflowing for large n */
+
+/**
+ * Multiply two Q16.16 numbers.  The halves are multiplied separately, so the
+ * intermediate results fit in a long.  The result must fit in Q16.16.
+ * @param a the first number
+ * @param b the second number
+ * @return a times b
+ */
+long fix16Mul(long a, long b) {
+  long ah = a >> 16;
+  long al = a & 0xFFFF;
+  long bh = b >> 16;
+  long bl = b & 0xFFFF;
+
+  // The two low halves lose a bit each to stay clear of the sign bit
+  return ((ah * bh) << 16) + (ah * bl) + (al * bh) + (((al >> 1) * (bl >> 1)) >> 14);
+}
+
+#if (__INERTIAL_FIXED__ == 1)
+typedef long tInertial;                                               /*!< Inertial sensor value, Q16.16 */
+#define inertialFromInt(i)        fix16FromInt(i)                     /*!< Convert an integer to a tInertial */
+#define inertialFromFloat(f)      fix16FromFloat(f)                   /*!< Convert a float to a tInertial */
+#define inertialToFloat(x)        fix16ToFloat(x)                     /*!< Convert a tInertial to a float */
+#define inertialFromRatio(n, d)   fix16FromRatio(n, d)                /*!< tInertial value of n / d */
+#define inertialMul(a, b)         fix16Mul(a, b)                      /*!< Multiply two tInertials */
+#else
+typedef float tInertial;                                              /*!< Inertial sensor value, float */
+#define inertialFromInt(i)        ((float)(i))                        /*!< Convert an integer to a tInertial */
+#define inertialFromFloat(f)      (f)                                 /*!< Convert a float to a tInertial */
+#define inertialToFloat(x)        (x)                                 /*!< Convert a tInertial to a float */
+#define inertialFromRatio(n, d)   ((float)(n) / (d))                  /*!< tInertial value of n / d */
+#define inertialMul(a, b)         ((a) * (b))                         /*!< Multiply two tInertials */
+#endif
+
+#endif // __MATH_FIXED_H__
+
+/* @} */
+/* @} */
@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MICC_I2CData[]
  *
  * Credits:
  * - Big thanks to MicroInfinity for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 29 May 2011
- * \version 0.1
+ * \version 0.2
  * \example microinfinity-cruizcore-test1.c
  * \example microinfinity-cruizcore-test2.c
  */
@@ -60,8 +61,7 @@ bool MICCsendCmd(tSensors link, ubyte command);
 #define MICCsetRange8G(x) MICCsendCmd(x, MICC_CMD_RANGE_8G) /*!< Macro for setting sensor to 8G range */
 #define MICCreset(x)      MICCsendCmd(x, MICC_CMD_RESET)    /*!< Macro for resetting sensor */
 
-tByteArray MICC_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray MICC_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData MICC_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 /**
  * Return the current relative heading, value between -179 and 180 degrees.<br>
@@ -69,17 +69,17 @@ tByteArray MICC_I2CReply;         /*!< Array to hold I2C reply data */
  * @return the relative heading
  */
 short MICCreadRelativeHeading(tSensors link) {
-  memset(MICC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MICC_I2CData[link].request, 0, sizeof(MICC_I2CData[link].request));
 
-  MICC_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MICC_I2CRequest[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
-  MICC_I2CRequest[2] = MICC_ACC_ANG;    // Set write address to sensor mode register
+  MICC_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MICC_I2CData[link].request[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
+  MICC_I2CData[link].request[2] = MICC_ACC_ANG;    // Set write address to sensor mode register
 
-  if (!writeI2C(link, MICC_I2CRequest, MICC_I2CReply, 2))
+  if (!writeI2C(link, MICC_I2CData[link].request, MICC_I2CData[link].reply, 2))
     return 0;
 
   // Each result is made up of two bytes.
-  return (MICC_I2CReply[1] << 8) + MICC_I2CReply[0];
+  return (MICC_I2CData[link].reply[1] << 8) + MICC_I2CData[link].reply[0];
 }
 
 /**
@@ -87,17 +87,17 @@ short MICCreadRelativeHeading(tSensors link) {
  * @return the current rate of turn
  */
 short MICCreadTurnRate(tSensors link) {
-  memset(MICC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MICC_I2CData[link].request, 0, sizeof(MICC_I2CData[link].request));
 
-  MICC_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MICC_I2CRequest[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
-  MICC_I2CRequest[2] = MICC_TURN_RATE;    // Set write address to sensor mode register
+  MICC_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MICC_I2CData[link].request[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
+  MICC_I2CData[link].request[2] = MICC_TURN_RATE;    // Set write address to sensor mode register
 
-  if (!writeI2C(link, MICC_I2CRequest, MICC_I2CReply, 2))
+  if (!writeI2C(link, MICC_I2CData[link].request, MICC_I2CData[link].reply, 2))
     return 0;
 
   // Each result is made up of two bytes.
-  return (MICC_I2CReply[1] << 8) + MICC_I2CReply[0];
+  return (MICC_I2CData[link].reply[1] << 8) + MICC_I2CData[link].reply[0];
 }
 
 /**
@@ -109,19 +109,19 @@ short MICCreadTurnRate(tSensors link) {
  * @return true if no error occured, false if it did
  */
 bool MICCreadAccel(tSensors link, short &x_accel, short &y_accel, short &z_accel) {
-  memset(MICC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MICC_I2CData[link].request, 0, sizeof(MICC_I2CData[link].request));
 
-  MICC_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MICC_I2CRequest[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
-  MICC_I2CRequest[2] = MICC_X_ACCEL;    // Set write address to sensor mode register
+  MICC_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MICC_I2CData[link].request[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
+  MICC_I2CData[link].request[2] = MICC_X_ACCEL;    // Set write address to sensor mode register
 
-  if (!writeI2C(link, MICC_I2CRequest, MICC_I2CReply, 6))
+  if (!writeI2C(link, MICC_I2CData[link].request, MICC_I2CData[link].reply, 6))
     return false;
 
   // Each result is made up of two bytes.
-  x_accel = (MICC_I2CReply[1] << 8) + MICC_I2CReply[0];
-  y_accel = (MICC_I2CReply[3] << 8) + MICC_I2CReply[2];
-  z_accel = (MICC_I2CReply[5] << 8) + MICC_I2CReply[4];
+  x_accel = (MICC_I2CData[link].reply[1] << 8) + MICC_I2CData[link].reply[0];
+  y_accel = (MICC_I2CData[link].reply[3] << 8) + MICC_I2CData[link].reply[2];
+  z_accel = (MICC_I2CData[link].reply[5] << 8) + MICC_I2CData[link].reply[4];
   return true;
 }
 
@@ -132,13 +132,13 @@ bool MICCreadAccel(tSensors link, short &x_accel, short &y_accel, short &z_accel
  * @return true if no error occured, false if it did
  */
 bool MICCsendCmd(tSensors link, ubyte command) {
-  memset(MICC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MICC_I2CData[link].request, 0, sizeof(MICC_I2CData[link].request));
 
-  MICC_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MICC_I2CRequest[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
-  MICC_I2CRequest[2] = command;         // Set write address to sensor mode register
+  MICC_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MICC_I2CData[link].request[1] = MICC_I2C_ADDR;   // I2C address of accel sensor
+  MICC_I2CData[link].request[2] = command;         // Set write address to sensor mode register
 
-  return writeI2C(link, MICC_I2CRequest);
+  return writeI2C(link, MICC_I2CData[link].request);
 }
 
 #endif //__MICC_H__
@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in NXTSERVO_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 30 September 2009
- * \version 0.1
+ * \version 0.2
  * \example mindensors-servo-test1.c
  */
 
@@ -82,8 +83,7 @@ bool NXTServoSetPos(tSensors link, ubyte servochan, short position, ubyte speed,
 bool NXTServoQSetPos(tSensors link, ubyte servochan, ubyte position, byte speed, ubyte address = NXTSERVO_I2C_ADDR);
 short NXTServoReadVoltage(tSensors link, ubyte address = NXTSERVO_I2C_ADDR);
 
-tByteArray NXTSERVO_I2CRequest;         /*!< Array to hold I2C command data */
-tByteArray NXTSERVO_I2CReply;           /*!< Array to hold I2C reply data */
+tI2CData NXTSERVO_I2CData[4];           /*!< Per-port I2C request and reply buffers */
 
 /**
  * Set the speed register for the specified servo.  This is the amount to increase
@@ -97,13 +97,13 @@ tByteArray NXTSERVO_I2CReply;           /*!< Array to hold I2C reply data */
  * @return true if no error occured, false if it did
  */
 bool NXTServoSetSpeed(tSensors link, ubyte servochan, ubyte speed, ubyte address) {
-  memset(NXTSERVO_I2CRequest, 0, sizeof(tByteArray));
-  NXTSERVO_I2CRequest[0] = 3;
-  NXTSERVO_I2CRequest[1] = address;
-  NXTSERVO_I2CRequest[2] = NXTSERVO_SPEED_CHAN1 + (servochan - 1);
-  NXTSERVO_I2CRequest[3] = speed;
+  memset(NXTSERVO_I2CData[link].request, 0, sizeof(NXTSERVO_I2CData[link].request));
+  NXTSERVO_I2CData[link].request[0] = 3;
+  NXTSERVO_I2CData[link].request[1] = address;
+  NXTSERVO_I2CData[link].request[2] = NXTSERVO_SPEED_CHAN1 + (servochan - 1);
+  NXTSERVO_I2CData[link].request[3] = speed;
 
-  return writeI2C(link, NXTSERVO_I2CRequest);
+  return writeI2C(link, NXTSERVO_I2CData[link].request);
 }
 
 /**
@@ -116,21 +116,21 @@ bool NXTServoSetSpeed(tSensors link, ubyte servochan, ubyte speed, ubyte address
  * @return true if no error occured, false if it did
  */
 bool NXTServoSetPos(tSensors link, ubyte servochan, short position, ubyte speed, ubyte address) {
-  memset(NXTSERVO_I2CRequest, 0, sizeof(tByteArray));
+  memset(NXTSERVO_I2CData[link].request, 0, sizeof(NXTSERVO_I2CData[link].request));
   if (!NXTServoSetSpeed(link, servochan, speed, address))
     return false;
 
   position = clip(position, 500, 2500);
 
   // set the position register and tell NXTServo to move the servo
-  memset(NXTSERVO_I2CRequest, 0, sizeof(tByteArray));
-  NXTSERVO_I2CRequest[0] = 4;
-  NXTSERVO_I2CRequest[1] = address;
-  NXTSERVO_I2CRequest[2] = NXTSERVO_POS_CHAN1 + ((servochan - 1) * 2);
-  NXTSERVO_I2CRequest[3] = position & 0x00FF;
-  NXTSERVO_I2CRequest[4] = (position >> 8) & 0x00FF;
-
-  return writeI2C(link, NXTSERVO_I2CRequest);
+  memset(NXTSERVO_I2CData[link].request, 0, sizeof(NXTSERVO_I2CData[link].request));
+  NXTSERVO_I2CData[link].request[0] = 4;
+  NXTSERVO_I2CData[link].request[1] = address;
+  NXTSERVO_I2CData[link].request[2] = NXTSERVO_POS_CHAN1 + ((servochan - 1) * 2);
+  NXTSERVO_I2CData[link].request[3] = position & 0x00FF;
+  NXTSERVO_I2CData[link].request[4] = (position >> 8) & 0x00FF;
+
+  return writeI2C(link, NXTSERVO_I2CData[link].request);
 }
 
 /**
@@ -145,7 +145,7 @@ bool NXTServoSetPos(tSensors link, ubyte servochan, short position, ubyte speed,
  * @return true if no error occured, false if it did
  */
 bool NXTServoQSetPos(tSensors link, ubyte servochan, ubyte position, byte speed, ubyte address) {
-  memset(NXTSERVO_I2CRequest, 0, sizeof(tByteArray));
+  memset(NXTSERVO_I2CData[link].request, 0, sizeof(NXTSERVO_I2CData[link].request));
 
   position = clip(position, 50, 250);
 
@@ -154,12 +154,12 @@ bool NXTServoQSetPos(tSensors link, ubyte servochan, ubyte position, byte speed,
 
   // set the position register and tell NXTServo to move the servo
 
-  NXTSERVO_I2CRequest[0] = 3;
-  NXTSERVO_I2CRequest[1] = address;
-  NXTSERVO_I2CRequest[2] = NXTSERVO_QPOS_CHAN1 + (servochan - 1);
-  NXTSERVO_I2CRequest[3] = position;
+  NXTSERVO_I2CData[link].request[0] = 3;
+  NXTSERVO_I2CData[link].request[1] = address;
+  NXTSERVO_I2CData[link].request[2] = NXTSERVO_QPOS_CHAN1 + (servochan - 1);
+  NXTSERVO_I2CData[link].request[3] = position;
 
-  return writeI2C(link, NXTSERVO_I2CRequest);
+  return writeI2C(link, NXTSERVO_I2CData[link].request);
 }
 
 /**
@@ -171,16 +171,16 @@ bool NXTServoQSetPos(tSensors link, ubyte servochan, ubyte position, byte speed,
 short NXTServoReadVoltage(tSensors link, ubyte address) {
   long mvs = 0;
 
-  memset(NXTSERVO_I2CRequest, 0, sizeof(tByteArray));
+  memset(NXTSERVO_I2CData[link].request, 0, sizeof(NXTSERVO_I2CData[link].request));
 
-  NXTSERVO_I2CRequest[0] = 2;                 // Message size
-  NXTSERVO_I2CRequest[1] = address;           // I2C Address
-  NXTSERVO_I2CRequest[2] = NXTSERVO_CMD;      // Start red sensor value
+  NXTSERVO_I2CData[link].request[0] = 2;                 // Message size
+  NXTSERVO_I2CData[link].request[1] = address;           // I2C Address
+  NXTSERVO_I2CData[link].request[2] = NXTSERVO_CMD;      // Start red sensor value
 
-  if (!writeI2C(link, NXTSERVO_I2CRequest, NXTSERVO_I2CReply, 1))
+  if (!writeI2C(link, NXTSERVO_I2CData[link].request, NXTSERVO_I2CData[link].reply, 1))
     return -1;
 
-  mvs = ((long)NXTSERVO_I2CReply[0] * 3886) / 100;
+  mvs = ((long)NXTSERVO_I2CData[link].reply[0] * 3886) / 100;
 
   return mvs;
 }
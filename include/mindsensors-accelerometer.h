@@ -16,6 +16,7 @@
  * - 0.1: Initial release
  * - 0.2: Added defines for ranges (MSAC_RANGE_2_5 ... MSAC_RANGE_10)<br>
  *        Removed ubyteToInt() calls.
+ * - 0.3: Request and reply buffers are now kept per port in MSAC_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -26,7 +27,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 28 November 2009
- * \version 0.2
+ * \version 0.3
  * \example mindsensors-accelerometer-test1.c
  * \example mindsensors-accelerometer-test2.c
  */
@@ -59,8 +60,7 @@ bool MSACreadAccel(tSensors link, short &x_accel, short &y_accel, short &z_accel
 bool MSACsendCmd(tSensors link, byte command);
 bool MSACsetRange(tSensors link, short range);
 
-tByteArray MSAC_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray MSAC_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData MSAC_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 /**
  * Read tilt data from the sensor
@@ -71,18 +71,18 @@ tByteArray MSAC_I2CReply;         /*!< Array to hold I2C reply data */
  * @return true if no error occured, false if it did
  */
 bool MSACreadTilt(tSensors link, short &x_tilt, short &y_tilt, short &z_tilt) {
-  memset(MSAC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSAC_I2CData[link].request, 0, sizeof(MSAC_I2CData[link].request));
 
-  MSAC_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSAC_I2CRequest[1] = MSAC_I2C_ADDR;   // I2C address of accel sensor
-  MSAC_I2CRequest[2] = MSAC_X_TILT;     // Set write address to sensor mode register
+  MSAC_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSAC_I2CData[link].request[1] = MSAC_I2C_ADDR;   // I2C address of accel sensor
+  MSAC_I2CData[link].request[2] = MSAC_X_TILT;     // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSAC_I2CRequest, MSAC_I2CReply, 3))
+  if (!writeI2C(link, MSAC_I2CData[link].request, MSAC_I2CData[link].reply, 3))
     return false;
 
-  x_tilt = MSAC_I2CReply[0] - 128;
-  y_tilt = MSAC_I2CReply[1] - 128;
-  z_tilt = MSAC_I2CReply[2] - 128;
+  x_tilt = MSAC_I2CData[link].reply[0] - 128;
+  y_tilt = MSAC_I2CData[link].reply[1] - 128;
+  z_tilt = MSAC_I2CData[link].reply[2] - 128;
 
   return true;
 }
@@ -96,19 +96,19 @@ bool MSACreadTilt(tSensors link, short &x_tilt, short &y_tilt, short &z_tilt) {
  * @return true if no error occured, false if it did
  */
 bool MSACreadAccel(tSensors link, short &x_accel, short &y_accel, short &z_accel) {
-  memset(MSAC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSAC_I2CData[link].request, 0, sizeof(MSAC_I2CData[link].request));
 
-  MSAC_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSAC_I2CRequest[1] = MSAC_I2C_ADDR;   // I2C address of accel sensor
-  MSAC_I2CRequest[2] = MSAC_X_ACCEL;    // Set write address to sensor mode register
+  MSAC_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSAC_I2CData[link].request[1] = MSAC_I2C_ADDR;   // I2C address of accel sensor
+  MSAC_I2CData[link].request[2] = MSAC_X_ACCEL;    // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSAC_I2CRequest, MSAC_I2CReply, 6))
+  if (!writeI2C(link, MSAC_I2CData[link].request, MSAC_I2CData[link].reply, 6))
     return false;
 
   // Each result is made up of two bytes.
-  x_accel = MSAC_I2CReply[0] + (MSAC_I2CReply[1] << 8);
-  y_accel = MSAC_I2CReply[2] + (MSAC_I2CReply[3] << 8);
-  z_accel = MSAC_I2CReply[4] + (MSAC_I2CReply[5] << 8);
+  x_accel = MSAC_I2CData[link].reply[0] + (MSAC_I2CData[link].reply[1] << 8);
+  y_accel = MSAC_I2CData[link].reply[2] + (MSAC_I2CData[link].reply[3] << 8);
+  z_accel = MSAC_I2CData[link].reply[4] + (MSAC_I2CData[link].reply[5] << 8);
   return true;
 }
 
@@ -119,14 +119,14 @@ bool MSACreadAccel(tSensors link, short &x_accel, short &y_accel, short &z_accel
  * @return true if no error occured, false if it did
  */
 bool MSACsendCmd(tSensors link, byte command) {
-  memset(MSAC_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSAC_I2CData[link].request, 0, sizeof(MSAC_I2CData[link].request));
 
-  MSAC_I2CRequest[0] = 3;               // Number of bytes in I2C command
-  MSAC_I2CRequest[1] = MSAC_I2C_ADDR;   // I2C address of accel sensor
-  MSAC_I2CRequest[2] = MSAC_CMD;        // Set write address to sensor mode register
-  MSAC_I2CRequest[3] = command;         // Command to be sent to the sensor
+  MSAC_I2CData[link].request[0] = 3;               // Number of bytes in I2C command
+  MSAC_I2CData[link].request[1] = MSAC_I2C_ADDR;   // I2C address of accel sensor
+  MSAC_I2CData[link].request[2] = MSAC_CMD;        // Set write address to sensor mode register
+  MSAC_I2CData[link].request[3] = command;         // Command to be sent to the sensor
 
-  return writeI2C(link, MSAC_I2CRequest);
+  return writeI2C(link, MSAC_I2CData[link].request);
 }
 
 /**
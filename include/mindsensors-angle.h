@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSANG_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 20 February 2011
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-angle-test1.c
  */
 
@@ -51,8 +52,7 @@ short MSANGreadRPM(tSensors link);
 long MSANGreadRaw(tSensors link);
 bool MSANGresetAngle(tSensors link);
 
-tByteArray MSANG_I2CRequest;             /*!< Array to hold I2C command data */
-tByteArray MSANG_I2CReply;               /*!< Array to hold I2C reply data */
+tI2CData MSANG_I2CData[4];               /*!< Per-port I2C request and reply buffers */
 
 /**
  * Return the current angle
@@ -60,16 +60,16 @@ tByteArray MSANG_I2CReply;               /*!< Array to hold I2C reply data */
  * @return current angle or -1 if an error occurred.
  */
 long MSANGreadAngle(tSensors link) {
-  memset(MSANG_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSANG_I2CData[link].request, 0, sizeof(MSANG_I2CData[link].request));
 
-  MSANG_I2CRequest[0] = 2;                         // Message size
-  MSANG_I2CRequest[1] = MSANG_I2C_ADDR;            // I2C Address
-  MSANG_I2CRequest[2] = MSANG_OFFSET + MSANG_ANG; // Start Current angle
+  MSANG_I2CData[link].request[0] = 2;                         // Message size
+  MSANG_I2CData[link].request[1] = MSANG_I2C_ADDR;            // I2C Address
+  MSANG_I2CData[link].request[2] = MSANG_OFFSET + MSANG_ANG; // Start Current angle
 
-  if (!writeI2C(link, MSANG_I2CRequest, MSANG_I2CReply, 4))
+  if (!writeI2C(link, MSANG_I2CData[link].request, MSANG_I2CData[link].reply, 4))
     return -1;
 
-  return MSANG_I2CReply[0] + (MSANG_I2CReply[1] << 8) + (MSANG_I2CReply[2] << 16) + (MSANG_I2CReply[3] << 24);
+  return MSANG_I2CData[link].reply[0] + (MSANG_I2CData[link].reply[1] << 8) + (MSANG_I2CData[link].reply[2] << 16) + (MSANG_I2CData[link].reply[3] << 24);
 }
 
 /**
@@ -78,16 +78,16 @@ long MSANGreadAngle(tSensors link) {
  * @return current raw value or -1 if an error occurred.
  */
 long MSANGreadRaw(tSensors link) {
-  memset(MSANG_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSANG_I2CData[link].request, 0, sizeof(MSANG_I2CData[link].request));
 
-  MSANG_I2CRequest[0] = 2;                         // Message size
-  MSANG_I2CRequest[1] = MSANG_I2C_ADDR;            // I2C Address
-  MSANG_I2CRequest[2] = MSANG_OFFSET + MSANG_RAW; // Start Current angle
+  MSANG_I2CData[link].request[0] = 2;                         // Message size
+  MSANG_I2CData[link].request[1] = MSANG_I2C_ADDR;            // I2C Address
+  MSANG_I2CData[link].request[2] = MSANG_OFFSET + MSANG_RAW; // Start Current angle
 
-  if (!writeI2C(link, MSANG_I2CRequest, MSANG_I2CReply, 4))
+  if (!writeI2C(link, MSANG_I2CData[link].request, MSANG_I2CData[link].reply, 4))
     return -1;
 
-  return MSANG_I2CReply[0] + (MSANG_I2CReply[1] << 8) + (MSANG_I2CReply[2] << 16) + (MSANG_I2CReply[3] << 24);
+  return MSANG_I2CData[link].reply[0] + (MSANG_I2CData[link].reply[1] << 8) + (MSANG_I2CData[link].reply[2] << 16) + (MSANG_I2CData[link].reply[3] << 24);
 }
 
 /**
@@ -96,16 +96,16 @@ long MSANGreadRaw(tSensors link) {
  * @return the current rpm of the shaft or -1 if an error occurred.
  */
 short MSANGreadRPM(tSensors link) {
-  memset(MSANG_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSANG_I2CData[link].request, 0, sizeof(MSANG_I2CData[link].request));
 
-  MSANG_I2CRequest[0] = 2;                           // Message size
-  MSANG_I2CRequest[1] = MSANG_I2C_ADDR;              // I2C Address
-  MSANG_I2CRequest[2] = MSANG_OFFSET + MSANG_RPM;    // Start of rpm
+  MSANG_I2CData[link].request[0] = 2;                           // Message size
+  MSANG_I2CData[link].request[1] = MSANG_I2C_ADDR;              // I2C Address
+  MSANG_I2CData[link].request[2] = MSANG_OFFSET + MSANG_RPM;    // Start of rpm
 
-  if (!writeI2C(link, MSANG_I2CRequest, MSANG_I2CReply, 2))
+  if (!writeI2C(link, MSANG_I2CData[link].request, MSANG_I2CData[link].reply, 2))
     return -1;
 
-  return (MSANG_I2CReply[1] <<  8) + MSANG_I2CReply[0];
+  return (MSANG_I2CData[link].reply[1] <<  8) + MSANG_I2CData[link].reply[0];
 }
 
 /**
@@ -114,14 +114,14 @@ short MSANGreadRPM(tSensors link) {
  * @return true if no error occured, false if it did
  */
 bool MSANGresetAngle(tSensors link) {
-  memset(MSANG_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSANG_I2CData[link].request, 0, sizeof(MSANG_I2CData[link].request));
 
-  MSANG_I2CRequest[0] = 3;                 // Message size
-  MSANG_I2CRequest[1] = MSANG_I2C_ADDR;    // I2C Address
-  MSANG_I2CRequest[2] = MSANG_CMD_REG;     // Command register
-  MSANG_I2CRequest[3] = MSANG_CMD_RST_ANG; // Command to be sent
+  MSANG_I2CData[link].request[0] = 3;                 // Message size
+  MSANG_I2CData[link].request[1] = MSANG_I2C_ADDR;    // I2C Address
+  MSANG_I2CData[link].request[2] = MSANG_CMD_REG;     // Command register
+  MSANG_I2CData[link].request[3] = MSANG_CMD_RST_ANG; // Command to be sent
 
-  return writeI2C(link, MSANG_I2CRequest);
+  return writeI2C(link, MSANG_I2CData[link].request);
 }
 
 #endif // __MSANG_H__
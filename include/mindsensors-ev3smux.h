@@ -14,6 +14,10 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Added tMSEV3SMUX to set up all three channels with a single port check and settle delay<br>
+ *        Added MSEV3readAll() to read all three channels back-to-back<br>
+ *        The read request is built once by initSensor() instead of on every read<br>
+ *        initSensor() now clears the whole struct
  *
  *
  * Credits:
@@ -25,9 +29,9 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 14 December 2014
- * \version 0.1
- * \example mindsensors-ev3smux-test1.c
+ * \version 0.2
  * \example mindsensors-ev3smux-test1.c
+ * \example mindsensors-ev3smux-test2.c
  */
 
 // #pragma systemFile
@@ -57,6 +61,7 @@ typedef enum tEV3SensorTypeMode
 	sonarInches         = 0x31,   /*!< measurements in inches */
 	sonarPresence       = 0x32,   /*!< for presence detection mode */
 	touchStateBump			= 0x4F,		/*!< pressed (1) or not pressed (0) */
+	noSensor            = 0xFF,   /*!< nothing attached to this channel, only for tMSEV3SMUX */
 } tEV3SensorTypeMode;
 
 typedef struct
@@ -77,30 +82,42 @@ typedef struct
   ubyte _cmd;
 } tMSEV3, *tMSEV3Ptr;
 
+/*!< Struct to hold all three channels of a SMUX */
+typedef struct
+{
+  tMSEV3 chan[3];         /*!< The data of each channel */
+  tSensors port;          /*!< The port the SMUX is attached to */
+  ubyte active;           /*!< Bitmask of the channels that have a sensor attached */
+} tMSEV3SMUX, *tMSEV3SMUXPtr;
+
 bool initSensor(tMSEV3Ptr msev3Ptr, tMUXSensor muxsensor, tEV3SensorTypeMode typeMode);
+bool initSensor(tMSEV3SMUXPtr smuxPtr, tSensors port, tEV3SensorTypeMode typeMode1, tEV3SensorTypeMode typeMode2, tEV3SensorTypeMode typeMode3);
 bool readSensor(tMSEV3Ptr msev3Ptr);
+bool MSEV3readAll(tMSEV3SMUXPtr smuxPtr);
 bool _sensorSendCommand(tMSEV3Ptr msev3Ptr);
 
 /**
- * Initialise the sensor's data struct and port
+ * Set up a channel's data struct and its read request, without touching the port.
  *
+ * Note: this is an internal function and should not be called directly.
  * @param msev3Ptr pointer to the sensor's data struct
- * @param port the sensor port
+ * @param muxsensor the SMUX sensor port number
+ * @param typeMode the type and mode of the sensor
  * @return true if no error occured, false if it did
  */
-bool initSensor(tMSEV3Ptr msev3Ptr, tMUXSensor muxsensor, tEV3SensorTypeMode typeMode)
+bool _MSEV3initChannel(tMSEV3Ptr msev3Ptr, tMUXSensor muxsensor, tEV3SensorTypeMode typeMode)
 {
-	memset(msev3Ptr, 0, sizeof(tMSEV3Ptr));
-
-	switch (MPORT(muxsensor))
-	{
-		case 0: msev3Ptr->I2CData.address = MSEV3_I2C_ADDR_CHAN1; break;
-		case 1: msev3Ptr->I2CData.address = MSEV3_I2C_ADDR_CHAN2; break;
-		case 2: msev3Ptr->I2CData.address = MSEV3_I2C_ADDR_CHAN3; break;
-		default: return false; // There are only 3 ports on the SMUX
-	}
+  memset(msev3Ptr, 0, sizeof(tMSEV3));
+
+  switch (MPORT(muxsensor))
+  {
+    case 0: msev3Ptr->I2CData.address = MSEV3_I2C_ADDR_CHAN1; break;
+    case 1: msev3Ptr->I2CData.address = MSEV3_I2C_ADDR_CHAN2; break;
+    case 2: msev3Ptr->I2CData.address = MSEV3_I2C_ADDR_CHAN3; break;
+    default: return false; // There are only 3 ports on the SMUX
+  }
 
-	msev3Ptr->typeMode = typeMode;
+  msev3Ptr->typeMode = typeMode;
   msev3Ptr->I2CData.port = (tSensors)SPORT(muxsensor);
 #if defined(NXT)
   msev3Ptr->I2CData.type = sensorI2CCustom;
@@ -109,6 +126,18 @@ bool initSensor(tMSEV3Ptr msev3Ptr, tMUXSensor muxsensor, tEV3SensorTypeMode typ
 #endif
   msev3Ptr->_cmd = (ubyte)msev3Ptr->typeMode & 0x0F;
 
+  return true;
+}
+
+/**
+ * Make sure the port is configured for the SMUX.  If it has to be
+ * reconfigured, the SMUX is given a second to settle.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param msev3Ptr pointer to the data struct of one of the SMUX's channels
+ */
+void _MSEV3checkPort(tMSEV3Ptr msev3Ptr)
+{
   // Ensure the sensor is configured correctly
   if (SensorType[msev3Ptr->I2CData.port] != msev3Ptr->I2CData.type)
   {
@@ -116,18 +145,16 @@ bool initSensor(tMSEV3Ptr msev3Ptr, tMUXSensor muxsensor, tEV3SensorTypeMode typ
     SensorType[msev3Ptr->I2CData.port] = msev3Ptr->I2CData.type;
     sleep(1000);
   }
-
-  return _sensorSendCommand(msev3Ptr);
-  //return true;
 }
 
 /**
- * Read all the sensor's data
+ * Build the request that reads the sensor's data.  Only the number of
+ * bytes the sensor's mode needs is requested.
  *
+ * Note: this is an internal function and should not be called directly.
  * @param msev3Ptr pointer to the sensor's data struct
- * @return true if no error occured, false if it did
  */
-bool readSensor(tMSEV3Ptr msev3Ptr)
+void _MSEV3prepareRead(tMSEV3Ptr msev3Ptr)
 {
   memset(msev3Ptr->I2CData.request, 0, sizeof(msev3Ptr->I2CData.request));
 
@@ -165,12 +192,17 @@ bool readSensor(tMSEV3Ptr msev3Ptr)
   msev3Ptr->I2CData.request[1] = msev3Ptr->I2CData.address; // I2C Address
   msev3Ptr->I2CData.request[2] = MSEV3_DATA_REG;
   msev3Ptr->I2CData.requestLen = 2;
+}
 
-  if (!writeI2C(&msev3Ptr->I2CData))
-  {
-    return false;
-  }
-
+/**
+ * Decode the reply of a read according to the sensor's type and mode.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param msev3Ptr pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool _MSEV3decode(tMSEV3Ptr msev3Ptr)
+{
  	switch(msev3Ptr->typeMode)
  	{
  		case touchStateBump:
@@ -225,6 +257,135 @@ bool readSensor(tMSEV3Ptr msev3Ptr)
   return true;
 }
 
+/**
+ * Initialise the sensor's data struct and port
+ *
+ * @param msev3Ptr pointer to the sensor's data struct
+ * @param port the sensor port
+ * @return true if no error occured, false if it did
+ */
+bool initSensor(tMSEV3Ptr msev3Ptr, tMUXSensor muxsensor, tEV3SensorTypeMode typeMode)
+{
+  if (!_MSEV3initChannel(msev3Ptr, muxsensor, typeMode))
+    return false;
+
+  _MSEV3checkPort(msev3Ptr);
+
+  return _sensorSendCommand(msev3Ptr);
+  //return true;
+}
+
+/**
+ * Initialise the data structs of all three channels of a SMUX.  The port
+ * is checked, and if needed reconfigured, only once.  Use noSensor for
+ * channels that have nothing attached.
+ *
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @param port the port the SMUX is attached to
+ * @param typeMode1 the type and mode of the sensor on channel 1
+ * @param typeMode2 the type and mode of the sensor on channel 2
+ * @param typeMode3 the type and mode of the sensor on channel 3
+ * @return true if no error occured, false if it did
+ */
+bool initSensor(tMSEV3SMUXPtr smuxPtr, tSensors port, tEV3SensorTypeMode typeMode1, tEV3SensorTypeMode typeMode2, tEV3SensorTypeMode typeMode3)
+{
+  tEV3SensorTypeMode typeModes[3];
+  bool retVal = true;
+
+  typeModes[0] = typeMode1;
+  typeModes[1] = typeMode2;
+  typeModes[2] = typeMode3;
+
+  smuxPtr->port = port;
+  smuxPtr->active = 0;
+
+  for (short i = 0; i < 3; i++)
+  {
+    _MSEV3initChannel(&smuxPtr->chan[i], (tMUXSensor)((port * 4) + i), typeModes[i]);
+    if (typeModes[i] != noSensor)
+      smuxPtr->active |= (1 << i);
+  }
+
+  // One port check and settle delay for the whole SMUX
+  _MSEV3checkPort(&smuxPtr->chan[0]);
+
+  for (short i = 0; i < 3; i++)
+  {
+    if ((smuxPtr->active & (1 << i)) == 0)
+      continue;
+    if (!_sensorSendCommand(&smuxPtr->chan[i]))
+      retVal = false;
+  }
+
+  return retVal;
+}
+
+/**
+ * Read all the sensor's data
+ *
+ * @param msev3Ptr pointer to the sensor's data struct
+ * @return true if no error occured, false if it did
+ */
+bool readSensor(tMSEV3Ptr msev3Ptr)
+{
+  if (!writeI2C(&msev3Ptr->I2CData))
+  {
+    return false;
+  }
+
+  return _MSEV3decode(msev3Ptr);
+}
+
+/**
+ * Read the data of all the channels of a SMUX that have a sensor attached.
+ * The reads are sent back-to-back, each channel's reply is decoded while
+ * the read of the next channel is on the bus.
+ *
+ * @param smuxPtr pointer to the SMUX's data struct
+ * @return true if no error occured, false if it did
+ */
+bool MSEV3readAll(tMSEV3SMUXPtr smuxPtr)
+{
+  bool retVal = true;
+  short next;
+  bool pending = false;
+
+  for (short i = 0; i < 3; i++)
+  {
+    if ((smuxPtr->active & (1 << i)) == 0)
+      continue;
+
+    if (!pending)
+    {
+      if (!startI2C(&smuxPtr->chan[i].I2CData))
+      {
+        retVal = false;
+        continue;
+      }
+    }
+
+    if (!collectI2C(&smuxPtr->chan[i].I2CData))
+    {
+      retVal = false;
+      pending = false;
+      continue;
+    }
+
+    // Get the next read going before this one is decoded
+    pending = false;
+    for (next = i + 1; next < 3; next++)
+      if ((smuxPtr->active & (1 << next)) != 0)
+        break;
+    if (next < 3)
+      pending = startI2C(&smuxPtr->chan[next].I2CData);
+
+    if (!_MSEV3decode(&smuxPtr->chan[i]))
+      retVal = false;
+  }
+
+  return retVal;
+}
+
 
 /**
  * Send a command to the sensor
@@ -242,9 +403,14 @@ bool _sensorSendCommand(tMSEV3Ptr msev3Ptr) {
   msev3Ptr->I2CData.request[1] = msev3Ptr->I2CData.address; // I2C Address
   msev3Ptr->I2CData.request[2] = MSEV3_CMD_REG;  						// Command register
   msev3Ptr->I2CData.request[3] = msev3Ptr->_cmd;  					// Command to be sent
+  msev3Ptr->I2CData.requestLen = 3;
+  msev3Ptr->I2CData.replyLen = 0;
 
   retVal = writeI2C(&msev3Ptr->I2CData);
 
+  // Put the read request back in place
+  _MSEV3prepareRead(msev3Ptr);
+
   return retVal;
 }
 
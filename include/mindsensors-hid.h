@@ -14,6 +14,7 @@
  * - 0.1: Initial release
  * - 0.2: Allow I2C address to be specified as an optional argument\n
  *        Added prototypes
+ * - 0.3: Request and reply buffers are now kept per port in MSHID_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 18 December 2010
- * \version 0.2
+ * \version 0.3
  * \example mindsensors-hid-test1.c
  */
 
@@ -61,7 +62,7 @@ bool MSHIDsendCommand(tSensors link, byte command, ubyte address = MSHID_I2C_ADD
 bool MSHIDsendKeyboardData(tSensors link, byte modifier, byte keybdata, ubyte address = MSHID_I2C_ADDR);
 bool MSHIDsendString(tSensors link, string data, ubyte address = MSHID_I2C_ADDR);
 
-tByteArray MSHID_I2CRequest;       /*!< Array to hold I2C command data */
+tI2CData MSHID_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 /**
  * Send a direct command to the HID sensor
@@ -71,13 +72,13 @@ tByteArray MSHID_I2CRequest;       /*!< Array to hold I2C command data */
  * @return true if no error occured, false if it did
  */
 bool MSHIDsendCommand(tSensors link, byte command, ubyte address) {
-  memset(MSHID_I2CRequest, 0, sizeof(tByteArray));
-  MSHID_I2CRequest[0] = 3;
-  MSHID_I2CRequest[1] = address;
-  MSHID_I2CRequest[2] = MSHID_CMD;
-  MSHID_I2CRequest[3] = command;
+  memset(MSHID_I2CData[link].request, 0, sizeof(MSHID_I2CData[link].request));
+  MSHID_I2CData[link].request[0] = 3;
+  MSHID_I2CData[link].request[1] = address;
+  MSHID_I2CData[link].request[2] = MSHID_CMD;
+  MSHID_I2CData[link].request[3] = command;
 
-  return writeI2C(link, MSHID_I2CRequest);
+  return writeI2C(link, MSHID_I2CData[link].request);
 }
 
 /**
@@ -90,14 +91,14 @@ bool MSHIDsendCommand(tSensors link, byte command, ubyte address) {
  * @return true if no error occured, false if it did
  */
 bool MSHIDsendKeyboardData(tSensors link, byte modifier, byte keybdata, ubyte address) {
-  memset(MSHID_I2CRequest, 0, sizeof(tByteArray));
-  MSHID_I2CRequest[0] = 4;
-  MSHID_I2CRequest[1] = address;
-  MSHID_I2CRequest[2] = MSHID_KEYBMOD;
-  MSHID_I2CRequest[3] = modifier;
-  MSHID_I2CRequest[4] = keybdata;
-
-  return writeI2C(link, MSHID_I2CRequest);
+  memset(MSHID_I2CData[link].request, 0, sizeof(MSHID_I2CData[link].request));
+  MSHID_I2CData[link].request[0] = 4;
+  MSHID_I2CData[link].request[1] = address;
+  MSHID_I2CData[link].request[2] = MSHID_KEYBMOD;
+  MSHID_I2CData[link].request[3] = modifier;
+  MSHID_I2CData[link].request[4] = keybdata;
+
+  return writeI2C(link, MSHID_I2CData[link].request);
 }
 
 /**
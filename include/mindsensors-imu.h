@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSIMU_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 23 August 2012
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-imu-test1.c
  * \example mindsensors-imu-test2.c
  * \example mindsensors-imu-test3.c
@@ -76,8 +77,7 @@
 #define MSIMU_GYRO_Y_AXIS           MSIMU_REG_GYRO_Y_AXIS
 #define MSIMU_GYRO_Z_AXIS           MSIMU_REG_GYRO_Z_AXIS
 
-tByteArray MSIMU_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray MSIMU_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData MSIMU_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 bool _MSIMUsendCMD(tSensors link, ubyte cmd);
 bool MSIMUreadTiltAxes(tSensors link, short &_x, short &_y, short &_z);
@@ -97,12 +97,12 @@ bool MSIMUsetGyroFilter(tSensors link, ubyte level);
  */
 bool _MSIMUsendCMD(tSensors link, ubyte cmd)
 {
-  MSIMU_I2CRequest[0] = 3;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_CMD;  // Register address
-  MSIMU_I2CRequest[3] = cmd;  // command
+  MSIMU_I2CData[link].request[0] = 3;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_CMD;  // Register address
+  MSIMU_I2CData[link].request[3] = cmd;  // command
 
-  return writeI2C(link, MSIMU_I2CRequest);
+  return writeI2C(link, MSIMU_I2CData[link].request);
 }
 
 /**
@@ -114,16 +114,16 @@ bool _MSIMUsendCMD(tSensors link, ubyte cmd)
  * @return true if no error occured, false if it did
  */
 bool MSIMUreadTiltAxes(tSensors link, short &_x, short &_y, short &_z){
-  MSIMU_I2CRequest[0] = 2;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_TILT_ALL_AXES;  // Register address
+  MSIMU_I2CData[link].request[0] = 2;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_TILT_ALL_AXES;  // Register address
 
-  if (!writeI2C(link, MSIMU_I2CRequest, MSIMU_I2CReply, 3))
+  if (!writeI2C(link, MSIMU_I2CData[link].request, MSIMU_I2CData[link].reply, 3))
     return false;
 
-  _x = (MSIMU_I2CReply[0] >= 128) ? (short)MSIMU_I2CReply[0] - 256 : (short)MSIMU_I2CReply[0];
-  _y = (MSIMU_I2CReply[1] >= 128) ? (short)MSIMU_I2CReply[1] - 256 : (short)MSIMU_I2CReply[1];
-  _z = (MSIMU_I2CReply[2] >= 128) ? (short)MSIMU_I2CReply[2] - 256 : (short)MSIMU_I2CReply[2];
+  _x = (MSIMU_I2CData[link].reply[0] >= 128) ? (short)MSIMU_I2CData[link].reply[0] - 256 : (short)MSIMU_I2CData[link].reply[0];
+  _y = (MSIMU_I2CData[link].reply[1] >= 128) ? (short)MSIMU_I2CData[link].reply[1] - 256 : (short)MSIMU_I2CData[link].reply[1];
+  _z = (MSIMU_I2CData[link].reply[2] >= 128) ? (short)MSIMU_I2CData[link].reply[2] - 256 : (short)MSIMU_I2CData[link].reply[2];
 
   return true;
 }
@@ -137,16 +137,16 @@ bool MSIMUreadTiltAxes(tSensors link, short &_x, short &_y, short &_z){
  * @return true if no error occured, false if it did
  */
 bool MSIMUreadGyroAxes(tSensors link, short &_x, short &_y, short &_z){
-  MSIMU_I2CRequest[0] = 2;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_GYRO_ALL_AXES;  // Register address
+  MSIMU_I2CData[link].request[0] = 2;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_GYRO_ALL_AXES;  // Register address
 
-  if (!writeI2C(link, MSIMU_I2CRequest, MSIMU_I2CReply, 6))
+  if (!writeI2C(link, MSIMU_I2CData[link].request, MSIMU_I2CData[link].reply, 6))
     return false;
 
-  _x = MSIMU_I2CReply[0] + ((short)(MSIMU_I2CReply[1]<<8));
-  _y = MSIMU_I2CReply[2] + ((short)(MSIMU_I2CReply[3]<<8));
-  _z = MSIMU_I2CReply[4] + ((short)(MSIMU_I2CReply[5]<<8));
+  _x = MSIMU_I2CData[link].reply[0] + ((short)(MSIMU_I2CData[link].reply[1]<<8));
+  _y = MSIMU_I2CData[link].reply[2] + ((short)(MSIMU_I2CData[link].reply[3]<<8));
+  _z = MSIMU_I2CData[link].reply[4] + ((short)(MSIMU_I2CData[link].reply[5]<<8));
   return true;
 }
 
@@ -159,16 +159,16 @@ bool MSIMUreadGyroAxes(tSensors link, short &_x, short &_y, short &_z){
  * @return true if no error occured, false if it did
  */
 bool MSIMUreadAccelAxes(tSensors link, short &_x, short &_y, short &_z){
-  MSIMU_I2CRequest[0] = 2;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_ACC_ALL_AXES;  // Register address
+  MSIMU_I2CData[link].request[0] = 2;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_ACC_ALL_AXES;  // Register address
 
-  if (!writeI2C(link, MSIMU_I2CRequest, MSIMU_I2CReply, 6))
+  if (!writeI2C(link, MSIMU_I2CData[link].request, MSIMU_I2CData[link].reply, 6))
     return false;
 
-  _x = MSIMU_I2CReply[0] + ((short)(MSIMU_I2CReply[1]<<8));
-  _y = MSIMU_I2CReply[2] + ((short)(MSIMU_I2CReply[3]<<8));
-  _z = MSIMU_I2CReply[4] + ((short)(MSIMU_I2CReply[5]<<8));
+  _x = MSIMU_I2CData[link].reply[0] + ((short)(MSIMU_I2CData[link].reply[1]<<8));
+  _y = MSIMU_I2CData[link].reply[2] + ((short)(MSIMU_I2CData[link].reply[3]<<8));
+  _z = MSIMU_I2CData[link].reply[4] + ((short)(MSIMU_I2CData[link].reply[5]<<8));
   return true;
 }
 
@@ -181,16 +181,16 @@ bool MSIMUreadAccelAxes(tSensors link, short &_x, short &_y, short &_z){
  * @return true if no error occured, false if it did
  */
 bool MSIMUreadMagneticFields(tSensors link, short &_x, short &_y, short &_z){
-  MSIMU_I2CRequest[0] = 2;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_ACC_ALL_AXES;  // Register address
+  MSIMU_I2CData[link].request[0] = 2;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_ACC_ALL_AXES;  // Register address
 
-  if (!writeI2C(link, MSIMU_I2CRequest, MSIMU_I2CReply, 6))
+  if (!writeI2C(link, MSIMU_I2CData[link].request, MSIMU_I2CData[link].reply, 6))
     return false;
 
-  _x = MSIMU_I2CReply[0] + ((short)(MSIMU_I2CReply[1]<<8));
-  _y = MSIMU_I2CReply[2] + ((short)(MSIMU_I2CReply[3]<<8));
-  _z = MSIMU_I2CReply[4] + ((short)(MSIMU_I2CReply[5]<<8));
+  _x = MSIMU_I2CData[link].reply[0] + ((short)(MSIMU_I2CData[link].reply[1]<<8));
+  _y = MSIMU_I2CData[link].reply[2] + ((short)(MSIMU_I2CData[link].reply[3]<<8));
+  _z = MSIMU_I2CData[link].reply[4] + ((short)(MSIMU_I2CData[link].reply[5]<<8));
 
   return true;
 }
@@ -202,14 +202,14 @@ bool MSIMUreadMagneticFields(tSensors link, short &_x, short &_y, short &_z){
  */
 short MSIMUreadHeading(tSensors link)
 {
-  MSIMU_I2CRequest[0] = 2;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_COMPASS_HEADING;  // Register address
+  MSIMU_I2CData[link].request[0] = 2;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_COMPASS_HEADING;  // Register address
 
-  if (!writeI2C(link, MSIMU_I2CRequest, MSIMU_I2CReply, 2))
+  if (!writeI2C(link, MSIMU_I2CData[link].request, MSIMU_I2CData[link].reply, 2))
     return 0;
 
-  return MSIMU_I2CReply[0] + ((short)(MSIMU_I2CReply[1]<<8));
+  return MSIMU_I2CData[link].reply[0] + ((short)(MSIMU_I2CData[link].reply[1]<<8));
 }
 
 /**
@@ -220,12 +220,12 @@ short MSIMUreadHeading(tSensors link)
  */
 bool MSIMUsetGyroFilter(tSensors link, ubyte level)
 {
-  MSIMU_I2CRequest[0] = 3;                        // Message size
-  MSIMU_I2CRequest[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
-  MSIMU_I2CRequest[2] = MSIMU_REG_GYRO_FILTER;  // Register address
-  MSIMU_I2CRequest[3] = level;  // filtering level
+  MSIMU_I2CData[link].request[0] = 3;                        // Message size
+  MSIMU_I2CData[link].request[1] = MSIMU_IMU_I2C_ADDR;      // I2C Address
+  MSIMU_I2CData[link].request[2] = MSIMU_REG_GYRO_FILTER;  // Register address
+  MSIMU_I2CData[link].request[3] = level;  // filtering level
 
-  return writeI2C(link, MSIMU_I2CRequest);
+  return writeI2C(link, MSIMU_I2CData[link].request);
 }
 
 #endif // __MSIMU_H__
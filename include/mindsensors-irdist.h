@@ -17,6 +17,7 @@
  * - 0.2: More comments
  * - 0.3: Sensor now auto-configures the type
  * - 0.4: Allow I2C address to be specified as an optional argument
+ * - 0.5: Request and reply buffers are now kept per port in MSDIST_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -27,7 +28,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 18 December 2010
- * \version 0.4
+ * \version 0.5
  * \example mindsensors-irdist-test1.c
  */
 
@@ -60,8 +61,7 @@ short MSDISTreadMaxDist(tSensors link, ubyte address = MSDIST_I2C_ADDR);
 short MSDISTreadModuleType(tSensors link, ubyte address = MSDIST_I2C_ADDR);
 bool MSDISTsendCmd(tSensors link, byte command, ubyte address = MSDIST_I2C_ADDR);
 
-tByteArray MSDIST_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray MSDIST_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData MSDIST_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 bool MSDISTcalibrated[] = {false, false, false, false};  /*!< Has the sensor been calibrated yet? */
 
@@ -82,16 +82,16 @@ short MSDISTreadDist(tSensors link, ubyte address) {
       MSDISTcalibrated[link] = true;
   }
 
-  memset(MSDIST_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSDIST_I2CData[link].request, 0, sizeof(MSDIST_I2CData[link].request));
 
-  MSDIST_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSDIST_I2CRequest[1] = address;         // I2C address of sensor
-  MSDIST_I2CRequest[2] = MSDIST_DIST;     // Set write address to sensor mode register
+  MSDIST_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSDIST_I2CData[link].request[1] = address;         // I2C address of sensor
+  MSDIST_I2CData[link].request[2] = MSDIST_DIST;     // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSDIST_I2CRequest, MSDIST_I2CReply, 2))
+  if (!writeI2C(link, MSDIST_I2CData[link].request, MSDIST_I2CData[link].reply, 2))
     return -1;
 
-  return (0x00FF & MSDIST_I2CReply[0]) + ((0x00FF & MSDIST_I2CReply[1]) <<8);
+  return (0x00FF & MSDIST_I2CData[link].reply[0]) + ((0x00FF & MSDIST_I2CData[link].reply[1]) <<8);
 }
 
 /**
@@ -101,17 +101,17 @@ short MSDISTreadDist(tSensors link, ubyte address) {
  * @return voltage reading from IR Sensor -1 if an error occurred
  */
 short MSDISTreadVoltage(tSensors link, ubyte address) {
-  memset(MSDIST_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSDIST_I2CData[link].request, 0, sizeof(MSDIST_I2CData[link].request));
 
-  MSDIST_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSDIST_I2CRequest[1] = address;         // I2C address of sensor
-  MSDIST_I2CRequest[2] = MSDIST_VOLT;     // Set write address to sensor mode register
+  MSDIST_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSDIST_I2CData[link].request[1] = address;         // I2C address of sensor
+  MSDIST_I2CData[link].request[2] = MSDIST_VOLT;     // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSDIST_I2CRequest, MSDIST_I2CReply, 2))
+  if (!writeI2C(link, MSDIST_I2CData[link].request, MSDIST_I2CData[link].reply, 2))
     return -1;
 
   // Each result is made up of two bytes.
-  return (0x00FF & MSDIST_I2CReply[0]) + ((0x00FF & MSDIST_I2CReply[1]) <<8);
+  return (0x00FF & MSDIST_I2CData[link].reply[0]) + ((0x00FF & MSDIST_I2CData[link].reply[1]) <<8);
 }
 
 /**
@@ -121,17 +121,17 @@ short MSDISTreadVoltage(tSensors link, ubyte address) {
  * @return minumum measuring distance from the sensor -1 if an error occurred
  */
 short MSDISTreadMinDist(tSensors link, ubyte address) {
-  memset(MSDIST_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSDIST_I2CData[link].request, 0, sizeof(MSDIST_I2CData[link].request));
 
-  MSDIST_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSDIST_I2CRequest[1] = address;         // I2C address of sensor
-  MSDIST_I2CRequest[2] = MSDIST_MINDIST;  // Set write address to sensor mode register
+  MSDIST_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSDIST_I2CData[link].request[1] = address;         // I2C address of sensor
+  MSDIST_I2CData[link].request[2] = MSDIST_MINDIST;  // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSDIST_I2CRequest, MSDIST_I2CReply, 2))
+  if (!writeI2C(link, MSDIST_I2CData[link].request, MSDIST_I2CData[link].reply, 2))
     return -1;
 
   // Each result is made up of two bytes.
-  return (0x00FF & MSDIST_I2CReply[0]) + ((0x00FF & MSDIST_I2CReply[1]) <<8);
+  return (0x00FF & MSDIST_I2CData[link].reply[0]) + ((0x00FF & MSDIST_I2CData[link].reply[1]) <<8);
 }
 
 /**
@@ -141,17 +141,17 @@ short MSDISTreadMinDist(tSensors link, ubyte address) {
  * @return maximum measuring distance from the sensor -1 if an error occurred
  */
 short MSDISTreadMaxDist(tSensors link, ubyte address) {
-  memset(MSDIST_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSDIST_I2CData[link].request, 0, sizeof(MSDIST_I2CData[link].request));
 
-  MSDIST_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSDIST_I2CRequest[1] = address;         // I2C address of sensor
-  MSDIST_I2CRequest[2] = MSDIST_MAXDIST;     // Set write address to sensor mode register
+  MSDIST_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSDIST_I2CData[link].request[1] = address;         // I2C address of sensor
+  MSDIST_I2CData[link].request[2] = MSDIST_MAXDIST;     // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSDIST_I2CRequest, MSDIST_I2CReply, 2))
+  if (!writeI2C(link, MSDIST_I2CData[link].request, MSDIST_I2CData[link].reply, 2))
     return -1;
 
   // Each result is made up of two bytes.
-  return (0x00FF & MSDIST_I2CReply[0]) + ((0x00FF & MSDIST_I2CReply[1]) <<8);
+  return (0x00FF & MSDIST_I2CData[link].reply[0]) + ((0x00FF & MSDIST_I2CData[link].reply[1]) <<8);
 }
 
 /**
@@ -161,16 +161,16 @@ short MSDISTreadMaxDist(tSensors link, ubyte address) {
  * @return Sharp IR module type from the sensor -1 if an error occurred
  */
 short MSDISTreadModuleType(tSensors link, ubyte address) {
-  memset(MSDIST_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSDIST_I2CData[link].request, 0, sizeof(MSDIST_I2CData[link].request));
 
-  MSDIST_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSDIST_I2CRequest[1] = address;         // I2C address of sensor
-  MSDIST_I2CRequest[2] = MSDIST_MOD_TYPE; // Set write address to sensor mode register
+  MSDIST_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSDIST_I2CData[link].request[1] = address;         // I2C address of sensor
+  MSDIST_I2CData[link].request[2] = MSDIST_MOD_TYPE; // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSDIST_I2CRequest, MSDIST_I2CReply, 1))
+  if (!writeI2C(link, MSDIST_I2CData[link].request, MSDIST_I2CData[link].reply, 1))
     return -1;
 
-  return 0x00FF & MSDIST_I2CReply[0];
+  return 0x00FF & MSDIST_I2CData[link].reply[0];
 }
 
 /**
@@ -181,14 +181,14 @@ short MSDISTreadModuleType(tSensors link, ubyte address) {
  * @return true if no error occured, false if it did
  */
 bool MSDISTsendCmd(tSensors link, byte command, ubyte address) {
-  memset(MSDIST_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSDIST_I2CData[link].request, 0, sizeof(MSDIST_I2CData[link].request));
 
-  MSDIST_I2CRequest[0] = 3;               // Number of bytes in I2C command
-  MSDIST_I2CRequest[1] = address;         // I2C address of sensor
-  MSDIST_I2CRequest[2] = MSDIST_CMD;      // Set write address to sensor mode register
-  MSDIST_I2CRequest[3] = command;         // Command to be sent to the sensor
+  MSDIST_I2CData[link].request[0] = 3;               // Number of bytes in I2C command
+  MSDIST_I2CData[link].request[1] = address;         // I2C address of sensor
+  MSDIST_I2CData[link].request[2] = MSDIST_CMD;      // Set write address to sensor mode register
+  MSDIST_I2CData[link].request[3] = command;         // Command to be sent to the sensor
 
-  return writeI2C(link, MSDIST_I2CRequest);
+  return writeI2C(link, MSDIST_I2CData[link].request);
 }
 
 #endif //__MSDIST_H__
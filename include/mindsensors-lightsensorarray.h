@@ -15,6 +15,7 @@
  *
  * Changelog:
  *  - 0.1 Initial  release<br>
+ *  - 0.2 Request and reply buffers are now kept per port in MSLSA_I2CData[]<br>
  *
  * License: You may use this code as you wish, provided you give credit where it's due.
  *
@@ -22,7 +23,7 @@
 
  * \author Xander Soldaat
  * \date 29 September 2012
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-ligthsensorarray-test1.c
  * \example mindsensors-ligthsensorarray-test3.c
  */
@@ -51,8 +52,7 @@
 #define MSLSA_CMD_FREQ_UNI      'U'   /*!< Universal frequency compensation (default) */
 #define MSLDA_CMD_CALIB_WHITE   'W'   /*!< Calibrate white values  */
 
-tByteArray MSLSA_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray MSLSA_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData MSLSA_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 #define MSLSAwakeUp(X)    _MSLSAsendCommand(X, MSLSA_CMD_POWERUP)     /*!< Wake sensor from sleep mode */
 #define MSLSASleep(X)     _MSLSAsendCommand(X, MSLSA_CMD_POWERDOWN)   /*!< Put sensor into sleep mode */
@@ -85,12 +85,12 @@ PRELIMINARY COMMANDS FROM NXC LIB CODE
  - W White balance
  */
 bool _MSLSAsendCommand(tSensors link, ubyte cmd) {
-  MSLSA_I2CRequest[0] = 3;             // Message size
-  MSLSA_I2CRequest[1] = MSLSA_I2C_ADDR;   // I2C Address
-  MSLSA_I2CRequest[2] = MSLSA_CMD_REG;    // Register used for issuing commands
-  MSLSA_I2CRequest[3] = cmd;           // Command to be executed
+  MSLSA_I2CData[link].request[0] = 3;             // Message size
+  MSLSA_I2CData[link].request[1] = MSLSA_I2C_ADDR;   // I2C Address
+  MSLSA_I2CData[link].request[2] = MSLSA_CMD_REG;    // Register used for issuing commands
+  MSLSA_I2CData[link].request[3] = cmd;           // Command to be executed
 
-  return writeI2C(link, MSLSA_I2CRequest);
+  return writeI2C(link, MSLSA_I2CData[link].request);
 }
 
 /**
@@ -101,18 +101,18 @@ bool _MSLSAsendCommand(tSensors link, ubyte cmd) {
  */
 bool MSLSAreadSensors(tSensors link, ubyte *values)
 {
-  MSLSA_I2CRequest[0] = 2;
-  MSLSA_I2CRequest[1] = MSLSA_I2C_ADDR;
-  MSLSA_I2CRequest[2] = MSLSA_CALIBRATED;
+  MSLSA_I2CData[link].request[0] = 2;
+  MSLSA_I2CData[link].request[1] = MSLSA_I2C_ADDR;
+  MSLSA_I2CData[link].request[2] = MSLSA_CALIBRATED;
 
-  if (!writeI2C(link, MSLSA_I2CRequest, MSLSA_I2CReply, 8))
+  if (!writeI2C(link, MSLSA_I2CData[link].request, MSLSA_I2CData[link].reply, 8))
     return false;
 
   // clear out the old values
   memset(values, 0, sizeof(values));
 
   // copy the new values (first 8 bytes)
-  memcpy(values, MSLSA_I2CReply, 8);
+  memcpy(values, MSLSA_I2CData[link].reply, 8);
 
   return true;
 }
@@ -125,11 +125,11 @@ bool MSLSAreadSensors(tSensors link, ubyte *values)
  */
 bool MSLSAreadRawSensors(tSensors link, short *values)
 {
-  MSLSA_I2CRequest[0] = 2;
-  MSLSA_I2CRequest[1] = MSLSA_I2C_ADDR;
-  MSLSA_I2CRequest[2] = MSLSA_UNCALIBRATED;
+  MSLSA_I2CData[link].request[0] = 2;
+  MSLSA_I2CData[link].request[1] = MSLSA_I2C_ADDR;
+  MSLSA_I2CData[link].request[2] = MSLSA_UNCALIBRATED;
 
-  if (!writeI2C(link, MSLSA_I2CRequest, MSLSA_I2CReply, 16))
+  if (!writeI2C(link, MSLSA_I2CData[link].request, MSLSA_I2CData[link].reply, 16))
     return false;
 
   // clear out the old values
@@ -137,7 +137,7 @@ bool MSLSAreadRawSensors(tSensors link, short *values)
 
   for (short i = 0; i < 8; i++)
   {
-    values[i] = MSLSA_I2CReply[i * 2] + (MSLSA_I2CReply[(i * 2) + 1] << 8);
+    values[i] = MSLSA_I2CData[link].reply[i * 2] + (MSLSA_I2CData[link].reply[(i * 2) + 1] << 8);
   }
 
   return true;
@@ -23,6 +23,7 @@
  *       all direct I2C calls changed to readI2C() and writeI2C() calls.
  *  - 0.5 Bug in LLreadSteering fixed
  *  - 0.6 Added LLreadSensorUncalibrated
+ *  - 0.7 Request and reply buffers are now kept per port in LL_I2CData[]
  *
  * License: You may use this code as you wish, provided you give credit where it's due.
  *
@@ -31,7 +32,7 @@
  * \author Thom Roach
  * \author Xander Soldaat (version 0.4+)
  * \date 29 October 2009
- * \version 0.6
+ * \version 0.7
  * \example mindsensors-lineleader-test2.c
  * \example mindsensors-lineleader-test3.c
  * \example mindsensors-lineleader-test4.c
@@ -65,8 +66,7 @@
 #define LL_BLACK_LIMIT    0X59  /*!< ubyte array (8) with raw value of black calibration for each sensor */
 #define LL_SENSOR_UNCAL   0x74  /*!< ubyte array (16) with uncalibrated sensor data */
 
-tByteArray LL_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray LL_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData LL_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 ubyte oneByte;
 
 //*******************************************************************************
@@ -139,12 +139,12 @@ PRELIMINARY COMMANDS FROM NXC LIB CODE
  - W White balance
  */
 bool _lineLeader_cmd(tSensors link, ubyte cmd) {
-  LL_I2CRequest[0] = 3;             // Message size
-  LL_I2CRequest[1] = LL_I2C_ADDR;   // I2C Address
-  LL_I2CRequest[2] = LL_CMD_REG;    // Register used for issuing commands
-  LL_I2CRequest[3] = cmd;           // Command to be executed
+  LL_I2CData[link].request[0] = 3;             // Message size
+  LL_I2CData[link].request[1] = LL_I2C_ADDR;   // I2C Address
+  LL_I2CData[link].request[2] = LL_CMD_REG;    // Register used for issuing commands
+  LL_I2CData[link].request[3] = cmd;           // Command to be executed
 
-  return writeI2C(link, LL_I2CRequest);
+  return writeI2C(link, LL_I2CData[link].request);
 }
 
 /**
@@ -159,13 +159,13 @@ bool _lineLeader_cmd(tSensors link, ubyte cmd) {
 
 bool _lineLeader_write(tSensors link, ubyte regToWrite, ubyte data) {
 
-  memset(LL_I2CRequest, 0, sizeof(tByteArray));
-  LL_I2CRequest[0] = 3;             // Message size
-  LL_I2CRequest[1] = LL_I2C_ADDR;   // I2C Address
-  LL_I2CRequest[2] = regToWrite;    // Register address to set
-  LL_I2CRequest[3] = data;          // value to place in register address
+  memset(LL_I2CData[link].request, 0, sizeof(LL_I2CData[link].request));
+  LL_I2CData[link].request[0] = 3;             // Message size
+  LL_I2CData[link].request[1] = LL_I2C_ADDR;   // I2C Address
+  LL_I2CData[link].request[2] = regToWrite;    // Register address to set
+  LL_I2CData[link].request[3] = data;          // value to place in register address
 
-  return writeI2C(link, LL_I2CRequest);
+  return writeI2C(link, LL_I2CData[link].request);
 }
 
 /**
@@ -178,15 +178,15 @@ bool _lineLeader_write(tSensors link, ubyte regToWrite, ubyte data) {
  * @return true if no error occured, false if it did
  */
 bool _lineLeader_read(tSensors link, ubyte regToRead, ubyte &retval) {
-  memset(LL_I2CRequest, 0, sizeof(LL_I2CRequest));
-  LL_I2CRequest[0] =  2;
-  LL_I2CRequest[1] =  LL_I2C_ADDR;
-  LL_I2CRequest[2] =  regToRead;
+  memset(LL_I2CData[link].request, 0, sizeof(LL_I2CData[link].request));
+  LL_I2CData[link].request[0] =  2;
+  LL_I2CData[link].request[1] =  LL_I2C_ADDR;
+  LL_I2CData[link].request[2] =  regToRead;
 
-  if (!writeI2C(link, LL_I2CRequest, LL_I2CReply, 1))
+  if (!writeI2C(link, LL_I2CData[link].request, LL_I2CData[link].reply, 1))
     return false;
 
-  retval = (short)LL_I2CReply[0];
+  retval = (short)LL_I2CData[link].reply[0];
 
   return true;
 }
@@ -202,18 +202,18 @@ bool _lineLeader_read(tSensors link, ubyte regToRead, ubyte &retval) {
  * @return true if no error occured, false if it did
  */
 bool _lineLeader_read(tSensors link, ubyte regToRead, short numBytes, tByteArray &pDataMsg) {
-  memset(LL_I2CRequest, 0, sizeof(tByteArray));
+  memset(LL_I2CData[link].request, 0, sizeof(LL_I2CData[link].request));
   memset(pDataMsg, 0, sizeof(tByteArray));
 
-  LL_I2CRequest[0] =  2;
-  LL_I2CRequest[1] =  LL_I2C_ADDR;
-  LL_I2CRequest[2] =  regToRead;
+  LL_I2CData[link].request[0] =  2;
+  LL_I2CData[link].request[1] =  LL_I2C_ADDR;
+  LL_I2CData[link].request[2] =  regToRead;
 
-  if (!writeI2C(link, LL_I2CRequest, LL_I2CReply, numBytes))
+  if (!writeI2C(link, LL_I2CData[link].request, LL_I2CData[link].reply, numBytes))
     return false;
 
   // copy the result into the array to be returned.
-  memcpy(pDataMsg, LL_I2CReply, sizeof(tByteArray));
+  memcpy(pDataMsg, LL_I2CData[link].reply, sizeof(LL_I2CData[link].reply));
   return true;
 }
 
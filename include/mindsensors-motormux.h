@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSMMUX_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 05 April 2010
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-motormux-test1.c
  * \example mindsensors-motormux-test2.c
  */
@@ -112,8 +113,7 @@ typedef struct
   tMMUXData MMUXData;
 } tMSMMUX, *tMSMMUXPtr;
 
-tByteArray MSMMUX_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray MSMMUX_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData MSMMUX_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 // Function prototypes
 void MSMMUXinit();
@@ -164,20 +164,20 @@ void MSMMUXinit(){
  */
 bool MSMMUXreadStatus(tMUXmotor muxmotor, ubyte &motorStatus, ubyte address) {
 
-  memset(MSMMUX_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSMMUX_I2CData[SPORT(muxmotor)].request, 0, sizeof(MSMMUX_I2CData[SPORT(muxmotor)].request));
 
-  MSMMUX_I2CRequest[0] = 2;               // Message size
-  MSMMUX_I2CRequest[1] = MSMMUX_I2C_ADDR; // I2C Address
+  MSMMUX_I2CData[SPORT(muxmotor)].request[0] = 2;               // Message size
+  MSMMUX_I2CData[SPORT(muxmotor)].request[1] = MSMMUX_I2C_ADDR; // I2C Address
 
   switch ((byte)MPORT(muxmotor)) {
-    case 0: MSMMUX_I2CRequest[2] = MSMMUX_STATUS_MOT1; break;
-    case 1: MSMMUX_I2CRequest[2] = MSMMUX_STATUS_MOT2; break;
+    case 0: MSMMUX_I2CData[SPORT(muxmotor)].request[2] = MSMMUX_STATUS_MOT1; break;
+    case 1: MSMMUX_I2CData[SPORT(muxmotor)].request[2] = MSMMUX_STATUS_MOT2; break;
   }
 
-  if (!writeI2C((tSensors)SPORT(muxmotor), MSMMUX_I2CRequest, MSMMUX_I2CReply, 1))
+  if (!writeI2C((tSensors)SPORT(muxmotor), MSMMUX_I2CData[SPORT(muxmotor)].request, MSMMUX_I2CData[SPORT(muxmotor)].reply, 1))
     return false;
 
-  motorStatus = MSMMUX_I2CReply[0];
+  motorStatus = MSMMUX_I2CData[SPORT(muxmotor)].reply[0];
 
   return true;
 }
@@ -196,25 +196,25 @@ bool MSMMUXreadStatus(tMUXmotor muxmotor, ubyte &motorStatus, ubyte address) {
  * @return true if no error occured, false if it did
  */
 bool MSMMUXsendCommand(tSensors link, ubyte channel, long setpoint, byte speed, ubyte seconds, ubyte commandA, ubyte address) {
-  memset(MSMMUX_I2CRequest, 0, sizeof(tByteArray));
-
-  MSMMUX_I2CRequest[0] = 10;               // Message size
-  MSMMUX_I2CRequest[1] = address;          // I2C Address
-  MSMMUX_I2CRequest[2] = MSMMUX_MOT_OFFSET + (channel * MSMMUX_ENTRY_SIZE);
-  MSMMUX_I2CRequest[3] = (setpoint >>  0) & 0xFF;
-  MSMMUX_I2CRequest[4] = (setpoint >>  8) & 0xFF;
-  MSMMUX_I2CRequest[5] = (setpoint >> 16) & 0xFF;
-  MSMMUX_I2CRequest[6] = (setpoint >> 24) & 0xFF;
-  MSMMUX_I2CRequest[7] = (speed & 0xFF);
-  MSMMUX_I2CRequest[8] = seconds;
-  MSMMUX_I2CRequest[9] = 0;
-  MSMMUX_I2CRequest[10] = commandA;
+  memset(MSMMUX_I2CData[link].request, 0, sizeof(MSMMUX_I2CData[link].request));
+
+  MSMMUX_I2CData[link].request[0] = 10;               // Message size
+  MSMMUX_I2CData[link].request[1] = address;          // I2C Address
+  MSMMUX_I2CData[link].request[2] = MSMMUX_MOT_OFFSET + (channel * MSMMUX_ENTRY_SIZE);
+  MSMMUX_I2CData[link].request[3] = (setpoint >>  0) & 0xFF;
+  MSMMUX_I2CData[link].request[4] = (setpoint >>  8) & 0xFF;
+  MSMMUX_I2CData[link].request[5] = (setpoint >> 16) & 0xFF;
+  MSMMUX_I2CData[link].request[6] = (setpoint >> 24) & 0xFF;
+  MSMMUX_I2CData[link].request[7] = (speed & 0xFF);
+  MSMMUX_I2CData[link].request[8] = seconds;
+  MSMMUX_I2CData[link].request[9] = 0;
+  MSMMUX_I2CData[link].request[10] = commandA;
 
   // make sure the targetUnit is reset for the next time
   mmuxData[link].targetUnit[channel] = MSMMUX_ROT_UNLIMITED;
 
   // send the command to the mmux
-  return writeI2C(link, MSMMUX_I2CRequest);
+  return writeI2C(link, MSMMUX_I2CData[link].request);
 
 }
 
@@ -228,14 +228,14 @@ bool MSMMUXsendCommand(tSensors link, ubyte channel, long setpoint, byte speed,
  * @return true if no error occured, false if it did
  */
 bool MSMMUXsendCommand(tSensors link, ubyte command, ubyte address) {
-  memset(MSMMUX_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSMMUX_I2CData[link].request, 0, sizeof(MSMMUX_I2CData[link].request));
 
-  MSMMUX_I2CRequest[0] = 3;               // Message size
-  MSMMUX_I2CRequest[1] = address; // I2C Address
-  MSMMUX_I2CRequest[2] = MSMMUX_REG_CMD;
-  MSMMUX_I2CRequest[3] = command;
+  MSMMUX_I2CData[link].request[0] = 3;               // Message size
+  MSMMUX_I2CData[link].request[1] = address; // I2C Address
+  MSMMUX_I2CData[link].request[2] = MSMMUX_REG_CMD;
+  MSMMUX_I2CData[link].request[3] = command;
 
-  return writeI2C(link, MSMMUX_I2CRequest);
+  return writeI2C(link, MSMMUX_I2CData[link].request);
 }
 
 /**
@@ -260,27 +260,27 @@ bool MSMMUXsendCommand(tSensors link, ubyte command, ubyte address) {
  * @return true if no error occured, false if it did
  */
 bool MSMMUXsetPID(tSensors link, unsigned short kpTacho, unsigned short kiTacho, unsigned short kdTacho, unsigned short kpSpeed, unsigned short kiSpeed, unsigned short kdSpeed, ubyte passCount, ubyte tolerance, ubyte address) {
-  memset(MSMMUX_I2CRequest, 0, sizeof(tByteArray));
-
-  MSMMUX_I2CRequest[0] = 16;               // Message size
-  MSMMUX_I2CRequest[1] = address; // I2C Address
-  MSMMUX_I2CRequest[2] = MSMMUX_KP_TACHO;
-  MSMMUX_I2CRequest[3] = kpTacho & 0xFF;
-  MSMMUX_I2CRequest[4] = (kpTacho >> 8) & 0xFF;
-  MSMMUX_I2CRequest[5] = kiTacho & 0xFF;
-  MSMMUX_I2CRequest[6] = (kiTacho >> 8) & 0xFF;
-  MSMMUX_I2CRequest[7] = kdTacho & 0xFF;
-  MSMMUX_I2CRequest[8] = (kdTacho >> 8) & 0xFF;
-  MSMMUX_I2CRequest[9] = kpSpeed & 0xFF;
-  MSMMUX_I2CRequest[10] = (kpSpeed >> 8) & 0xFF;
-  MSMMUX_I2CRequest[11] = kiSpeed & 0xFF;
-  MSMMUX_I2CRequest[12] = (kiSpeed >> 8) & 0xFF;
-  MSMMUX_I2CRequest[13] = kdSpeed & 0xFF;
-  MSMMUX_I2CRequest[14] = (kdSpeed >> 8) & 0xFF;
-  MSMMUX_I2CRequest[15] = passCount;
-  MSMMUX_I2CRequest[16] = tolerance;
-
-  return writeI2C(link, MSMMUX_I2CRequest);
+  memset(MSMMUX_I2CData[link].request, 0, sizeof(MSMMUX_I2CData[link].request));
+
+  MSMMUX_I2CData[link].request[0] = 16;               // Message size
+  MSMMUX_I2CData[link].request[1] = address; // I2C Address
+  MSMMUX_I2CData[link].request[2] = MSMMUX_KP_TACHO;
+  MSMMUX_I2CData[link].request[3] = kpTacho & 0xFF;
+  MSMMUX_I2CData[link].request[4] = (kpTacho >> 8) & 0xFF;
+  MSMMUX_I2CData[link].request[5] = kiTacho & 0xFF;
+  MSMMUX_I2CData[link].request[6] = (kiTacho >> 8) & 0xFF;
+  MSMMUX_I2CData[link].request[7] = kdTacho & 0xFF;
+  MSMMUX_I2CData[link].request[8] = (kdTacho >> 8) & 0xFF;
+  MSMMUX_I2CData[link].request[9] = kpSpeed & 0xFF;
+  MSMMUX_I2CData[link].request[10] = (kpSpeed >> 8) & 0xFF;
+  MSMMUX_I2CData[link].request[11] = kiSpeed & 0xFF;
+  MSMMUX_I2CData[link].request[12] = (kiSpeed >> 8) & 0xFF;
+  MSMMUX_I2CData[link].request[13] = kdSpeed & 0xFF;
+  MSMMUX_I2CData[link].request[14] = (kdSpeed >> 8) & 0xFF;
+  MSMMUX_I2CData[link].request[15] = passCount;
+  MSMMUX_I2CData[link].request[16] = tolerance;
+
+  return writeI2C(link, MSMMUX_I2CData[link].request);
 }
 
 /**
@@ -403,20 +403,20 @@ void MSMMotorSetEncoderTarget(tMUXmotor muxmotor, long target, bool relative) {
 long MSMMotorEncoder(tMUXmotor muxmotor, ubyte address) {
   long result;
 
-  memset(MSMMUX_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSMMUX_I2CData[SPORT(muxmotor)].request, 0, sizeof(MSMMUX_I2CData[SPORT(muxmotor)].request));
 
-  MSMMUX_I2CRequest[0] = 2;               // Message size
-  MSMMUX_I2CRequest[1] = address; // I2C Address
+  MSMMUX_I2CData[SPORT(muxmotor)].request[0] = 2;               // Message size
+  MSMMUX_I2CData[SPORT(muxmotor)].request[1] = address; // I2C Address
 
   switch ((byte)MPORT(muxmotor)) {
-    case 0: MSMMUX_I2CRequest[2] = MSMMUX_TACHO_MOT1; break;
-    case 1: MSMMUX_I2CRequest[2] = MSMMUX_TACHO_MOT2; break;
+    case 0: MSMMUX_I2CData[SPORT(muxmotor)].request[2] = MSMMUX_TACHO_MOT1; break;
+    case 1: MSMMUX_I2CData[SPORT(muxmotor)].request[2] = MSMMUX_TACHO_MOT2; break;
   }
 
-  if (!writeI2C((tSensors)SPORT(muxmotor), MSMMUX_I2CRequest,  MSMMUX_I2CReply, 4))
+  if (!writeI2C((tSensors)SPORT(muxmotor), MSMMUX_I2CData[SPORT(muxmotor)].request,  MSMMUX_I2CData[SPORT(muxmotor)].reply, 4))
     return 0;
 
-  result = MSMMUX_I2CReply[0] + (MSMMUX_I2CReply[1]<<8) + (MSMMUX_I2CReply[2]<<16) + (MSMMUX_I2CReply[3]<<24);
+  result = MSMMUX_I2CData[SPORT(muxmotor)].reply[0] + (MSMMUX_I2CData[SPORT(muxmotor)].reply[1]<<8) + (MSMMUX_I2CData[SPORT(muxmotor)].reply[2]<<16) + (MSMMUX_I2CData[SPORT(muxmotor)].reply[3]<<24);
 
   return result;
 }
@@ -466,16 +466,16 @@ bool MSMMotorBusy(tMUXmotor muxmotor, ubyte address) {
   ubyte commandA = 0;
 
   // Fetch the last sent commandA
-  memset(MSMMUX_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSMMUX_I2CData[SPORT(muxmotor)].request, 0, sizeof(MSMMUX_I2CData[SPORT(muxmotor)].request));
 
-  MSMMUX_I2CRequest[0] = 2;               // Message size
-  MSMMUX_I2CRequest[1] = address; // I2C Address
-  MSMMUX_I2CRequest[2] = MSMMUX_MOT_OFFSET + (MPORT(muxmotor) * MSMMUX_ENTRY_SIZE) + MSMMUX_CMD_A;
+  MSMMUX_I2CData[SPORT(muxmotor)].request[0] = 2;               // Message size
+  MSMMUX_I2CData[SPORT(muxmotor)].request[1] = address; // I2C Address
+  MSMMUX_I2CData[SPORT(muxmotor)].request[2] = MSMMUX_MOT_OFFSET + (MPORT(muxmotor) * MSMMUX_ENTRY_SIZE) + MSMMUX_CMD_A;
 
-  if (!writeI2C((tSensors)SPORT(muxmotor), MSMMUX_I2CRequest, MSMMUX_I2CReply, 1))
+  if (!writeI2C((tSensors)SPORT(muxmotor), MSMMUX_I2CData[SPORT(muxmotor)].request, MSMMUX_I2CData[SPORT(muxmotor)].reply, 1))
     return false;
 
-  commandA = MSMMUX_I2CReply[0];
+  commandA = MSMMUX_I2CData[SPORT(muxmotor)].reply[0];
 
   // If commandA is 0 then the motor can't be busy.
   if (commandA == 0)
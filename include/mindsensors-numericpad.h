@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSNP_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 30 October 2010
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-numericpad-test1.c
  */
 
@@ -37,8 +38,7 @@
 #define MSNP_I2C_ADDR  0xB4     /*!< Numeric Pad I2C device address */
 #define MSNP_DATA_REG  0x00     /*!< Data registers start at 0x00 */
 
-tByteArray MSNP_I2CRequest;     /*!< Array to hold I2C command data */
-tByteArray MSNP_I2CReply;       /*!< Array to hold I2C reply data */
+tI2CData MSNP_I2CData[4];       /*!< Per-port I2C request and reply buffers */
 
 #define KEY_STATUS_REG 0x00
 
@@ -64,28 +64,28 @@ bool _MSNPinitialised[] = {false, false, false, false};
 bool _MSNPinit(tSensors link) {
 // Must be called at the beginning of every power cycle
 
-  memcpy(MSNP_I2CRequest, MSNP_ConfigGroup1, sizeof(MSNP_ConfigGroup1));
-  if (!writeI2C(link, MSNP_I2CRequest))
+  memcpy(MSNP_I2CData[link].request, MSNP_ConfigGroup1, sizeof(MSNP_ConfigGroup1));
+  if (!writeI2C(link, MSNP_I2CData[link].request))
     return false;
 
-  memcpy(MSNP_I2CRequest, MSNP_ConfigGroup2, sizeof(MSNP_ConfigGroup2));
-  if (!writeI2C(link, MSNP_I2CRequest))
+  memcpy(MSNP_I2CData[link].request, MSNP_ConfigGroup2, sizeof(MSNP_ConfigGroup2));
+  if (!writeI2C(link, MSNP_I2CData[link].request))
     return false;
 
-  memcpy(MSNP_I2CRequest, MSNP_ConfigGroup3, sizeof(MSNP_ConfigGroup3));
-  if (!writeI2C(link, MSNP_I2CRequest))
+  memcpy(MSNP_I2CData[link].request, MSNP_ConfigGroup3, sizeof(MSNP_ConfigGroup3));
+  if (!writeI2C(link, MSNP_I2CData[link].request))
     return false;
 
-  memcpy(MSNP_I2CRequest, MSNP_ConfigGroup4, sizeof(MSNP_ConfigGroup4));
-  if (!writeI2C(link, MSNP_I2CRequest))
+  memcpy(MSNP_I2CData[link].request, MSNP_ConfigGroup4, sizeof(MSNP_ConfigGroup4));
+  if (!writeI2C(link, MSNP_I2CData[link].request))
     return false;
 
-  memcpy(MSNP_I2CRequest, MSNP_ConfigGroup5, sizeof(MSNP_ConfigGroup5));
-  if (!writeI2C(link, MSNP_I2CRequest))
+  memcpy(MSNP_I2CData[link].request, MSNP_ConfigGroup5, sizeof(MSNP_ConfigGroup5));
+  if (!writeI2C(link, MSNP_I2CData[link].request))
     return false;
 
-  memcpy(MSNP_I2CRequest, MSNP_ConfigGroup6, sizeof(MSNP_ConfigGroup6));
-  if (!writeI2C(link, MSNP_I2CRequest))
+  memcpy(MSNP_I2CData[link].request, MSNP_ConfigGroup6, sizeof(MSNP_ConfigGroup6));
+  if (!writeI2C(link, MSNP_I2CData[link].request))
     return false;
 
   return true;
@@ -111,14 +111,14 @@ bool MSNPscanKeys(tSensors link, short &pressedKeys, unsigned byte &key, short &
   key = 'X';
   number = -255;
 
-  MSNP_I2CRequest[0] = 2;
-  MSNP_I2CRequest[1] = MSNP_I2C_ADDR;
-  MSNP_I2CRequest[2] = MSNP_DATA_REG;
+  MSNP_I2CData[link].request[0] = 2;
+  MSNP_I2CData[link].request[1] = MSNP_I2C_ADDR;
+  MSNP_I2CData[link].request[2] = MSNP_DATA_REG;
 
-  if (!writeI2C(link, MSNP_I2CRequest, MSNP_I2CReply, 2))
+  if (!writeI2C(link, MSNP_I2CData[link].request, MSNP_I2CData[link].reply, 2))
     return false;
 
-  pressedKeys = MSNP_I2CReply[0] + (MSNP_I2CReply[1] * 256);
+  pressedKeys = MSNP_I2CData[link].reply[0] + (MSNP_I2CData[link].reply[1] * 256);
 
   for (short i=0; i < 12; i++) {
     if (pressedKeys & (1<<i)) {
@@ -145,14 +145,14 @@ short MSNPscanKeys(tSensors link) {
     sleep(10);
   }
 
-  MSNP_I2CRequest[0] = 2;
-  MSNP_I2CRequest[1] = MSNP_I2C_ADDR;
-  MSNP_I2CRequest[2] = MSNP_DATA_REG;
+  MSNP_I2CData[link].request[0] = 2;
+  MSNP_I2CData[link].request[1] = MSNP_I2C_ADDR;
+  MSNP_I2CData[link].request[2] = MSNP_DATA_REG;
 
-  if (!writeI2C(link, MSNP_I2CRequest, MSNP_I2CReply, 2))
+  if (!writeI2C(link, MSNP_I2CData[link].request, MSNP_I2CData[link].reply, 2))
     return -255;
 
-  keyPress = MSNP_I2CReply[0] + (MSNP_I2CReply[1] * 256);
+  keyPress = MSNP_I2CData[link].reply[0] + (MSNP_I2CData[link].reply[1] * 256);
 
   for (short i=0; i < 12; i++) {
     if (keyPress & (1<<i)) {
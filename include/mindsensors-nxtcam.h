@@ -23,6 +23,7 @@
  *        Added extra wait times after each issued command in init functions
  * - 1.4: Removed printDebugLine from driver
  * - 1.5: Added ability to specify I2C address with optional argument.  Defaults to 0x02 when not specified.
+ * - 1.6: Request and reply buffers are now kept per port in NXTCAM_I2CData[]
  *
  * License: You may use this code as you wish, provided you give credit where it's due.
  *
@@ -31,7 +32,7 @@
  * \author Xander Soldaat
  * \author Gordon Wyeth
  * \date 03 Dec 2010
- * \version 1.5
+ * \version 1.6
  * \example mindsensors-nxtcam-test1.c
  */
 
@@ -69,8 +70,7 @@ typedef struct {
 /*! Array of blob as a typedef, this is a work around for RobotC's inability to pass an array to a function */
 typedef blob blob_array[MAX_BLOBS];
 
-tByteArray NXTCAM_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray NXTCAM_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData NXTCAM_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 // "public" functions
 bool NXTCAMinit(tSensors link, ubyte address = NXTCAM_I2C_ADDR);
@@ -107,12 +107,12 @@ bool still_merging = false;
  * @return true if no error occured, false if it did
  */
 bool _camera_cmd(tSensors link, byte cmd, ubyte address) {
-  NXTCAM_I2CRequest[0] = 3;                 // Message size
-  NXTCAM_I2CRequest[1] = address;           // I2C Address
-  NXTCAM_I2CRequest[2] = NXTCAM_CMD_REG;    // Register used for issuing commands
-  NXTCAM_I2CRequest[3] = cmd;               // Command to be executed
+  NXTCAM_I2CData[link].request[0] = 3;                 // Message size
+  NXTCAM_I2CData[link].request[1] = address;           // I2C Address
+  NXTCAM_I2CData[link].request[2] = NXTCAM_CMD_REG;    // Register used for issuing commands
+  NXTCAM_I2CData[link].request[3] = cmd;               // Command to be executed
 
-  return writeI2C(link, NXTCAM_I2CRequest);
+  return writeI2C(link, NXTCAM_I2CData[link].request);
 }
 
 /**
@@ -274,14 +274,14 @@ short NXTCAMgetBlobs(tSensors link, blob_array &blobs, ubyte address) {
   memset(blobs, 0, sizeof(blob_array));
 
   // Request number of blobs from the count register
-  NXTCAM_I2CRequest[0] = 2;                 // Message size
-  NXTCAM_I2CRequest[1] = address;           // I2C Address
-  NXTCAM_I2CRequest[2] = NXTCAM_COUNT_REG;  // Register used to hold number of blobs detected
+  NXTCAM_I2CData[link].request[0] = 2;                 // Message size
+  NXTCAM_I2CData[link].request[1] = address;           // I2C Address
+  NXTCAM_I2CData[link].request[2] = NXTCAM_COUNT_REG;  // Register used to hold number of blobs detected
 
-  if (!writeI2C(link, NXTCAM_I2CRequest, NXTCAM_I2CReply, 1))
+  if (!writeI2C(link, NXTCAM_I2CData[link].request, NXTCAM_I2CData[link].reply, 1))
     return -1;
 
-  _nblobs = NXTCAM_I2CReply[0];
+  _nblobs = NXTCAM_I2CData[link].reply[0];
   if (_nblobs > MAX_BLOBS) {
     return -1;
   }
@@ -290,19 +290,19 @@ short NXTCAMgetBlobs(tSensors link, blob_array &blobs, ubyte address) {
   for (short _i = 0; _i < _nblobs; _i++) {
 
     // Request blob data
-    NXTCAM_I2CRequest[0] = 2;                         // Message size
-    NXTCAM_I2CRequest[1] = address;           // I2C Address
-    NXTCAM_I2CRequest[2] = NXTCAM_DATA_REG + _i * 5;  // Register containing data pertaining to blob
+    NXTCAM_I2CData[link].request[0] = 2;                         // Message size
+    NXTCAM_I2CData[link].request[1] = address;           // I2C Address
+    NXTCAM_I2CData[link].request[2] = NXTCAM_DATA_REG + _i * 5;  // Register containing data pertaining to blob
 
-    if (!writeI2C(link, NXTCAM_I2CRequest, NXTCAM_I2CReply, 5))
+    if (!writeI2C(link, NXTCAM_I2CData[link].request, NXTCAM_I2CData[link].reply, 5))
       return -1;
 
     // Put the I2C data into the blob
-    blobs[_i].colour    = (short)NXTCAM_I2CReply[0];
-    blobs[_i].x1        = (short)NXTCAM_I2CReply[1];
-    blobs[_i].y1        = (short)NXTCAM_I2CReply[2];
-    blobs[_i].x2        = (short)NXTCAM_I2CReply[3];
-    blobs[_i].y2        = (short)NXTCAM_I2CReply[4];
+    blobs[_i].colour    = (short)NXTCAM_I2CData[link].reply[0];
+    blobs[_i].x1        = (short)NXTCAM_I2CData[link].reply[1];
+    blobs[_i].y1        = (short)NXTCAM_I2CData[link].reply[2];
+    blobs[_i].x2        = (short)NXTCAM_I2CData[link].reply[3];
+    blobs[_i].y2        = (short)NXTCAM_I2CData[link].reply[4];
     blobs[_i].size      = abs(blobs[_i].x2 - blobs[_i].x1) * abs(blobs[_i].y2 - blobs[_i].y1);
   }
 
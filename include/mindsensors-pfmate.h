@@ -12,6 +12,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSPFM_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -22,7 +23,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 22 July 2009
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-pfmate-test1.c
  */
 
@@ -60,7 +61,7 @@ bool MSPFMcontrolMotorA(tSensors link, byte chan, byte motor_op, byte motor_spee
 bool MSPFMcontrolMotorB(tSensors link, byte chan, byte motor_op, byte motor_speed, ubyte address = MSPFM_I2C_ADDR);
 bool MSPFMcontrolMotorAB(tSensors link, byte chan, byte motorA_op, byte motorA_speed, byte motorB_op, byte motorB_speed, ubyte address = MSPFM_I2C_ADDR);
 
-tByteArray MSPFM_I2CRequest;       /*!< Array to hold I2C command data */
+tI2CData MSPFM_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 /**
  * Control motor A with the PFMate.
@@ -110,26 +111,26 @@ bool MSPFMcontrolMotorAB(tSensors link, byte chan, byte motorA_op, byte motorA_s
   else if (motorB_op == MSPFM_NOOP)
     mselect = MSPFM_MOTORA;
 
-  memset(MSPFM_I2CRequest, 0, sizeof(tByteArray));
-  MSPFM_I2CRequest[0] = 8;
-  MSPFM_I2CRequest[1] = address;
-  MSPFM_I2CRequest[2] = MSPFM_IRCHAN;
-  MSPFM_I2CRequest[3] = chan;
-  MSPFM_I2CRequest[4] = mselect;
-  MSPFM_I2CRequest[5] = motorA_op;
-  MSPFM_I2CRequest[6] = motorA_speed;
-  MSPFM_I2CRequest[7] = motorB_op;
-  MSPFM_I2CRequest[8] = motorB_speed;
-
-  if (!writeI2C(link, MSPFM_I2CRequest))
+  memset(MSPFM_I2CData[link].request, 0, sizeof(MSPFM_I2CData[link].request));
+  MSPFM_I2CData[link].request[0] = 8;
+  MSPFM_I2CData[link].request[1] = address;
+  MSPFM_I2CData[link].request[2] = MSPFM_IRCHAN;
+  MSPFM_I2CData[link].request[3] = chan;
+  MSPFM_I2CData[link].request[4] = mselect;
+  MSPFM_I2CData[link].request[5] = motorA_op;
+  MSPFM_I2CData[link].request[6] = motorA_speed;
+  MSPFM_I2CData[link].request[7] = motorB_op;
+  MSPFM_I2CData[link].request[8] = motorB_speed;
+
+  if (!writeI2C(link, MSPFM_I2CData[link].request))
     return false;
 
-  MSPFM_I2CRequest[0] = 3;
-  MSPFM_I2CRequest[1] = address;
-  MSPFM_I2CRequest[2] = MSPFM_CMD;
-  MSPFM_I2CRequest[3] = MSPFM_GOCMD;
+  MSPFM_I2CData[link].request[0] = 3;
+  MSPFM_I2CData[link].request[1] = address;
+  MSPFM_I2CData[link].request[2] = MSPFM_CMD;
+  MSPFM_I2CData[link].request[3] = MSPFM_GOCMD;
 
-  return writeI2C(link, MSPFM_I2CRequest);
+  return writeI2C(link, MSPFM_I2CData[link].request);
 }
 
 #endif // __MSPFM_H__
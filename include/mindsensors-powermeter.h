@@ -15,6 +15,7 @@
  *
  * Changelog:
  *  - 0.1 Initial  release.
+ *  - 0.2 Request and reply buffers are now kept per port in MSPM_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -25,7 +26,7 @@
 
  * \author Xander Soldaat
  * \date 16 December 2009
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-powermeter-test1.c
  */
 
@@ -46,8 +47,7 @@
 #define MSPM_CAPUSED       0x46  /*!< Capacity used since last reset in mAh - 2 bytes */
 #define MSPM_TIME         0x56  /*!< Time since last reset  in ms - 4 bytes (long) */
 
-tByteArray MSPM_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray MSPM_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData MSPM_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 //*******************************************************************************
 // PUBLIC Power Meter functions
@@ -73,12 +73,12 @@ bool _MSPMsendCommand(tSensors link, byte command, ubyte address);
  * @return true if no error occured, false if it did
  */
 bool _MSPMsendCommand(tSensors link, byte command, ubyte address) {
-  MSPM_I2CRequest[0] = 3;               // Message size
-  MSPM_I2CRequest[1] = address;         // I2C Address
-  MSPM_I2CRequest[2] = MSPM_CMD_REG;    // Register used for issuing commands
-  MSPM_I2CRequest[3] = command;         // Command to be executed
+  MSPM_I2CData[link].request[0] = 3;               // Message size
+  MSPM_I2CData[link].request[1] = address;         // I2C Address
+  MSPM_I2CData[link].request[2] = MSPM_CMD_REG;    // Register used for issuing commands
+  MSPM_I2CData[link].request[3] = command;         // Command to be executed
 
-  return writeI2C(link, MSPM_I2CRequest);
+  return writeI2C(link, MSPM_I2CData[link].request);
 }
 
 /**
@@ -88,16 +88,16 @@ bool _MSPMsendCommand(tSensors link, byte command, ubyte address) {
  * @return the present current measured or -1 if an error occurred.
  */
 short MSPMreadCurrent(tSensors link, ubyte address) {
-  memset(MSPM_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPM_I2CData[link].request, 0, sizeof(MSPM_I2CData[link].request));
 
-  MSPM_I2CRequest[0] = 2;             // Message size
-  MSPM_I2CRequest[1] = address;       // I2C Address
-  MSPM_I2CRequest[2] = MSPM_PCURRENT; // Present current register
+  MSPM_I2CData[link].request[0] = 2;             // Message size
+  MSPM_I2CData[link].request[1] = address;       // I2C Address
+  MSPM_I2CData[link].request[2] = MSPM_PCURRENT; // Present current register
 
-  if (!writeI2C(link, MSPM_I2CRequest, MSPM_I2CReply, 2))
+  if (!writeI2C(link, MSPM_I2CData[link].request, MSPM_I2CData[link].reply, 2))
     return -1;
 
-  return (MSPM_I2CReply[0] + (MSPM_I2CReply[1]<<8));
+  return (MSPM_I2CData[link].reply[0] + (MSPM_I2CData[link].reply[1]<<8));
 }
 
 /**
@@ -107,16 +107,16 @@ short MSPMreadCurrent(tSensors link, ubyte address) {
  * @return the present voltage measured or -1 if an error occurred.
  */
 short MSPMreadVoltage(tSensors link, ubyte address) {
-  memset(MSPM_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPM_I2CData[link].request, 0, sizeof(MSPM_I2CData[link].request));
 
-  MSPM_I2CRequest[0] = 2;             // Message size
-  MSPM_I2CRequest[1] = address;       // I2C Address
-  MSPM_I2CRequest[2] = MSPM_PVOLTAGE; // Present voltage register
+  MSPM_I2CData[link].request[0] = 2;             // Message size
+  MSPM_I2CData[link].request[1] = address;       // I2C Address
+  MSPM_I2CData[link].request[2] = MSPM_PVOLTAGE; // Present voltage register
 
-  if (!writeI2C(link, MSPM_I2CRequest, MSPM_I2CReply, 2))
+  if (!writeI2C(link, MSPM_I2CData[link].request, MSPM_I2CData[link].reply, 2))
     return -1;
 
-  return (MSPM_I2CReply[0] + (MSPM_I2CReply[1]<<8));
+  return (MSPM_I2CData[link].reply[0] + (MSPM_I2CData[link].reply[1]<<8));
 }
 
 /**
@@ -129,17 +129,17 @@ short MSPMreadVoltage(tSensors link, ubyte address) {
  * @return the present voltage measured or -1 if an error occurred.
  */
 bool MSPMreadVoltageCurrent(tSensors link, short &voltage, short &current, ubyte address) {
-  memset(MSPM_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPM_I2CData[link].request, 0, sizeof(MSPM_I2CData[link].request));
 
-  MSPM_I2CRequest[0] = 2;             // Message size
-  MSPM_I2CRequest[1] = address;       // I2C Address
-  MSPM_I2CRequest[2] = MSPM_PCURRENT; // Present current register
+  MSPM_I2CData[link].request[0] = 2;             // Message size
+  MSPM_I2CData[link].request[1] = address;       // I2C Address
+  MSPM_I2CData[link].request[2] = MSPM_PCURRENT; // Present current register
 
-  if (!writeI2C(link, MSPM_I2CRequest, MSPM_I2CReply, 4))
+  if (!writeI2C(link, MSPM_I2CData[link].request, MSPM_I2CData[link].reply, 4))
     return false;
 
-  current = MSPM_I2CReply[0] + (MSPM_I2CReply[1]<<8);
-  voltage = MSPM_I2CReply[2] + (MSPM_I2CReply[3]<<8);
+  current = MSPM_I2CData[link].reply[0] + (MSPM_I2CData[link].reply[1]<<8);
+  voltage = MSPM_I2CData[link].reply[2] + (MSPM_I2CData[link].reply[3]<<8);
   return true;
 }
 
@@ -150,17 +150,17 @@ bool MSPMreadVoltageCurrent(tSensors link, short &voltage, short &current, ubyte
  * @return the time elapsed in ms since the last reset.
  */
 long MSPMreadTime(tSensors link, ubyte address) {
-  memset(MSPM_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPM_I2CData[link].request, 0, sizeof(MSPM_I2CData[link].request));
 
-  MSPM_I2CRequest[0] = 2;             // Message size
-  MSPM_I2CRequest[1] = address;       // I2C Address
-  MSPM_I2CRequest[2] = MSPM_TIME;     // Present voltage register
+  MSPM_I2CData[link].request[0] = 2;             // Message size
+  MSPM_I2CData[link].request[1] = address;       // I2C Address
+  MSPM_I2CData[link].request[2] = MSPM_TIME;     // Present voltage register
 
-  if (!writeI2C(link, MSPM_I2CRequest, MSPM_I2CReply, 4))
+  if (!writeI2C(link, MSPM_I2CData[link].request, MSPM_I2CData[link].reply, 4))
     return -1;
 
-  return (((long)MSPM_I2CReply[3] << 24) + ((long)MSPM_I2CReply[2] << 16) + ((long)MSPM_I2CReply[1] <<  8) + (long)MSPM_I2CReply[0]);
-  // return uByteToLong(MSPM_I2CReply[3], MSPM_I2CReply[2], MSPM_I2CReply[1], MSPM_I2CReply[0]);
+  return (((long)MSPM_I2CData[link].reply[3] << 24) + ((long)MSPM_I2CData[link].reply[2] << 16) + ((long)MSPM_I2CData[link].reply[1] <<  8) + (long)MSPM_I2CData[link].reply[0]);
+  // return uByteToLong(MSPM_I2CData[link].reply[3], MSPM_I2CData[link].reply[2], MSPM_I2CData[link].reply[1], MSPM_I2CData[link].reply[0]);
 }
 
 /**
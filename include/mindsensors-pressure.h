@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSPPS_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 01 January 2012
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-pressure-test1.c
  */
 
@@ -64,8 +65,7 @@ bool MSPPSsetRefPressure(tSensors link, short refpressure);
 #define MSPPSsetUnitmB(X)   MSPPSsetUnit(X, MSPPS_UNIT_MB)
 #define MSPPSsetUnitkPa(X)  MSPPSsetUnit(X, MSPPS_UNIT_KPA)
 
-tByteArray MSPPS_I2CRequest;       /*!< Array to hold I2C command data */
-tByteArray MSPPS_I2CReply;         /*!< Array to hold I2C reply data */
+tI2CData MSPPS_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 /**
  * Read the pressure from the sensor and return it in the
@@ -78,16 +78,16 @@ tByteArray MSPPS_I2CReply;         /*!< Array to hold I2C reply data */
  */
 long MSPPSreadPressure(tSensors link, ubyte reg)
 {
-  memset(MSPPS_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPPS_I2CData[link].request, 0, sizeof(MSPPS_I2CData[link].request));
 
-  MSPPS_I2CRequest[0] = 2;               // Number of bytes in I2C command
-  MSPPS_I2CRequest[1] = MSPPS_I2C_ADDR;   // I2C address of accel sensor
-  MSPPS_I2CRequest[2] = reg;     // Set write address to sensor mode register
+  MSPPS_I2CData[link].request[0] = 2;               // Number of bytes in I2C command
+  MSPPS_I2CData[link].request[1] = MSPPS_I2C_ADDR;   // I2C address of accel sensor
+  MSPPS_I2CData[link].request[2] = reg;     // Set write address to sensor mode register
 
-  if (!writeI2C(link, MSPPS_I2CRequest, MSPPS_I2CReply, 2))
+  if (!writeI2C(link, MSPPS_I2CData[link].request, MSPPS_I2CData[link].reply, 2))
     return 0;
 
-  return ((long)MSPPS_I2CReply[1] * 256) + MSPPS_I2CReply[0];
+  return ((long)MSPPS_I2CData[link].reply[1] * 256) + MSPPS_I2CData[link].reply[0];
 }
 
 /**
@@ -132,15 +132,15 @@ long MSPPSreadRefPressure(tSensors link)
  */
 bool MSPPSsetRefPressure(tSensors link, short refpressure)
 {
-  memset(MSPPS_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPPS_I2CData[link].request, 0, sizeof(MSPPS_I2CData[link].request));
 
-  MSPPS_I2CRequest[0] = 4;                         // Number of bytes in I2C command
-  MSPPS_I2CRequest[1] = MSPPS_I2C_ADDR;            // I2C address of accel sensor
-  MSPPS_I2CRequest[2] = MSPPS_PRESS_REF;           // Set write address to sensor mode register
-  MSPPS_I2CRequest[3] = refpressure & 0xFF;         // Command to be sent to the sensor
-  MSPPS_I2CRequest[4] = (refpressure << 8) & 0xFF;  // Command to be sent to the sensor
+  MSPPS_I2CData[link].request[0] = 4;                         // Number of bytes in I2C command
+  MSPPS_I2CData[link].request[1] = MSPPS_I2C_ADDR;            // I2C address of accel sensor
+  MSPPS_I2CData[link].request[2] = MSPPS_PRESS_REF;           // Set write address to sensor mode register
+  MSPPS_I2CData[link].request[3] = refpressure & 0xFF;         // Command to be sent to the sensor
+  MSPPS_I2CData[link].request[4] = (refpressure << 8) & 0xFF;  // Command to be sent to the sensor
 
-  return writeI2C(link, MSPPS_I2CRequest);
+  return writeI2C(link, MSPPS_I2CData[link].request);
 }
 
 /**
@@ -160,14 +160,14 @@ bool MSPPSsetRefPressure(tSensors link)
  * @return true if no error occured, false if it did
  */
 bool MSPPSsendCmd(tSensors link, ubyte command) {
-  memset(MSPPS_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPPS_I2CData[link].request, 0, sizeof(MSPPS_I2CData[link].request));
 
-  MSPPS_I2CRequest[0] = 3;               // Number of bytes in I2C command
-  MSPPS_I2CRequest[1] = MSPPS_I2C_ADDR;   // I2C address of accel sensor
-  MSPPS_I2CRequest[2] = MSPPS_CMD;        // Set write address to sensor mode register
-  MSPPS_I2CRequest[3] = command;         // Command to be sent to the sensor
+  MSPPS_I2CData[link].request[0] = 3;               // Number of bytes in I2C command
+  MSPPS_I2CData[link].request[1] = MSPPS_I2C_ADDR;   // I2C address of accel sensor
+  MSPPS_I2CData[link].request[2] = MSPPS_CMD;        // Set write address to sensor mode register
+  MSPPS_I2CData[link].request[3] = command;         // Command to be sent to the sensor
 
-  return writeI2C(link, MSPPS_I2CRequest);
+  return writeI2C(link, MSPPS_I2CData[link].request);
 }
 
 /**
@@ -177,14 +177,14 @@ bool MSPPSsendCmd(tSensors link, ubyte command) {
  * @return true if no error occured, false if it did
  */
 bool MSPPSsetUnit(tSensors link, ubyte unit) {
-  memset(MSPPS_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSPPS_I2CData[link].request, 0, sizeof(MSPPS_I2CData[link].request));
 
-  MSPPS_I2CRequest[0] = 3;               // Number of bytes in I2C command
-  MSPPS_I2CRequest[1] = MSPPS_I2C_ADDR;   // I2C address of accel sensor
-  MSPPS_I2CRequest[2] = MSPPS_UNIT;        // Set write address to sensor mode register
-  MSPPS_I2CRequest[3] = unit;         // Command to be sent to the sensor
+  MSPPS_I2CData[link].request[0] = 3;               // Number of bytes in I2C command
+  MSPPS_I2CData[link].request[1] = MSPPS_I2C_ADDR;   // I2C address of accel sensor
+  MSPPS_I2CData[link].request[2] = MSPPS_UNIT;        // Set write address to sensor mode register
+  MSPPS_I2CData[link].request[3] = unit;         // Command to be sent to the sensor
 
-  return writeI2C(link, MSPPS_I2CRequest);
+  return writeI2C(link, MSPPS_I2CData[link].request);
 }
 
 #endif //__MSPPS_H__
@@ -15,6 +15,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in PSPV4_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -25,7 +26,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 30 July 2012
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-ps2ctrl-v4-test1.c
  * \example mindsensors-ps2ctrl-v4-test2.c
  */
@@ -70,8 +71,7 @@
 #define PSPV4_SIGNAL_PLAY           0x35    /*!< Referee Signal 'play' */
 #define PSPV4_SIGNAL_STOP           0x36    /*!< Referee Signal 'stop' */
 
-tByteArray PSPV4_I2CRequest;     /*!< Array to hold I2C command data */
-tByteArray PSPV4_I2CReply;       /*!< Array to hold I2C reply data */
+tI2CData PSPV4_I2CData[4];       /*!< Per-port I2C request and reply buffers */
 
 bool PSPV4initalised[4] = {false, false, false, false};
 
@@ -112,12 +112,12 @@ tPSP pspController;
  */
 bool _PSPV4init(tSensors link, ubyte address = PSPV4_I2C_ADDR)
 {
-  PSPV4_I2CRequest[0] = 3;                   // Message size
-  PSPV4_I2CRequest[1] = address ;            // I2C Address
-  PSPV4_I2CRequest[2] = 0x41;                // Register address
-  PSPV4_I2CRequest[3] = PSPV4_CMD_INITIALISE; // Register address
+  PSPV4_I2CData[link].request[0] = 3;                   // Message size
+  PSPV4_I2CData[link].request[1] = address ;            // I2C Address
+  PSPV4_I2CData[link].request[2] = 0x41;                // Register address
+  PSPV4_I2CData[link].request[3] = PSPV4_CMD_INITIALISE; // Register address
 
-  if (!writeI2C(link, PSPV4_I2CRequest))
+  if (!writeI2C(link, PSPV4_I2CData[link].request))
   {
     return false;
   }
@@ -145,16 +145,16 @@ ubyte _PSPV4readByte (tSensors link, ubyte reg, ubyte address = PSPV4_I2C_ADDR)
     _PSPV4init(link, address);
   }
 
-  memset(PSPV4_I2CRequest, 0, sizeof(PSPV4_I2CRequest));
+  memset(PSPV4_I2CData[link].request, 0, sizeof(PSPV4_I2CData[link].request));
 
-  PSPV4_I2CRequest[0] = 2;                   // Message size
-  PSPV4_I2CRequest[1] = address;  // I2C Address
-  PSPV4_I2CRequest[2] = reg;            // Register address
+  PSPV4_I2CData[link].request[0] = 2;                   // Message size
+  PSPV4_I2CData[link].request[1] = address;  // I2C Address
+  PSPV4_I2CData[link].request[2] = reg;            // Register address
 
-  if (!writeI2C(link, PSPV4_I2CRequest, PSPV4_I2CReply, 1))
+  if (!writeI2C(link, PSPV4_I2CData[link].request, PSPV4_I2CData[link].reply, 1))
     return 0;
 
-  return PSPV4_I2CReply[0];
+  return PSPV4_I2CData[link].reply[0];
 }
 
 /**
@@ -176,18 +176,18 @@ bool PSPV4readButtons(tSensors link, tPSP &controllerState, ubyte address = PSPV
     _PSPV4init(link, address);
   }
 
-  memset(PSPV4_I2CRequest, 0, sizeof(PSPV4_I2CRequest));
+  memset(PSPV4_I2CData[link].request, 0, sizeof(PSPV4_I2CData[link].request));
   memset(controllerState, 0, sizeof(controllerState));
 
-  PSPV4_I2CRequest[0] = 2;                   // Message size
-  PSPV4_I2CRequest[1] = address;             // I2C Address
-  PSPV4_I2CRequest[2] = PSPV4_REG_BTN_SET_1;      // Register address
+  PSPV4_I2CData[link].request[0] = 2;                   // Message size
+  PSPV4_I2CData[link].request[1] = address;             // I2C Address
+  PSPV4_I2CData[link].request[2] = PSPV4_REG_BTN_SET_1;      // Register address
 
-  if (!writeI2C(link, PSPV4_I2CRequest, PSPV4_I2CReply, 6))
+  if (!writeI2C(link, PSPV4_I2CData[link].request, PSPV4_I2CData[link].reply, 6))
     return false;
 
-  b0 = ~PSPV4_I2CReply[0];
-  b1 = ~PSPV4_I2CReply[1];
+  b0 = ~PSPV4_I2CData[link].reply[0];
+  b1 = ~PSPV4_I2CData[link].reply[1];
 
   controllerState.selectBtn         = (b0 >> 0) & 0x01;
   controllerState.joystickLeftBtn   = (b0 >> 1) & 0x01;
@@ -207,10 +207,10 @@ bool PSPV4readButtons(tSensors link, tPSP &controllerState, ubyte address = PSPV
   controllerState.crossBtn          = (b1 >> 6) & 0x01;
   controllerState.squareBtn         = (b1 >> 7) & 0x01;
 
-  controllerState.joystickLeft_x    = (((long)PSPV4_I2CReply[2] - 128) * 100)/128;
-  controllerState.joystickLeft_y    = (((long)PSPV4_I2CReply[3] - 128) * 100)/128;
-  controllerState.joystickRight_x   = (((long)PSPV4_I2CReply[4] - 128) * 100)/128;
-  controllerState.joystickRight_y   = (((long)PSPV4_I2CReply[5] - 128) * 100)/128;
+  controllerState.joystickLeft_x    = (((long)PSPV4_I2CData[link].reply[2] - 128) * 100)/128;
+  controllerState.joystickLeft_y    = (((long)PSPV4_I2CData[link].reply[3] - 128) * 100)/128;
+  controllerState.joystickRight_x   = (((long)PSPV4_I2CData[link].reply[4] - 128) * 100)/128;
+  controllerState.joystickRight_y   = (((long)PSPV4_I2CData[link].reply[5] - 128) * 100)/128;
 
   return true;
 }
@@ -236,27 +236,27 @@ bool PSPV4readButtonPressure(tSensors link, tPSP &controllerState,  ubyte addres
     return false;
   }
 
-  memset(PSPV4_I2CRequest, 0, sizeof(PSPV4_I2CRequest));
-  PSPV4_I2CRequest[0] = 2;                   // Message size
-  PSPV4_I2CRequest[1] = address;  // I2C Address
-  PSPV4_I2CRequest[2] = PSPV4_REG_PRES_JPAD_UP;            // Register address
+  memset(PSPV4_I2CData[link].request, 0, sizeof(PSPV4_I2CData[link].request));
+  PSPV4_I2CData[link].request[0] = 2;                   // Message size
+  PSPV4_I2CData[link].request[1] = address;  // I2C Address
+  PSPV4_I2CData[link].request[2] = PSPV4_REG_PRES_JPAD_UP;            // Register address
 
-  if (!writeI2C(link, PSPV4_I2CRequest, PSPV4_I2CReply, 12))
+  if (!writeI2C(link, PSPV4_I2CData[link].request, PSPV4_I2CData[link].reply, 12))
     return false;
 
-  controllerState.joypadUp          = (PSPV4_I2CReply[0]  * 100) / 255;
-  controllerState.joypadRight       = (PSPV4_I2CReply[1]  * 100) / 255;
-  controllerState.joypadDown        = (PSPV4_I2CReply[2]  * 100) / 255;
-  controllerState.joypadLeft        = (PSPV4_I2CReply[3]  * 100) / 255;
+  controllerState.joypadUp          = (PSPV4_I2CData[link].reply[0]  * 100) / 255;
+  controllerState.joypadRight       = (PSPV4_I2CData[link].reply[1]  * 100) / 255;
+  controllerState.joypadDown        = (PSPV4_I2CData[link].reply[2]  * 100) / 255;
+  controllerState.joypadLeft        = (PSPV4_I2CData[link].reply[3]  * 100) / 255;
 
-  controllerState.left2Btn          = (PSPV4_I2CReply[4]  * 100) / 255;
-  controllerState.rigth2Btn         = (PSPV4_I2CReply[5]  * 100) / 255;
-  controllerState.left1Btn          = (PSPV4_I2CReply[6]  * 100) / 255;
-  controllerState.right1Btn         = (PSPV4_I2CReply[7]  * 100) / 255;
-  controllerState.triangleBtn       = (PSPV4_I2CReply[8]  * 100) / 255;
-  controllerState.circleBtn         = (PSPV4_I2CReply[9]  * 100) / 255;
-  controllerState.crossBtn          = (PSPV4_I2CReply[10] * 100) / 255;
-  controllerState.squareBtn         = (PSPV4_I2CReply[11] * 100) / 255;
+  controllerState.left2Btn          = (PSPV4_I2CData[link].reply[4]  * 100) / 255;
+  controllerState.rigth2Btn         = (PSPV4_I2CData[link].reply[5]  * 100) / 255;
+  controllerState.left1Btn          = (PSPV4_I2CData[link].reply[6]  * 100) / 255;
+  controllerState.right1Btn         = (PSPV4_I2CData[link].reply[7]  * 100) / 255;
+  controllerState.triangleBtn       = (PSPV4_I2CData[link].reply[8]  * 100) / 255;
+  controllerState.circleBtn         = (PSPV4_I2CData[link].reply[9]  * 100) / 255;
+  controllerState.crossBtn          = (PSPV4_I2CData[link].reply[10] * 100) / 255;
+  controllerState.squareBtn         = (PSPV4_I2CData[link].reply[11] * 100) / 255;
 
   return true;
 }
@@ -316,16 +316,16 @@ long PSPV4readRawRefTXValue(tSensors link, ubyte address = PSPV4_I2C_ADDR)
     _PSPV4init(link, address);
   }
 
-  memset(PSPV4_I2CRequest, 0, sizeof(PSPV4_I2CRequest));
+  memset(PSPV4_I2CData[link].request, 0, sizeof(PSPV4_I2CData[link].request));
 
-  PSPV4_I2CRequest[0] = 2;                        // Message size
-  PSPV4_I2CRequest[1] = address;                  // I2C Address
-  PSPV4_I2CRequest[2] = PSPV4_REG_REF_SIGNAL_RAW; // Register address
+  PSPV4_I2CData[link].request[0] = 2;                        // Message size
+  PSPV4_I2CData[link].request[1] = address;                  // I2C Address
+  PSPV4_I2CData[link].request[2] = PSPV4_REG_REF_SIGNAL_RAW; // Register address
 
-  if (!writeI2C(link, PSPV4_I2CRequest, PSPV4_I2CReply, 4))
+  if (!writeI2C(link, PSPV4_I2CData[link].request, PSPV4_I2CData[link].reply, 4))
     return 0;
 
-  return PSPV4_I2CReply[0] + (PSPV4_I2CReply[1]<<8) + (PSPV4_I2CReply[2]<<16) + (PSPV4_I2CReply[3]<<24);
+  return PSPV4_I2CData[link].reply[0] + (PSPV4_I2CData[link].reply[1]<<8) + (PSPV4_I2CData[link].reply[2]<<16) + (PSPV4_I2CData[link].reply[3]<<24);
 }
 
 #endif // __PSPV4_H__
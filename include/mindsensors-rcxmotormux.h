@@ -45,7 +45,7 @@ typedef enum tMSMTRMXMotors {
   MSMTRMX_M4 = 3
 } tMSMTRMXMotors;
 
-tByteArray MSMTRMX_I2CMessage;       /*!< Array to hold I2C command data */
+tI2CData MSMTRMX_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 /*! Function prototypes */
 bool MSMTRMX_Control(tSensors link, tMSMTRMXMotors channel, short power, ubyte address = MSMTRMX_I2C_ADDR);
@@ -76,15 +76,15 @@ bool MSMTRMX_Control(tSensors link, tMSMTRMXMotors channel, short power, ubyte a
     dir = MSMTRMX_MODE_FORWARD;
   }
 
-  memset(MSMTRMX_I2CMessage, 0, sizeof(tByteArray));
+  memset(MSMTRMX_I2CData[link].request, 0, sizeof(MSMTRMX_I2CData[link].request));
 
-  MSMTRMX_I2CMessage[0] = 4;
-  MSMTRMX_I2CMessage[1] = address;
-  MSMTRMX_I2CMessage[2] = MSMTRMX_MOTOR_REG + channel * 2;
-  MSMTRMX_I2CMessage[3] = (ubyte) dir;
-  MSMTRMX_I2CMessage[4] = power;
+  MSMTRMX_I2CData[link].request[0] = 4;
+  MSMTRMX_I2CData[link].request[1] = address;
+  MSMTRMX_I2CData[link].request[2] = MSMTRMX_MOTOR_REG + channel * 2;
+  MSMTRMX_I2CData[link].request[3] = (ubyte) dir;
+  MSMTRMX_I2CData[link].request[4] = power;
 
-  if (!writeI2C(link, MSMTRMX_I2CMessage)) {
+  if (!writeI2C(link, MSMTRMX_I2CData[link].request)) {
     return false;
   }
 
@@ -101,15 +101,15 @@ bool MSMTRMX_Control(tSensors link, tMSMTRMXMotors channel, short power, ubyte a
  */
 bool MSMTRMX_Brake(tSensors link, tMSMTRMXMotors channel, unsigned byte brakeForce, ubyte address) {
 
-  memset(MSMTRMX_I2CMessage, 0, sizeof(tByteArray));
+  memset(MSMTRMX_I2CData[link].request, 0, sizeof(MSMTRMX_I2CData[link].request));
 
-  MSMTRMX_I2CMessage[0] = 4;
-  MSMTRMX_I2CMessage[1] = address;
-  MSMTRMX_I2CMessage[2] = MSMTRMX_MOTOR_REG + channel * 2;
-  MSMTRMX_I2CMessage[3] = (ubyte) MSMTRMX_MODE_BRAKE;
-  MSMTRMX_I2CMessage[4] = brakeForce;
+  MSMTRMX_I2CData[link].request[0] = 4;
+  MSMTRMX_I2CData[link].request[1] = address;
+  MSMTRMX_I2CData[link].request[2] = MSMTRMX_MOTOR_REG + channel * 2;
+  MSMTRMX_I2CData[link].request[3] = (ubyte) MSMTRMX_MODE_BRAKE;
+  MSMTRMX_I2CData[link].request[4] = brakeForce;
 
-  if (!writeI2C(link, MSMTRMX_I2CMessage)) {
+  if (!writeI2C(link, MSMTRMX_I2CData[link].request)) {
     return false;
   }
 
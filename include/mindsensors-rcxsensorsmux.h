@@ -12,6 +12,10 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSRXMUX_I2CData[]
+ * - 0.3: Added a scan scheduler task that cycles through the subscribed channels in the background,
+ *        see MSRXMUXsubscribe() (__MSRXMUX_SCHEDULER__)
+ * - 0.4: The scan scheduler is now opt-in, define __MSRXMUX_SCHEDULER__ as 1 to use it
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -22,8 +26,9 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 30 August 2009
- * \version 0.1
+ * \version 0.4
  * \example mindsensors-rcxsensorsmux-test1.c
+ * \example mindsensors-rcxsensorsmux-test2.c
  */
 
 #pragma systemFile
@@ -35,6 +40,11 @@
 #include "common.h"
 #endif
 
+/*!< define this as 1 to add the scan scheduler task */
+#ifndef __MSRXMUX_SCHEDULER__
+#define __MSRXMUX_SCHEDULER__ 0
+#endif
+
 #define MSRXMUX_I2C_ADDR  0x7E      /*!< I2C address for sensor */
 #define MSRXMUX_CHAN1     0xFE      /*!< Select MUX channel 1 */
 #define MSRXMUX_CHAN2     0xFD      /*!< Select MUX channel 2 */
@@ -42,7 +52,10 @@
 #define MSRXMUX_CHAN4     0xF7      /*!< Select MUX channel 4 */
 #define MSRXMUX_NONE      0xFF      /*!< Deselect all MUX channels */
 
-tByteArray MSRXMUX_I2CRequest;       /*!< Array to hold I2C command data */
+#define MSRXMUX_HOLD_INTERVAL 5     /*!< Time between two samples when only one channel is subscribed, in ms */
+#define MSRXMUX_WAIT_TIMEOUT  500   /*!< Time MSRXMUXreadChan() waits for the first value of a channel, in ms */
+
+tI2CData MSRXMUX_I2CData[4];         /*!< Per-port I2C request and reply buffers */
 
 TSensorTypes RCXSensorTypes[4][4] = {{sensorNone, sensorNone, sensorNone, sensorNone},
                                      {sensorNone, sensorNone, sensorNone, sensorNone},
@@ -54,6 +67,28 @@ TSensorModes RCXSensorModes[4][4] = {{modeRaw, modeRaw, modeRaw, modeRaw},
                                      {modeRaw, modeRaw, modeRaw, modeRaw}};
 ubyte RCXSensorDelays[4][4] =        {{0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}};
 
+#if (__MSRXMUX_SCHEDULER__ == 1)
+/*!< Latest value of a channel, as sampled by the scan scheduler */
+typedef struct
+{
+  short value;                /*!< Value of the sensor */
+  long timestamp;             /*!< Time the value was sampled, in ms */
+  long count;                 /*!< Number of times the channel has been sampled since it was subscribed */
+} tMSRXMUXSample;
+
+tMSRXMUXSample MSRXMUXsamples[4][4];  /*!< Latest value of each channel */
+ubyte MSRXMUXsubscribed[4];           /*!< Bitmask of the subscribed channels of each port */
+byte MSRXMUXcurrChan[4];              /*!< Channel the MUX is switched to, 0 if unknown */
+long MSRXMUXreadyTime[4];             /*!< Time the current channel has settled, in ms */
+long MSRXMUXcycleStart[4];            /*!< Time the current cycle through the channels started, in ms */
+long MSRXMUXcycleTime[4];             /*!< Time the last cycle through the channels took, in ms */
+bool MSRXMUXschedulerRunning = false; /*!< The scheduler task is running */
+
+void MSRXMUXsubscribe(tSensors link, byte chan);
+void MSRXMUXunsubscribe(tSensors link, byte chan);
+bool MSRXMUXreadCached(tSensors link, byte chan, short &value, long &timestamp);
+#endif // __MSRXMUX_SCHEDULER__
+
 /**
  * Send a direct command to the MUX sensor
  *
@@ -74,32 +109,247 @@ void MSRXMUXsetupChan(tSensors link, ubyte chan, TSensorTypes chantype, TSensorM
   RCXSensorDelays[link][chan-1] = delay;
 }
 
-short MSRXMUXreadChan(tSensors link, byte chan) {
+/**
+ * Switch the MUX to a channel.  The port is set up for the MUX first, if needed.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the MUX port number
+ * @param chan the channel to switch to, 0 to deselect all channels
+ * @return true if no error occured, false if it did
+ */
+bool _MSRXMUXselectChan(tSensors link, byte chan) {
   if (SensorType[link] != sensorI2CCustom9V) {
     SensorType[link] = sensorI2CCustom9V;
     sleep(3);
   }
 
-  MSRXMUX_I2CRequest[0] = 2;
-  MSRXMUX_I2CRequest[1] = MSRXMUX_I2C_ADDR;
+  MSRXMUX_I2CData[link].request[0] = 2;
+  MSRXMUX_I2CData[link].request[1] = MSRXMUX_I2C_ADDR;
   switch(chan) {
-    case 0: MSRXMUX_I2CRequest[2] =  MSRXMUX_NONE; break;
-    case 1: MSRXMUX_I2CRequest[2] =  MSRXMUX_CHAN1; break;
-    case 2: MSRXMUX_I2CRequest[2] =  MSRXMUX_CHAN2; break;
-    case 3: MSRXMUX_I2CRequest[2] =  MSRXMUX_CHAN3; break;
-    case 4: MSRXMUX_I2CRequest[2] =  MSRXMUX_CHAN4; break;
-    default: MSRXMUX_I2CRequest[2] =  MSRXMUX_NONE;
+    case 0: MSRXMUX_I2CData[link].request[2] =  MSRXMUX_NONE; break;
+    case 1: MSRXMUX_I2CData[link].request[2] =  MSRXMUX_CHAN1; break;
+    case 2: MSRXMUX_I2CData[link].request[2] =  MSRXMUX_CHAN2; break;
+    case 3: MSRXMUX_I2CData[link].request[2] =  MSRXMUX_CHAN3; break;
+    case 4: MSRXMUX_I2CData[link].request[2] =  MSRXMUX_CHAN4; break;
+    default: MSRXMUX_I2CData[link].request[2] =  MSRXMUX_NONE;
   }
 
-  if (!writeI2C(link, MSRXMUX_I2CRequest))
-    return -1;
+  return writeI2C(link, MSRXMUX_I2CData[link].request);
+}
 
-  sleep((3+RCXSensorDelays[link][chan-1]) * 10);
+/**
+ * Set the port up for the sensor on a channel and read its value.  The MUX
+ * must have been switched to the channel and given time to settle.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the MUX port number
+ * @param chan the channel, 1-4
+ * @return the value of the sensor
+ */
+short _MSRXMUXsampleChan(tSensors link, byte chan) {
   SensorType[link] = RCXSensorTypes[link][chan-1];
   SensorMode[link] = RCXSensorModes[link][chan-1];
   return(SensorValue[link]);
 }
 
+/**
+ * Read the value of the sensor attached to a channel.  This switches the MUX
+ * to the channel and waits for it to settle, which takes at least 30ms.\n
+ * If the scan scheduler is running for the port, the latest value it sampled
+ * is returned instead.  A channel that was not subscribed yet is subscribed
+ * and its first value waited for.
+ * @param link the MUX port number
+ * @param chan the channel, 1-4
+ * @return the value of the sensor, -1 if an error occured
+ */
+short MSRXMUXreadChan(tSensors link, byte chan) {
+#if (__MSRXMUX_SCHEDULER__ == 1)
+  short value;
+  long timestamp;
+  long start = nPgmTime;
+
+  // The scheduler owns the port while it has channels subscribed on it
+  if (MSRXMUXsubscribed[link] != 0 && chan >= 1 && chan <= 4) {
+    if ((MSRXMUXsubscribed[link] & (1 << (chan - 1))) == 0)
+      MSRXMUXsubscribe(link, chan);
+
+    while (!MSRXMUXreadCached(link, chan, value, timestamp)) {
+      if (nPgmTime - start > MSRXMUX_WAIT_TIMEOUT)
+        return -1;
+      sleep(1);
+    }
+    return value;
+  }
+#endif // __MSRXMUX_SCHEDULER__
+
+  if (!_MSRXMUXselectChan(link, chan))
+    return -1;
+
+  sleep((3+RCXSensorDelays[link][chan-1]) * 10);
+  return _MSRXMUXsampleChan(link, chan);
+}
+
+#if (__MSRXMUX_SCHEDULER__ == 1)
+/**
+ * Find the next subscribed channel after the current one, wrapping around.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param subscribed bitmask of the subscribed channels
+ * @param chan the current channel, 0 if none
+ * @return the next subscribed channel, 1-4
+ */
+byte _MSRXMUXnextChan(ubyte subscribed, byte chan) {
+  byte next = chan;
+
+  for (short i = 0; i < 4; i++) {
+    next = (next % 4) + 1;
+    if ((subscribed & (1 << (next - 1))) != 0)
+      return next;
+  }
+  return chan;
+}
+
+/**
+ * Cycle through the subscribed channels of every port and publish the values.
+ * The ports are handled side by side: while one MUX is settling after a channel
+ * switch, the others are sampled.  When a port has only a single channel
+ * subscribed, the MUX is left on that channel and it is sampled every
+ * MSRXMUX_HOLD_INTERVAL ms.  The task ends by itself when nothing is subscribed.
+ */
+task MSRXMUXscheduler() {
+  bool enabled = true;
+  long wake;
+  ubyte subscribed;
+  byte chan;
+  byte next;
+  short value;
+
+  while (enabled) {
+    enabled = false;
+    wake = nPgmTime + MSRXMUX_HOLD_INTERVAL;
+
+    for (short link = 0; link < 4; link++) {
+      subscribed = MSRXMUXsubscribed[link];
+      if (subscribed == 0) {
+        MSRXMUXcurrChan[link] = 0;
+        continue;
+      }
+      enabled = true;
+
+      // Sample the current channel once the MUX has settled
+      chan = MSRXMUXcurrChan[link];
+      if (chan != 0 && (subscribed & (1 << (chan - 1))) != 0) {
+        if (nPgmTime < MSRXMUXreadyTime[link]) {
+          wake = min2(wake, MSRXMUXreadyTime[link]);
+          continue;
+        }
+
+        if (SensorType[link] != RCXSensorTypes[link][chan-1])
+          value = _MSRXMUXsampleChan((tSensors)link, chan);
+        else
+          value = SensorValue[link];
+
+        hogCPU();
+        MSRXMUXsamples[link][chan-1].value = value;
+        MSRXMUXsamples[link][chan-1].timestamp = nPgmTime;
+        MSRXMUXsamples[link][chan-1].count++;
+        releaseCPU();
+      }
+
+      // Stay on the channel if it's the only one
+      next = _MSRXMUXnextChan(subscribed, chan);
+      if (next == chan) {
+        MSRXMUXreadyTime[link] = nPgmTime + MSRXMUX_HOLD_INTERVAL;
+        MSRXMUXcycleTime[link] = MSRXMUX_HOLD_INTERVAL;
+        continue;
+      }
+
+      // Wrapping around to the first channel completes a cycle
+      if (next <= chan) {
+        MSRXMUXcycleTime[link] = nPgmTime - MSRXMUXcycleStart[link];
+        MSRXMUXcycleStart[link] = nPgmTime;
+      }
+
+      if (!_MSRXMUXselectChan((tSensors)link, next)) {
+        MSRXMUXcurrChan[link] = 0;
+        continue;
+      }
+      MSRXMUXcurrChan[link] = next;
+      MSRXMUXreadyTime[link] = nPgmTime + ((3 + RCXSensorDelays[link][next-1]) * 10);
+      wake = min2(wake, MSRXMUXreadyTime[link]);
+    }
+
+    // MSRXMUXsubscribe() must not see the task running after it decided to stop
+    hogCPU();
+    if (!enabled)
+      MSRXMUXschedulerRunning = false;
+    releaseCPU();
+
+    if (enabled && wake > nPgmTime)
+      sleep(wake - nPgmTime);
+  }
+}
+
+/**
+ * Add a channel to the ones the scan scheduler cycles through.  The scheduler
+ * task is started if it isn't running yet.  Set the channel up with
+ * MSRXMUXsetupChan() first.
+ * @param link the MUX port number
+ * @param chan the channel, 1-4
+ */
+void MSRXMUXsubscribe(tSensors link, byte chan) {
+  if (chan < 1 || chan > 4)
+    return;
+
+  hogCPU();
+  MSRXMUXsamples[link][chan-1].count = 0;
+  MSRXMUXsubscribed[link] |= (1 << (chan - 1));
+  if (!MSRXMUXschedulerRunning) {
+    MSRXMUXschedulerRunning = true;
+    startTask(MSRXMUXscheduler);
+  }
+  releaseCPU();
+}
+
+/**
+ * Remove a channel from the ones the scan scheduler cycles through.  The
+ * scheduler task ends by itself when no channels are subscribed.
+ * @param link the MUX port number
+ * @param chan the channel, 1-4
+ */
+void MSRXMUXunsubscribe(tSensors link, byte chan) {
+  if (chan < 1 || chan > 4)
+    return;
+
+  hogCPU();
+  MSRXMUXsubscribed[link] &= ~(1 << (chan - 1));
+  releaseCPU();
+}
+
+/**
+ * Get the latest value the scan scheduler sampled for a channel.
+ * @param link the MUX port number
+ * @param chan the channel, 1-4
+ * @param value the latest value of the sensor
+ * @param timestamp the time the value was sampled, in ms
+ * @return true if there was a value, false if the channel hasn't been sampled yet
+ */
+bool MSRXMUXreadCached(tSensors link, byte chan, short &value, long &timestamp) {
+  bool valid;
+
+  if (chan < 1 || chan > 4)
+    return false;
+
+  hogCPU();
+  value = MSRXMUXsamples[link][chan-1].value;
+  timestamp = MSRXMUXsamples[link][chan-1].timestamp;
+  valid = (MSRXMUXsamples[link][chan-1].count != 0);
+  releaseCPU();
+
+  return valid;
+}
+#endif // __MSRXMUX_SCHEDULER__
+
 #endif // __MSRXMUX_H__
 
 /* @} */
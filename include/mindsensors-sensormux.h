@@ -14,6 +14,14 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in MSMX_I2CData[]
+ * - 0.3: Added MSSMUXsetupChan() and MSSMUXreadChan()<br>
+ *        Added a scan scheduler task that cycles through the subscribed channels in the background,
+ *        see MSSMUXsubscribe() (__MSSMUX_SCHEDULER__)
+ * - 0.4: MSSMUXsetChan() and MSSMUXreadBattery() refuse to touch a port the scan scheduler is using<br>
+ *        MSSMUXsetChan() now returns a bool<br>
+ *        The scan scheduler is now opt-in, define __MSSMUX_SCHEDULER__ as 1 to use it<br>
+ *        MSSMUXreadBattery() returns 0 on an I2C error and no longer prints to the debug stream
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,9 +32,10 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 02 March 2013
- * \version 0.1
+ * \version 0.4
  * \example mindsensors-sensormux-test1.c
  * \example mindsensors-sensormux-test2.c
+ * \example mindsensors-sensormux-test3.c
  */
 
 #pragma systemFile
@@ -35,49 +44,62 @@
 #include "common.h"
 #endif
 
+/*!< define this as 1 to add the scan scheduler task */
+#ifndef __MSSMUX_SCHEDULER__
+#define __MSSMUX_SCHEDULER__ 0
+#endif
+
 #define MSMX_I2C_ADDR     0x24
 #define MSMX_REG_CHANSEL  0x42
 #define MSMX_REG_VOLTAGE  0x43
 
-tByteArray MSMX_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray MSMX_I2CReply;      /*!< Array to hold I2C reply data */
+#define MSSMUX_SETTLE_TIME    5     /*!< Time a sensor needs after the port has been set up for it, in ms */
+#define MSSMUX_HOLD_INTERVAL  5     /*!< Time between two samples when only one channel is subscribed, in ms */
+#define MSSMUX_WAIT_TIMEOUT   500   /*!< Time MSSMUXreadChan() waits for the first value of a channel, in ms */
 
-void MSSMUXsetChan(tSensors link, short channel);
-short MSSMUXreadBattery(tSensors link);
+tI2CData MSMX_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
-/**
- * Read the voltage level of the external battery.
- * @param link the port number
- * @return the battery voltage in mV
- */
-short MSSMUXreadBattery(tSensors link)
+TSensorTypes MSSMUXSensorTypes[4][4];   /*!< Sensor type of each channel, see MSSMUXsetupChan() */
+TSensorModes MSSMUXSensorModes[4][4];   /*!< Sensor mode of each channel */
+ubyte MSSMUXSensorDelays[4][4];         /*!< Additional settle time of each channel, in 10ms units */
+
+#if (__MSSMUX_SCHEDULER__ == 1)
+/*!< Latest value of a channel, as sampled by the scan scheduler */
+typedef struct
 {
-  // Switch to the virtual channel (0)
-  MSSMUXsetChan(link, 0);
-  sleep(50);
+  short value;                /*!< Value of the sensor */
+  long timestamp;             /*!< Time the value was sampled, in ms */
+  long count;                 /*!< Number of times the channel has been sampled since it was subscribed */
+} tMSSMUXSample;
 
-  SensorType[link] = sensorI2CCustomFastSkipStates;
-  memset(MSMX_I2CRequest, 0, sizeof(tByteArray));
+tMSSMUXSample MSSMUXsamples[4][4];    /*!< Latest value of each channel */
+ubyte MSSMUXsubscribed[4];            /*!< Bitmask of the subscribed channels of each port */
+short MSSMUXcurrChan[4];              /*!< Channel the SMUX is switched to, 0 if unknown */
+long MSSMUXreadyTime[4];              /*!< Time the sensor on the current channel has settled, in ms */
+long MSSMUXcycleStart[4];             /*!< Time the current cycle through the channels started, in ms */
+long MSSMUXcycleTime[4];              /*!< Time the last cycle through the channels took, in ms */
+bool MSSMUXschedulerRunning = false;  /*!< The scheduler task is running */
+#endif // __MSSMUX_SCHEDULER__
 
-  MSMX_I2CRequest[0] = 2;                      // Message size
-  MSMX_I2CRequest[1] = MSMX_I2C_ADDR;         // I2C Address
-  MSMX_I2CRequest[2] = MSMX_REG_VOLTAGE;
+bool MSSMUXsetChan(tSensors link, short channel);
+short MSSMUXreadBattery(tSensors link);
+void MSSMUXsetupChan(tSensors link, short channel, TSensorTypes chantype, TSensorModes chanmode, ubyte delay);
+short MSSMUXreadChan(tSensors link, short channel);
 
-  if (!writeI2C(link, MSMX_I2CRequest, MSMX_I2CReply, 1))
-  {
-    writeDebugStreamLine("error with i2c");
-    return false;
-  }
-
-  return (0x00FF & MSMX_I2CReply[0]) * 37;
-}
+#if (__MSSMUX_SCHEDULER__ == 1)
+void MSSMUXsubscribe(tSensors link, short channel);
+void MSSMUXunsubscribe(tSensors link, short channel);
+bool MSSMUXreadCached(tSensors link, short channel, short &value, long &timestamp);
+#endif // __MSSMUX_SCHEDULER__
 
 /**
- * Switch to the specified channel
+ * Switch to the specified channel.
+ *
+ * Note: this is an internal function and should not be called directly.
  * @param link the port number
  * @param channel the sensor mux channel number
  */
-void MSSMUXsetChan(tSensors link, short channel)
+void _MSSMUXsetChan(tSensors link, short channel)
 {
   static short currChannel[4] = {-1, -1, -1, -1};
 
@@ -91,7 +113,6 @@ void MSSMUXsetChan(tSensors link, short channel)
   currChannel[link] = channel;
 
   TSensorTypes previous = SensorType[link];
-  writeDebugStreamLine("channel type: %d", previous);
 
   // Set the sensor type to sensorCustom so we can
   // start sending messages
@@ -129,6 +150,296 @@ void MSSMUXsetChan(tSensors link, short channel)
   }
 }
 
+/**
+ * Read the voltage level of the external battery.  This can't be done while
+ * the scan scheduler has channels subscribed on the port.
+ * @param link the port number
+ * @return the battery voltage in mV, 0 if an error occured or the port is in use by the scan scheduler
+ */
+short MSSMUXreadBattery(tSensors link)
+{
+  // Switch to the virtual channel (0)
+  if (!MSSMUXsetChan(link, 0))
+    return 0;
+  sleep(50);
+
+  SensorType[link] = sensorI2CCustomFastSkipStates;
+  memset(MSMX_I2CData[link].request, 0, sizeof(MSMX_I2CData[link].request));
+
+  MSMX_I2CData[link].request[0] = 2;                      // Message size
+  MSMX_I2CData[link].request[1] = MSMX_I2C_ADDR;         // I2C Address
+  MSMX_I2CData[link].request[2] = MSMX_REG_VOLTAGE;
+
+  if (!writeI2C(link, MSMX_I2CData[link].request, MSMX_I2CData[link].reply, 1))
+    return 0;
+
+  return (0x00FF & MSMX_I2CData[link].reply[0]) * 37;
+}
+
+/**
+ * Switch to the specified channel.  This can't be done while the scan
+ * scheduler has channels subscribed on the port, it switches the channels itself.
+ * @param link the port number
+ * @param channel the sensor mux channel number
+ * @return true if the SMUX was switched, false if the port is in use by the scan scheduler
+ */
+bool MSSMUXsetChan(tSensors link, short channel)
+{
+#if (__MSSMUX_SCHEDULER__ == 1)
+  if (MSSMUXsubscribed[link] != 0)
+    return false;
+#endif // __MSSMUX_SCHEDULER__
+
+  _MSSMUXsetChan(link, channel);
+  return true;
+}
+
+/**
+ * Set up a channel for the sensor attached to it.  This is only needed for
+ * MSSMUXreadChan() and the scan scheduler.
+ * @param link the port number
+ * @param channel the sensor mux channel number, 1-4
+ * @param chantype the sensor type connected to the channel
+ * @param chanmode the sensor mode of the sensor
+ * @param delay additional settle time after switching to the channel, in 10ms units
+ */
+void MSSMUXsetupChan(tSensors link, short channel, TSensorTypes chantype, TSensorModes chanmode, ubyte delay)
+{
+  if (channel < 1 || channel > 4)
+    return;
+
+  MSSMUXSensorTypes[link][channel-1] = chantype;
+  MSSMUXSensorModes[link][channel-1] = chanmode;
+  MSSMUXSensorDelays[link][channel-1] = delay;
+}
+
+/**
+ * Set the port up for the sensor on a channel.  The SMUX must have been
+ * switched to the channel.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the port number
+ * @param channel the sensor mux channel number, 1-4
+ * @return the time the sensor needs to settle, in ms
+ */
+short _MSSMUXconfigChan(tSensors link, short channel)
+{
+  SensorType[link] = MSSMUXSensorTypes[link][channel-1];
+  SensorMode[link] = MSSMUXSensorModes[link][channel-1];
+  return MSSMUX_SETTLE_TIME + (MSSMUXSensorDelays[link][channel-1] * 10);
+}
+
+/**
+ * Read the value of the sensor attached to a channel that was set up with
+ * MSSMUXsetupChan().  This switches the SMUX to the channel and waits for the
+ * sensor to settle.\n
+ * If the scan scheduler is running for the port, the latest value it sampled
+ * is returned instead.  A channel that was not subscribed yet is subscribed
+ * and its first value waited for.
+ * @param link the port number
+ * @param channel the sensor mux channel number, 1-4
+ * @return the value of the sensor, -1 if an error occured
+ */
+short MSSMUXreadChan(tSensors link, short channel)
+{
+#if (__MSSMUX_SCHEDULER__ == 1)
+  short value;
+  long timestamp;
+  long start = nPgmTime;
+#endif // __MSSMUX_SCHEDULER__
+
+  if (channel < 1 || channel > 4)
+    return -1;
+
+#if (__MSSMUX_SCHEDULER__ == 1)
+  // The scheduler owns the port while it has channels subscribed on it
+  if (MSSMUXsubscribed[link] != 0) {
+    if ((MSSMUXsubscribed[link] & (1 << (channel - 1))) == 0)
+      MSSMUXsubscribe(link, channel);
+
+    while (!MSSMUXreadCached(link, channel, value, timestamp)) {
+      if (nPgmTime - start > MSSMUX_WAIT_TIMEOUT)
+        return -1;
+      sleep(1);
+    }
+    return value;
+  }
+#endif // __MSSMUX_SCHEDULER__
+
+  _MSSMUXsetChan(link, channel);
+  sleep(_MSSMUXconfigChan(link, channel));
+  return SensorValue[link];
+}
+
+#if (__MSSMUX_SCHEDULER__ == 1)
+/**
+ * Find the next subscribed channel after the current one, wrapping around.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param subscribed bitmask of the subscribed channels
+ * @param channel the current channel, 0 if none
+ * @return the next subscribed channel, 1-4
+ */
+short _MSSMUXnextChan(ubyte subscribed, short channel)
+{
+  short next = channel;
+
+  for (short i = 0; i < 4; i++)
+  {
+    next = (next % 4) + 1;
+    if ((subscribed & (1 << (next - 1))) != 0)
+      return next;
+  }
+  return channel;
+}
+
+/**
+ * Cycle through the subscribed channels of every port and publish the values.
+ * While the sensor on one port is settling after a channel switch, the other
+ * ports are sampled.  When a port has only a single channel subscribed, the
+ * SMUX is left on that channel and it is sampled every MSSMUX_HOLD_INTERVAL ms.
+ * The task ends by itself when nothing is subscribed.
+ */
+task MSSMUXscheduler()
+{
+  bool enabled = true;
+  long wake;
+  ubyte subscribed;
+  short channel;
+  short next;
+  short value;
+
+  while (enabled)
+  {
+    enabled = false;
+    wake = nPgmTime + MSSMUX_HOLD_INTERVAL;
+
+    for (short link = 0; link < 4; link++)
+    {
+      subscribed = MSSMUXsubscribed[link];
+      if (subscribed == 0)
+      {
+        MSSMUXcurrChan[link] = 0;
+        continue;
+      }
+      enabled = true;
+
+      // Sample the current channel once the sensor has settled
+      channel = MSSMUXcurrChan[link];
+      if (channel != 0 && (subscribed & (1 << (channel - 1))) != 0)
+      {
+        if (nPgmTime < MSSMUXreadyTime[link])
+        {
+          wake = min2(wake, MSSMUXreadyTime[link]);
+          continue;
+        }
+
+        value = SensorValue[link];
+
+        hogCPU();
+        MSSMUXsamples[link][channel-1].value = value;
+        MSSMUXsamples[link][channel-1].timestamp = nPgmTime;
+        MSSMUXsamples[link][channel-1].count++;
+        releaseCPU();
+      }
+
+      // Stay on the channel if it's the only one
+      next = _MSSMUXnextChan(subscribed, channel);
+      if (next == channel)
+      {
+        MSSMUXreadyTime[link] = nPgmTime + MSSMUX_HOLD_INTERVAL;
+        MSSMUXcycleTime[link] = MSSMUX_HOLD_INTERVAL;
+        continue;
+      }
+
+      // Wrapping around to the first channel completes a cycle
+      if (next <= channel)
+      {
+        MSSMUXcycleTime[link] = nPgmTime - MSSMUXcycleStart[link];
+        MSSMUXcycleStart[link] = nPgmTime;
+      }
+
+      _MSSMUXsetChan((tSensors)link, next);
+      MSSMUXcurrChan[link] = next;
+      MSSMUXreadyTime[link] = nPgmTime + _MSSMUXconfigChan((tSensors)link, next);
+      wake = min2(wake, MSSMUXreadyTime[link]);
+    }
+
+    // MSSMUXsubscribe() must not see the task running after it decided to stop
+    hogCPU();
+    if (!enabled)
+      MSSMUXschedulerRunning = false;
+    releaseCPU();
+
+    if (enabled && wake > nPgmTime)
+      sleep(wake - nPgmTime);
+  }
+}
+
+/**
+ * Add a channel to the ones the scan scheduler cycles through.  The scheduler
+ * task is started if it isn't running yet.  Set the channel up with
+ * MSSMUXsetupChan() first.
+ * @param link the port number
+ * @param channel the sensor mux channel number, 1-4
+ */
+void MSSMUXsubscribe(tSensors link, short channel)
+{
+  if (channel < 1 || channel > 4)
+    return;
+
+  hogCPU();
+  MSSMUXsamples[link][channel-1].count = 0;
+  MSSMUXsubscribed[link] |= (1 << (channel - 1));
+  if (!MSSMUXschedulerRunning)
+  {
+    MSSMUXschedulerRunning = true;
+    startTask(MSSMUXscheduler);
+  }
+  releaseCPU();
+}
+
+/**
+ * Remove a channel from the ones the scan scheduler cycles through.  The
+ * scheduler task ends by itself when no channels are subscribed.
+ * @param link the port number
+ * @param channel the sensor mux channel number, 1-4
+ */
+void MSSMUXunsubscribe(tSensors link, short channel)
+{
+  if (channel < 1 || channel > 4)
+    return;
+
+  hogCPU();
+  MSSMUXsubscribed[link] &= ~(1 << (channel - 1));
+  releaseCPU();
+}
+
+/**
+ * Get the latest value the scan scheduler sampled for a channel.
+ * @param link the port number
+ * @param channel the sensor mux channel number, 1-4
+ * @param value the latest value of the sensor
+ * @param timestamp the time the value was sampled, in ms
+ * @return true if there was a value, false if the channel hasn't been sampled yet
+ */
+bool MSSMUXreadCached(tSensors link, short channel, short &value, long &timestamp)
+{
+  bool valid;
+
+  if (channel < 1 || channel > 4)
+    return false;
+
+  hogCPU();
+  value = MSSMUXsamples[link][channel-1].value;
+  timestamp = MSSMUXsamples[link][channel-1].timestamp;
+  valid = (MSSMUXsamples[link][channel-1].count != 0);
+  releaseCPU();
+
+  return valid;
+}
+#endif // __MSSMUX_SCHEDULER__
+
 #endif // __MSSMUX_H__
 
 /* @} */
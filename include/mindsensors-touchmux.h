@@ -15,6 +15,10 @@
  * Changelog:
  * - 0.1: Initial release
  * - 0.2: Added support for HiTechnic Sensor MUX
+ * - 0.3: Added a background sampler that debounces the switches and queues press and release
+ *        events, see MSTMUXstartSampler() (__MSTMUX_SAMPLER__)
+ * - 0.4: The sampler is now opt-in, define __MSTMUX_SAMPLER__ as 1 to use it<br>
+ *        The debouncing and event queue are shared with the HiTechnic Touch MUX, see touch-events.h
  *
  * Credits:
  * - Big thanks to HiTechnic and Mindsensors for providing me with the hardware necessary to write and test this.
@@ -25,8 +29,9 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 24 March 2009
- * \version 0.2
+ * \version 0.4
  * \example mindsensors-touchmux-test1.c
+ * \example mindsensors-touchmux-test2.c
  */
 
 #pragma systemFile
@@ -35,6 +40,17 @@
 #include "common.h"
 #endif
 
+/*!< define this as 1 to add the sampler task */
+#ifndef __MSTMUX_SAMPLER__
+#define __MSTMUX_SAMPLER__ 0
+#endif
+
+#if (__MSTMUX_SAMPLER__ == 1) && !defined(__TOUCH_EVENTS_H__)
+#include "touch-events.h"
+#endif
+
+#define MSTMUX_SAMPLE_INTERVAL    5   /*!< Time between two samples of the sampler, in ms */
+
 // Sensor values for each combo of buttons pressed
 #define MSTMUX_LOW_1     60
 #define MSTMUX_HIGH_1   160
@@ -66,6 +82,18 @@
 #define MSTMUX_SMUX_LOW_123  603
 #define MSTMUX_SMUX_HIGH_123 643
 
+#if (__MSTMUX_SAMPLER__ == 1)
+typedef tTouchEvent tMSTMUXEvent;             /*!< A switch being pressed or released, see touch-events.h */
+
+tTouchEvents MSTMUXsamplers[4];               /*!< Sampler state and event queue of each port */
+bool MSTMUXsamplerRunning = false;            /*!< The sampler task is running */
+
+void MSTMUXstartSampler(tSensors link);
+void MSTMUXstopSampler(tSensors link);
+bool MSTMUXreadEvent(tSensors link, tMSTMUXEvent &event);
+void MSTMUXflushEvents(tSensors link);
+#endif // __MSTMUX_SAMPLER__
+
 short MSTMUXgetActive(tSensors link);
 bool MSTMUXisActive(tSensors link, short touch);
 
@@ -75,23 +103,13 @@ bool MSTMUXisActive(tMUXSensor muxsensor, short touch);
 #endif
 
 /**
- * Read the value of all of the currently connected touch sensors.  The status is logically OR'd
- * together. Touch 1 = 1, Touch 2 = 2, Touch 3 = 4, Touch 4 = 8.  If Touch 1 and 3 are active,
- * the return value will be 1 + 4 == 5.
- * @param link the MSTMUX port number
+ * Turn a raw sensor value into the status of the switches.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param s the raw value of the sensor
  * @return the value of the switches status
  */
-short MSTMUXgetActive(tSensors link) {
-
-  // Make sure the sensor is configured as type sensorLightInactive
-  if (SensorType[link] != sensorLightInactive) {
-    SensorType[link] = sensorLightInactive;
-    sleep(10);
-  }
-
-  short s;
-  s = SensorRaw[link];
-
+short _MSTMUXdecode(short s) {
   if ( MSTMUX_LOW_1 < s && s < MSTMUX_HIGH_1 ) {
     return 1;
   } else if ( MSTMUX_LOW_2 < s && s < MSTMUX_HIGH_2 ) {
@@ -111,6 +129,37 @@ short MSTMUXgetActive(tSensors link) {
   }
 }
 
+/**
+ * Make sure the sensor is configured as type sensorLightInactive.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param link the MSTMUX port number
+ */
+void _MSTMUXcheckType(tSensors link) {
+  if (SensorType[link] != sensorLightInactive) {
+    SensorType[link] = sensorLightInactive;
+    sleep(10);
+  }
+}
+
+/**
+ * Read the value of all of the currently connected touch sensors.  The status is logically OR'd
+ * together. Touch 1 = 1, Touch 2 = 2, Touch 3 = 4, Touch 4 = 8.  If Touch 1 and 3 are active,
+ * the return value will be 1 + 4 == 5.\n
+ * If the sampler is running for the port, its debounced status is returned.
+ * @param link the MSTMUX port number
+ * @return the value of the switches status
+ */
+short MSTMUXgetActive(tSensors link) {
+#if (__MSTMUX_SAMPLER__ == 1)
+  if (MSTMUXsamplers[link].enabled)
+    return MSTMUXsamplers[link].state;
+#endif // __MSTMUX_SAMPLER__
+
+  _MSTMUXcheckType(link);
+  return _MSTMUXdecode(SensorRaw[link]);
+}
+
 /**
  * Read the value of all of the currently connected touch sensors.  The status is logically OR'd
  * together. Touch 1 = 1, Touch 2 = 2, Touch 3 = 4, Touch 4 = 8.  If Touch 1 and 3 are active,
@@ -172,6 +221,82 @@ bool MSTMUXisActive(tMUXSensor muxsensor, short touch) {
 }
 #endif // __HTSMUX_SUPPORT__
 
+#if (__MSTMUX_SAMPLER__ == 1)
+/**
+ * Sample the switches of every port that has the sampler enabled and pass
+ * them to TOUCHEVTupdate() to be debounced and queued.  The task ends by
+ * itself when no port has the sampler enabled.
+ */
+task MSTMUXsampler() {
+  bool enabled = true;
+
+  while (enabled) {
+    enabled = false;
+    for (short link = 0; link < 4; link++) {
+      if (!MSTMUXsamplers[link].enabled)
+        continue;
+      enabled = true;
+      TOUCHEVTupdate(&MSTMUXsamplers[link], _MSTMUXdecode(SensorRaw[link]), nPgmTime);
+    }
+
+    // MSTMUXstartSampler() must not see the task running after it decided to stop
+    hogCPU();
+    if (!enabled)
+      MSTMUXsamplerRunning = false;
+    releaseCPU();
+
+    if (enabled)
+      sleep(MSTMUX_SAMPLE_INTERVAL);
+  }
+}
+
+/**
+ * Start sampling the switches in the background.  Presses and releases are
+ * queued as events, read them with MSTMUXreadEvent().  MSTMUXgetActive() and
+ * MSTMUXisActive() return the debounced status without reading the sensor.
+ * @param link the MSTMUX port number
+ */
+void MSTMUXstartSampler(tSensors link) {
+  _MSTMUXcheckType(link);
+
+  hogCPU();
+  TOUCHEVTinit(&MSTMUXsamplers[link], _MSTMUXdecode(SensorRaw[link]));
+  MSTMUXsamplers[link].enabled = true;
+  if (!MSTMUXsamplerRunning) {
+    MSTMUXsamplerRunning = true;
+    startTask(MSTMUXsampler);
+  }
+  releaseCPU();
+}
+
+/**
+ * Stop sampling the switches of a port.  The sampler task ends by itself
+ * when no other port uses it.
+ * @param link the MSTMUX port number
+ */
+void MSTMUXstopSampler(tSensors link) {
+  MSTMUXsamplers[link].enabled = false;
+}
+
+/**
+ * Take the oldest event from the queue of a port.
+ * @param link the MSTMUX port number
+ * @param event the struct to copy the event into
+ * @return true if there was an event, false if the queue was empty
+ */
+bool MSTMUXreadEvent(tSensors link, tMSTMUXEvent &event) {
+  return TOUCHEVTread(&MSTMUXsamplers[link], event);
+}
+
+/**
+ * Throw away all the events in the queue of a port.
+ * @param link the MSTMUX port number
+ */
+void MSTMUXflushEvents(tSensors link) {
+  TOUCHEVTflush(&MSTMUXsamplers[link]);
+}
+#endif // __MSTMUX_SAMPLER__
+
 #endif // __MSTMUX_HIGH___
 
 /* @} */
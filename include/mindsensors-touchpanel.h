@@ -15,6 +15,7 @@
  *
  * Changelog:
  *  - 0.1 Initial  release.
+ *  - 0.2 Request and reply buffers are now kept per port in MSTP_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -25,7 +26,7 @@
 
  * \author Xander Soldaat
  * \date 30 November 2011
- * \version 0.1
+ * \version 0.2
  * \example mindsensors-touchpanel-test1.c
  */
 
@@ -68,8 +69,7 @@
 
 // typedef ubyte tHugeArray[220];
 
-tByteArray MSTP_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray MSTP_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData MSTP_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 // tHugeArray MSTP_GestureData;
 
 #define isButtonTouched(X, Y) (X >> Y) & 0x01         /*!< Check if the specified button is pressed */
@@ -100,18 +100,18 @@ bool MSTPsendCmd(tSensors link, ubyte cmd, ubyte addr = MSTP_I2C_ADDR);
  * @return true if no error has occured, false if it did
  */
 bool MSTPgetTouch(tSensors link, short &x, short &y, ubyte &buttons, ubyte addr) {
-  memset(MSTP_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSTP_I2CData[link].request, 0, sizeof(MSTP_I2CData[link].request));
 
-  MSTP_I2CRequest[0] = 2;                      // Message size
-  MSTP_I2CRequest[1] = addr;         // I2C Address
-  MSTP_I2CRequest[2] = MSTP_REG_TOUCH_X;
+  MSTP_I2CData[link].request[0] = 2;                      // Message size
+  MSTP_I2CData[link].request[1] = addr;         // I2C Address
+  MSTP_I2CData[link].request[2] = MSTP_REG_TOUCH_X;
 
-  if (!writeI2C(link, MSTP_I2CRequest, MSTP_I2CReply, 3))
+  if (!writeI2C(link, MSTP_I2CData[link].request, MSTP_I2CData[link].reply, 3))
     return false;
 
-  x = MSTP_I2CReply[0];
-  y = MSTP_I2CReply[1];
-  buttons = MSTP_I2CReply[2];
+  x = MSTP_I2CData[link].reply[0];
+  y = MSTP_I2CData[link].reply[1];
+  buttons = MSTP_I2CData[link].reply[2];
 
   return true;
 }
@@ -125,32 +125,32 @@ bool MSTPgetTouch(tSensors link, short &x, short &y, ubyte &buttons, ubyte addr)
  */
 bool MSTPsendCmd(tSensors link, ubyte cmd, ubyte addr)
 {
-  memset(MSTP_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSTP_I2CData[link].request, 0, sizeof(MSTP_I2CData[link].request));
 
-  MSTP_I2CRequest[0] = 3;                      // Message size
-  MSTP_I2CRequest[1] = MSTP_I2C_ADDR;         // I2C Address
-  MSTP_I2CRequest[2] = 0x41;         //
-  MSTP_I2CRequest[3] = cmd;
+  MSTP_I2CData[link].request[0] = 3;                      // Message size
+  MSTP_I2CData[link].request[1] = MSTP_I2C_ADDR;         // I2C Address
+  MSTP_I2CData[link].request[2] = 0x41;         //
+  MSTP_I2CData[link].request[3] = cmd;
 
-  return writeI2C(link, MSTP_I2CRequest);
+  return writeI2C(link, MSTP_I2CData[link].request);
 }
 
 /*
 short MSTPgetGesture(tSensors link)
 {
-  memset(MSTP_I2CRequest, 0, sizeof(tByteArray));
+  memset(MSTP_I2CData[link].request, 0, sizeof(MSTP_I2CData[link].request));
 
-  MSTP_I2CRequest[0] = 2;                      // Message size
-  MSTP_I2CRequest[1] = addr;         // I2C Address
-  MSTP_I2CRequest[2] = MSTP_REG_G_AVAIL;
+  MSTP_I2CData[link].request[0] = 2;                      // Message size
+  MSTP_I2CData[link].request[1] = addr;         // I2C Address
+  MSTP_I2CData[link].request[2] = MSTP_REG_G_AVAIL;
 
-  if (!writeI2C(link, MSTP_I2CRequest, 1))
+  if (!writeI2C(link, MSTP_I2CData[link].request, 1))
     return false;
 
-  if (!readI2C(link, MSTP_I2CReply, 1))
+  if (!readI2C(link, MSTP_I2CData[link].reply, 1))
     return false;
 
-  if (MSTP_I2CReply[0] == 0)
+  if (MSTP_I2CData[link].reply[0] == 0)
     return 0;
 
 }
@@ -14,6 +14,7 @@
  *
  * Changelog:
  * - 0.1: Initial release
+ * - 0.2: Request and reply buffers are now kept per port in PCF8574_I2CData[]
  *
  * Credits:
  * - Big thanks to Mindsensors for providing me with the hardware necessary to write and test this.
@@ -24,7 +25,7 @@
 
  * \author Xander Soldaat (xander_at_botbench.com)
  * \date 30 March 2010
- * \version 0.1
+ * \version 0.2
  * \example philips-pcf8574-test1.c
  */
 
@@ -36,8 +37,7 @@
 
 #define PCF8574_I2C_ADDR         0x70  /*!< HDMMUX I2C device address */
 
-tByteArray PCF8574_I2CRequest;    /*!< Array to hold I2C command data */
-tByteArray PCF8574_I2CReply;      /*!< Array to hold I2C reply data */
+tI2CData PCF8574_I2CData[4];      /*!< Per-port I2C request and reply buffers */
 
 // Function prototypes
 bool PCF8574sendBytes(tSensors link, ubyte _byte);
@@ -51,13 +51,13 @@ bool PCF8574readBytes(tSensors link, ubyte &_byte);
  * @return true if no error occured, false if it did
  */
 bool PCF8574sendBytes(tSensors link, ubyte _byte) {
-  memset(PCF8574_I2CRequest, 0, sizeof(tByteArray));
+  memset(PCF8574_I2CData[link].request, 0, sizeof(PCF8574_I2CData[link].request));
 
-  PCF8574_I2CRequest[0] = 2;               // Message size
-  PCF8574_I2CRequest[1] = PCF8574_I2C_ADDR; // I2C Address
-  PCF8574_I2CRequest[2] = _byte;
+  PCF8574_I2CData[link].request[0] = 2;               // Message size
+  PCF8574_I2CData[link].request[1] = PCF8574_I2C_ADDR; // I2C Address
+  PCF8574_I2CData[link].request[2] = _byte;
 
-  return writeI2C(link, PCF8574_I2CRequest);
+  return writeI2C(link, PCF8574_I2CData[link].request);
 }
 
 /**
@@ -68,16 +68,16 @@ bool PCF8574sendBytes(tSensors link, ubyte _byte) {
  * @return true if no error occured, false if it did
  */
 bool PCF8574readBytes(tSensors link, ubyte &_byte) {
-  memset(PCF8574_I2CRequest, 0, sizeof(tByteArray));
+  memset(PCF8574_I2CData[link].request, 0, sizeof(PCF8574_I2CData[link].request));
 
-  PCF8574_I2CRequest[0] = 1;               // Message size
-  PCF8574_I2CRequest[1] = PCF8574_I2C_ADDR; // I2C Address
-  PCF8574_I2CRequest[2] = _byte;
+  PCF8574_I2CData[link].request[0] = 1;               // Message size
+  PCF8574_I2CData[link].request[1] = PCF8574_I2C_ADDR; // I2C Address
+  PCF8574_I2CData[link].request[2] = _byte;
 
-  if (!writeI2C(link, PCF8574_I2CRequest, PCF8574_I2CReply, 1))
+  if (!writeI2C(link, PCF8574_I2CData[link].request, PCF8574_I2CData[link].reply, 1))
     return false;
 
-  _byte = PCF8574_I2CReply[0];
+  _byte = PCF8574_I2CData[link].reply[0];
 
   return true;
 
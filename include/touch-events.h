@@ -0,0 +1,190 @@
+/*!@addtogroup other
+ * @{
+ * @defgroup touchevents Touch Event Queue Library
+ * Touch Event Queue Library
+ * @{
+ */
+
+#ifndef __TOUCH_EVENTS_H__
+#define __TOUCH_EVENTS_H__
+/** \file touch-events.h
+ * \brief Debounced switch events for ROBOTC.
+ *
+ * touch-events.h debounces the status of up to four switches and keeps the
+ * presses and releases in a small queue.  It is shared by the samplers of the
+ * touch sensor MUX drivers, which read and decode their sensor and pass the
+ * status to TOUCHEVTupdate().  A new status is only accepted after it has been
+ * seen TOUCHEVT_DEBOUNCE_SAMPLES times in a row, then an event is queued for
+ * every switch that changed.  When the queue is full, the oldest event is
+ * dropped and counted as lost.
+ *
+ * License: You may use this code as you wish, provided you give credit where its due.
+ * THIS CODE WILL ONLY WORK WITH ROBOTC VERSION 4.10 AND HIGHER
+
+ *
+ * Changelog:
+ * - 0.1: Initial release, split off from mindsensors-touchmux.h and hitechnic-touchmux.h
+ *
+ * \author Xander Soldaat (xander_at_botbench.com)
+ * \date 17 October 2026
+ * \version 0.1
+ */
+
+#pragma systemFile
+
+#ifndef __COMMON_H__
+#include "common.h"
+#endif
+
+#define TOUCHEVT_DEBOUNCE_SAMPLES   3   /*!< Number of identical samples before a change is accepted */
+
+#ifndef TOUCHEVT_QUEUE_SIZE
+#define TOUCHEVT_QUEUE_SIZE         16  /*!< Number of events a queue can hold, can be overridden in your own program */
+#endif
+
+/*!< A switch being pressed or released */
+typedef struct
+{
+  long timestamp;           /*!< Time the change was first seen, in ms */
+  ubyte touch;              /*!< The touch sensor, numbered 1 to 4 */
+  bool pressed;             /*!< true if it was pressed, false if it was released */
+} tTouchEvent;
+
+/*!< Debounce state and event queue of a set of switches */
+typedef struct
+{
+  bool enabled;                               /*!< The switches are being sampled */
+  ubyte state;                                /*!< Debounced state of the switches */
+  ubyte candidate;                            /*!< State that is being debounced */
+  short candidateCount;                       /*!< Number of samples the candidate has been seen */
+  long candidateTime;                         /*!< Time the candidate was first seen, in ms */
+  tTouchEvent events[TOUCHEVT_QUEUE_SIZE];    /*!< Ring buffer holding the events */
+  short head;                                 /*!< Oldest event in the queue */
+  short count;                                /*!< Number of events in the queue */
+  long lost;                                  /*!< Number of events dropped because the queue was full */
+} tTouchEvents, *tTouchEventsPtr;
+
+void TOUCHEVTinit(tTouchEventsPtr eventsPtr, ubyte state);
+void TOUCHEVTupdate(tTouchEventsPtr eventsPtr, ubyte sample, long timestamp);
+bool TOUCHEVTread(tTouchEventsPtr eventsPtr, tTouchEvent &event);
+void TOUCHEVTflush(tTouchEventsPtr eventsPtr);
+
+/**
+ * Start debouncing from a known status with an empty queue.  The caller has to
+ * make sure the sampler isn't updating the struct at the same time.
+ * @param eventsPtr pointer to the event queue
+ * @param state the current status of the switches, one bit per switch
+ */
+void TOUCHEVTinit(tTouchEventsPtr eventsPtr, ubyte state)
+{
+  eventsPtr->state = state;
+  eventsPtr->candidateCount = 0;
+  eventsPtr->head = 0;
+  eventsPtr->count = 0;
+  eventsPtr->lost = 0;
+}
+
+/**
+ * Add an event to the queue.  When the queue is full, the oldest event is dropped.
+ *
+ * Note: this is an internal function and should not be called directly.
+ * @param eventsPtr pointer to the event queue
+ * @param touch the touch sensor, numbered 1 to 4
+ * @param pressed true if it was pressed, false if it was released
+ * @param timestamp the time the change was first seen, in ms
+ */
+void _TOUCHEVTpush(tTouchEventsPtr eventsPtr, ubyte touch, bool pressed, long timestamp)
+{
+  short idx;
+
+  hogCPU();
+  if (eventsPtr->count == TOUCHEVT_QUEUE_SIZE)
+  {
+    eventsPtr->head = (eventsPtr->head + 1) % TOUCHEVT_QUEUE_SIZE;
+    eventsPtr->count--;
+    eventsPtr->lost++;
+  }
+  idx = (eventsPtr->head + eventsPtr->count) % TOUCHEVT_QUEUE_SIZE;
+  eventsPtr->events[idx].timestamp = timestamp;
+  eventsPtr->events[idx].touch = touch;
+  eventsPtr->events[idx].pressed = pressed;
+  eventsPtr->count++;
+  releaseCPU();
+}
+
+/**
+ * Debounce a new sample of the switches and queue an event for every switch
+ * whose change has been seen TOUCHEVT_DEBOUNCE_SAMPLES times in a row.
+ * @param eventsPtr pointer to the event queue
+ * @param sample the status of the switches, one bit per switch
+ * @param timestamp the time the sample was taken, in ms
+ */
+void TOUCHEVTupdate(tTouchEventsPtr eventsPtr, ubyte sample, long timestamp)
+{
+  ubyte changed;
+
+  if (sample == eventsPtr->state)
+  {
+    eventsPtr->candidateCount = 0;
+    return;
+  }
+
+  if (eventsPtr->candidateCount == 0 || sample != eventsPtr->candidate)
+  {
+    eventsPtr->candidate = sample;
+    eventsPtr->candidateCount = 0;
+    eventsPtr->candidateTime = timestamp;
+  }
+
+  if (++eventsPtr->candidateCount < TOUCHEVT_DEBOUNCE_SAMPLES)
+    return;
+
+  changed = sample ^ eventsPtr->state;
+  eventsPtr->state = sample;
+  eventsPtr->candidateCount = 0;
+  for (short i = 0; i < 4; i++)
+  {
+    if ((changed & (1 << i)) != 0)
+      _TOUCHEVTpush(eventsPtr, i + 1, (sample & (1 << i)) != 0, eventsPtr->candidateTime);
+  }
+}
+
+/**
+ * Take the oldest event from the queue.
+ * @param eventsPtr pointer to the event queue
+ * @param event the struct to copy the event into
+ * @return true if there was an event, false if the queue was empty
+ */
+bool TOUCHEVTread(tTouchEventsPtr eventsPtr, tTouchEvent &event)
+{
+  bool found = false;
+
+  hogCPU();
+  if (eventsPtr->count > 0)
+  {
+    memcpy(event, eventsPtr->events[eventsPtr->head], sizeof(tTouchEvent));
+    eventsPtr->head = (eventsPtr->head + 1) % TOUCHEVT_QUEUE_SIZE;
+    eventsPtr->count--;
+    found = true;
+  }
+  releaseCPU();
+
+  return found;
+}
+
+/**
+ * Throw away all the events in the queue.
+ * @param eventsPtr pointer to the event queue
+ */
+void TOUCHEVTflush(tTouchEventsPtr eventsPtr)
+{
+  hogCPU();
+  eventsPtr->head = 0;
+  eventsPtr->count = 0;
+  releaseCPU();
+}
+
+#endif // __TOUCH_EVENTS_H__
+
+/* @} */
+/* @} */
@@ -0,0 +1,59 @@
+#!/bin/sh
+#
+# Build a ROBOTC program for the host-side emulation in host/
+#
+# Usage: host-build.sh program.c [output] [extra g++ flags]
+#
+# The program's "#pragma config(Sensor, ...)" and "#pragma config(Motor, ...)"
+# lines are turned into -DNAME=S1 style defines, and into a robotcPragmaConfig()
+# function that sets up SensorType[] before task main starts, the same way ROBOTC
+# does.
+
+# Absolute path to this script. /home/user/bin/foo.sh
+SCRIPT=$(readlink -f $0)
+# Absolute path this script is in. /home/user/bin
+SCRIPTPATH=`dirname $SCRIPT`
+REPO=`dirname $SCRIPTPATH`
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 program.c [output] [extra g++ flags]"
+  exit 1
+fi
+
+PROGRAM=$1
+shift
+OUTPUT=`basename $PROGRAM .c`
+if [ $# -gt 0 ]; then
+  OUTPUT=$1
+  shift
+fi
+
+CXX=${CXX:-g++}
+GENDIR=`mktemp -d`
+trap 'rm -rf $GENDIR' EXIT
+
+# Sensor and motor names
+DEFINES=`tr -d '\r' < $PROGRAM | awk -F, '
+  /^#pragma config\((Sensor|Motor),/ {
+    gsub(/[ \t]/, "", $2); gsub(/[ \t]/, "", $3);
+    if ($3 != "") printf "-D%s=%s ", $3, $2
+  }'`
+
+# ROBOTC accepts "task main {" without the parentheses
+tr -d '\r' < $PROGRAM | sed 's/^\(task [A-Za-z_0-9]*\) *{/\1() {/' > $GENDIR/`basename $PROGRAM`
+
+# Sensor types
+tr -d '\r' < $PROGRAM | awk -F, '
+  BEGIN { print "void robotcPragmaConfig() {" }
+  /^#pragma config\(Sensor/ {
+    gsub(/[ \t]/, "", $2); gsub(/[ \t\)]/, "", $4);
+    printf "  SensorType[%s] = %s;\n", $2, $4
+  }
+  END { print "}" }' > $GENDIR/pragma-config.h
+
+# ROBOTC treats enums as plain integers, narrows braced initialisers silently and
+# allows text after #endif.  Only those warnings are turned off, the rest of what
+# -fpermissive lets through is still reported.
+$CXX -std=c++17 -fpermissive -Wno-enum-compare -Wno-narrowing -Wno-endif-labels -x c++ -g -O1 \
+  -include robotc.h -include $GENDIR/pragma-config.h \
+  -I`dirname $PROGRAM` -I$REPO/host -I$REPO/include $DEFINES "$@" $GENDIR/`basename $PROGRAM` -o $OUTPUT